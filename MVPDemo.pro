@@ -12,11 +12,70 @@ CONFIG-=app_bundle
 # Auto include all .cpp files in the project src directory (can specifiy individually if required)
 SOURCES+= $$PWD/src/main.cpp \
           $$PWD/src/NGLScene.cpp \
-          $$PWD/src/NGLSceneMouseControls.cpp
+          $$PWD/src/NGLSceneMouseControls.cpp \
+          $$PWD/src/BatchTransform.cpp \
+          $$PWD/src/SoftwareRenderer.cpp \
+          $$PWD/src/TransformState.cpp \
+          $$PWD/src/TextOverlay.cpp \
+          $$PWD/src/FrameTrace.cpp \
+          $$PWD/src/InstancedRenderer.cpp \
+          $$PWD/src/JobSystem.cpp \
+          $$PWD/src/FrustumCuller.cpp \
+          $$PWD/src/MappedMesh.cpp \
+          $$PWD/src/PackedMesh.cpp \
+          $$PWD/src/ShaderCache.cpp \
+          $$PWD/src/OffscreenRenderer.cpp \
+          $$PWD/src/FrameProfiler.cpp \
+          $$PWD/src/ComputeTransform.cpp \
+          $$PWD/src/TransformUBO.cpp \
+          $$PWD/src/FramePacer.cpp \
+          $$PWD/src/LatencyHistogram.cpp \
+          $$PWD/src/MeshImport.cpp \
+          $$PWD/src/MeshSimplify.cpp \
+          $$PWD/src/MeshLod.cpp \
+          $$PWD/src/InputSession.cpp \
+          $$PWD/src/MeshStreamer.cpp \
+          $$PWD/src/ShaderReloader.cpp \
+          $$PWD/src/MeshBVH.cpp \
+          $$PWD/src/ArenaAllocator.cpp \
+          $$PWD/src/BatchRenderer.cpp \
+          $$PWD/src/ResolutionScaler.cpp
 
 # same for the .h files
 HEADERS+= $$PWD/include/NGLScene.h \
-          $$PWD/include/WindowParams.h
+          $$PWD/include/WindowParams.h \
+          $$PWD/include/BatchTransform.h \
+          $$PWD/include/SoftwareRenderer.h \
+          $$PWD/include/TransformState.h \
+          $$PWD/include/TextOverlay.h \
+          $$PWD/include/FrameTrace.h \
+          $$PWD/include/SPSCRing.h \
+          $$PWD/include/TraceFormat.h \
+          $$PWD/include/InstancedRenderer.h \
+          $$PWD/include/JobSystem.h \
+          $$PWD/include/FrustumCuller.h \
+          $$PWD/include/MappedMesh.h \
+          $$PWD/include/MeshFormat.h \
+          $$PWD/include/PackedMesh.h \
+          $$PWD/include/ShaderCache.h \
+          $$PWD/include/OffscreenRenderer.h \
+          $$PWD/include/FrameProfiler.h \
+          $$PWD/include/ComputeTransform.h \
+          $$PWD/include/TransformUBO.h \
+          $$PWD/include/FramePacer.h \
+          $$PWD/include/LatencyHistogram.h \
+          $$PWD/include/InputAccumulator.h \
+          $$PWD/include/TRSCompose.h \
+          $$PWD/include/MeshImport.h \
+          $$PWD/include/MeshSimplify.h \
+          $$PWD/include/MeshLod.h \
+          $$PWD/include/InputSession.h \
+          $$PWD/include/MeshStreamer.h \
+          $$PWD/include/ShaderReloader.h \
+          $$PWD/include/MeshBVH.h \
+          $$PWD/include/ArenaAllocator.h \
+          $$PWD/include/BatchRenderer.h \
+          $$PWD/include/ResolutionScaler.h
 # and add the include dir into the search path for Qt and make
 INCLUDEPATH +=./include
 # where our exe is going to live (root of project)
@@ -26,6 +85,8 @@ OTHER_FILES+= shaders/*.glsl \
 							README.md
 # were are going to default to a console app
 CONFIG += console
+# the software renderer uses std::thread
+CONFIG += thread
 # note each command you add needs a ; as it will be run as a single line
 # first check if we are shadow building or not easiest way is to check out against current
 !equals(PWD, $${OUT_PWD}){
@@ -0,0 +1,303 @@
+/****************************************************************************
+cpu submit cost of many different meshes drawn with one multi draw indirect
+call against one draw call each, renders into an offscreen FBO so it can run
+headless, for Mesa's software GL run with
+LIBGL_ALWAYS_SOFTWARE=1 QT_QPA_PLATFORM=offscreen ./BatchBench
+from the project root (so the shaders can be found). Both ways have to give
+the same image, which has to match each mesh drawn on its own with the
+plain Phong program, and the arena allocator is checked against a simple
+occupancy map first, the run fails if any of them disagree
+usage BatchBench [frames]
+****************************************************************************/
+#include "ArenaAllocator.h"
+#include "BatchRenderer.h"
+#include "MeshImport.h"
+#include "PackedMesh.h"
+#include "ShaderCache.h"
+#include <ngl/NGLInit.h>
+#include <ngl/ShaderLib.h>
+#include <ngl/Util.h>
+#include <QGuiApplication>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace
+{
+constexpr int c_width=1024;
+constexpr int c_height=720;
+// how far a reference pixel's channels may be off, and the fraction of the image allowed past that
+constexpr int c_channelTolerance=8;
+constexpr float c_referenceFraction=0.002f;
+
+//----------------------------------------------------------------------------------------------------------------------
+// random allocations and releases, no unit may be handed out twice and once everything is
+// released the arena has to be back to one free range
+//----------------------------------------------------------------------------------------------------------------------
+bool checkAllocator()
+{
+  const size_t capacity=1<<16;
+  ArenaAllocator arena(capacity);
+  std::vector<bool> taken(capacity,false);
+  std::vector<std::pair<size_t,size_t>> live;
+  std::mt19937 gen(1234);
+  size_t overlaps=0;
+  size_t failed=0;
+  for(int i=0; i<100000; ++i)
+  {
+    if(live.empty() || gen()%2)
+    {
+      size_t size=1+gen()%1000;
+      size_t offset=arena.allocate(size);
+      if(offset==ArenaAllocator::c_invalid)
+      {
+        failed+=arena.largestFree()>=size;
+        continue;
+      }
+      for(size_t u=offset; u<offset+size; ++u)
+      {
+        overlaps+=taken[u];
+        taken[u]=true;
+      }
+      live.push_back({offset,size});
+    }
+    else
+    {
+      size_t index=gen()%live.size();
+      arena.release(live[index].first);
+      for(size_t u=live[index].first; u<live[index].first+live[index].second; ++u)
+        taken[u]=false;
+      live[index]=live.back();
+      live.pop_back();
+    }
+  }
+  for(auto range : live)
+    arena.release(range.first);
+  bool ok=overlaps==0 && failed==0 && arena.used()==0 && arena.freeRanges()==1 && arena.largestFree()==capacity;
+  std::cout<<"allocator "<<(ok ? "ok" : "FAILED")<<" overlaps "<<overlaps<<" refused with room "<<failed
+           <<" free ranges at the end "<<arena.freeRanges()<<'\n';
+  return ok;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// the draws are a grid of meshes over the ground
+//----------------------------------------------------------------------------------------------------------------------
+ngl::Mat4 drawMatrix(size_t _i, size_t _count)
+{
+  size_t side=static_cast<size_t>(std::ceil(std::sqrt(static_cast<float>(_count))));
+  float spacing=8.0f/side;
+  ngl::Mat4 M;
+  M.translate(((_i%side)+0.5f)*spacing-4.0f,0.0f,((_i/side)+0.5f)*spacing-4.0f);
+  return M;
+}
+
+ngl::Mat3 normalMatrixFor(const ngl::Mat4 &_view)
+{
+  // the draws are only translated so the view's normal matrix does for all of them
+  ngl::Mat3 normalMatrix=_view;
+  normalMatrix.inverse().transpose();
+  return normalMatrix;
+}
+
+void addDraws(BatchRenderer &_batch, const std::vector<int> &_meshes, size_t _count, const ngl::Mat4 &_view)
+{
+  ngl::Mat3 normalMatrix=normalMatrixFor(_view);
+  _batch.begin();
+  for(size_t i=0; i<_count; ++i)
+    _batch.add(_meshes[i%_meshes.size()],drawMatrix(i,_count),normalMatrix);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// the same draws one mesh at a time with the plain Phong program and its own matrix uniforms,
+// nothing shared with the batch path but the mesh data
+//----------------------------------------------------------------------------------------------------------------------
+void drawReference(const std::vector<std::unique_ptr<PackedMesh>> &_meshes, size_t _count, const ngl::Mat4 &_view,
+                   const ngl::Mat4 &_project)
+{
+  ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+  (*shader)["PhongLegacy"]->use();
+  ngl::Mat3 normalMatrix=normalMatrixFor(_view);
+  for(size_t i=0; i<_count; ++i)
+  {
+    ngl::Mat4 M=drawMatrix(i,_count);
+    ngl::Mat4 MV=_view*M;
+    shader->setUniform("M",M);
+    shader->setUniform("MV",MV);
+    shader->setUniform("MVP",_project*MV);
+    shader->setUniform("normalMatrix",normalMatrix);
+    const PackedMesh &mesh=*_meshes[i%_meshes.size()];
+    mesh.setDecodeUniforms();
+    mesh.draw();
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// pixels with any channel more than _tolerance apart
+//----------------------------------------------------------------------------------------------------------------------
+size_t differingPixels(const std::vector<unsigned char> &_a, const std::vector<unsigned char> &_b, int _tolerance)
+{
+  size_t differing=0;
+  for(size_t i=0; i<_a.size(); i+=4)
+  {
+    bool differs=false;
+    for(size_t c=0; c<4; ++c)
+      differs=differs || std::abs(_a[i+c]-_b[i+c])>_tolerance;
+    differing+=differs;
+  }
+  return differing;
+}
+
+void setLighting(const std::string &_program)
+{
+  ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+  (*shader)[_program]->use();
+  shader->setUniform("viewerPos",ngl::Vec3(0.0f,6.0f,6.0f));
+  shader->setUniform("light.position",ngl::Vec4(0.0f,2.0f,2.0f,0.0f));
+  shader->setUniform("light.diffuse",1.0f,1.0f,1.0f,1.0f);
+  shader->setUniform("material.diffuse",0.75164f,0.60648f,0.22648f,0.0f);
+}
+} // end anon namespace
+
+int main(int argc, char **argv)
+{
+  if(!checkAllocator())
+    return EXIT_FAILURE;
+  QGuiApplication app(argc, argv);
+  int frames = argc > 1 ? std::atoi(argv[1]) : 100;
+  QSurfaceFormat format;
+  format.setMajorVersion(4);
+  format.setMinorVersion(5);
+  format.setProfile(QSurfaceFormat::CoreProfile);
+  QOffscreenSurface surface;
+  surface.setFormat(format);
+  surface.create();
+  QOpenGLContext context;
+  context.setFormat(format);
+  if(!context.create() || !context.makeCurrent(&surface))
+  {
+    std::cerr<<"unable to create an OpenGL context\n";
+    return EXIT_FAILURE;
+  }
+  ngl::NGLInit::instance();
+  std::cout<<"GL_RENDERER "<<glGetString(GL_RENDERER)<<'\n';
+  QOpenGLFramebufferObject fbo(c_width,c_height,QOpenGLFramebufferObject::Depth);
+  fbo.bind();
+  glViewport(0,0,c_width,c_height);
+  glEnable(GL_DEPTH_TEST);
+
+  ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+  shader->createShaderProgram(BatchRenderer::c_program);
+  shader->attachShader("PhongBatchVertex",ngl::ShaderType::VERTEX);
+  shader->attachShader("PhongFragment",ngl::ShaderType::FRAGMENT);
+  shader->loadShaderSource("PhongBatchVertex","shaders/PhongBatchVertex.glsl");
+  shader->loadShaderSource("PhongFragment","shaders/PhongFragment.glsl");
+  shader->compileShader("PhongBatchVertex");
+  shader->compileShader("PhongFragment");
+  shader->attachShaderToProgram(BatchRenderer::c_program,"PhongBatchVertex");
+  shader->attachShaderToProgram(BatchRenderer::c_program,"PhongFragment");
+  shader->linkProgramObject(BatchRenderer::c_program);
+  // the reference draws use the individual matrix uniforms build of the demo's Phong shader
+  ShaderCache legacyCache(".shadercache","#define LEGACY_UNIFORMS");
+  if(!legacyCache.loadProgram("PhongLegacy",{{"PhongVertexLegacy",ngl::ShaderType::VERTEX,"shaders/PhongVertex.glsl"},
+                                             {"PhongFragmentLegacy",ngl::ShaderType::FRAGMENT,"shaders/PhongFragment.glsl"}}))
+  {
+    std::cerr<<"unable to build the Phong shaders\n";
+    return EXIT_FAILURE;
+  }
+  setLighting("PhongLegacy");
+  setLighting(BatchRenderer::c_program);
+
+  // every draw is a different mesh
+  const size_t counts[]={64,256,1024,4096};
+  const size_t maxDraws=counts[3];
+  const size_t maxRings=12;
+  BatchRenderer batch(maxDraws*(maxRings+1)*(2*maxRings+1),maxDraws*maxRings*2*maxRings*6,maxDraws);
+  std::vector<int> meshes;
+  std::vector<std::unique_ptr<PackedMesh>> reference;
+  for(size_t i=0; i<maxDraws; ++i)
+  {
+    meshfile::MeshData mesh;
+    meshfile::makeSuperellipsoid(0.2f+0.04f*(i%64),0.2f+0.04f*(i/64%64),4+i%(maxRings-3),0.5f,mesh);
+    int id=batch.addMesh(mesh.positions.data(),mesh.normals.data(),mesh.vertexCount(),mesh.indices.data(),mesh.indices.size());
+    if(id<0)
+    {
+      std::cerr<<"arena full after "<<i<<" meshes\n";
+      return EXIT_FAILURE;
+    }
+    meshes.push_back(id);
+    // the image check draws counts[1] of them
+    if(i<counts[1])
+      reference.emplace_back(new PackedMesh(mesh.positions.data(),mesh.normals.data(),mesh.vertexCount(),mesh.indices.data(),
+                                            mesh.indices.size(),PackedMesh::Format::Float));
+  }
+  std::cout<<"meshes "<<batch.meshCount()<<" vertices "<<batch.vertexArena().used()<<" indices "<<batch.indexArena().used()
+           <<" persistent mapped "<<(batch.persistentMapped() ? "yes" : "no")<<'\n';
+
+  ngl::Mat4 view=ngl::lookAt(ngl::Vec3(0.0f,6.0f,6.0f),ngl::Vec3(0.0f,0.0f,0.0f),ngl::Vec3(0.0f,1.0f,0.0f));
+  ngl::Mat4 project=ngl::perspective(45.0f,static_cast<float>(c_width)/c_height,0.05f,350.0f);
+
+  // the single call has to draw exactly what the separate ones do. Both take each draw's matrices
+  // through its draw index, so a mistake there draws the same wrong image twice, the reference
+  // made without the batch renderer catches that
+  std::vector<unsigned char> images[3];
+  for(int path=0; path<3; ++path)
+  {
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    if(path<2)
+    {
+      addDraws(batch,meshes,counts[1],view);
+      batch.draw(view,project,path==1);
+    }
+    else
+      drawReference(reference,counts[1],view,project);
+    images[path].resize(c_width*c_height*4);
+    glReadPixels(0,0,c_width,c_height,GL_RGBA,GL_UNSIGNED_BYTE,images[path].data());
+  }
+  size_t differing=differingPixels(images[0],images[1],0);
+  std::cout<<"multi draw against per draw image "<<(differing ? "FAILED " : "ok ")<<differing<<" pixels differ\n";
+  // the two vertex shaders round differently so a few edge pixels may go either way, and an
+  // empty reference would prove nothing
+  size_t pixels=c_width*c_height;
+  size_t covered=0;
+  for(size_t i=0; i<images[2].size(); i+=4)
+    covered+=images[2][i]!=0 || images[2][i+1]!=0 || images[2][i+2]!=0;
+  size_t fromReference=differingPixels(images[1],images[2],c_channelTolerance);
+  bool referenceOk=fromReference<=pixels*c_referenceFraction && covered>pixels/100;
+  std::cout<<"multi draw against reference image "<<(referenceOk ? "ok " : "FAILED ")<<fromReference<<" pixels differ, "
+           <<covered<<" covered\n";
+  if(differing || !referenceOk)
+    return EXIT_FAILURE;
+
+  for(auto count : counts)
+  {
+    for(bool multi : {false,true})
+    {
+      float submit=0.0f;
+      glFinish();
+      auto start=std::chrono::high_resolution_clock::now();
+      for(int f=0; f<frames; ++f)
+      {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        addDraws(batch,meshes,count,view);
+        batch.draw(view,project,multi);
+        submit+=batch.stats().submitMs;
+      }
+      glFinish();
+      double seconds=std::chrono::duration<double>(std::chrono::high_resolution_clock::now()-start).count();
+      std::cout<<(multi ? "multi draw" : "per draw  ")<<" draws "<<count
+               <<" calls/frame "<<batch.stats().drawCalls
+               <<" triangles "<<batch.stats().triangles
+               <<" submit ms/frame "<<submit/frames
+               <<" ms/frame "<<1000.0*seconds/frames<<'\n';
+    }
+  }
+  fbo.release();
+  return EXIT_SUCCESS;
+}
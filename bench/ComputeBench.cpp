@@ -0,0 +1,140 @@
+/****************************************************************************
+vertex transform on the gpu with shaders/compute.glsl against the best cpu
+BatchTransform path, for Mesa's llvmpipe run with
+LIBGL_ALWAYS_SOFTWARE=1 QT_QPA_PLATFORM=offscreen ./ComputeBench
+from the project root (so the shader can be found). The gpu results have to
+match the cpu ones to within c_tolerance (relative above 1) or the run fails
+usage ComputeBench [iterations] [numVerts ...]
+****************************************************************************/
+#include "BatchTransform.h"
+#include "ComputeTransform.h"
+#include <ngl/NGLInit.h>
+#include <ngl/ShaderLib.h>
+#include <ngl/Util.h>
+#include <QGuiApplication>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace
+{
+// both sides are fp32 but may round or fuse the multiply adds differently
+constexpr float c_tolerance=1e-4f;
+
+float relativeError(float _gpu, float _cpu)
+{
+  return std::fabs(_gpu-_cpu)/std::max(1.0f,std::fabs(_cpu));
+}
+} // end anon namespace
+
+int main(int argc, char **argv)
+{
+  QGuiApplication app(argc, argv);
+  int iterations = argc > 1 ? std::atoi(argv[1]) : 20;
+  std::vector<size_t> counts;
+  for(int i=2; i<argc; ++i)
+    counts.push_back(std::strtoul(argv[i],nullptr,10));
+  if(counts.empty())
+    counts={10000,100000,1000000,4000000};
+
+  QSurfaceFormat format;
+  format.setMajorVersion(4);
+  format.setMinorVersion(5);
+  format.setProfile(QSurfaceFormat::CoreProfile);
+  QOffscreenSurface surface;
+  surface.setFormat(format);
+  surface.create();
+  QOpenGLContext context;
+  context.setFormat(format);
+  if(!context.create() || !context.makeCurrent(&surface))
+  {
+    std::cerr<<"unable to create an OpenGL context\n";
+    return EXIT_FAILURE;
+  }
+  ngl::NGLInit::instance();
+  std::cout<<"GL_RENDERER "<<glGetString(GL_RENDERER)<<'\n';
+
+  ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+  shader->createShaderProgram(ComputeTransform::c_program);
+  shader->attachShader("ComputeTransformShader",ngl::ShaderType::COMPUTE);
+  shader->loadShaderSource("ComputeTransformShader","shaders/compute.glsl");
+  shader->compileShader("ComputeTransformShader");
+  shader->attachShaderToProgram(ComputeTransform::c_program,"ComputeTransformShader");
+  shader->linkProgramObject(ComputeTransform::c_program);
+
+  ngl::Mat4 MVP=ngl::perspective(45.0f,1.0f,0.05f,350.0f)*
+                ngl::lookAt(ngl::Vec3(0,1,1),ngl::Vec3(0,0,0),ngl::Vec3(0,1,0));
+  std::cout<<"iterations "<<iterations<<" cpu path "<<BatchTransform::pathName(BatchTransform::bestPath())<<'\n';
+  std::mt19937 gen(1234);
+  std::uniform_real_distribution<float> dist(-1.0f,1.0f);
+  bool ok=true;
+  for(auto numVerts : counts)
+  {
+    VertexBatchSoA in;
+    in.resize(numVerts);
+    std::vector<float> xyz(numVerts*3);
+    for(size_t i=0; i<numVerts; ++i)
+    {
+      xyz[3*i]=in.x[i]=dist(gen);
+      xyz[3*i+1]=in.y[i]=dist(gen);
+      xyz[3*i+2]=in.z[i]=dist(gen);
+    }
+
+    ClipBatchSoA cpu;
+    BatchTransform::transform(MVP,in,cpu);
+    auto start=std::chrono::high_resolution_clock::now();
+    for(int i=0; i<iterations; ++i)
+      BatchTransform::transform(MVP,in,cpu);
+    double cpuMs=std::chrono::duration<double,std::milli>(std::chrono::high_resolution_clock::now()-start).count()/iterations;
+
+    // dispatch only is the cost when the results are drawn, readback when the cpu needs them
+    ComputeTransform gpu(xyz.data(),nullptr,numVerts,nullptr,0);
+    gpu.dispatch(MVP);
+    glFinish();
+    start=std::chrono::high_resolution_clock::now();
+    for(int i=0; i<iterations; ++i)
+      gpu.dispatch(MVP);
+    glFinish();
+    double dispatchMs=std::chrono::duration<double,std::milli>(std::chrono::high_resolution_clock::now()-start).count()/iterations;
+    ClipBatchSoA result;
+    start=std::chrono::high_resolution_clock::now();
+    for(int i=0; i<iterations; ++i)
+    {
+      gpu.dispatch(MVP);
+      gpu.readBack(result);
+    }
+    double readBackMs=std::chrono::duration<double,std::milli>(std::chrono::high_resolution_clock::now()-start).count()/iterations;
+
+    float maxError=0.0f;
+    size_t outside=0;
+    auto check=[&](float _gpu, float _cpu)
+    {
+      float error=relativeError(_gpu,_cpu);
+      maxError=std::max(maxError,error);
+      // written so a NaN counts as outside
+      outside+=!(error<=c_tolerance);
+    };
+    for(size_t i=0; i<numVerts; ++i)
+    {
+      check(result.x[i],cpu.x[i]);
+      check(result.y[i],cpu.y[i]);
+      check(result.z[i],cpu.z[i]);
+      check(result.w[i],cpu.w[i]);
+    }
+    bool match=outside==0;
+    ok&=match;
+    std::cout<<"vertices "<<numVerts
+             <<" cpu "<<cpuMs<<" ms"
+             <<" gpu dispatch "<<dispatchMs<<" ms"
+             <<" gpu dispatch+readback "<<readBackMs<<" ms"
+             <<" speedup "<<cpuMs/dispatchMs<<"x / "<<cpuMs/readBackMs<<"x"
+             <<" max error "<<maxError<<(match ? " ok" : " FAILED")<<" ("<<outside<<" values over "<<c_tolerance<<")\n';
+  }
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
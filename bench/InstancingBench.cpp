@@ -0,0 +1,94 @@
+/****************************************************************************
+instanced rendering throughput, renders into an offscreen FBO so it can run
+headless, for Mesa's software GL run with
+LIBGL_ALWAYS_SOFTWARE=1 QT_QPA_PLATFORM=offscreen ./InstancingBench
+from the project root (so the shaders can be found)
+usage InstancingBench [frames]
+****************************************************************************/
+#include "InstancedRenderer.h"
+#include "JobSystem.h"
+#include "TransformState.h"
+#include <ngl/NGLInit.h>
+#include <ngl/ShaderLib.h>
+#include <ngl/Util.h>
+#include <QGuiApplication>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+int main(int argc, char **argv)
+{
+  QGuiApplication app(argc, argv);
+  int frames = argc > 1 ? std::atoi(argv[1]) : 100;
+  QSurfaceFormat format;
+  format.setMajorVersion(4);
+  format.setMinorVersion(5);
+  format.setProfile(QSurfaceFormat::CoreProfile);
+  QOffscreenSurface surface;
+  surface.setFormat(format);
+  surface.create();
+  QOpenGLContext context;
+  context.setFormat(format);
+  if(!context.create() || !context.makeCurrent(&surface))
+  {
+    std::cerr<<"unable to create an OpenGL context\n";
+    return EXIT_FAILURE;
+  }
+  ngl::NGLInit::instance();
+  std::cout<<"GL_RENDERER "<<glGetString(GL_RENDERER)<<'\n';
+  QOpenGLFramebufferObject fbo(1024,720,QOpenGLFramebufferObject::Depth);
+  fbo.bind();
+  glViewport(0,0,1024,720);
+  glEnable(GL_DEPTH_TEST);
+
+  ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+  shader->createShaderProgram("PhongInstanced");
+  shader->attachShader("PhongInstancedVertex",ngl::ShaderType::VERTEX);
+  shader->attachShader("PhongFragment",ngl::ShaderType::FRAGMENT);
+  shader->loadShaderSource("PhongInstancedVertex","shaders/PhongInstancedVertex.glsl");
+  shader->loadShaderSource("PhongFragment","shaders/PhongFragment.glsl");
+  shader->compileShader("PhongInstancedVertex");
+  shader->compileShader("PhongFragment");
+  shader->attachShaderToProgram("PhongInstanced","PhongInstancedVertex");
+  shader->attachShaderToProgram("PhongInstanced","PhongFragment");
+  shader->linkProgramObject("PhongInstanced");
+
+  std::array<ngl::Vec3,3> verts={{ngl::Vec3(0.0f,0.5f,0.0f),ngl::Vec3(0.5f,-0.5f,0.0f),ngl::Vec3(-0.5f,-0.5f,0.0f)}};
+  std::array<ngl::Vec3,3> normals;
+  normals.fill(ngl::Vec3(0.0f,1.0f,0.0f));
+  TransformState transform;
+  transform.setView(ngl::lookAt(ngl::Vec3(0,1,1),ngl::Vec3(0,0,0),ngl::Vec3(0,1,0)));
+  transform.setProject(ngl::perspective(45.0f,1024.0f/720.0f,0.05f,350.0f));
+  transform.update();
+
+  const size_t counts[]={1000,10000,50000,100000};
+  JobSystem jobs;
+  InstancedRenderer renderer(&verts[0],&normals[0],verts.size(),counts[3]);
+  std::cout<<"persistent mapped "<<(renderer.persistentMapped() ? "yes" : "no")<<'\n';
+  for(auto count : counts)
+  {
+    renderer.setInstanceCount(count);
+    float fill=0.0f;
+    glFinish();
+    auto start=std::chrono::high_resolution_clock::now();
+    for(int f=0; f<frames; ++f)
+    {
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      jobs.beginFrame();
+      renderer.draw(transform,jobs);
+      fill+=renderer.fillTime();
+    }
+    glFinish();
+    double seconds=std::chrono::duration<double>(std::chrono::high_resolution_clock::now()-start).count();
+    std::cout<<"instances/frame "<<count
+             <<" ms/frame "<<1000.0*seconds/frames
+             <<" fill ms/frame "<<fill/frames
+             <<" instances/sec "<<(static_cast<double>(count)*frames)/seconds<<'\n';
+  }
+  fbo.release();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,120 @@
+/****************************************************************************
+stress test for the JobSystem, builds random task graphs and parallelFor
+splits and checks the results match running the same work serially
+returns non zero on any mismatch
+usage JobStress [iterations] [threads]
+****************************************************************************/
+#include "JobSystem.h"
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace
+{
+// a little bit of deterministic busy work so tasks overlap
+uint64_t mix(uint64_t _v)
+{
+  for(int i=0; i<64; ++i)
+    _v=_v*6364136223846793005ULL+1442695040888963407ULL;
+  return _v;
+}
+
+struct Graph
+{
+  std::vector<std::vector<size_t>> deps;
+};
+
+Graph randomGraph(std::mt19937 &_gen, size_t _numTasks)
+{
+  // deps always point at earlier tasks so the graph is acyclic
+  Graph g;
+  g.deps.resize(_numTasks);
+  for(size_t i=1; i<_numTasks; ++i)
+  {
+    std::uniform_int_distribution<size_t> pick(0,i-1);
+    size_t count=std::uniform_int_distribution<size_t>(0,std::min<size_t>(i,4))(_gen);
+    for(size_t d=0; d<count; ++d)
+      g.deps[i].push_back(pick(_gen));
+  }
+  return g;
+}
+
+std::vector<uint64_t> runSerial(const Graph &_g)
+{
+  std::vector<uint64_t> values(_g.deps.size());
+  for(size_t i=0; i<values.size(); ++i)
+  {
+    uint64_t v=i;
+    for(auto d : _g.deps[i])
+      v+=values[d];
+    values[i]=mix(v);
+  }
+  return values;
+}
+
+std::vector<uint64_t> runJobs(JobSystem &_jobs, const Graph &_g)
+{
+  std::vector<uint64_t> values(_g.deps.size());
+  _jobs.beginFrame();
+  for(size_t i=0; i<values.size(); ++i)
+  {
+    _jobs.add("node",[i,&values,&_g]()
+    {
+      uint64_t v=i;
+      for(auto d : _g.deps[i])
+        v+=values[d];
+      values[i]=mix(v);
+    },_g.deps[i]);
+  }
+  _jobs.waitAll();
+  return values;
+}
+} // end anon namespace
+
+int main(int argc, char **argv)
+{
+  int iterations = argc > 1 ? std::atoi(argv[1]) : 200;
+  unsigned int threads = argc > 2 ? static_cast<unsigned int>(std::atoi(argv[2])) : 0;
+  JobSystem jobs(threads);
+  std::mt19937 gen(42);
+  int failures=0;
+  auto start=std::chrono::high_resolution_clock::now();
+  for(int it=0; it<iterations; ++it)
+  {
+    Graph g=randomGraph(gen,std::uniform_int_distribution<size_t>(1,2000)(gen));
+    if(runSerial(g)!=runJobs(jobs,g))
+    {
+      std::cerr<<"graph mismatch on iteration "<<it<<'\n';
+      ++failures;
+    }
+    // parallelFor with a dependency chain in front of it and nested waits
+    size_t count=std::uniform_int_distribution<size_t>(1,100000)(gen);
+    std::vector<double> serial(count);
+    std::vector<double> parallel(count,0.0);
+    double scale=0.0;
+    for(size_t i=0; i<count; ++i)
+      serial[i]=std::sqrt(static_cast<double>(i))*2.5;
+    jobs.beginFrame();
+    auto setup=jobs.add("setup",[&scale](){ scale=2.5; });
+    auto ids=jobs.parallelFor("for",count,1024,[&parallel,&scale](size_t _begin, size_t _end)
+    {
+      for(size_t i=_begin; i<_end; ++i)
+        parallel[i]=std::sqrt(static_cast<double>(i))*scale;
+    },{setup});
+    jobs.wait(ids);
+    if(serial!=parallel)
+    {
+      std::cerr<<"parallelFor mismatch on iteration "<<it<<'\n';
+      ++failures;
+    }
+  }
+  double seconds=std::chrono::duration<double>(std::chrono::high_resolution_clock::now()-start).count();
+  JobSystem::Stats stats=jobs.frameStats();
+  std::cout<<"threads "<<jobs.numThreads()<<" iterations "<<iterations<<" failures "<<failures
+           <<" time "<<seconds<<"s last frame tasks "<<stats.tasks<<" steals "<<stats.steals<<'\n';
+  return failures==0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,161 @@
+/****************************************************************************
+simplification time and error of the LOD chain MeshLod builds, for a closed
+sphere and an open height field (whose border has to stay put). Every level
+has to have fewer triangles than the one before and no more than its
+target, the reported error can't shrink from one level to the next and has
+to cover the distance from every source vertex to the level's surface
+(checked against every triangle) while staying a small part of the bounds,
+the run fails if any level breaks one of these
+usage LodBench [sphere rings]
+****************************************************************************/
+#include "MeshSimplify.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+namespace
+{
+// as MeshLod::simplify
+constexpr float c_levelRatio=0.5f;
+constexpr size_t c_minTriangles=64;
+constexpr size_t c_maxLevels=8;
+//----------------------------------------------------------------------------------------------------------------------
+// the largest error allowed as a fraction of the bounding radius, the coarsest levels are only
+// c_minTriangles so they are allowed to be rough
+//----------------------------------------------------------------------------------------------------------------------
+constexpr float c_maxRelativeError=0.25f;
+
+void makeHeightField(size_t _size, meshfile::MeshData &_mesh)
+{
+  for(size_t z=0; z<=_size; ++z)
+    for(size_t x=0; x<=_size; ++x)
+    {
+      float u=2.0f*x/_size-1.0f;
+      float v=2.0f*z/_size-1.0f;
+      _mesh.positions.insert(_mesh.positions.end(),{u,0.1f*std::sin(3.0f*u)*std::cos(2.0f*v),v});
+    }
+  uint32_t row=static_cast<uint32_t>(_size+1);
+  for(uint32_t z=0; z<_size; ++z)
+    for(uint32_t x=0; x<_size; ++x)
+    {
+      uint32_t i=z*row+x;
+      _mesh.indices.insert(_mesh.indices.end(),{i,i+row,i+1,i+1,i+row,i+row+1});
+    }
+  meshfile::computeNormals(_mesh);
+}
+
+double pointTriangleDistance(const float *_p, const float *_a, const float *_b, const float *_c)
+{
+  // closest point by barycentric regions, Ericson's Real-Time Collision Detection 5.1.5
+  auto dot=[](const double *_u, const double *_v){ return _u[0]*_v[0]+_u[1]*_v[1]+_u[2]*_v[2]; };
+  double ab[3], ac[3], ap[3], bp[3], cp[3];
+  for(int k=0; k<3; ++k)
+  {
+    ab[k]=_b[k]-_a[k];
+    ac[k]=_c[k]-_a[k];
+    ap[k]=_p[k]-_a[k];
+    bp[k]=_p[k]-_b[k];
+    cp[k]=_p[k]-_c[k];
+  }
+  double d1=dot(ab,ap), d2=dot(ac,ap), d3=dot(ab,bp), d4=dot(ac,bp), d5=dot(ab,cp), d6=dot(ac,cp);
+  double va=d3*d6-d5*d4, vb=d5*d2-d1*d6, vc=d1*d4-d3*d2;
+  double v=0.0, w=0.0;
+  if(d1<=0.0 && d2<=0.0)
+    {}
+  else if(d3>=0.0 && d4<=d3)
+    v=1.0;
+  else if(d6>=0.0 && d5<=d6)
+    w=1.0;
+  else if(vc<=0.0 && d1>=0.0 && d3<=0.0)
+    v=d1/(d1-d3);
+  else if(vb<=0.0 && d2>=0.0 && d6<=0.0)
+    w=d2/(d2-d6);
+  else if(va<=0.0 && d4-d3>=0.0 && d5-d6>=0.0)
+  {
+    w=(d4-d3)/((d4-d3)+(d5-d6));
+    v=1.0-w;
+  }
+  else if(va+vb+vc!=0.0)
+  {
+    v=vb/(va+vb+vc);
+    w=vc/(va+vb+vc);
+  }
+  double d[3];
+  for(int k=0; k<3; ++k)
+    d[k]=ap[k]-v*ab[k]-w*ac[k];
+  return std::sqrt(dot(d,d));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// the real one sided distance from the source vertices to a level, every vertex against every triangle
+//----------------------------------------------------------------------------------------------------------------------
+double measuredError(const meshfile::MeshData &_source, const meshfile::MeshData &_level)
+{
+  double worst=0.0;
+  const std::vector<float> &p=_level.positions;
+  for(size_t v=0; v<_source.vertexCount(); ++v)
+  {
+    double best=std::numeric_limits<double>::max();
+    for(size_t i=0; i<_level.indices.size(); i+=3)
+      best=std::min(best,pointTriangleDistance(&_source.positions[v*3],&p[_level.indices[i]*3],&p[_level.indices[i+1]*3],
+                                               &p[_level.indices[i+2]*3]));
+    worst=std::max(worst,best);
+  }
+  return worst;
+}
+
+bool checkChain(const char *_name, const meshfile::MeshData &_mesh)
+{
+  float radius=0.0f;
+  for(size_t v=0; v<_mesh.vertexCount(); ++v)
+    radius=std::max(radius,std::sqrt(_mesh.positions[v*3]*_mesh.positions[v*3]+_mesh.positions[v*3+1]*_mesh.positions[v*3+1]+
+                                     _mesh.positions[v*3+2]*_mesh.positions[v*3+2]));
+  size_t triangles=_mesh.indices.size()/3;
+  std::vector<size_t> targets;
+  for(size_t t=static_cast<size_t>(triangles*c_levelRatio); t>=c_minTriangles && targets.size()+1<c_maxLevels;
+      t=static_cast<size_t>(t*c_levelRatio))
+    targets.push_back(t);
+
+  auto start=std::chrono::high_resolution_clock::now();
+  std::vector<meshfile::SimplifiedMesh> levels=meshfile::simplify(_mesh.positions.data(),_mesh.vertexCount(),_mesh.indices.data(),
+                                                                  _mesh.indices.size(),targets);
+  double ms=std::chrono::duration<double,std::milli>(std::chrono::high_resolution_clock::now()-start).count();
+  std::cout<<_name<<" triangles "<<triangles<<" levels "<<levels.size()<<" of "<<targets.size()<<" in "<<ms<<" ms\n";
+
+  bool ok=!levels.empty();
+  size_t previousTriangles=triangles;
+  float previousError=0.0f;
+  for(size_t i=0; i<levels.size(); ++i)
+  {
+    const meshfile::SimplifiedMesh &level=levels[i];
+    double measured=measuredError(_mesh,level.mesh);
+    // a float's worth of slack, the level positions were rounded from the simplifier's doubles
+    bool covers=level.error+1e-5f*radius>=measured;
+    bool levelOk=level.triangleCount()<previousTriangles && level.triangleCount()<=targets[i] &&
+                 level.error>=previousError && covers && level.error<=c_maxRelativeError*radius;
+    std::cout<<"  level "<<i+1<<(levelOk ? " ok " : " FAILED ")<<"triangles "<<level.triangleCount()<<" target "<<targets[i]
+             <<" error "<<level.error<<" measured "<<measured<<'\n';
+    ok&=levelOk;
+    previousTriangles=level.triangleCount();
+    previousError=level.error;
+  }
+  return ok;
+}
+} // end anon namespace
+
+int main(int argc, char **argv)
+{
+  size_t rings=argc>1 ? static_cast<size_t>(std::max(4,std::atoi(argv[1]))) : 48;
+  meshfile::MeshData sphere;
+  meshfile::makeSuperellipsoid(1.0f,1.0f,rings,1.0f,sphere);
+  meshfile::MeshData field;
+  makeHeightField(rings,field);
+  bool ok=checkChain("sphere",sphere);
+  ok&=checkChain("height field",field);
+  std::cout<<(ok ? "ok\n" : "FAILED\n");
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
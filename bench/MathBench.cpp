@@ -0,0 +1,258 @@
+/****************************************************************************
+micro benchmarks of the ngl math and overlay formatting NGLScene runs every
+frame, each case is calibrated to take at least minMs per repetition then
+repeated so the spread can be seen. Results go to stdout and optionally to
+a JSON file along with the compiler, flags and cpu so runs from different
+machines or builds can be compared, e.g. configure cmake (the only build of
+the benches, MVPDemo.pro is the demo alone) with
+-DMATHBENCH_FLAGS="-O3 -march=native" against the default -O2. The flags
+only reach the code compiled here, the ngl calls that aren't inline need
+NGL rebuilt with them as well
+usage MathBench [--json out.json] [--label text] [--reps n] [--min-ms ms]
+****************************************************************************/
+#include <ngl/Mat3.h>
+#include <ngl/Mat4.h>
+#include <ngl/Util.h>
+#include <ngl/Vec3.h>
+#include <ngl/Vec4.h>
+#include <QString>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef MATHBENCH_FLAGS
+  #define MATHBENCH_FLAGS ""
+#endif
+#if defined(__clang__)
+  #define MATHBENCH_COMPILER "clang " __VERSION__
+#elif defined(__GNUC__)
+  #define MATHBENCH_COMPILER "gcc " __VERSION__
+#elif defined(_MSC_VER)
+  #define MATHBENCH_XSTR(x) #x
+  #define MATHBENCH_STR(x) MATHBENCH_XSTR(x)
+  #define MATHBENCH_COMPILER "msvc " MATHBENCH_STR(_MSC_FULL_VER)
+#else
+  #define MATHBENCH_COMPILER "unknown"
+#endif
+
+namespace
+{
+  // the results of every case end up here so none of the work can be optimised away
+  volatile float g_sink=0.0f;
+  // inputs are cycled through so nothing is constant folded, a power of 2 so the index is a mask
+  constexpr size_t c_poolSize=256;
+
+  struct Result
+  {
+    std::string name;
+    size_t iterations=0;
+    std::vector<double> nsPerOp;
+    double min=0.0;
+    double median=0.0;
+    double mean=0.0;
+    double stddev=0.0;
+    double max=0.0;
+  };
+
+  template <typename F>
+  double timeRun(F &_op, size_t _iterations)
+  {
+    float sum=0.0f;
+    auto start=std::chrono::high_resolution_clock::now();
+    for(size_t i=0; i<_iterations; ++i)
+      sum+=_op(i&(c_poolSize-1));
+    double ms=std::chrono::duration<double,std::milli>(std::chrono::high_resolution_clock::now()-start).count();
+    g_sink=g_sink+sum;
+    return ms;
+  }
+
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief double the iterations until one run takes _minMs (this doubles as the warm up) then
+  /// time _reps runs of that many
+  //----------------------------------------------------------------------------------------------------------------------
+  template <typename F>
+  Result run(const char *_name, F _op, int _reps, double _minMs)
+  {
+    Result result;
+    result.name=_name;
+    result.iterations=64;
+    while(timeRun(_op,result.iterations)<_minMs && result.iterations<(size_t(1)<<30))
+      result.iterations*=2;
+    for(int r=0; r<_reps; ++r)
+      result.nsPerOp.push_back(timeRun(_op,result.iterations)*1e6/result.iterations);
+
+    std::vector<double> sorted(result.nsPerOp);
+    std::sort(sorted.begin(),sorted.end());
+    double sum=0.0;
+    for(double ns : sorted)
+      sum+=ns;
+    result.min=sorted.front();
+    result.max=sorted.back();
+    result.median=sorted.size()%2 ? sorted[sorted.size()/2] : 0.5*(sorted[sorted.size()/2-1]+sorted[sorted.size()/2]);
+    result.mean=sum/sorted.size();
+    double variance=0.0;
+    for(double ns : sorted)
+      variance+=(ns-result.mean)*(ns-result.mean);
+    result.stddev=sorted.size()>1 ? std::sqrt(variance/(sorted.size()-1)) : 0.0;
+    std::printf("%-28s %10zu %9.2f %9.2f %9.2f %8.2f%%\n",_name,result.iterations,result.min,result.median,
+                result.max,result.mean>0.0 ? 100.0*result.stddev/result.mean : 0.0);
+    return result;
+  }
+
+  std::string cpuModel()
+  {
+    std::ifstream file("/proc/cpuinfo");
+    std::string line;
+    while(std::getline(file,line))
+      if(line.compare(0,10,"model name")==0 && line.find(':')!=std::string::npos)
+        return line.substr(line.find(':')+2);
+    return "unknown";
+  }
+
+  std::string escape(const std::string &_s)
+  {
+    std::string out;
+    for(char c : _s)
+    {
+      if(c=='"' || c=='\\')
+        out+='\\';
+      out+=c;
+    }
+    return out;
+  }
+
+  bool writeJSON(const std::string &_fname, const std::string &_label, const std::vector<Result> &_results, int _reps, double _minMs)
+  {
+    std::ofstream file(_fname.c_str());
+    if(!file.is_open())
+    {
+      std::cerr<<"unable to write "<<_fname<<'\n';
+      return false;
+    }
+    file<<"{\n  \"benchmark\": \"MathBench\",\n"
+        <<"  \"label\": \""<<escape(_label)<<"\",\n"
+        <<"  \"compiler\": \""<<escape(MATHBENCH_COMPILER)<<"\",\n"
+        <<"  \"flags\": \""<<escape(MATHBENCH_FLAGS)<<"\",\n"
+        <<"  \"cpu\": \""<<escape(cpuModel())<<"\",\n"
+        <<"  \"threads\": "<<std::thread::hardware_concurrency()<<",\n"
+        <<"  \"reps\": "<<_reps<<",\n  \"min_ms\": "<<_minMs<<",\n  \"unit\": \"ns/op\",\n  \"results\": [\n";
+    for(size_t i=0; i<_results.size(); ++i)
+    {
+      const Result &r=_results[i];
+      file<<"    {\"name\": \""<<r.name<<"\", \"iterations\": "<<r.iterations
+          <<", \"min\": "<<r.min<<", \"median\": "<<r.median<<", \"mean\": "<<r.mean
+          <<", \"stddev\": "<<r.stddev<<", \"max\": "<<r.max<<", \"samples\": [";
+      for(size_t s=0; s<r.nsPerOp.size(); ++s)
+        file<<(s ? ", " : "")<<r.nsPerOp[s];
+      file<<"]}"<<(i+1<_results.size() ? ",\n" : "\n");
+    }
+    file<<"  ]\n}\n";
+    return static_cast<bool>(file);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  std::string jsonFile;
+  // anything to tell runs apart the flags don't, e.g. the machine or the NGL build
+  std::string label;
+  int reps=15;
+  double minMs=20.0;
+  for(int i=1; i<argc; ++i)
+  {
+    if(std::strcmp(argv[i],"--json")==0 && i+1<argc)
+      jsonFile=argv[++i];
+    else if(std::strcmp(argv[i],"--label")==0 && i+1<argc)
+      label=argv[++i];
+    else if(std::strcmp(argv[i],"--reps")==0 && i+1<argc)
+      reps=std::max(1,std::atoi(argv[++i]));
+    else if(std::strcmp(argv[i],"--min-ms")==0 && i+1<argc)
+      minMs=std::max(0.1,std::atof(argv[++i]));
+    else
+    {
+      std::cerr<<"usage "<<argv[0]<<" [--json out.json] [--label text] [--reps n] [--min-ms ms]\n";
+      return EXIT_FAILURE;
+    }
+  }
+
+  // the same kind of values NGLScene feeds in
+  std::mt19937 gen(1234);
+  std::uniform_real_distribution<float> unit(-1.0f,1.0f);
+  std::uniform_real_distribution<float> angle(-180.0f,180.0f);
+  std::vector<float> fov(c_poolSize);
+  std::vector<float> aspect(c_poolSize);
+  std::vector<ngl::Vec3> eye(c_poolSize);
+  std::vector<ngl::Vec4> point(c_poolSize);
+  std::vector<ngl::Mat4> model(c_poolSize);
+  for(size_t i=0; i<c_poolSize; ++i)
+  {
+    fov[i]=35.0f+20.0f*(unit(gen)+1.0f);
+    aspect[i]=1.0f+0.5f*(unit(gen)+1.0f);
+    eye[i].set(unit(gen)*5.0f,1.0f+unit(gen),2.0f+unit(gen));
+    point[i].set(unit(gen),unit(gen),unit(gen),1.0f);
+    ngl::Mat4 t;
+    ngl::Mat4 rX;
+    ngl::Mat4 rY;
+    ngl::Mat4 s;
+    t.translate(unit(gen),unit(gen),unit(gen));
+    rX.rotateX(angle(gen));
+    rY.rotateY(angle(gen));
+    s.scale(1.5f+unit(gen),1.5f+unit(gen),1.5f+unit(gen));
+    model[i]=t*rX*rY*s;
+  }
+  const ngl::Vec3 to(0.0f,0.0f,0.0f);
+  const ngl::Vec3 up(0.0f,1.0f,0.0f);
+  const ngl::Mat4 view=ngl::lookAt(ngl::Vec3(0.0f,1.0f,1.0f),to,up);
+  const ngl::Mat4 MVP=ngl::perspective(45.0f,720.0f/576.0f,0.05f,350.0f)*view*model[0];
+
+  std::printf("%-28s %10s %9s %9s %9s %9s\n","ns/op","iterations","min","median","max","cv");
+  std::vector<Result> results;
+  results.push_back(run("perspective",[&](size_t i){ return ngl::perspective(fov[i],aspect[i],0.05f,350.0f).m_openGL[0]; },reps,minMs));
+  results.push_back(run("ortho",[&](size_t i){ return ngl::ortho(-aspect[i],aspect[i],-1.0f,1.0f,0.1f,fov[i]).m_openGL[14]; },reps,minMs));
+  results.push_back(run("lookAt",[&](size_t i){ return ngl::lookAt(eye[i],to,up).m_openGL[12]; },reps,minMs));
+  results.push_back(run("Mat4 * Mat4",[&](size_t i){ return (view*model[i]).m_openGL[13]; },reps,minMs));
+  results.push_back(run("Mat3 transpose",[&](size_t i) -> float
+  {
+    ngl::Mat3 n;
+    n=model[i];
+    return n.transpose().m_openGL[3];
+  },reps,minMs));
+  // the normal matrix as TransformState used to make it
+  results.push_back(run("Mat3 inverse + transpose",[&](size_t i) -> float
+  {
+    ngl::Mat3 n;
+    n=model[i];
+    n.inverse().transpose();
+    return n.m_openGL[3];
+  },reps,minMs));
+  results.push_back(run("Mat4 * Vec4",[&](size_t i){ return (MVP*point[i]).m_w; },reps,minMs));
+  // one matrix row of the overlay, the cached overlay uses snprintf and the per line one QString
+  results.push_back(run("overlay row snprintf",[&](size_t i) -> float
+  {
+    const float *m=model[i].m_openGL;
+    char line[64];
+    int n=std::snprintf(line,sizeof(line),"[ %+0.4f %+0.4f %+0.4f %+0.4f]",m[0],m[4],m[8],m[12]);
+    return static_cast<float>(n+line[2]);
+  },reps,minMs));
+  results.push_back(run("overlay row QString",[&](size_t i) -> float
+  {
+    const float *m=model[i].m_openGL;
+    QString text;
+    text.sprintf("[ %+0.4f %+0.4f %+0.4f %+0.4f]",m[0],m[4],m[8],m[12]);
+    return static_cast<float>(text.size());
+  },reps,minMs));
+
+  std::cout<<"flags \""<<MATHBENCH_FLAGS<<"\" (sum "<<g_sink<<")\n";
+  if(!jsonFile.empty() && !writeJSON(jsonFile,label,results,reps,minMs))
+    return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
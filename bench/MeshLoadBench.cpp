@@ -0,0 +1,75 @@
+/****************************************************************************
+compares loading a text mesh against mapping the converted binary one
+peak RSS only ever grows so run each mode in its own process
+usage MeshLoadBench text model.obj
+      MeshLoadBench binary model.mvpm
+****************************************************************************/
+#include "MappedMesh.h"
+#include "MeshImport.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sys/resource.h>
+
+namespace
+{
+// sum the data so both paths actually touch every byte they would hand to GL
+double checksum(const float *_p, const float *_n, const uint32_t *_i, size_t _numVerts, size_t _numIndices)
+{
+  double sum=0.0;
+  for(size_t i=0; i<_numVerts*3; ++i)
+    sum+=_p[i]+_n[i];
+  for(size_t i=0; i<_numIndices; ++i)
+    sum+=_i[i];
+  return sum;
+}
+
+long peakRSSKb()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF,&usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss/1024;
+#else
+  return usage.ru_maxrss;
+#endif
+}
+} // end anon namespace
+
+int main(int argc, char **argv)
+{
+  if(argc < 3 || (std::strcmp(argv[1],"text")!=0 && std::strcmp(argv[1],"binary")!=0))
+  {
+    std::cerr<<"usage "<<argv[0]<<" text|binary file\n";
+    return EXIT_FAILURE;
+  }
+  bool text=std::strcmp(argv[1],"text")==0;
+  long baseRSS=peakRSSKb();
+  auto start=std::chrono::high_resolution_clock::now();
+  double sum=0.0;
+  size_t numVerts=0;
+  size_t numIndices=0;
+  if(text)
+  {
+    meshfile::MeshData mesh;
+    if(!meshfile::loadText(argv[2],mesh))
+      return EXIT_FAILURE;
+    numVerts=mesh.vertexCount();
+    numIndices=mesh.indices.size();
+    sum=checksum(mesh.positions.data(),mesh.normals.data(),mesh.indices.data(),numVerts,numIndices);
+  }
+  else
+  {
+    MappedMesh mesh;
+    if(!mesh.open(argv[2]))
+      return EXIT_FAILURE;
+    numVerts=mesh.vertexCount();
+    numIndices=mesh.indexCount();
+    sum=checksum(mesh.positions(),mesh.normals(),mesh.indices(),numVerts,numIndices);
+  }
+  double ms=std::chrono::duration<double,std::milli>(std::chrono::high_resolution_clock::now()-start).count();
+  std::cout<<(text ? "text   " : "binary ")<<argv[2]<<" vertices "<<numVerts<<" triangles "<<numIndices/3
+           <<" load "<<ms<<" ms peak RSS "<<peakRSSKb()<<" KB (+"<<peakRSSKb()-baseRSS<<" KB) checksum "<<sum<<'\n';
+  return EXIT_SUCCESS;
+}
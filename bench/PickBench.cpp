@@ -0,0 +1,144 @@
+/****************************************************************************
+build time, memory and ray throughput of the MeshBVH used for picking. The
+mesh is a MeshConvert file or a generated bumpy sphere with about the given
+number of triangles, rays go through random points of a perspective view
+of it. Every SIMD path is timed through the tree and a sample of the rays
+is checked against testing every triangle, the run fails if any of them
+disagree on the hit or its distance
+usage PickBench [mesh.mvpm | triangles] [rays]
+****************************************************************************/
+#include "MappedMesh.h"
+#include "MeshBVH.h"
+#include "MeshImport.h"
+#include <ngl/Mat4.h>
+#include <ngl/Util.h>
+#include <ngl/Vec3.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace
+{
+constexpr size_t c_checkedRays=200;
+
+//----------------------------------------------------------------------------------------------------------------------
+// a unit sphere with a few octaves of bumps so the tree has some depth complexity to deal with
+//----------------------------------------------------------------------------------------------------------------------
+void makeBumpySphere(size_t _triangles, meshfile::MeshData &_mesh)
+{
+  size_t rings=std::max<size_t>(4,static_cast<size_t>(std::sqrt(_triangles/4.0)));
+  meshfile::makeSuperellipsoid(1.0f,1.0f,rings,1.0f,_mesh);
+  for(size_t i=0; i<_mesh.positions.size(); i+=3)
+  {
+    float *p=&_mesh.positions[i];
+    float theta=std::acos(std::max(-1.0f,std::min(1.0f,p[1])));
+    float phi=std::atan2(p[2],p[0]);
+    float radius=1.0f+0.05f*std::sin(theta*12.0f)*std::cos(phi*9.0f)+0.01f*std::sin(theta*70.0f+phi*50.0f);
+    p[0]*=radius;
+    p[1]*=radius;
+    p[2]*=radius;
+  }
+}
+} // end anon namespace
+
+int main(int argc, char **argv)
+{
+  const char *source = argc > 1 ? argv[1] : "2000000";
+  size_t numRays     = argc > 2 ? std::strtoul(argv[2],nullptr,10) : 1000000;
+
+  meshfile::MeshData generated;
+  MappedMesh file;
+  const float *positions;
+  const uint32_t *indices;
+  size_t numVerts;
+  size_t numIndices;
+  char *end;
+  size_t triangles=std::strtoul(source,&end,10);
+  if(*end=='\0' && triangles>0)
+  {
+    makeBumpySphere(triangles,generated);
+    positions=generated.positions.data();
+    indices=generated.indices.data();
+    numVerts=generated.vertexCount();
+    numIndices=generated.indices.size();
+  }
+  else
+  {
+    if(!file.open(source))
+      return EXIT_FAILURE;
+    positions=file.positions();
+    indices=file.indices();
+    numVerts=file.vertexCount();
+    numIndices=file.indexCount();
+  }
+  std::cout<<"mesh "<<source<<" "<<numVerts<<" vertices "<<numIndices/3<<" triangles\n";
+
+  MeshBVH bvh(positions,numVerts,indices,numIndices);
+  const MeshBVH::Stats &stats=bvh.stats();
+  std::cout<<"build "<<stats.buildMs<<" ms "<<stats.nodes<<" nodes "<<stats.leaves<<" leaves "<<stats.packets
+           <<" packets ("<<100.0f*stats.packetFill()<<"% full) depth "<<stats.depth<<'\n'
+           <<"memory "<<stats.bytes/(1024.0*1024.0)<<" MB "<<static_cast<double>(stats.bytes)/std::max<size_t>(1,stats.triangles)
+           <<" bytes/triangle\n";
+
+  // rays through random pixels of a view that fits a unit sphere, most of them hit
+  ngl::Mat4 MVP=ngl::perspective(45.0f,1.0f,0.05f,350.0f)*
+                ngl::lookAt(ngl::Vec3(0.0f,0.5f,3.0f),ngl::Vec3(0.0f,0.0f,0.0f),ngl::Vec3(0.0f,1.0f,0.0f));
+  std::mt19937 gen(1234);
+  std::uniform_real_distribution<float> ndc(-1.0f,1.0f);
+  std::vector<ngl::Vec3> origins(numRays);
+  std::vector<ngl::Vec3> dirs(numRays);
+  for(size_t i=0; i<numRays; ++i)
+    if(!MeshBVH::unproject(MVP,ndc(gen),ndc(gen),origins[i],dirs[i]))
+    {
+      std::cerr<<"unable to invert the view\n";
+      return EXIT_FAILURE;
+    }
+
+  for(SimdPath path : {SimdPath::Scalar,SimdPath::SSE,SimdPath::AVX2})
+  {
+    if(!BatchTransform::isSupported(path))
+      continue;
+    size_t hits=0;
+    size_t nodes=0;
+    size_t packets=0;
+    auto start=std::chrono::high_resolution_clock::now();
+    for(size_t i=0; i<numRays; ++i)
+    {
+      MeshBVH::Hit hit=bvh.intersect(origins[i],dirs[i],path);
+      hits+=hit.hit;
+      nodes+=hit.nodesVisited;
+      packets+=hit.packetsTested;
+    }
+    double seconds=std::chrono::duration<double>(std::chrono::high_resolution_clock::now()-start).count();
+    std::cout<<BatchTransform::pathName(path)<<" "<<numRays/seconds/1e6<<" Mrays/s "<<1e6*seconds/numRays<<" us/ray hits "
+             <<hits<<" nodes/ray "<<static_cast<double>(nodes)/numRays<<" packets/ray "<<static_cast<double>(packets)/numRays<<'\n';
+  }
+
+  // the tree has to find the same closest hit as testing everything, two triangles can share
+  // the hit on an edge so only the distance has to match
+  size_t checked=std::min(numRays,c_checkedRays);
+  size_t failures=0;
+  auto start=std::chrono::high_resolution_clock::now();
+  for(size_t i=0; i<checked; ++i)
+  {
+    MeshBVH::Hit reference=bvh.intersectAll(origins[i],dirs[i],SimdPath::Scalar);
+    MeshBVH::Hit hit=bvh.intersect(origins[i],dirs[i]);
+    ngl::Vec3 p(origins[i].m_x+dirs[i].m_x*hit.distance,origins[i].m_y+dirs[i].m_y*hit.distance,
+                origins[i].m_z+dirs[i].m_z*hit.distance);
+    float error=std::abs(p.m_x-hit.position.m_x)+std::abs(p.m_y-hit.position.m_y)+std::abs(p.m_z-hit.position.m_z);
+    if(hit.hit!=reference.hit || (hit.hit && (std::abs(hit.distance-reference.distance)>1e-4f*reference.distance || error>1e-4f)))
+    {
+      std::cout<<"FAILED ray "<<i<<" bvh "<<hit.hit<<" "<<hit.triangle<<" "<<hit.distance
+               <<" all "<<reference.hit<<" "<<reference.triangle<<" "<<reference.distance<<'\n';
+      ++failures;
+    }
+  }
+  double seconds=std::chrono::duration<double>(std::chrono::high_resolution_clock::now()-start).count();
+  std::cout<<"every triangle "<<checked/seconds<<" rays/s, "<<checked<<" rays checked "<<failures<<" failed\n";
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,87 @@
+/****************************************************************************
+scene throughput for the SoftwareRenderer, renders a tessellated sphere at
+1920x1080 with 1,2,4... threads up to the number of cores and reports
+frames / second and triangles / second for each
+usage RasterBench [slices] [frames] [output.ppm]
+****************************************************************************/
+#include "SoftwareRenderer.h"
+#include <ngl/Mat3.h>
+#include <ngl/Mat4.h>
+#include <ngl/Util.h>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+void buildSphere(int _slices, std::vector<ngl::Vec3> &o_verts, std::vector<ngl::Vec3> &o_normals)
+{
+  auto point=[_slices](int _i, int _j)
+  {
+    float theta=static_cast<float>(M_PI)*_i/_slices;
+    float phi=2.0f*static_cast<float>(M_PI)*_j/_slices;
+    return ngl::Vec3(std::sin(theta)*std::cos(phi),std::cos(theta),std::sin(theta)*std::sin(phi));
+  };
+  for(int i=0; i<_slices; ++i)
+  {
+    for(int j=0; j<_slices; ++j)
+    {
+      ngl::Vec3 quad[6]={point(i,j),point(i+1,j),point(i+1,j+1),point(i,j),point(i+1,j+1),point(i,j+1)};
+      for(auto &p : quad)
+      {
+        o_verts.push_back(p*0.5f);
+        o_normals.push_back(p);
+      }
+    }
+  }
+}
+} // end anon namespace
+
+int main(int argc, char **argv)
+{
+  int slices = argc > 1 ? std::atoi(argv[1]) : 256;
+  int frames = argc > 2 ? std::atoi(argv[2]) : 10;
+  std::vector<ngl::Vec3> verts;
+  std::vector<ngl::Vec3> normals;
+  buildSphere(slices,verts,normals);
+  size_t numTris=verts.size()/3;
+
+  // same camera as NGLScene::initializeGL
+  ngl::Vec3 from(0,1,1);
+  ngl::Mat4 view=ngl::lookAt(from,ngl::Vec3(0,0,0),ngl::Vec3(0,1,0));
+  ngl::Mat4 project=ngl::perspective(45.0f,1920.0f/1080.0f,0.05f,350.0f);
+  ngl::Mat4 M;
+  ngl::Mat4 MV=view*M;
+  ngl::Mat4 MVP=project*MV;
+  ngl::Mat3 normalMatrix=MV;
+  normalMatrix.inverse().transpose();
+
+  SoftwareRenderer renderer(1920,1080);
+  renderer.setMatrices(MVP,MV,normalMatrix,M);
+  renderer.setViewerPos(from);
+
+  unsigned int cores=std::max(1u,std::thread::hardware_concurrency());
+  std::cout<<"triangles "<<numTris<<" frames "<<frames<<" cores "<<cores<<'\n';
+  for(unsigned int threads=1; ; threads=std::min(threads*2,cores))
+  {
+    renderer.setNumThreads(threads);
+    auto start=std::chrono::high_resolution_clock::now();
+    for(int f=0; f<frames; ++f)
+    {
+      renderer.clear();
+      renderer.drawTriangles(&verts[0],&normals[0],verts.size());
+    }
+    auto end=std::chrono::high_resolution_clock::now();
+    double seconds=std::chrono::duration<double>(end-start).count();
+    std::cout<<"threads "<<threads<<" fps "<<frames/seconds
+             <<" tris/sec "<<(static_cast<double>(numTris)*frames)/seconds<<'\n';
+    if(threads==cores)
+      break;
+  }
+  if(argc > 3)
+    renderer.writePPM(argv[3]);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,107 @@
+/****************************************************************************
+the dynamic resolution controller run against a simulated frame cost, a
+cpu part the scale can't touch and a gpu part, fixed plus some that goes
+with the number of pixels, with noise. The gpu time is what the demo feeds
+it, arriving a few frames late like the timer queries. Each scenario has to
+settle with the gpu inside the budget and stay put, and a cpu bound frame
+has to stay at full size, the run fails if one ends over budget, is still
+changing scale at the end or ends at the wrong scale
+usage ScalerBench [frames per scenario]
+****************************************************************************/
+#include "ResolutionScaler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <random>
+
+namespace
+{
+constexpr size_t c_latency=4;
+constexpr float c_budgetMs=1000.0f/60.0f;
+
+struct Scenario
+{
+  const char *name;
+  float cpuMs;
+  float fixedMs;
+  //----------------------------------------------------------------------------------------------------------------------
+  // the per pixel part at full scale, it jumps to afterMs half way through
+  //----------------------------------------------------------------------------------------------------------------------
+  float pixelMs;
+  float afterMs;
+  //----------------------------------------------------------------------------------------------------------------------
+  // the scale the run has to end at or below (above for the light ones)
+  //----------------------------------------------------------------------------------------------------------------------
+  float expectScale;
+  bool expectBelow;
+};
+
+bool run(const Scenario &_scenario, int _frames)
+{
+  ResolutionScaler scaler(c_budgetMs);
+  std::mt19937 gen(1234);
+  std::normal_distribution<float> noise(0.0f,0.3f);
+  std::deque<float> inFlight;
+  bool ok=true;
+  std::cout<<_scenario.name<<'\n';
+  for(int half=0; half<2; ++half)
+  {
+    float pixelMs=half==0 ? _scenario.pixelMs : _scenario.afterMs;
+    float sum=0.0f;
+    int counted=0;
+    size_t changes=0;
+    for(int f=0; f<_frames; ++f)
+    {
+      // the last quarter of each half is the steady state
+      if(f==_frames-_frames/4)
+        changes=scaler.changes();
+      float s=scaler.scale();
+      // the frame takes the longer of this and cpuMs, only the gpu part is measured for the scaler
+      float cost=_scenario.fixedMs+pixelMs*s*s;
+      inFlight.push_back(std::max(0.1f,cost+noise(gen)));
+      if(inFlight.size()>c_latency)
+      {
+        scaler.addSample(inFlight.front());
+        inFlight.pop_front();
+      }
+      if(f>=_frames-_frames/4)
+      {
+        sum+=cost;
+        ++counted;
+      }
+    }
+    float steadyMs=sum/counted;
+    size_t lateChanges=scaler.changes()-changes;
+    bool budgetOk=steadyMs<=c_budgetMs || scaler.scale()<=ResolutionScaler::c_minScale+1e-3f;
+    bool scaleOk=half==0 || (_scenario.expectBelow ? scaler.scale()<=_scenario.expectScale+1e-3f
+                                                    : scaler.scale()>=_scenario.expectScale-1e-3f);
+    bool halfOk=budgetOk && scaleOk && lateChanges==0;
+    std::cout<<(halfOk ? "  ok     " : "  FAILED ")<<"scale "<<scaler.scale()<<" steady gpu "<<steadyMs<<" ms frame "
+             <<std::max(steadyMs,_scenario.cpuMs)<<" ms budget "<<c_budgetMs<<" ms changes "<<scaler.changes()<<" (last quarter "<<lateChanges<<")\n";
+    ok&=halfOk;
+  }
+  return ok;
+}
+} // end anon namespace
+
+int main(int argc, char **argv)
+{
+  int frames = argc > 1 ? std::atoi(argv[1]) : 400;
+  const Scenario scenarios[]=
+  {
+    // fill bound at twice the budget, then the load goes away and it should grow back to full size
+    {"heavy then light",4.0f,2.0f,30.0f,8.0f,1.0f,false},
+    // fits at full size all along
+    {"light",4.0f,2.0f,10.0f,10.0f,1.0f,false},
+    // gets heavier half way
+    {"light then heavy",4.0f,2.0f,10.0f,25.0f,0.85f,true},
+    // over budget on the cpu, a smaller scale wouldn't help so it has to stay at full size
+    {"cpu bound",25.0f,0.5f,2.0f,2.0f,1.0f,false}
+  };
+  bool ok=true;
+  for(const auto &scenario : scenarios)
+    ok&=run(scenario,frames);
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,227 @@
+/****************************************************************************
+checks that frame times stay flat while MeshStreamer loads a large mesh on
+its worker thread. A grid mesh of about the requested size is written once
+(and kept for later runs), then a fixed frame is timed with no streaming as
+the baseline and again while the mesh streams in. The run fails if the
+mesh never becomes resident or the p99 frame time while streaming is more
+than tolerance times the baseline p99 plus slackMs. For comparison the same
+file is then loaded on the render thread the way NGLScene::loadMesh does,
+note the file is in the page cache by then so that is a best case. For
+Mesa's software GL run with
+LIBGL_ALWAYS_SOFTWARE=1 QT_QPA_PLATFORM=offscreen ./StreamBench
+from the project root (so the shaders can be found)
+usage StreamBench [meshMB] [mesh file] [tolerance] [slackMs]
+****************************************************************************/
+#include "MappedMesh.h"
+#include "MeshImport.h"
+#include "MeshStreamer.h"
+#include "PackedMesh.h"
+#include "ShaderCache.h"
+#include <ngl/NGLInit.h>
+#include <ngl/ShaderLib.h>
+#include <ngl/Util.h>
+#include <QGuiApplication>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+constexpr size_t c_baselineFrames=120;
+constexpr size_t c_objects=400;
+constexpr double c_timeoutMs=300000.0;
+
+//----------------------------------------------------------------------------------------------------------------------
+// a wavy grid at 48 bytes a vertex in the file (positions, normals and about 6 indices)
+//----------------------------------------------------------------------------------------------------------------------
+bool writeGrid(const std::string &_fname, size_t _megabytes)
+{
+  size_t side=static_cast<size_t>(std::sqrt(_megabytes*1024.0*1024.0/48.0));
+  meshfile::MeshData mesh;
+  mesh.positions.reserve(side*side*3);
+  for(size_t z=0; z<side; ++z)
+    for(size_t x=0; x<side; ++x)
+    {
+      float u=static_cast<float>(x)/side-0.5f;
+      float v=static_cast<float>(z)/side-0.5f;
+      mesh.positions.insert(mesh.positions.end(),{u,0.05f*std::sin(u*40.0f)*std::cos(v*40.0f),v});
+    }
+  mesh.indices.reserve((side-1)*(side-1)*6);
+  for(size_t z=0; z+1<side; ++z)
+    for(size_t x=0; x+1<side; ++x)
+    {
+      uint32_t i=static_cast<uint32_t>(z*side+x);
+      uint32_t s=static_cast<uint32_t>(side);
+      mesh.indices.insert(mesh.indices.end(),{i,i+s,i+1,i+1,i+s,i+s+1});
+    }
+  meshfile::computeNormals(mesh);
+  std::cout<<"writing "<<_fname<<" "<<mesh.vertexCount()<<" vertices\n";
+  return meshfile::writeMesh(_fname,mesh);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// the render thread's work for a frame, c_objects draws each with their own matrices
+//----------------------------------------------------------------------------------------------------------------------
+double drawFrame(const PackedMesh &_mesh, const ngl::Mat4 &_VP)
+{
+  ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+  auto start=std::chrono::high_resolution_clock::now();
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  for(size_t i=0; i<c_objects; ++i)
+  {
+    ngl::Mat4 M;
+    M.translate((static_cast<float>(i%20)/20.0f-0.5f)*4.0f,(static_cast<float>(i/20)/20.0f-0.5f)*4.0f,0.0f);
+    shader->setUniform("M",M);
+    shader->setUniform("MV",M);
+    shader->setUniform("MVP",_VP*M);
+    _mesh.draw();
+  }
+  // the frame is only done when the gpu is, as it would be at the swap
+  glFinish();
+  return std::chrono::duration<double,std::milli>(std::chrono::high_resolution_clock::now()-start).count();
+}
+
+double percentile(std::vector<double> _ms, double _p)
+{
+  if(_ms.empty())
+    return 0.0;
+  std::sort(_ms.begin(),_ms.end());
+  return _ms[std::min(_ms.size()-1,static_cast<size_t>(_p*(_ms.size()-1)+0.5))];
+}
+
+void report(const char *_name, const std::vector<double> &_ms)
+{
+  std::cout<<_name<<" frames "<<_ms.size()<<" p50 "<<percentile(_ms,0.5)<<" p99 "<<percentile(_ms,0.99)
+           <<" max "<<percentile(_ms,1.0)<<" ms\n";
+}
+} // end anon namespace
+
+int main(int argc, char **argv)
+{
+  QGuiApplication app(argc, argv);
+  size_t megabytes  = argc > 1 ? std::strtoul(argv[1],nullptr,10) : 300;
+  std::string fname = argc > 2 ? argv[2] : "streamBench.mesh";
+  double tolerance  = argc > 3 ? std::atof(argv[3]) : 1.5;
+  double slackMs    = argc > 4 ? std::atof(argv[4]) : 2.0;
+
+  MappedMesh existing;
+  if(!existing.open(fname) || existing.size()<megabytes*1024*1024*9/10)
+  {
+    existing.close();
+    if(!writeGrid(fname,megabytes))
+      return EXIT_FAILURE;
+  }
+  existing.close();
+
+  QSurfaceFormat format;
+  format.setMajorVersion(4);
+  format.setMinorVersion(5);
+  format.setProfile(QSurfaceFormat::CoreProfile);
+  QOffscreenSurface surface;
+  surface.setFormat(format);
+  surface.create();
+  QOpenGLContext context;
+  context.setFormat(format);
+  if(!context.create() || !context.makeCurrent(&surface))
+  {
+    std::cerr<<"unable to create an OpenGL context\n";
+    return EXIT_FAILURE;
+  }
+  ngl::NGLInit::instance();
+  std::cout<<"GL_RENDERER "<<glGetString(GL_RENDERER)<<'\n';
+  QOpenGLFramebufferObject fbo(1024,720,QOpenGLFramebufferObject::Depth);
+  fbo.bind();
+  glViewport(0,0,1024,720);
+  glEnable(GL_DEPTH_TEST);
+
+  // the individual matrix uniforms keep the frame simple, see UniformBench
+  ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+  ShaderCache cache(".shadercache","#define LEGACY_UNIFORMS");
+  if(!cache.loadProgram("PhongLegacy",{{"PhongVertexLegacy",ngl::ShaderType::VERTEX,"shaders/PhongVertex.glsl"},
+                                       {"PhongFragmentLegacy",ngl::ShaderType::FRAGMENT,"shaders/PhongFragment.glsl"}}))
+  {
+    std::cerr<<"unable to build the Phong shader\n";
+    return EXIT_FAILURE;
+  }
+  (*shader)["PhongLegacy"]->use();
+  ngl::Mat4 view=ngl::lookAt(ngl::Vec3(0,0,5),ngl::Vec3(0,0,0),ngl::Vec3(0,1,0));
+  ngl::Mat4 VP=ngl::perspective(45.0f,1024.0f/720.0f,0.05f,350.0f)*view;
+  ngl::Mat3 normalMatrix;
+  shader->setUniform("normalMatrix",normalMatrix);
+  const float verts[]={0.0f,0.5f,0.0f, 0.5f,-0.5f,0.0f, -0.5f,-0.5f,0.0f};
+  const float normals[]={0.0f,1.0f,0.0f, 0.0f,1.0f,0.0f, 0.0f,1.0f,0.0f};
+  PackedMesh triangle(verts,normals,3,nullptr,0,PackedMesh::Format::Float);
+
+  // a few frames to settle then the baseline
+  for(int i=0; i<10; ++i)
+    drawFrame(triangle,VP);
+  std::vector<double> baseline;
+  for(size_t i=0; i<c_baselineFrames; ++i)
+    baseline.push_back(drawFrame(triangle,VP));
+  report("baseline ",baseline);
+
+  // the streamer is made while nothing else has the context current
+  MeshStreamer streamer(&context);
+  if(!streamer.isValid())
+    return EXIT_FAILURE;
+  std::vector<double> streaming;
+  std::unique_ptr<StreamedMesh> mesh;
+  size_t maxInFlight=0;
+  auto start=std::chrono::high_resolution_clock::now();
+  streamer.request(fname);
+  while(!mesh)
+  {
+    for(auto &m : streamer.poll())
+      mesh=std::move(m);
+    maxInFlight=std::max(maxInFlight,streamer.stats().bytesInFlight);
+    streaming.push_back(drawFrame(triangle,VP));
+    if(std::chrono::duration<double,std::milli>(std::chrono::high_resolution_clock::now()-start).count()>c_timeoutMs)
+    {
+      std::cerr<<"FAILED the mesh didn't become resident within "<<c_timeoutMs/1000.0<<" s\n";
+      return EXIT_FAILURE;
+    }
+  }
+  report("streaming",streaming);
+  MeshStreamer::Stats stats=streamer.stats();
+  std::cout<<"streamed "<<stats.bytesUploaded/(1024*1024)<<" MB in "<<stats.lastMeshMs<<" ms "
+           <<stats.lastMeshMBps<<" MB/s, max in flight "<<maxInFlight/1024<<" KB\n";
+  // the resident mesh has to draw from this context
+  while(glGetError()!=GL_NO_ERROR)
+    ;
+  shader->setUniform("MVP",VP);
+  mesh->draw();
+  glFinish();
+  bool ok=glGetError()==GL_NO_ERROR;
+  if(!ok)
+    std::cout<<"FAILED GL error drawing the streamed mesh\n";
+
+  double limit=percentile(baseline,0.99)*tolerance+slackMs;
+  double p99=percentile(streaming,0.99);
+  std::cout<<"streaming p99 "<<p99<<" ms limit "<<limit<<" ms"<<(p99>limit ? " FAILED" : "")<<'\n';
+  ok&=p99<=limit;
+
+  // what loadMesh costs the render thread for the same file
+  auto syncStart=std::chrono::high_resolution_clock::now();
+  MappedMesh file;
+  file.open(fname);
+  GLuint buffers[2];
+  glGenBuffers(2,buffers);
+  glBindBuffer(GL_ARRAY_BUFFER,buffers[0]);
+  glBufferData(GL_ARRAY_BUFFER,static_cast<GLsizeiptr>(file.vertexBlockSize()),file.positions(),GL_STATIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER,buffers[1]);
+  glBufferData(GL_ARRAY_BUFFER,static_cast<GLsizeiptr>(file.indexCount()*sizeof(uint32_t)),file.indices(),GL_STATIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER,0);
+  glFinish();
+  double syncMs=std::chrono::duration<double,std::milli>(std::chrono::high_resolution_clock::now()-syncStart).count();
+  glDeleteBuffers(2,buffers);
+  std::cout<<"loading on the render thread stalls a frame for "<<syncMs<<" ms\n";
+  mesh.reset();
+  fbo.release();
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
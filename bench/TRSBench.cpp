@@ -0,0 +1,175 @@
+/****************************************************************************
+accuracy and speed of the closed form TRSCompose matrices against the ngl
+T*R*R*R*S products and general inverse the demo used before, every euler
+order is checked and the run fails if any of them is out of tolerance
+usage TRSBench [numTransforms] [iterations]
+****************************************************************************/
+#include "TRSCompose.h"
+#include <ngl/Mat3.h>
+#include <ngl/Mat4.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// the constexpr path, a quarter turn about z scaled by 2 and moved along x is fixed at compile time
+constexpr Affine4 c_fixed=TRSCompose::affine(TRSCompose::rotation<EulerOrder::XYZ>(SinCos{0.0f,1.0f},SinCos{0.0f,1.0f},SinCos{1.0f,0.0f}),
+                                             3.0f,0.0f,0.0f,2.0f,2.0f,2.0f);
+static_assert(c_fixed.m[1]==2.0f && c_fixed.m[4]==-2.0f && c_fixed.m[10]==2.0f && c_fixed.m[12]==3.0f,"constexpr TRS");
+
+namespace
+{
+  struct Input
+  {
+    ngl::Vec3 pos;
+    ngl::Vec3 rot;
+    ngl::Vec3 scale;
+  };
+
+  ngl::Mat4 axisProduct(EulerOrder _order, const ngl::Mat4 &_x, const ngl::Mat4 &_y, const ngl::Mat4 &_z)
+  {
+    switch(_order)
+    {
+      case EulerOrder::XYZ : return _x*_y*_z;
+      case EulerOrder::XZY : return _x*_z*_y;
+      case EulerOrder::YXZ : return _y*_x*_z;
+      case EulerOrder::YZX : return _y*_z*_x;
+      case EulerOrder::ZXY : return _z*_x*_y;
+      case EulerOrder::ZYX : default : return _z*_y*_x;
+    }
+  }
+
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief what TransformState did before, five general multiplies and a general inverse
+  //----------------------------------------------------------------------------------------------------------------------
+  void reference(EulerOrder _order, const Input &_in, ngl::Mat4 &_M, ngl::Mat3 &_normal)
+  {
+    ngl::Mat4 t;
+    ngl::Mat4 rX;
+    ngl::Mat4 rY;
+    ngl::Mat4 rZ;
+    ngl::Mat4 s;
+    t.translate(_in.pos.m_x,_in.pos.m_y,_in.pos.m_z);
+    rX.rotateX(_in.rot.m_x);
+    rY.rotateY(_in.rot.m_y);
+    rZ.rotateZ(_in.rot.m_z);
+    s.scale(_in.scale.m_x,_in.scale.m_y,_in.scale.m_z);
+    _M=t*axisProduct(_order,rX,rY,rZ)*s;
+    _normal=_M;
+    _normal.inverse().transpose();
+  }
+
+  template <EulerOrder O>
+  void closedForm(const Input &_in, ngl::Mat4 &_M, ngl::Mat3 &_normal)
+  {
+    TRSCompose::compose<O>(_in.pos,_in.rot,_in.scale,_M,&_normal);
+  }
+
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief largest difference relative to the size of the reference entry
+  //----------------------------------------------------------------------------------------------------------------------
+  float maxError(const float *_a, const float *_b, int _n)
+  {
+    float error=0.0f;
+    for(int i=0; i<_n; ++i)
+      error=std::max(error,std::abs(_a[i]-_b[i])/std::max(1.0f,std::abs(_b[i])));
+    return error;
+  }
+
+  template <EulerOrder O>
+  bool check(const char *_name, const std::vector<Input> &_inputs)
+  {
+    float errorM=0.0f;
+    float errorN=0.0f;
+    for(const auto &in : _inputs)
+    {
+      ngl::Mat4 refM;
+      ngl::Mat3 refN;
+      reference(O,in,refM,refN);
+      ngl::Mat4 M;
+      ngl::Mat3 N;
+      closedForm<O>(in,M,N);
+      errorM=std::max(errorM,maxError(M.m_openGL,refM.m_openGL,16));
+      errorN=std::max(errorN,maxError(N.m_openGL,refN.m_openGL,9));
+    }
+    // the reference inverse loses a few bits on the smaller scales
+    bool ok=errorM<1e-5f && errorN<1e-4f;
+    std::cout<<_name<<" max error M "<<errorM<<" normal "<<errorN<<(ok ? "" : " FAILED")<<'\n';
+    return ok;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  size_t numTransforms = argc > 1 ? std::strtoul(argv[1],nullptr,10) : 100000;
+  int iterations       = argc > 2 ? std::atoi(argv[2]) : 20;
+
+  std::vector<Input> inputs(numTransforms);
+  std::mt19937 gen(1234);
+  std::uniform_real_distribution<float> position(-10.0f,10.0f);
+  std::uniform_real_distribution<float> angle(-360.0f,360.0f);
+  std::uniform_real_distribution<float> scale(0.25f,4.0f);
+  for(auto &in : inputs)
+  {
+    in.pos.set(position(gen),position(gen),position(gen));
+    in.rot.set(angle(gen),angle(gen),angle(gen));
+    in.scale.set(scale(gen),scale(gen),scale(gen));
+  }
+
+  bool ok=check<EulerOrder::XYZ>("XYZ",inputs);
+  ok&=check<EulerOrder::XZY>("XZY",inputs);
+  ok&=check<EulerOrder::YXZ>("YXZ",inputs);
+  ok&=check<EulerOrder::YZX>("YZX",inputs);
+  ok&=check<EulerOrder::ZXY>("ZXY",inputs);
+  ok&=check<EulerOrder::ZYX>("ZYX",inputs);
+
+  // the overlay's S*Rz*Ry*Rx*T
+  float errorDisplay=0.0f;
+  for(const auto &in : inputs)
+  {
+    ngl::Mat4 t;
+    ngl::Mat4 rX;
+    ngl::Mat4 rY;
+    ngl::Mat4 rZ;
+    ngl::Mat4 s;
+    t.translate(in.pos.m_x,in.pos.m_y,in.pos.m_z);
+    rX.rotateX(in.rot.m_x);
+    rY.rotateY(in.rot.m_y);
+    rZ.rotateZ(in.rot.m_z);
+    s.scale(in.scale.m_x,in.scale.m_y,in.scale.m_z);
+    ngl::Mat4 ref=s*rZ*rY*rX*t;
+    ngl::Mat4 M;
+    TRSCompose::composeReversed<EulerOrder::ZYX>(in.pos,in.rot,in.scale,M);
+    errorDisplay=std::max(errorDisplay,maxError(M.m_openGL,ref.m_openGL,16));
+  }
+  // the translation goes through the rotation and scale so picks up more rounding
+  std::cout<<"S*R*T max error "<<errorDisplay<<'\n';
+  ok&=errorDisplay<1e-4f;
+
+  // the sum of one entry stops the loops being optimised away
+  auto timeCompose=[&](const char *_name, void (*_compose)(const Input &, ngl::Mat4 &, ngl::Mat3 &)) -> double
+  {
+    float sink=0.0f;
+    auto start=std::chrono::high_resolution_clock::now();
+    for(int it=0; it<iterations; ++it)
+      for(const auto &in : inputs)
+      {
+        ngl::Mat4 M;
+        ngl::Mat3 N;
+        _compose(in,M,N);
+        sink+=M.m_openGL[0]+N.m_openGL[4];
+      }
+    double seconds=std::chrono::duration<double>(std::chrono::high_resolution_clock::now()-start).count();
+    double ns=seconds*1e9/(static_cast<double>(numTransforms)*iterations);
+    std::cout<<_name<<" "<<ns<<" ns/transform (sum "<<sink<<")\n";
+    return ns;
+  };
+  std::cout<<"transforms "<<numTransforms<<" iterations "<<iterations<<'\n';
+  double ref=timeCompose("ngl products + inverse",[](const Input &_in, ngl::Mat4 &_M, ngl::Mat3 &_N){ reference(EulerOrder::XYZ,_in,_M,_N); });
+  double closed=timeCompose("closed form XYZ",closedForm<EulerOrder::XYZ>);
+  std::cout<<"speedup "<<ref/closed<<"x\n";
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
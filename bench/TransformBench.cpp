@@ -0,0 +1,65 @@
+/****************************************************************************
+micro benchmark for the BatchTransform kernels, reports vertices / second
+for each code path the host cpu supports
+usage TransformBench [numVerts] [iterations]
+****************************************************************************/
+#include "BatchTransform.h"
+#include <ngl/Mat4.h>
+#include <ngl/Util.h>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+int main(int argc, char **argv)
+{
+  size_t numVerts = argc > 1 ? std::strtoul(argv[1],nullptr,10) : 4000000;
+  int iterations  = argc > 2 ? std::atoi(argv[2]) : 20;
+
+  VertexBatchSoA in;
+  in.resize(numVerts);
+  std::mt19937 gen(1234);
+  std::uniform_real_distribution<float> dist(-1.0f,1.0f);
+  for(size_t i=0; i<numVerts; ++i)
+  {
+    in.x[i]=dist(gen);
+    in.y[i]=dist(gen);
+    in.z[i]=dist(gen);
+  }
+  ngl::Mat4 MVP=ngl::perspective(45.0f,1.0f,0.05f,350.0f)*
+                ngl::lookAt(ngl::Vec3(0,1,1),ngl::Vec3(0,0,0),ngl::Vec3(0,1,0));
+
+  ClipBatchSoA reference;
+  BatchTransform::transform(MVP,in,reference,SimdPath::Scalar);
+
+  std::cout<<"vertices "<<numVerts<<" iterations "<<iterations
+           <<" best path "<<BatchTransform::pathName(BatchTransform::bestPath())<<'\n';
+  const SimdPath paths[]={SimdPath::Scalar,SimdPath::SSE,SimdPath::AVX2,SimdPath::AVX512};
+  for(auto path : paths)
+  {
+    if(!BatchTransform::isSupported(path))
+    {
+      std::cout<<BatchTransform::pathName(path)<<" not supported\n";
+      continue;
+    }
+    ClipBatchSoA out;
+    // warm up and check against the scalar path
+    BatchTransform::transform(MVP,in,out,path);
+    float maxError=0.0f;
+    for(size_t i=0; i<numVerts; ++i)
+    {
+      maxError=std::max(maxError,std::abs(out.x[i]-reference.x[i]));
+      maxError=std::max(maxError,std::abs(out.w[i]-reference.w[i]));
+    }
+    auto start=std::chrono::high_resolution_clock::now();
+    for(int i=0; i<iterations; ++i)
+      BatchTransform::transform(MVP,in,out,path);
+    auto end=std::chrono::high_resolution_clock::now();
+    double seconds=std::chrono::duration<double>(end-start).count();
+    std::cout<<BatchTransform::pathName(path)<<" "
+             <<(static_cast<double>(numVerts)*iterations)/seconds<<" verts/sec"
+             <<" max error "<<maxError<<'\n';
+  }
+  return EXIT_SUCCESS;
+}
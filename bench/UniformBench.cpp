@@ -0,0 +1,158 @@
+/****************************************************************************
+cpu cost per object of sending the Phong matrices with four setUniform calls
+against the TransformUBO ring, renders into an offscreen FBO so it can run
+headless, for Mesa's software GL run with
+LIBGL_ALWAYS_SOFTWARE=1 QT_QPA_PLATFORM=offscreen ./UniformBench
+from the project root (so the shaders can be found)
+usage UniformBench [frames] [objects ...]
+****************************************************************************/
+#include "PackedMesh.h"
+#include "ShaderCache.h"
+#include "TransformUBO.h"
+#include <ngl/NGLInit.h>
+#include <ngl/ShaderLib.h>
+#include <ngl/Util.h>
+#include <QGuiApplication>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+//----------------------------------------------------------------------------------------------------------------------
+// the same grid of translated copies as the culled scene
+//----------------------------------------------------------------------------------------------------------------------
+ngl::Mat4 objectMatrix(size_t _i, size_t _count)
+{
+  size_t side=1;
+  while(side*side<_count)
+    ++side;
+  ngl::Mat4 tx;
+  tx.translate((static_cast<float>(_i%side)/side-0.5f)*4.0f,(static_cast<float>(_i/side)/side-0.5f)*4.0f,0.0f);
+  return tx;
+}
+} // end anon namespace
+
+int main(int argc, char **argv)
+{
+  QGuiApplication app(argc, argv);
+  int frames = argc > 1 ? std::atoi(argv[1]) : 100;
+  std::vector<size_t> counts;
+  for(int i=2; i<argc; ++i)
+    counts.push_back(std::strtoul(argv[i],nullptr,10));
+  if(counts.empty())
+    counts={100,1000,10000};
+  size_t maxObjects=0;
+  for(auto c : counts)
+    maxObjects=std::max(maxObjects,c);
+
+  QSurfaceFormat format;
+  format.setMajorVersion(4);
+  format.setMinorVersion(5);
+  format.setProfile(QSurfaceFormat::CoreProfile);
+  QOffscreenSurface surface;
+  surface.setFormat(format);
+  surface.create();
+  QOpenGLContext context;
+  context.setFormat(format);
+  if(!context.create() || !context.makeCurrent(&surface))
+  {
+    std::cerr<<"unable to create an OpenGL context\n";
+    return EXIT_FAILURE;
+  }
+  ngl::NGLInit::instance();
+  std::cout<<"GL_RENDERER "<<glGetString(GL_RENDERER)<<'\n';
+  QOpenGLFramebufferObject fbo(1024,720,QOpenGLFramebufferObject::Depth);
+  fbo.bind();
+  glViewport(0,0,1024,720);
+  glEnable(GL_DEPTH_TEST);
+
+  // the legacy build of the same shader keeps the individual matrix uniforms
+  ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+  ShaderCache cache(".shadercache");
+  ShaderCache legacyCache(".shadercache","#define LEGACY_UNIFORMS");
+  if(!cache.loadProgram("Phong",{{"PhongVertex",ngl::ShaderType::VERTEX,"shaders/PhongVertex.glsl"},
+                                 {"PhongFragment",ngl::ShaderType::FRAGMENT,"shaders/PhongFragment.glsl"}}) ||
+     !legacyCache.loadProgram("PhongLegacy",{{"PhongVertexLegacy",ngl::ShaderType::VERTEX,"shaders/PhongVertex.glsl"},
+                                             {"PhongFragmentLegacy",ngl::ShaderType::FRAGMENT,"shaders/PhongFragment.glsl"}}))
+  {
+    std::cerr<<"unable to build the Phong shaders\n";
+    return EXIT_FAILURE;
+  }
+  TransformUBO::bindBlock(shader->getProgramID("Phong"));
+
+  const float verts[]={0.0f,0.5f,0.0f, 0.5f,-0.5f,0.0f, -0.5f,-0.5f,0.0f};
+  const float normals[]={0.0f,1.0f,0.0f, 0.0f,1.0f,0.0f, 0.0f,1.0f,0.0f};
+  PackedMesh mesh(verts,normals,3,nullptr,0,PackedMesh::Format::Float);
+  TransformUBO ubo(maxObjects);
+  std::cout<<"persistent mapped "<<(ubo.persistentMapped() ? "yes" : "no")<<'\n';
+  ngl::Mat4 view=ngl::lookAt(ngl::Vec3(0,0,5),ngl::Vec3(0,0,0),ngl::Vec3(0,1,0));
+  ngl::Mat4 project=ngl::perspective(45.0f,1024.0f/720.0f,0.05f,350.0f);
+  ngl::Mat3 normalMatrix=view;
+  normalMatrix.inverse().transpose();
+
+  for(auto count : counts)
+  {
+    // submit is the cpu time to issue the frame, total includes waiting for the gpu to draw it
+    double submitMs[2]={0.0,0.0};
+    double totalMs[2]={0.0,0.0};
+    for(int path=0; path<2; ++path)
+    {
+      (*shader)[path==0 ? "PhongLegacy" : "Phong"]->use();
+      glFinish();
+      auto start=std::chrono::high_resolution_clock::now();
+      for(int f=0; f<frames; ++f)
+      {
+        auto frameStart=std::chrono::high_resolution_clock::now();
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        if(path==0)
+        {
+          for(size_t i=0; i<count; ++i)
+          {
+            ngl::Mat4 M=objectMatrix(i,count);
+            ngl::Mat4 MV=view*M;
+            shader->setUniform("M",M);
+            shader->setUniform("MV",MV);
+            shader->setUniform("MVP",project*MV);
+            shader->setUniform("normalMatrix",normalMatrix);
+            mesh.draw();
+          }
+        }
+        else
+        {
+          ubo.begin(count);
+          for(size_t i=0; i<count; ++i)
+          {
+            ngl::Mat4 M=objectMatrix(i,count);
+            ngl::Mat4 MV=view*M;
+            ubo.set(i,project*MV,MV,M,normalMatrix);
+          }
+          ubo.upload();
+          for(size_t i=0; i<count; ++i)
+          {
+            ubo.bind(i);
+            mesh.draw();
+          }
+          ubo.end();
+        }
+        submitMs[path]+=std::chrono::duration<double,std::milli>(std::chrono::high_resolution_clock::now()-frameStart).count();
+      }
+      glFinish();
+      totalMs[path]=std::chrono::duration<double,std::milli>(std::chrono::high_resolution_clock::now()-start).count();
+    }
+    double objects=static_cast<double>(count)*frames;
+    std::cout<<"objects "<<count
+             <<" setUniform submit us/object "<<1000.0*submitMs[0]/objects
+             <<" ms/frame "<<totalMs[0]/frames
+             <<" | ubo submit us/object "<<1000.0*submitMs[1]/objects
+             <<" ms/frame "<<totalMs[1]/frames
+             <<" | submit speedup "<<submitMs[0]/submitMs[1]<<"x\n";
+  }
+  fbo.release();
+  return EXIT_SUCCESS;
+}
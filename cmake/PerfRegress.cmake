@@ -0,0 +1,40 @@
+# replays every session in SESSIONS_DIR with MVPDemo --replay and checks each report against
+# BASELINE_DIR/<session>.json with PerfCompare, run by the perf_regress target as
+# cmake -DMVPDEMO=... -DPERFCOMPARE=... -DSESSIONS_DIR=... -DBASELINE_DIR=... -DOUT_DIR=... [-DTOLERANCE=0.15] -P PerfRegress.cmake
+# a session with no baseline fails. With -DUPDATE_BASELINE=ON (the perf_update_baseline target)
+# the reports are copied to BASELINE_DIR instead, commit those from the machine the checks run on
+# as the numbers are only comparable on the same hardware
+if(NOT DEFINED TOLERANCE)
+  set(TOLERANCE 0.15)
+endif()
+file(MAKE_DIRECTORY ${OUT_DIR})
+if(UPDATE_BASELINE)
+  file(MAKE_DIRECTORY ${BASELINE_DIR})
+endif()
+file(GLOB SESSIONS ${SESSIONS_DIR}/*.rec)
+if(NOT SESSIONS)
+  message(FATAL_ERROR "no sessions in ${SESSIONS_DIR}")
+endif()
+set(FAILED "")
+foreach(SESSION ${SESSIONS})
+  get_filename_component(NAME ${SESSION} NAME_WE)
+  message(STATUS "replaying ${NAME}")
+  execute_process(COMMAND ${MVPDEMO} --replay ${SESSION} ${OUT_DIR}/${NAME}.json
+                  RESULT_VARIABLE RESULT)
+  if(NOT RESULT EQUAL 0)
+    message(FATAL_ERROR "replay of ${NAME} failed")
+  endif()
+  if(UPDATE_BASELINE)
+    file(COPY ${OUT_DIR}/${NAME}.json DESTINATION ${BASELINE_DIR})
+    message(STATUS "stored ${BASELINE_DIR}/${NAME}.json")
+    continue()
+  endif()
+  execute_process(COMMAND ${PERFCOMPARE} ${BASELINE_DIR}/${NAME}.json ${OUT_DIR}/${NAME}.json ${TOLERANCE}
+                  RESULT_VARIABLE RESULT)
+  if(NOT RESULT EQUAL 0)
+    list(APPEND FAILED ${NAME})
+  endif()
+endforeach()
+if(FAILED)
+  message(FATAL_ERROR "performance regressions in ${FAILED}")
+endif()
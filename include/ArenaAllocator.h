@@ -0,0 +1,55 @@
+#ifndef ARENAALLOCATOR_H_
+#define ARENAALLOCATOR_H_
+#include <cstddef>
+#include <map>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file ArenaAllocator.h
+/// @brief hands out ranges of a fixed size arena, used for the shared vertex and index buffers
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/10/26
+/// @class ArenaAllocator
+/// @brief only the bookkeeping, the units are whatever the caller counts in (vertices or indices
+/// for BatchRenderer) and no memory is touched. The free ranges are kept sorted by offset, an
+/// allocation takes the smallest one it fits in and a release merges with the free neighbours so
+/// the arena can't end up in pieces that are all free
+//----------------------------------------------------------------------------------------------------------------------
+
+class ArenaAllocator
+{
+  public :
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief returned by allocate when there is no free range large enough
+    //----------------------------------------------------------------------------------------------------------------------
+    static constexpr size_t c_invalid=static_cast<size_t>(-1);
+    explicit ArenaAllocator(size_t _capacity);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief reserve _size units
+    /// @returns the offset of the range or c_invalid
+    //----------------------------------------------------------------------------------------------------------------------
+    size_t allocate(size_t _size);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief give back a range allocate returned, unknown offsets are ignored
+    //----------------------------------------------------------------------------------------------------------------------
+    void release(size_t _offset);
+    size_t capacity() const { return m_capacity; }
+    size_t used() const { return m_used; }
+    size_t allocations() const { return m_allocated.size(); }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the number of free ranges and the size of the largest, the largest allocation that will succeed
+    //----------------------------------------------------------------------------------------------------------------------
+    size_t freeRanges() const { return m_free.size(); }
+    size_t largestFree() const;
+
+  private :
+    size_t m_capacity;
+    size_t m_used=0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief offset to size for the free and the allocated ranges
+    //----------------------------------------------------------------------------------------------------------------------
+    std::map<size_t,size_t> m_free;
+    std::map<size_t,size_t> m_allocated;
+};
+
+#endif
@@ -0,0 +1,150 @@
+#ifndef BATCHRENDERER_H_
+#define BATCHRENDERER_H_
+#include "ArenaAllocator.h"
+#include <ngl/Types.h>
+#include <ngl/Mat3.h>
+#include <ngl/Mat4.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file BatchRenderer.h
+/// @brief draws many different meshes with one glMultiDrawElementsIndirect call
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/10/26
+/// @class BatchRenderer
+/// @brief every mesh lives in one shared vertex buffer and one shared index buffer, the ranges
+/// come from an ArenaAllocator each so meshes can be added and removed without moving the
+/// others, and one VAO covers them all. A frame's draws (a mesh and its matrices) are written
+/// to a shader storage buffer and the indirect commands built on the cpu, both in one of three
+/// fenced regions like the InstancedRenderer ring, then everything is submitted with a single
+/// call. Each command's baseInstance is its draw index, which an instanced attribute turns in to
+/// the index the vertex shader reads its matrices with. Needs GL 4.3, draws with the c_program
+/// program (PhongBatchVertex.glsl)
+//----------------------------------------------------------------------------------------------------------------------
+
+class BatchRenderer
+{
+  public :
+    static constexpr int c_numRegions=3;
+    static constexpr GLuint c_bindingPoint=0;
+    static constexpr const char *c_program="PhongBatch";
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the std430 layout of a draw in PhongBatchVertex.glsl, the mat3 columns are padded to vec4
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Draw
+    {
+      float M[16];
+      float normalMatrix[12];
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the layout glMultiDrawElementsIndirect reads
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Command
+    {
+      GLuint count;
+      GLuint instanceCount;
+      GLuint firstIndex;
+      GLint baseVertex;
+      GLuint baseInstance;
+    };
+    struct Stats
+    {
+      size_t draws=0;
+      //----------------------------------------------------------------------------------------------------------------------
+      /// @brief GL draw calls made for them, 1 with multi draw and one per draw without
+      //----------------------------------------------------------------------------------------------------------------------
+      size_t drawCalls=0;
+      size_t triangles=0;
+      //----------------------------------------------------------------------------------------------------------------------
+      /// @brief cpu time in draw from building the commands to the last GL call returning, in ms
+      //----------------------------------------------------------------------------------------------------------------------
+      float submitMs=0.0f;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief ctor needs a valid GL 4.3 context
+    /// @param [in] _maxVerts _maxIndices the sizes of the shared arenas
+    /// @param [in] _maxDraws the number of draws in each ring region
+    //----------------------------------------------------------------------------------------------------------------------
+    BatchRenderer(size_t _maxVerts, size_t _maxIndices, size_t _maxDraws);
+    ~BatchRenderer();
+    BatchRenderer(const BatchRenderer &)=delete;
+    BatchRenderer &operator=(const BatchRenderer &)=delete;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief copy a mesh in to the arenas
+    /// @param [in] _positions _normals xyz per vertex
+    /// @param [in] _indices three per triangle, relative to the mesh's first vertex
+    /// @returns the id to draw it with or -1 if either arena has no room
+    //----------------------------------------------------------------------------------------------------------------------
+    int addMesh(const float *_positions, const float *_normals, size_t _numVerts, const uint32_t *_indices, size_t _numIndices);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief free a mesh's ranges, it must not be in the draws since the last begin
+    //----------------------------------------------------------------------------------------------------------------------
+    void removeMesh(int _mesh);
+    size_t meshCount() const { return m_meshCount; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief start the next frame's draws, waits if the gpu is still reading that region
+    //----------------------------------------------------------------------------------------------------------------------
+    void begin();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief draw _mesh with model matrix _M
+    /// @param [in] _normalMatrix the inverse transpose of the model view
+    /// @returns false once the region is full
+    //----------------------------------------------------------------------------------------------------------------------
+    bool add(int _mesh, const ngl::Mat4 &_M, const ngl::Mat3 &_normalMatrix);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief submit everything added since begin and fence the region
+    /// @param [in] _multiDraw false issues one draw call per draw instead, to compare against
+    //----------------------------------------------------------------------------------------------------------------------
+    void draw(const ngl::Mat4 &_view, const ngl::Mat4 &_project, bool _multiDraw=true);
+    const Stats &stats() const { return m_stats; }
+    const ArenaAllocator &vertexArena() const { return m_vertexArena; }
+    const ArenaAllocator &indexArena() const { return m_indexArena; }
+    bool persistentMapped() const { return m_mapped!=nullptr; }
+
+  private :
+    struct Mesh
+    {
+      size_t firstVertex=0;
+      size_t firstIndex=0;
+      GLuint numIndices=0;
+    };
+    void waitForRegion(int _region);
+    size_t drawOffset() const { return static_cast<size_t>(m_region)*m_drawStride; }
+    size_t commandOffset() const { return c_numRegions*m_drawStride+static_cast<size_t>(m_region)*m_maxDraws*sizeof(Command); }
+    GLuint m_vao=0;
+    GLuint m_vertexBuffer=0;
+    GLuint m_indexBuffer=0;
+    GLuint m_drawIDBuffer=0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the draw regions then the command regions, bound as both the storage and indirect buffer
+    //----------------------------------------------------------------------------------------------------------------------
+    GLuint m_frameBuffer=0;
+    ArenaAllocator m_vertexArena;
+    ArenaAllocator m_indexArena;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief removed meshes leave a slot with no indices for the next addMesh
+    //----------------------------------------------------------------------------------------------------------------------
+    std::vector<Mesh> m_meshes;
+    size_t m_meshCount=0;
+    size_t m_maxDraws;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the size of a draw region rounded up to GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT
+    //----------------------------------------------------------------------------------------------------------------------
+    size_t m_drawStride;
+    int m_region=0;
+    std::array<GLsync,c_numRegions> m_fences;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the mesh of each draw since begin, the commands are built from them in draw
+    //----------------------------------------------------------------------------------------------------------------------
+    std::vector<int> m_drawMeshes;
+    unsigned char *m_mapped=nullptr;
+    std::vector<Draw> m_drawStaging;
+    std::vector<Command> m_commandStaging;
+    Stats m_stats;
+};
+
+#endif
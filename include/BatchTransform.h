@@ -0,0 +1,79 @@
+#ifndef BATCHTRANSFORM_H_
+#define BATCHTRANSFORM_H_
+#include <ngl/Mat4.h>
+#include <cstddef>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file BatchTransform.h
+/// @brief batch transform of vertex positions by a single Mat4, using the widest SIMD
+/// path the host cpu supports
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/10/26
+/// @class BatchTransform
+/// @brief transforms a structure of arrays batch of points (w=1) into clip space, there are
+/// SSE / AVX2 / AVX-512 kernels chosen at runtime plus a scalar fallback
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a batch of input positions stored as separate x,y,z arrays
+//----------------------------------------------------------------------------------------------------------------------
+struct VertexBatchSoA
+{
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<float> z;
+  void resize(size_t _n) { x.resize(_n); y.resize(_n); z.resize(_n); }
+  size_t size() const { return x.size(); }
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the homogeneous clip space output of a batch transform
+//----------------------------------------------------------------------------------------------------------------------
+struct ClipBatchSoA
+{
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<float> z;
+  std::vector<float> w;
+  void resize(size_t _n) { x.resize(_n); y.resize(_n); z.resize(_n); w.resize(_n); }
+  size_t size() const { return x.size(); }
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the available code paths, Auto picks the widest one supported at runtime
+//----------------------------------------------------------------------------------------------------------------------
+enum class SimdPath { Scalar, SSE, AVX2, AVX512, Auto };
+
+class BatchTransform
+{
+  public :
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the widest path this cpu can run (queried once and cached)
+    //----------------------------------------------------------------------------------------------------------------------
+    static SimdPath bestPath();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief check if a path was compiled in and is supported by the host cpu
+    //----------------------------------------------------------------------------------------------------------------------
+    static bool isSupported(SimdPath _path);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief human readable name of the path, used for the benchmark reports
+    //----------------------------------------------------------------------------------------------------------------------
+    static const char *pathName(SimdPath _path);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief transform a batch of points by _m, _out is resized to match _in
+    /// @param [in] _m the matrix (usually the MVP)
+    /// @param [in] _in the points to transform
+    /// @param [out] _out the clip space results
+    /// @param [in] _path the code path to use, unsupported paths fall back to the best available
+    //----------------------------------------------------------------------------------------------------------------------
+    static void transform(const ngl::Mat4 &_m, const VertexBatchSoA &_in, ClipBatchSoA &_out, SimdPath _path=SimdPath::Auto);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief raw pointer version, _m is 16 floats in OpenGL column major order
+    //----------------------------------------------------------------------------------------------------------------------
+    static void transform(const float *_m, const float *_x, const float *_y, const float *_z,
+                          float *_ox, float *_oy, float *_oz, float *_ow, size_t _n, SimdPath _path=SimdPath::Auto);
+};
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef COMPUTETRANSFORM_H_
+#define COMPUTETRANSFORM_H_
+#include "BatchTransform.h"
+#include <ngl/Types.h>
+#include <ngl/Mat4.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file ComputeTransform.h
+/// @brief gpu version of BatchTransform using shaders/compute.glsl
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/10/26
+/// @class ComputeTransform
+/// @brief the positions live in a shader storage buffer, dispatch runs the compute shader to
+/// write their clip space positions to a second one. That can be drawn directly, it is bound as
+/// inClip of PhongVertex.glsl alongside the original positions and normals, or read back to
+/// compare with the cpu path. The c_program program has to be loaded before use
+//----------------------------------------------------------------------------------------------------------------------
+
+class ComputeTransform
+{
+  public :
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief ShaderLib name of the compute program and its work group size (matches compute.glsl)
+    //----------------------------------------------------------------------------------------------------------------------
+    static constexpr const char *c_program="ComputeTransform";
+    static constexpr GLuint c_groupSize=256;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief build the buffers, needs a valid GL context
+    /// @param [in] _positions xyz per vertex
+    /// @param [in] _normals xyz per vertex, may be null if the mesh is only transformed
+    /// @param [in] _numVerts the number of vertices
+    /// @param [in] _indices triangle indices, if null the vertices are drawn in order
+    /// @param [in] _numIndices the number of indices
+    //----------------------------------------------------------------------------------------------------------------------
+    ComputeTransform(const float *_positions, const float *_normals, size_t _numVerts,
+                     const uint32_t *_indices, size_t _numIndices);
+    ~ComputeTransform();
+    ComputeTransform(const ComputeTransform &)=delete;
+    ComputeTransform &operator=(const ComputeTransform &)=delete;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief transform every vertex by _MVP, leaves the compute program active
+    //----------------------------------------------------------------------------------------------------------------------
+    void dispatch(const ngl::Mat4 &_MVP);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief draw with the current shader (Phong) using the results of the last dispatch
+    //----------------------------------------------------------------------------------------------------------------------
+    void draw() const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief copy the results of the last dispatch back to the cpu, waits for the gpu
+    //----------------------------------------------------------------------------------------------------------------------
+    void readBack(ClipBatchSoA &_out);
+    size_t vertexCount() const { return m_numVerts; }
+
+  private :
+    size_t m_numVerts;
+    GLsizei m_numIndices;
+    GLuint m_vao=0;
+    GLuint m_positions=0;
+    GLuint m_normals=0;
+    GLuint m_clip=0;
+    GLuint m_indices=0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief xyzw staging for readBack
+    //----------------------------------------------------------------------------------------------------------------------
+    std::vector<float> m_staging;
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef FRAMEPACER_H_
+#define FRAMEPACER_H_
+#include <chrono>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file FramePacer.h
+/// @brief decides when the next requested frame should start
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/10/26
+/// @class FramePacer
+/// @brief frames are only drawn when something asks for one, so the loop is idle without input.
+/// A requested frame is held back until it can finish just before its slot at the target rate,
+/// the predicted frame cost jumps up to any slow frame and decays slowly, so the wait adapts
+/// to the scene and input is sampled as late as possible. A target of 0 draws straight away
+//----------------------------------------------------------------------------------------------------------------------
+
+class FramePacer
+{
+  public :
+    using Clock=std::chrono::steady_clock;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief time kept spare before the slot in ms
+    //----------------------------------------------------------------------------------------------------------------------
+    static constexpr float c_marginMs=1.0f;
+    explicit FramePacer(float _targetFps=60.0f);
+    void setTargetRate(float _fps);
+    float targetRate() const { return m_targetFps; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief how long to wait from _now before starting the next frame
+    //----------------------------------------------------------------------------------------------------------------------
+    int delayMs(Clock::time_point _now) const;
+    void frameStarted(Clock::time_point _now);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief called once the frame has been swapped, updates the cost prediction
+    //----------------------------------------------------------------------------------------------------------------------
+    void framePresented(Clock::time_point _now);
+    float predictedCostMs() const { return m_predictedMs; }
+
+  private :
+    float m_targetFps;
+    float m_periodMs;
+    float m_predictedMs=0.0f;
+    bool m_presented=false;
+    Clock::time_point m_frameStart;
+    Clock::time_point m_lastPresent;
+};
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef FRAMEPROFILER_H_
+#define FRAMEPROFILER_H_
+#include <ngl/Types.h>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file FrameProfiler.h
+/// @brief per stage cpu and gpu timing of a frame
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/10/26
+/// @class FrameProfiler
+/// @brief each named stage is timed on the cpu with a clock and on the gpu with a pair of
+/// GL_TIMESTAMP queries. The queries go in to a ring of c_latency sets and are only read back
+/// c_latency frames later, if they still aren't ready they are dropped rather than waited on.
+/// The last c_historySize frames are kept for the rolling min / avg / p99 and the exports.
+/// Each stage can be timed at most once a frame, there is only one query pair for it
+/// All calls must be made from the thread owning the GL context
+//----------------------------------------------------------------------------------------------------------------------
+
+class FrameProfiler
+{
+  public :
+    static constexpr int c_latency=4;
+    static constexpr size_t c_historySize=300;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief rolling stats for one stage in ms, the gpu values are 0 until a result arrives
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Summary
+    {
+      float cpuMin=0.0f;
+      float cpuAvg=0.0f;
+      float cpuP99=0.0f;
+      float gpuMin=0.0f;
+      float gpuAvg=0.0f;
+      float gpuP99=0.0f;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief times a stage for the lifetime of the object, at most one per stage per frame
+    //----------------------------------------------------------------------------------------------------------------------
+    class Scope
+    {
+      public :
+        Scope(FrameProfiler &_profiler, int _stage) : m_profiler(_profiler), m_stage(_stage) { m_profiler.begin(m_stage); }
+        ~Scope() { m_profiler.end(m_stage); }
+        Scope(const Scope &)=delete;
+        Scope &operator=(const Scope &)=delete;
+      private :
+        FrameProfiler &m_profiler;
+        int m_stage;
+    };
+    FrameProfiler()=default;
+    ~FrameProfiler();
+    FrameProfiler(const FrameProfiler &)=delete;
+    FrameProfiler &operator=(const FrameProfiler &)=delete;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief add a stage, all stages have to be added before initGL
+    /// @returns the id to pass to begin / end
+    //----------------------------------------------------------------------------------------------------------------------
+    int addStage(const std::string &_name);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief create the queries, needs a valid GL context
+    //----------------------------------------------------------------------------------------------------------------------
+    void initGL();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief collect any finished gpu results, refresh the summaries and start a new frame
+    //----------------------------------------------------------------------------------------------------------------------
+    void beginFrame();
+    void endFrame();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief time _stage, asserts if it has already been timed this frame
+    //----------------------------------------------------------------------------------------------------------------------
+    void begin(int _stage);
+    void end(int _stage);
+
+    size_t numStages() const { return m_names.size(); }
+    const std::string &stageName(int _stage) const { return m_names[_stage]; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the summaries as of the last beginFrame, they don't change during a frame
+    //----------------------------------------------------------------------------------------------------------------------
+    const Summary &summary(int _stage) const { return m_summaries[_stage]; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the times of _stage in the newest frame whose gpu results have arrived, c_latency
+    /// frames behind at best, for anything reacting to the frame cost as it changes
+    /// @param [out] _frame the frame they are for, so a caller can tell a new one from one it has seen
+    /// @returns false if no results have arrived yet (or _stage wasn't run in that frame)
+    //----------------------------------------------------------------------------------------------------------------------
+    bool latest(int _stage, uint64_t &_frame, float &_cpuMs, float &_gpuMs) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief query sets overwritten before their results arrived
+    //----------------------------------------------------------------------------------------------------------------------
+    size_t gpuDropped() const { return m_gpuDropped; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief write the kept frames, CSV is one row per frame and stage (frame,stage,cpu_ms,gpu_ms),
+    /// JSON has the summaries followed by the per frame values. Missing values are empty / null
+    //----------------------------------------------------------------------------------------------------------------------
+    bool writeCSV(const std::string &_fname) const;
+    bool writeJSON(const std::string &_fname) const;
+
+  private :
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief one frame of samples, negative values weren't recorded
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Record
+    {
+      uint64_t frame=0;
+      bool valid=false;
+      std::vector<float> cpuMs;
+      std::vector<float> gpuMs;
+    };
+    void resolve(int _slot);
+    void summarise();
+    GLuint query(int _slot, int _stage, int _end) const { return m_queries[(_slot*m_names.size()+_stage)*2+_end]; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the kept frames oldest first
+    //----------------------------------------------------------------------------------------------------------------------
+    std::vector<const Record *> orderedHistory() const;
+
+    std::vector<std::string> m_names;
+    std::vector<Summary> m_summaries;
+    std::vector<GLuint> m_queries;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief which stages were issued in each query set and the frame it belongs to
+    //----------------------------------------------------------------------------------------------------------------------
+    std::array<std::vector<char>,c_latency> m_issued;
+    std::array<uint64_t,c_latency> m_slotFrame;
+    std::array<bool,c_latency> m_slotPending;
+    std::vector<std::chrono::high_resolution_clock::time_point> m_cpuStart;
+    std::vector<Record> m_history;
+    uint64_t m_frame=0;
+    size_t m_gpuDropped=0;
+    bool m_hasLatest=false;
+    uint64_t m_latestFrame=0;
+};
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef FRAMETRACE_H_
+#define FRAMETRACE_H_
+#include "SPSCRing.h"
+#include "TraceFormat.h"
+#include "BatchTransform.h"
+#include <ngl/Mat4.h>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file FrameTrace.h
+/// @brief asynchronous binary frame tracing for the render loop
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/10/26
+/// @class FrameTrace
+/// @brief the render thread pushes binary records (see TraceFormat.h) into an SPSCRing without
+/// locking, a drain thread writes them to disk, if the drain falls behind records are dropped
+/// and counted rather than stalling the frame, decode the output with the TraceDecode tool
+//----------------------------------------------------------------------------------------------------------------------
+
+class FrameTrace
+{
+  public :
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief ctor
+    /// @param [in] _ringSize size of the ring buffer in bytes
+    //----------------------------------------------------------------------------------------------------------------------
+    explicit FrameTrace(size_t _ringSize=4*1024*1024);
+    ~FrameTrace();
+    FrameTrace(const FrameTrace &)=delete;
+    FrameTrace &operator=(const FrameTrace &)=delete;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief open _fname and start the drain thread
+    /// @returns false if the file can't be opened
+    //----------------------------------------------------------------------------------------------------------------------
+    bool start(const std::string &_fname);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief flush everything still in the ring and close the file
+    //----------------------------------------------------------------------------------------------------------------------
+    void stop();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief start or stop, used for the runtime toggle
+    //----------------------------------------------------------------------------------------------------------------------
+    void toggle(const std::string &_fname);
+    bool isEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief producer side, only ever call these from the render thread
+    //----------------------------------------------------------------------------------------------------------------------
+    void recordMatrices(uint64_t _frame, const ngl::Mat4 &_MVP, const ngl::Mat4 &_M, const ngl::Mat4 &_view, const ngl::Mat4 &_project);
+    void recordPoints(uint64_t _frame, const ClipBatchSoA &_points);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief number of records that didn't fit in the ring
+    //----------------------------------------------------------------------------------------------------------------------
+    uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+    uint64_t written() const { return m_written.load(std::memory_order_relaxed); }
+
+  private :
+    bool push(trace::RecordType _type, const void *_payload, uint32_t _size);
+    void drainLoop();
+    bool drainOnce(std::vector<char> &_scratch);
+
+    SPSCRing m_ring;
+    std::FILE *m_file=nullptr;
+    std::thread m_drainThread;
+    std::atomic<bool> m_enabled{false};
+    std::atomic<bool> m_running{false};
+    std::atomic<uint64_t> m_dropped{0};
+    std::atomic<uint64_t> m_written{0};
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief reused on the render thread to pack the point records
+    //----------------------------------------------------------------------------------------------------------------------
+    std::vector<float> m_pointScratch;
+};
+
+#endif
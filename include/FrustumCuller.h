@@ -0,0 +1,104 @@
+#ifndef FRUSTUMCULLER_H_
+#define FRUSTUMCULLER_H_
+#include "BatchTransform.h"
+#include <ngl/Mat4.h>
+#include <ngl/Vec3.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file FrustumCuller.h
+/// @brief view frustum culling of axis aligned bounding boxes stored in a uniform grid
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/10/26
+/// @class FrustumCuller
+/// @brief objects are binned by the centre of their bounds into a uniform grid, each cell keeps
+/// the union of its objects' bounds and the objects themselves as contiguous centre / extent
+/// arrays. Culling tests each non empty cell against the six planes extracted from the
+/// view projection matrix, cells fully outside are skipped, cells fully inside are accepted
+/// whole and only the straddling cells have their objects tested, several boxes at a time
+/// with the same SIMD paths as BatchTransform
+//----------------------------------------------------------------------------------------------------------------------
+
+class FrustumCuller
+{
+  public :
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the planes as a,b,c,d with the normal pointing into the frustum, normalised
+    //----------------------------------------------------------------------------------------------------------------------
+    typedef std::array<std::array<float,4>,6> Planes;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief counters for the last call to cull
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Stats
+    {
+      size_t total=0;
+      size_t visible=0;
+      size_t cellsTested=0;
+      size_t objectsTested=0;
+      float cullMs=0.0f;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief ctor
+    /// @param [in] _cellSize the edge length of a grid cell in world units
+    //----------------------------------------------------------------------------------------------------------------------
+    explicit FrustumCuller(float _cellSize=8.0f);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief remove all the objects
+    //----------------------------------------------------------------------------------------------------------------------
+    void clear();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief add an object, the grid is rebuilt on the next cull
+    /// @returns the id reported by cull
+    //----------------------------------------------------------------------------------------------------------------------
+    uint32_t addObject(const ngl::Vec3 &_min, const ngl::Vec3 &_max);
+    size_t size() const { return m_min.size(); }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief find the objects that are at least partly inside the frustum of _VP
+    /// @param [in] _VP the projection * view matrix used for drawing
+    /// @param [in] _path the SIMD path for the object tests
+    /// @returns the ids of the visible objects in grid order
+    //----------------------------------------------------------------------------------------------------------------------
+    const std::vector<uint32_t> &cull(const ngl::Mat4 &_VP, SimdPath _path=SimdPath::Auto);
+    const std::vector<uint32_t> &visible() const { return m_visible; }
+    const Stats &stats() const { return m_stats; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief extract the frustum planes from a projection * view matrix (Gribb / Hartmann)
+    //----------------------------------------------------------------------------------------------------------------------
+    static Planes extractPlanes(const ngl::Mat4 &_VP);
+
+  private :
+    struct Cell
+    {
+      float centre[3];
+      float extent[3];
+      uint32_t first;
+      uint32_t count;
+    };
+    void build();
+
+    float m_cellSize;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the bounds as added
+    //----------------------------------------------------------------------------------------------------------------------
+    std::vector<ngl::Vec3> m_min;
+    std::vector<ngl::Vec3> m_max;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the bounds sorted by cell as centre / extent arrays plus the original ids
+    //----------------------------------------------------------------------------------------------------------------------
+    std::array<std::vector<float>,3> m_centre;
+    std::array<std::vector<float>,3> m_extent;
+    std::vector<uint32_t> m_ids;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief only the non empty cells are kept
+    //----------------------------------------------------------------------------------------------------------------------
+    std::vector<Cell> m_cells;
+    std::vector<uint32_t> m_visible;
+    bool m_dirty=true;
+    Stats m_stats;
+};
+
+#endif
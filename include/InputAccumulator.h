@@ -0,0 +1,88 @@
+#ifndef INPUTACCUMULATOR_H_
+#define INPUTACCUMULATOR_H_
+#include "WindowParams.h"
+#include <ngl/Vec3.h>
+#include <chrono>
+#include <cstddef>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file InputAccumulator.h
+/// @brief merges the input events that arrive between two frames
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/10/26
+/// @class InputAccumulator
+/// @brief the event handlers add their deltas here instead of applying them and repainting,
+/// the next frame takes the sum of everything since the last one in a single step. The time
+/// of the oldest pending event is kept so the input to present latency can be measured
+//----------------------------------------------------------------------------------------------------------------------
+
+class InputAccumulator
+{
+  public :
+    using Clock=std::chrono::steady_clock;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the merged deltas, events is how many input events they came from
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Delta
+    {
+      int spinX=0;
+      int spinY=0;
+      ngl::Vec3 move=ngl::Vec3(0.0f,0.0f,0.0f);
+      size_t events=0;
+      Clock::time_point oldest;
+      //----------------------------------------------------------------------------------------------------------------------
+      /// @brief add the deltas to the window params and model position as the handlers used to
+      //----------------------------------------------------------------------------------------------------------------------
+      void apply(WinParams &_win, ngl::Vec3 &_modelPos) const
+      {
+        _win.spinXFace+=spinX;
+        _win.spinYFace+=spinY;
+        _modelPos.m_x+=move.m_x;
+        _modelPos.m_y+=move.m_y;
+        _modelPos.m_z+=move.m_z;
+      }
+    };
+    void addSpin(int _x, int _y)
+    {
+      addEvent();
+      m_pending.spinX+=_x;
+      m_pending.spinY+=_y;
+    }
+    void addMove(float _x, float _y, float _z)
+    {
+      addEvent();
+      m_pending.move.m_x+=_x;
+      m_pending.move.m_y+=_y;
+      m_pending.move.m_z+=_z;
+    }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief an event with no delta to merge (e.g. a key) that should still be timed
+    //----------------------------------------------------------------------------------------------------------------------
+    void addEvent()
+    {
+      if(m_pending.events++==0)
+        m_pending.oldest=Clock::now();
+    }
+    bool pending() const { return m_pending.events!=0; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief hand over everything since the last take and start again
+    //----------------------------------------------------------------------------------------------------------------------
+    Delta take()
+    {
+      Delta delta=m_pending;
+      m_pending=Delta();
+      m_merged+=delta.events>1 ? delta.events-1 : 0;
+      return delta;
+    }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief events that didn't need a frame of their own
+    //----------------------------------------------------------------------------------------------------------------------
+    size_t merged() const { return m_merged; }
+
+  private :
+    Delta m_pending;
+    size_t m_merged=0;
+};
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef INPUTSESSION_H_
+#define INPUTSESSION_H_
+#include "TransformState.h"
+#include "InputAccumulator.h"
+#include "WindowParams.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file InputSession.h
+/// @brief recorded key / mouse event streams for replaying perf sessions
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/10/26
+/// @class InputSession
+/// @brief NGLScene writes every input event plus a marker for each frame it draws, stamped with
+/// the ms since recording started and the frame the event went into. The file is text, a
+/// "# mvp input session 1" line then one event per line
+///   ms frame type code buttons x y
+/// type is frame, key, press, move, release or wheel, code is the Qt key, mouse button or wheel
+/// delta. Since the frame markers are in the stream a replay draws exactly the frames that were
+/// drawn while recording, with the same events applied before each one
+//----------------------------------------------------------------------------------------------------------------------
+
+class InputSession
+{
+  public :
+    using Clock=std::chrono::steady_clock;
+    enum class EventType { Frame, Key, MousePress, MouseMove, MouseRelease, Wheel };
+    struct Event
+    {
+      double ms=0.0;
+      uint64_t frame=0;
+      EventType type=EventType::Frame;
+      int code=0;
+      int buttons=0;
+      int x=0;
+      int y=0;
+    };
+    InputSession()=default;
+    InputSession(const InputSession &)=delete;
+    InputSession &operator=(const InputSession &)=delete;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief start / stop writing events to a file, toggle is for a key binding
+    //----------------------------------------------------------------------------------------------------------------------
+    bool start(const std::string &_fname);
+    void stop();
+    void toggle(const std::string &_fname);
+    bool isRecording() const { return m_file.is_open(); }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief write one event, does nothing unless recording
+    //----------------------------------------------------------------------------------------------------------------------
+    void record(EventType _type, uint64_t _frame, int _code=0, int _buttons=0, int _x=0, int _y=0);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief read a recorded session
+    /// @returns false (with a message on std::cerr) on a read or syntax error
+    //----------------------------------------------------------------------------------------------------------------------
+    bool load(const std::string &_fname);
+    const std::vector<Event> &events() const { return m_events; }
+    size_t frameCount() const;
+    static const char *typeName(EventType _type);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief NGLScene's handling of the keys that move the model or camera, shared with the replay
+    /// so both end up with the same transforms
+    /// @returns false if _key isn't one of them
+    //----------------------------------------------------------------------------------------------------------------------
+    static bool applyTransformKey(TransformState &_transform, int _key, float _aspect);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief NGLScene's handling of the mouse buttons and wheel, also shared with the replay. A
+    /// left drag spins and a right drag moves, the deltas go to _input to be applied at the next frame
+    /// @param [in] _code the button of a press or release or the wheel delta
+    /// @param [in] _buttons the buttons held, for a move
+    /// @returns true if a delta was added to _input
+    //----------------------------------------------------------------------------------------------------------------------
+    static bool applyMouseEvent(EventType _type, int _code, int _buttons, int _x, int _y, WinParams &_win,
+                                InputAccumulator &_input);
+
+  private :
+    std::ofstream m_file;
+    Clock::time_point m_start;
+    std::vector<Event> m_events;
+};
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef INSTANCEDRENDERER_H_
+#define INSTANCEDRENDERER_H_
+#include "TransformState.h"
+#include "JobSystem.h"
+#include <ngl/Types.h>
+#include <ngl/Vec3.h>
+#include <array>
+#include <cstddef>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file InstancedRenderer.h
+/// @brief draws many transformed copies of a mesh with a single instanced draw call
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/10/26
+/// @class InstancedRenderer
+/// @brief each frame the per instance model and normal matrices are computed in parallel on the
+/// cpu by the frame's JobSystem (a sweep over position, rotation and scale around the current TransformState) and written
+/// into one of three regions of a persistently mapped instance buffer, each region is protected
+/// by a fence so the cpu never writes data the gpu is still reading. If the context doesn't have
+/// glBufferStorage (GL < 4.4) the regions are updated with glBufferSubData instead.
+/// Draws with the PhongInstanced shader program
+//----------------------------------------------------------------------------------------------------------------------
+
+class InstancedRenderer
+{
+  public :
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief number of regions in the instance ring
+    //----------------------------------------------------------------------------------------------------------------------
+    static constexpr int c_numRegions=3;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief floats per instance, mat4 M then the normal matrix as three vec4 columns
+    //----------------------------------------------------------------------------------------------------------------------
+    static constexpr int c_floatsPerInstance=28;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief ctor needs a valid GL context
+    /// @param [in] _verts the mesh positions (GL_TRIANGLES)
+    /// @param [in] _normals the mesh normals
+    /// @param [in] _numVerts the number of vertices
+    /// @param [in] _maxInstances the size of each ring region in instances
+    //----------------------------------------------------------------------------------------------------------------------
+    InstancedRenderer(const ngl::Vec3 *_verts, const ngl::Vec3 *_normals, size_t _numVerts, size_t _maxInstances);
+    ~InstancedRenderer();
+    InstancedRenderer(const InstancedRenderer &)=delete;
+    InstancedRenderer &operator=(const InstancedRenderer &)=delete;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief set the number of instances to draw, clamped to the max
+    //----------------------------------------------------------------------------------------------------------------------
+    void setInstanceCount(size_t _count);
+    size_t instanceCount() const { return m_instanceCount; }
+    size_t maxInstances() const { return m_maxInstances; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief instances per fill task
+    //----------------------------------------------------------------------------------------------------------------------
+    static constexpr size_t c_fillGrain=2048;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief compute this frame's instance matrices and draw them all with one call
+    /// @param [in] _transform the base transform and camera, the sweep is applied around it
+    /// @param [in] _jobs the fill is split into tasks on this, the calling thread helps until they finish
+    //----------------------------------------------------------------------------------------------------------------------
+    void draw(const TransformState &_transform, JobSystem &_jobs);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief cpu time of the last matrix fill in ms
+    //----------------------------------------------------------------------------------------------------------------------
+    float fillTime() const { return m_fillTime; }
+    bool persistentMapped() const { return m_mapped!=nullptr; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief compute the matrices for instances [_begin,_end) into _out, public so it can be
+    /// split into tasks by the caller
+    //----------------------------------------------------------------------------------------------------------------------
+    void fillInstances(const TransformState &_transform, size_t _begin, size_t _end, float *_out) const;
+
+  private :
+    void waitForRegion(int _region);
+    GLuint m_vao=0;
+    GLuint m_meshBuffer=0;
+    GLuint m_instanceBuffer=0;
+    GLsizei m_numVerts;
+    size_t m_maxInstances;
+    size_t m_instanceCount;
+    int m_region=0;
+    std::array<GLsync,c_numRegions> m_fences;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the persistent mapping of the whole ring, null if we fall back to glBufferSubData
+    //----------------------------------------------------------------------------------------------------------------------
+    float *m_mapped=nullptr;
+    std::vector<float> m_staging;
+    float m_fillTime=0.0f;
+};
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef JOBSYSTEM_H_
+#define JOBSYSTEM_H_
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file JobSystem.h
+/// @brief small work stealing task scheduler used to split the cpu stages of a frame
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/10/26
+/// @class JobSystem
+/// @brief every thread (the owning thread plus the workers) has its own deque, a thread pushes
+/// and pops work at the back of its own deque and steals from the front of the others when it
+/// runs dry. Tasks may depend on other tasks and become runnable as soon as their last
+/// dependency finishes, tasks are only ever added from the owning thread (usually the GUI thread)
+/// which helps run work while it waits. Call beginFrame once all work is finished to recycle the
+/// task storage and reset the per frame timings.
+//----------------------------------------------------------------------------------------------------------------------
+
+class JobSystem
+{
+  public :
+    typedef size_t TaskId;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief timing of a single task relative to the start of the frame
+    //----------------------------------------------------------------------------------------------------------------------
+    struct TaskTiming
+    {
+      std::string name;
+      unsigned int thread;
+      float startMs;
+      float durationMs;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief per frame counters
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Stats
+    {
+      size_t tasks=0;
+      size_t steals=0;
+      float busyMs=0.0f;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief ctor
+    /// @param [in] _numThreads total threads including the owner, 0 means one per core
+    //----------------------------------------------------------------------------------------------------------------------
+    explicit JobSystem(unsigned int _numThreads=0);
+    ~JobSystem();
+    JobSystem(const JobSystem &)=delete;
+    JobSystem &operator=(const JobSystem &)=delete;
+    unsigned int numThreads() const { return static_cast<unsigned int>(m_queues.size()); }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief waits for any outstanding work then recycles the tasks and clears the timings
+    //----------------------------------------------------------------------------------------------------------------------
+    void beginFrame();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief add a task, it is scheduled as soon as all of _deps have finished
+    /// @param [in] _name used for the timings
+    /// @param [in] _func the work to do
+    /// @param [in] _deps tasks that must finish first
+    //----------------------------------------------------------------------------------------------------------------------
+    TaskId add(const char *_name, std::function<void()> _func, std::initializer_list<TaskId> _deps={});
+    TaskId add(const char *_name, std::function<void()> _func, const std::vector<TaskId> &_deps);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief split [0,_count) into tasks of at most _grain items
+    /// @returns the ids of the tasks created
+    //----------------------------------------------------------------------------------------------------------------------
+    std::vector<TaskId> parallelFor(const char *_name, size_t _count, size_t _grain,
+                                    std::function<void(size_t,size_t)> _func, std::initializer_list<TaskId> _deps={});
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief run tasks on the calling thread until _task (or _tasks) has finished
+    //----------------------------------------------------------------------------------------------------------------------
+    void wait(TaskId _task);
+    void wait(const std::vector<TaskId> &_tasks);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief run tasks on the calling thread until everything added so far has finished
+    //----------------------------------------------------------------------------------------------------------------------
+    void waitAll();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief timings of the tasks run since the last beginFrame
+    //----------------------------------------------------------------------------------------------------------------------
+    std::vector<TaskTiming> timings() const;
+    Stats frameStats() const;
+
+  private :
+    struct Task
+    {
+      std::string name;
+      std::function<void()> func;
+      std::atomic<int> pending{1};
+      std::mutex lock;
+      bool done=false;
+      std::vector<Task *> successors;
+      unsigned int thread=0;
+      std::chrono::high_resolution_clock::time_point start;
+      std::chrono::high_resolution_clock::time_point end;
+      std::atomic<bool> finished{false};
+    };
+    struct WorkQueue
+    {
+      std::mutex lock;
+      std::deque<Task *> tasks;
+    };
+    void workerLoop(unsigned int _index);
+    void push(Task *_task, unsigned int _queue);
+    Task *pop(unsigned int _index);
+    void execute(Task *_task, unsigned int _index);
+    unsigned int currentIndex() const;
+    bool runOne();
+
+    std::vector<WorkQueue> m_queues;
+    std::vector<std::thread> m_workers;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief deque so pointers stay valid as tasks are added
+    //----------------------------------------------------------------------------------------------------------------------
+    std::deque<Task> m_tasks;
+    std::atomic<size_t> m_outstanding{0};
+    std::atomic<size_t> m_ready{0};
+    std::atomic<size_t> m_steals{0};
+    std::atomic<bool> m_quit{false};
+    std::mutex m_wakeLock;
+    std::condition_variable m_wake;
+    std::chrono::high_resolution_clock::time_point m_frameStart;
+};
+
+#endif
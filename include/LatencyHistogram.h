@@ -0,0 +1,46 @@
+#ifndef LATENCYHISTOGRAM_H_
+#define LATENCYHISTOGRAM_H_
+#include <array>
+#include <cstddef>
+#include <iosfwd>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file LatencyHistogram.h
+/// @brief fixed bucket histogram of latencies in ms
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/10/26
+/// @class LatencyHistogram
+/// @brief c_bucketMs wide buckets up to c_numBuckets*c_bucketMs, anything slower lands in the
+/// last one. Percentiles are the upper edge of the bucket they fall in
+//----------------------------------------------------------------------------------------------------------------------
+
+class LatencyHistogram
+{
+  public :
+    static constexpr float c_bucketMs=0.5f;
+    static constexpr int c_numBuckets=200;
+    void add(float _ms);
+    void reset();
+    size_t count() const { return m_count; }
+    float minMs() const { return m_count ? m_min : 0.0f; }
+    float maxMs() const { return m_max; }
+    float meanMs() const { return m_count ? static_cast<float>(m_sum/m_count) : 0.0f; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the latency _p (0-1) of the samples are at or under
+    //----------------------------------------------------------------------------------------------------------------------
+    float percentile(float _p) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the summary and a bar per non empty bucket
+    //----------------------------------------------------------------------------------------------------------------------
+    void print(std::ostream &_out) const;
+
+  private :
+    std::array<size_t,c_numBuckets> m_buckets={};
+    size_t m_count=0;
+    double m_sum=0.0;
+    float m_min=0.0f;
+    float m_max=0.0f;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef MAPPEDMESH_H_
+#define MAPPEDMESH_H_
+#include "MeshFormat.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MappedMesh.h
+/// @brief read only view of a binary mesh file
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/10/26
+/// @class MappedMesh
+/// @brief the file is memory mapped and validated, the accessors point straight into the mapping
+/// so the data can be handed to GL without any intermediate copies. On platforms without mmap
+/// the file is read into memory instead
+//----------------------------------------------------------------------------------------------------------------------
+
+class MappedMesh
+{
+  public :
+    MappedMesh()=default;
+    ~MappedMesh();
+    MappedMesh(const MappedMesh &)=delete;
+    MappedMesh &operator=(const MappedMesh &)=delete;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief map and validate a mesh file, any previous file is closed first
+    /// @returns false (with a message on std::cerr) if the file can't be mapped or is malformed
+    //----------------------------------------------------------------------------------------------------------------------
+    bool open(const std::string &_fname);
+    void close();
+    bool isOpen() const { return m_data!=nullptr; }
+
+    const meshfile::MeshFileHeader &header() const { return *reinterpret_cast<const meshfile::MeshFileHeader *>(m_data); }
+    uint32_t vertexCount() const { return header().vertexCount; }
+    uint32_t indexCount() const { return header().indexCount; }
+    const float *positions() const { return reinterpret_cast<const float *>(m_data+header().positionOffset); }
+    const float *normals() const { return reinterpret_cast<const float *>(m_data+header().normalOffset); }
+    const uint32_t *indices() const { return reinterpret_cast<const uint32_t *>(m_data+header().indexOffset); }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the positions and normals as one block, from the start of the positions to the end of the normals
+    //----------------------------------------------------------------------------------------------------------------------
+    size_t vertexBlockSize() const { return static_cast<size_t>(header().normalOffset-header().positionOffset)+vertexCount()*3*sizeof(float); }
+    size_t size() const { return m_size; }
+
+  private :
+    const unsigned char *m_data=nullptr;
+    size_t m_size=0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief only used when mmap isn't available
+    //----------------------------------------------------------------------------------------------------------------------
+    std::vector<unsigned char> m_fallback;
+};
+
+#endif
@@ -0,0 +1,145 @@
+#ifndef MESHBVH_H_
+#define MESHBVH_H_
+#include "BatchTransform.h"
+#include <ngl/Mat4.h>
+#include <ngl/Vec3.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MeshBVH.h
+/// @brief bounding volume hierarchy over a triangle mesh for picking with rays on the cpu
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/10/26
+/// @class MeshBVH
+/// @brief built top down splitting each node where the surface area heuristic says, the candidate
+/// splits are c_bins bins of the triangle centroids on each axis. The triangles of a leaf are
+/// stored as packets of c_packetWidth in SoA form (a vertex and two edges) so one ray is tested
+/// against a whole packet with Moller-Trumbore using the same SIMD paths as BatchTransform, the
+/// cost of a leaf in the heuristic is its number of packets. Traversal visits the nearer child
+/// first and skips any node further away than the closest hit so far
+//----------------------------------------------------------------------------------------------------------------------
+
+class MeshBVH
+{
+  public :
+    static constexpr int c_packetWidth=8;
+    static constexpr int c_bins=16;
+    static constexpr int c_maxLeafPackets=4;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief deeper than this a node becomes a leaf whatever the heuristic says, it sizes the traversal stack
+    //----------------------------------------------------------------------------------------------------------------------
+    static constexpr int c_maxDepth=64;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the closest triangle along a ray, the position is
+    /// (1-u-v)*v0 + u*v1 + v*v2 in the space the mesh was given in
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Hit
+    {
+      bool hit=false;
+      uint32_t triangle=0;
+      //----------------------------------------------------------------------------------------------------------------------
+      /// @brief along the ray in units of its direction, so the mesh's units for a normalised direction
+      //----------------------------------------------------------------------------------------------------------------------
+      float distance=0.0f;
+      float u=0.0f;
+      float v=0.0f;
+      ngl::Vec3 position;
+      //----------------------------------------------------------------------------------------------------------------------
+      /// @brief nodes and packets visited, to see how well the tree culls
+      //----------------------------------------------------------------------------------------------------------------------
+      uint32_t nodesVisited=0;
+      uint32_t packetsTested=0;
+    };
+    struct Stats
+    {
+      size_t triangles=0;
+      size_t nodes=0;
+      size_t leaves=0;
+      size_t packets=0;
+      size_t bytes=0;
+      int depth=0;
+      float buildMs=0.0f;
+      //----------------------------------------------------------------------------------------------------------------------
+      /// @brief the fraction of packet lanes holding a triangle rather than padding
+      //----------------------------------------------------------------------------------------------------------------------
+      float packetFill() const { return packets ? static_cast<float>(triangles)/(packets*c_packetWidth) : 0.0f; }
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief build the tree, the mesh is copied in to the packets so it needn't outlive this
+    /// @param [in] _positions xyz per vertex
+    /// @param [in] _indices three per triangle, the hit triangle is the index of its first / 3
+    //----------------------------------------------------------------------------------------------------------------------
+    MeshBVH(const float *_positions, size_t _numVerts, const uint32_t *_indices, size_t _numIndices);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief closest hit in front of _origin, both sides of a triangle count
+    /// @param [in] _path the SIMD path for the packet tests, unsupported paths fall back to the best available
+    //----------------------------------------------------------------------------------------------------------------------
+    Hit intersect(const ngl::Vec3 &_origin, const ngl::Vec3 &_dir, SimdPath _path=SimdPath::Auto) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief every packet with no tree, the reference the tree is checked against
+    //----------------------------------------------------------------------------------------------------------------------
+    Hit intersectAll(const ngl::Vec3 &_origin, const ngl::Vec3 &_dir, SimdPath _path=SimdPath::Auto) const;
+    const Stats &stats() const { return m_stats; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the ray in the space _MVP takes points from through a point on the screen
+    /// @param [in] _MVP the matrix the mesh is drawn with
+    /// @param [in] _ndcX _ndcY the point in normalised device coordinates, -1 to 1 with y up
+    /// @param [out] _origin on the near plane
+    /// @param [out] _dir normalised, towards the far plane
+    /// @returns false if _MVP can't be inverted
+    //----------------------------------------------------------------------------------------------------------------------
+    static bool unproject(const ngl::Mat4 &_MVP, float _ndcX, float _ndcY, ngl::Vec3 &_origin, ngl::Vec3 &_dir);
+
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief c_packetWidth triangles, unused lanes have zero edges so they can never be hit
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Packet
+    {
+      float v0[3][c_packetWidth];
+      float e1[3][c_packetWidth];
+      float e2[3][c_packetWidth];
+      uint32_t triangle[c_packetWidth];
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief a ray with everything the kernels need precomputed
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Ray
+    {
+      float origin[3];
+      float dir[3];
+      float invDir[3];
+    };
+
+  private :
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief a leaf has count packets from first, an interior node count 0 and children first and first+1
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Node
+    {
+      float min[3];
+      uint32_t first;
+      float max[3];
+      uint32_t count;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief a triangle's bounds while building
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Reference
+    {
+      float min[3];
+      uint32_t triangle;
+      float max[3];
+      float centre(int _axis) const { return 0.5f*(min[_axis]+max[_axis]); }
+      void centroid(float *_c) const { for(int a=0; a<3; ++a) _c[a]=centre(a); }
+    };
+    void makePackets(Node &_node, const Reference *_refs, size_t _count, const float *_positions, const uint32_t *_indices);
+
+    std::vector<Node> m_nodes;
+    std::vector<Packet> m_packets;
+    Stats m_stats;
+};
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef MESHFORMAT_H_
+#define MESHFORMAT_H_
+#include <cstdint>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MeshFormat.h
+/// @brief on disk layout of the binary meshes written by MeshConvert and mapped by MappedMesh
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/10/26
+/// the file is a MeshFileHeader followed by the position, normal and index sections, each
+/// starting on a c_sectionAlignment boundary. Positions and normals are tightly packed x,y,z
+/// floats and the two sections are contiguous (apart from padding) so they can be uploaded as
+/// one buffer, indices are uint32 GL_TRIANGLES. All values are little endian as written by the host
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace meshfile
+{
+  constexpr uint32_t c_magic=0x4d50564d; // "MVPM"
+  constexpr uint32_t c_version=1;
+  constexpr uint64_t c_sectionAlignment=64;
+
+  struct MeshFileHeader
+  {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    float boundsMin[3];
+    float boundsMax[3];
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief byte offsets of each section from the start of the file
+    //----------------------------------------------------------------------------------------------------------------------
+    uint64_t positionOffset;
+    uint64_t normalOffset;
+    uint64_t indexOffset;
+    uint64_t fileSize;
+  };
+
+  constexpr uint64_t alignSection(uint64_t _offset)
+  {
+    return (_offset+c_sectionAlignment-1) & ~(c_sectionAlignment-1);
+  }
+}
+
+#endif
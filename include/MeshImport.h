@@ -0,0 +1,61 @@
+#ifndef MESHIMPORT_H_
+#define MESHIMPORT_H_
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MeshImport.h
+/// @brief text mesh parsers (OBJ and PLY), the writer for the binary mesh format and a generated shape
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/10/26
+/// used by the MeshConvert tool and the MeshLoadBench comparison, the demo itself only ever
+/// maps the binary files with MappedMesh and uses MeshData / computeNormals for its LOD levels
+/// and makeSuperellipsoid for its batch scene, as do the benches that need a mesh.
+/// All the loaders report problems on std::cerr and return false
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace meshfile
+{
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief an indexed triangle mesh with one normal per vertex
+  //----------------------------------------------------------------------------------------------------------------------
+  struct MeshData
+  {
+    std::vector<float> positions;
+    std::vector<float> normals;
+    std::vector<uint32_t> indices;
+    size_t vertexCount() const { return positions.size()/3; }
+  };
+
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief load a Wavefront OBJ, polygons are fan triangulated and v / vn pairs become vertices
+  //----------------------------------------------------------------------------------------------------------------------
+  bool loadOBJ(const std::string &_fname, MeshData &_mesh);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief load an ascii or binary little endian PLY with x,y,z (and optional nx,ny,nz) vertices
+  //----------------------------------------------------------------------------------------------------------------------
+  bool loadPLY(const std::string &_fname, MeshData &_mesh);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief pick loadOBJ or loadPLY from the extension
+  //----------------------------------------------------------------------------------------------------------------------
+  bool loadText(const std::string &_fname, MeshData &_mesh);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief replace the normals with area weighted face normals averaged at each vertex
+  //----------------------------------------------------------------------------------------------------------------------
+  void computeNormals(MeshData &_mesh);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief replace _mesh with a superellipsoid of _rings rings of 2*_rings segments and its normals,
+  /// the exponents go from close to a box (small) through a sphere (1, 1) to a pinched star (large)
+  /// @param [in] _radius the distance from the centre to the poles and the equator
+  //----------------------------------------------------------------------------------------------------------------------
+  void makeSuperellipsoid(float _e1, float _e2, size_t _rings, float _radius, MeshData &_mesh);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief write _mesh in the MeshFormat.h layout
+  //----------------------------------------------------------------------------------------------------------------------
+  bool writeMesh(const std::string &_fname, const MeshData &_mesh);
+}
+
+#endif
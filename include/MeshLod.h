@@ -0,0 +1,91 @@
+#ifndef MESHLOD_H_
+#define MESHLOD_H_
+#include "MeshSimplify.h"
+#include "PackedMesh.h"
+#include <ngl/Mat4.h>
+#include <ngl/Vec3.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MeshLod.h
+/// @brief chain of simplified levels of a mesh picked by projected size
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/10/26
+/// @class MeshLod
+/// @brief level 0 is the source mesh, each further level has about c_levelRatio of the triangles
+/// of the one before (see MeshSimplify.h). Each frame select() projects the bounding sphere with the
+/// MVP to get the pixels per object space unit and takes the coarsest level whose simplification
+/// error is under c_pixelError pixels. A coarser level is only taken once it is under
+/// c_pixelError*c_hysteresis so an object sitting on a threshold doesn't pop back and forth. The
+/// simplification is the slow part and needs no GL so it is done by simplify() on any thread, the
+/// ctor only uploads its result
+//----------------------------------------------------------------------------------------------------------------------
+
+class MeshLod
+{
+  public :
+    static constexpr float c_levelRatio=0.5f;
+    static constexpr size_t c_minTriangles=64;
+    static constexpr float c_pixelError=1.0f;
+    static constexpr float c_hysteresis=0.75f;
+    struct Level
+    {
+      size_t triangles=0;
+      float error=0.0f;
+      std::unique_ptr<PackedMesh> mesh;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the bounds and simplified levels (finest first, the source not included) of a mesh
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Chain
+    {
+      ngl::Vec3 centre;
+      float radius=0.0f;
+      std::vector<meshfile::SimplifiedMesh> levels;
+      float buildMs=0.0f;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief simplify the mesh down by c_levelRatio a level, touches no GL so it can run on a worker
+    /// @param [in] _maxLevels counting the source
+    //----------------------------------------------------------------------------------------------------------------------
+    static Chain simplify(const float *_positions, size_t _numVerts, const uint32_t *_indices, size_t _numIndices,
+                          size_t _maxLevels=8);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief upload the source mesh and every level of _chain (built from the same mesh), needs a valid GL context
+    //----------------------------------------------------------------------------------------------------------------------
+    MeshLod(const float *_positions, const float *_normals, size_t _numVerts,
+            const uint32_t *_indices, size_t _numIndices, Chain _chain);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief pick the level for this frame
+    /// @param [in] _MVP the matrix the mesh is drawn with
+    /// @param [in] _width _height the viewport in pixels
+    /// @returns the chosen level
+    //----------------------------------------------------------------------------------------------------------------------
+    size_t select(const ngl::Mat4 &_MVP, int _width, int _height);
+    void draw() const;
+    size_t current() const { return m_current; }
+    size_t numLevels() const { return m_levels.size(); }
+    const Level &level(size_t _i) const { return m_levels[_i]; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the pixels per unit from the last select, 0 when the camera was inside the bounds
+    //----------------------------------------------------------------------------------------------------------------------
+    float pixelsPerUnit() const { return m_pixelsPerUnit; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the simplification and upload times together in ms
+    //----------------------------------------------------------------------------------------------------------------------
+    float buildTime() const { return m_buildMs; }
+
+  private :
+    std::vector<Level> m_levels;
+    ngl::Vec3 m_centre;
+    float m_radius=0.0f;
+    size_t m_current=0;
+    float m_pixelsPerUnit=0.0f;
+    float m_buildMs=0.0f;
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef MESHSIMPLIFY_H_
+#define MESHSIMPLIFY_H_
+#include "MeshImport.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MeshSimplify.h
+/// @brief quadric error edge collapse simplification
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/10/26
+/// Garland / Heckbert style, each vertex sums the plane quadrics of its faces (plus a heavily
+/// weighted plane along any open edge) and the cheapest edge is collapsed to the point that
+/// minimises the summed quadric. Collapses that would flip a face or make the mesh non manifold
+/// are skipped. Vertices are welded by position first so the OBJ v / vn splits don't open cracks,
+/// the normals of each level are recomputed from its faces
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace meshfile
+{
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief one simplified level, error is the largest distance in object space from a source vertex to
+  /// the level's surface (measured against the faces within two rings of the vertex it was collapsed in
+  /// to, so on the large side) and never less than the error of the level before
+  //----------------------------------------------------------------------------------------------------------------------
+  struct SimplifiedMesh
+  {
+    MeshData mesh;
+    float error=0.0f;
+    size_t triangleCount() const { return mesh.indices.size()/3; }
+  };
+
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief simplify an indexed triangle mesh down through each of _targets (triangle counts, largest first)
+  /// in a single pass, a level is taken each time the face count reaches the next target. Fewer levels
+  /// come back if the mesh can't be reduced that far
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<SimplifiedMesh> simplify(const float *_positions, size_t _numVerts, const uint32_t *_indices,
+                                       size_t _numIndices, const std::vector<size_t> &_targets);
+}
+
+#endif
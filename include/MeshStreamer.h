@@ -0,0 +1,161 @@
+#ifndef MESHSTREAMER_H_
+#define MESHSTREAMER_H_
+#include <ngl/Types.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class QOpenGLContext;
+class QOffscreenSurface;
+class QThread;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MeshStreamer.h
+/// @brief background loading of MeshConvert files in to GL buffers
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/10/26
+/// @class MeshStreamer
+/// @brief a worker thread owns a GL context shared with the window's. For each requested file it
+/// maps the mesh (so the disk reads happen on the worker) and uploads the vertex block and
+/// indices with glBufferSubData in c_chunkBytes pieces, each followed by a fence. Only
+/// c_maxChunksInFlight chunks are let through before it waits on the oldest so the driver never
+/// holds more than that much of a copy the render thread would have to queue behind.
+/// When a mesh is all submitted its last fence is handed over, poll() on the render thread checks it
+/// without waiting and only then builds the VAO (they aren't shared between contexts), so the
+/// frame keeps drawing whatever is already resident
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a mesh that has finished streaming, owned and drawn by the render thread
+//----------------------------------------------------------------------------------------------------------------------
+class StreamedMesh
+{
+  public :
+    ~StreamedMesh();
+    StreamedMesh(const StreamedMesh &)=delete;
+    StreamedMesh &operator=(const StreamedMesh &)=delete;
+    void draw() const;
+    const std::string &name() const { return m_name; }
+    size_t vertexCount() const { return m_numVerts; }
+    size_t indexCount() const { return m_numIndices; }
+    size_t bytes() const { return m_bytes; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief from the request to the mesh being resident
+    //----------------------------------------------------------------------------------------------------------------------
+    float loadTime() const { return m_loadMs; }
+
+  private :
+    friend class MeshStreamer;
+    StreamedMesh()=default;
+    std::string m_name;
+    GLuint m_vao=0;
+    GLuint m_vbo=0;
+    GLuint m_ibo=0;
+    size_t m_numVerts=0;
+    size_t m_numIndices=0;
+    size_t m_normalOffset=0;
+    size_t m_bytes=0;
+    float m_loadMs=0.0f;
+};
+
+class MeshStreamer
+{
+  public :
+    using Clock=std::chrono::steady_clock;
+    static constexpr size_t c_chunkBytes=4*1024*1024;
+    static constexpr int c_maxChunksInFlight=4;
+    struct Stats
+    {
+      //----------------------------------------------------------------------------------------------------------------------
+      /// @brief requests not yet resident, including the one uploading and any waiting on their fence
+      //----------------------------------------------------------------------------------------------------------------------
+      size_t queueDepth=0;
+      //----------------------------------------------------------------------------------------------------------------------
+      /// @brief submitted with glBufferSubData but not yet seen complete
+      //----------------------------------------------------------------------------------------------------------------------
+      size_t bytesInFlight=0;
+      size_t bytesUploaded=0;
+      size_t meshesResident=0;
+      //----------------------------------------------------------------------------------------------------------------------
+      /// @brief of the last mesh to become resident, the time includes reading the file
+      //----------------------------------------------------------------------------------------------------------------------
+      float lastMeshMs=0.0f;
+      float lastMeshMBps=0.0f;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief create the worker and its context, call on the gui thread
+    /// @param [in] _share the context meshes are drawn with, it must not be current on another thread
+    //----------------------------------------------------------------------------------------------------------------------
+    explicit MeshStreamer(QOpenGLContext *_share);
+    ~MeshStreamer();
+    MeshStreamer(const MeshStreamer &)=delete;
+    MeshStreamer &operator=(const MeshStreamer &)=delete;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief false if the shared context couldn't be created, requests are then ignored
+    //----------------------------------------------------------------------------------------------------------------------
+    bool isValid() const { return m_valid; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief queue a file made by MeshConvert, returns straight away
+    //----------------------------------------------------------------------------------------------------------------------
+    void request(const std::string &_fname);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief call once a frame with _share current, never waits on the gpu
+    /// @returns the meshes that became resident since the last call, in request order
+    //----------------------------------------------------------------------------------------------------------------------
+    std::vector<std::unique_ptr<StreamedMesh>> poll();
+    Stats stats() const;
+
+  private :
+    class Worker;
+    struct Request
+    {
+      std::string fname;
+      Clock::time_point requested;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief a fully submitted mesh waiting on its fence, pendingBytes are still counted in flight
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Uploaded
+    {
+      std::unique_ptr<StreamedMesh> mesh;
+      Clock::time_point requested;
+      GLsync fence=nullptr;
+      size_t pendingBytes=0;
+    };
+    void run();
+    bool upload(const Request &_request);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief copy _size bytes to the buffer bound to GL_COPY_WRITE_BUFFER a chunk at a time
+    //----------------------------------------------------------------------------------------------------------------------
+    void uploadChunks(const char *_data, size_t _size);
+
+    bool m_valid=false;
+    std::unique_ptr<QOffscreenSurface> m_surface;
+    std::unique_ptr<QOpenGLContext> m_context;
+    std::unique_ptr<Worker> m_worker;
+    QThread *m_guiThread=nullptr;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the worker's chunk fences oldest first with their sizes, only touched by the worker
+    //----------------------------------------------------------------------------------------------------------------------
+    std::deque<std::pair<GLsync,size_t>> m_chunkFences;
+    mutable std::mutex m_lock;
+    std::condition_variable m_requestAdded;
+    std::deque<Request> m_requests;
+    std::deque<Uploaded> m_uploaded;
+    size_t m_uploading=0;
+    bool m_quit=false;
+    std::atomic<size_t> m_bytesInFlight{0};
+    std::atomic<size_t> m_bytesUploaded{0};
+    size_t m_meshesResident=0;
+    float m_lastMeshMs=0.0f;
+    float m_lastMeshMBps=0.0f;
+};
+
+#endif
@@ -3,10 +3,39 @@
 #include <ngl/Text.h>
 #include <ngl/Vec3.h>
 #include <ngl/Mat4.h>
+#include <ngl/Mat3.h>
 #include <ngl/AbstractVAO.h>
 #include "WindowParams.h"
+#include "BatchTransform.h"
+#include "TransformState.h"
+#include "TextOverlay.h"
+#include "FrameTrace.h"
+#include "InstancedRenderer.h"
+#include "JobSystem.h"
+#include "FrustumCuller.h"
+#include "MappedMesh.h"
+#include "PackedMesh.h"
+#include "FrameProfiler.h"
+#include "ComputeTransform.h"
+#include "TransformUBO.h"
+#include "InputAccumulator.h"
+#include "FramePacer.h"
+#include "LatencyHistogram.h"
+#include "MeshLod.h"
+#include "InputSession.h"
+#include "MeshStreamer.h"
+#include "ShaderReloader.h"
+#include "MeshBVH.h"
+#include "BatchRenderer.h"
+#include "ResolutionScaler.h"
+#include <QOpenGLFramebufferObject>
 #include <QOpenGLWindow>
+#include <QTimer>
+#include <atomic>
+#include <future>
 #include <memory>
+#include <string>
+#include <vector>
 
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -47,6 +76,11 @@ class NGLScene : public QOpenGLWindow
     /// @brief this is called everytime we resize
     //----------------------------------------------------------------------------------------------------------------------
     void resizeGL(int _w, int _h);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief ask for a frame at the next paced slot for work that isn't input, e.g. a subsystem with
+    /// results to hand over. Safe to call from any thread, repeated calls before the frame are merged
+    //----------------------------------------------------------------------------------------------------------------------
+    void requestFrame();
 
 private:
     //----------------------------------------------------------------------------------------------------------------------
@@ -58,10 +92,9 @@ private:
     //----------------------------------------------------------------------------------------------------------------------
     ngl::Mat4 m_mouseGlobalTX;
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief Our Camera
+    /// @brief Our Camera and model transform, derived matrices are only rebuilt when these change
     //----------------------------------------------------------------------------------------------------------------------
-    ngl::Mat4 m_view;
-    ngl::Mat4 m_project;
+    TransformState m_transform;
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief the model position for mouse movement
     //----------------------------------------------------------------------------------------------------------------------
@@ -71,11 +104,24 @@ private:
     //----------------------------------------------------------------------------------------------------------------------
     void loadMatricesToShader();
     //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the Phong Transforms block, sized for every object of the culled scene
+    //----------------------------------------------------------------------------------------------------------------------
+    std::unique_ptr<TransformUBO> m_transformUBO;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief render the current frame with the SoftwareRenderer and save it as a ppm
+    /// @param [in] _fname the file to write
+    //----------------------------------------------------------------------------------------------------------------------
+    void renderSoftware(const std::string &_fname);
+    //----------------------------------------------------------------------------------------------------------------------
     /// @brief Qt Event called when a key is pressed
     /// @param [in] _event the Qt event to query for size etc
     //----------------------------------------------------------------------------------------------------------------------
     void keyPressEvent(QKeyEvent *_event);
     //----------------------------------------------------------------------------------------------------------------------
+    /// @brief picks up the frame requests posted by requestFrame, everything else goes to QOpenGLWindow
+    //----------------------------------------------------------------------------------------------------------------------
+    bool event(QEvent *_event);
+    //----------------------------------------------------------------------------------------------------------------------
     /// @brief this method is called every time a mouse is moved
     /// @param _event the Qt Event structure
     //----------------------------------------------------------------------------------------------------------------------
@@ -99,21 +145,260 @@ private:
     /// @param _event the Qt Event structure
     //----------------------------------------------------------------------------------------------------------------------
     void wheelEvent( QWheelEvent *_event);
-    ngl::Mat4 m_tranMat;
-    ngl::Mat4 m_rX;
-    ngl::Mat4 m_rY;
-    ngl::Mat4 m_rZ;
-    ngl::Mat4 m_scaleMat;
-
-    ngl::Vec3 m_rot;
-    ngl::Vec3 m_scale;
-    ngl::Vec3 m_pos;
-    ngl::Mat4 m_MVP;
     std::unique_ptr<ngl::Text>m_text;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the cached overlay and the block ids for each section of it
+    //----------------------------------------------------------------------------------------------------------------------
+    std::unique_ptr<TextOverlay> m_overlay;
+    enum OverlayBlock { MVP_BLOCK, MODEL_BLOCK, VIEW_BLOCK, PROJECT_BLOCK, VERTEX_BLOCK, PROFILE_BLOCK, SHADER_BLOCK, PICK_BLOCK, BATCH_BLOCK, SCALE_BLOCK, NUM_OVERLAY_BLOCKS };
+    std::array<int,NUM_OVERLAY_BLOCKS> m_overlayBlocks;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief toggle between the cached overlay and the original per line ngl::Text one
+    //----------------------------------------------------------------------------------------------------------------------
+    bool m_cachedOverlay=true;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief gui thread time of the last overlay draw in ms so the two paths can be compared
+    //----------------------------------------------------------------------------------------------------------------------
+    float m_overlayTime=0.0f;
+    void createOverlay();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief draw the matrix HUD with one renderText per line
+    //----------------------------------------------------------------------------------------------------------------------
+    void drawOverlayPerLine();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief format the matrix HUD into the cached overlay, no GL calls so it runs as a task
+    /// @param [in] _fillTime the instance fill time to show
+    //----------------------------------------------------------------------------------------------------------------------
+    void updateOverlayCached(float _fillTime);
     bool m_wireframe;
     std::unique_ptr<ngl::AbstractVAO> m_tri;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief instanced mode draws a sweep of transformed copies of the triangle in one call
+    //----------------------------------------------------------------------------------------------------------------------
+    std::unique_ptr<InstancedRenderer> m_instanced;
+    bool m_instancedMode=false;
+    static constexpr size_t c_maxInstances=1<<17;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief cull mode draws a grid of copies of the triangle, only submitting the ones in the frustum
+    //----------------------------------------------------------------------------------------------------------------------
+    FrustumCuller m_culler;
+    std::vector<ngl::Vec3> m_scenePositions;
+    ngl::Mat4 m_cullModel;
+    bool m_cullMode=false;
+    static constexpr int c_sceneSide=128;
+    static constexpr float c_sceneSpacing=2.0f;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief refresh the object bounds if the model matrix changed and cull them against the camera
+    //----------------------------------------------------------------------------------------------------------------------
+    void cullScene();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief draw the objects that survived cullScene
+    //----------------------------------------------------------------------------------------------------------------------
+    void drawCulledScene();
     void createTriangle();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief optional mesh drawn instead of the triangle, set MVP_MESH to a file made by MeshConvert
+    //----------------------------------------------------------------------------------------------------------------------
+    std::unique_ptr<ngl::AbstractVAO> m_mesh;
+    MappedMesh m_meshFile;
+    bool loadMesh(const std::string &_fname);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief MVP_STREAM_MESH loads a mesh on a worker thread instead, the triangle (or MVP_MESH)
+    /// is drawn until it is resident
+    //----------------------------------------------------------------------------------------------------------------------
+    std::unique_ptr<MeshStreamer> m_streamer;
+    std::unique_ptr<StreamedMesh> m_streamed;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief rebuilds the programs in the background when files in shaders/ change
+    //----------------------------------------------------------------------------------------------------------------------
+    std::unique_ptr<ShaderReloader> m_shaderReloader;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the light, material and viewer position of the Phong programs
+    //----------------------------------------------------------------------------------------------------------------------
+    void setShaderDefaults(const std::string &_program, const ngl::Vec3 &_eye);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief line _line of the shader reload HUD block, returns false for an error line
+    //----------------------------------------------------------------------------------------------------------------------
+    bool formatShaderLine(int _line, char *_buffer, size_t _size) const;
+    static constexpr int c_shaderLines=3;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the triangle or loaded mesh in one of the PackedMesh layouts, -1 uses the original buffers
+    //----------------------------------------------------------------------------------------------------------------------
+    std::unique_ptr<PackedMesh> m_packed;
+    int m_vertexLayout=-1;
+    void createPackedMesh();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief compute mode transforms the triangle or loaded mesh with shaders/compute.glsl and
+    /// draws the clip space results, needs GL 4.3
+    //----------------------------------------------------------------------------------------------------------------------
+    std::unique_ptr<ComputeTransform> m_compute;
+    bool m_computeMode=false;
+    bool m_computeSupported=false;
+    void createComputeTransform();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief simplified levels of the triangle or loaded mesh, built the first time LOD mode is turned on
+    //----------------------------------------------------------------------------------------------------------------------
+    std::unique_ptr<MeshLod> m_lod;
+    bool m_lodMode=false;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the chain being simplified on a worker, paintGL uploads it and turns LOD mode on once it's ready
+    //----------------------------------------------------------------------------------------------------------------------
+    std::future<MeshLod::Chain> m_lodBuild;
+    void startMeshLodBuild();
+    void createMeshLod(MeshLod::Chain _chain);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief pick mode finds the triangle of the triangle or loaded mesh under the cursor each
+    /// frame, the BVH is built on a worker the first time it is asked for and pick mode comes on
+    /// once paintGL has collected it
+    //----------------------------------------------------------------------------------------------------------------------
+    std::unique_ptr<MeshBVH> m_bvh;
+    std::future<std::unique_ptr<MeshBVH>> m_bvhBuild;
+    bool m_pickMode=false;
+    void startPickBVHBuild();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief true when the triangle or loaded mesh the BVH was built from is what's being drawn
+    //----------------------------------------------------------------------------------------------------------------------
+    bool drawsPickMesh() const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief cast a ray through the last cursor position with this frame's MVP
+    //----------------------------------------------------------------------------------------------------------------------
+    void pickUnderCursor();
+    int m_cursorX=-1;
+    int m_cursorY=-1;
+    MeshBVH::Hit m_pick;
+    float m_pickUs=0.0f;
+    static constexpr int c_pickLines=3;
+    void formatPickLine(int _line, char *_buffer, size_t _size) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief batch mode draws a grid of different generated meshes from the shared arenas with
+    /// one multi draw call, or one call each to compare, needs GL 4.3
+    //----------------------------------------------------------------------------------------------------------------------
+    std::unique_ptr<BatchRenderer> m_batch;
+    bool m_batchMode=false;
+    bool m_batchMultiDraw=true;
+    bool m_batchSupported=false;
+    std::vector<int> m_batchMeshes;
+    size_t m_batchTriangles=0;
+    static constexpr int c_batchSide=16;
+    static constexpr float c_batchSpacing=2.5f;
+    void createBatchScene();
+    void drawBatchScene();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the last frame's batch stats, copied before the overlay tasks start as the draw overwrites them
+    //----------------------------------------------------------------------------------------------------------------------
+    BatchRenderer::Stats m_batchStats;
+    static constexpr int c_batchLines=2;
+    void formatBatchLine(int _line, char *_buffer, size_t _size) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief triangles the current mode submits, worked out before the frame's tasks start
+    //----------------------------------------------------------------------------------------------------------------------
+    size_t m_frameTriangles=0;
+    size_t submittedTriangles() const;
+    const char *vertexLayoutName() const;
+    size_t separateLayoutBytes() const;
     const static std::array<ngl::Vec3,3> s_triVerts;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief SoA copy of s_triVerts fed to the batch transform
+    //----------------------------------------------------------------------------------------------------------------------
+    VertexBatchSoA m_triBatch;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the clip space vertices from the last frame
+    //----------------------------------------------------------------------------------------------------------------------
+    ClipBatchSoA m_clipVerts;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief binary trace of the per frame matrices and transformed points
+    //----------------------------------------------------------------------------------------------------------------------
+    FrameTrace m_trace;
+    uint64_t m_frame=0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief key / mouse events and frame markers for --replay, Y or MVP_RECORD starts it
+    //----------------------------------------------------------------------------------------------------------------------
+    InputSession m_session;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief runs the per frame cpu stages alongside the GL submission, plus the stats of the last frame
+    //----------------------------------------------------------------------------------------------------------------------
+    JobSystem m_jobs;
+    JobSystem::Stats m_jobStats;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief cpu / gpu time of each stage of paintGL, E writes them to frameProfile.csv / .json
+    //----------------------------------------------------------------------------------------------------------------------
+    FrameProfiler m_profiler;
+    enum ProfileStage { FRAME_STAGE, SETUP_STAGE, UPLOAD_STAGE, DRAW_STAGE, JOBS_STAGE, OVERLAY_STAGE, NUM_PROFILE_STAGES };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the rolling stats of each stage as HUD lines
+    //----------------------------------------------------------------------------------------------------------------------
+    void formatProfileLine(int _stage, char *_buffer, size_t _size) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the event handlers only accumulate, the merged deltas are applied once at the start of the next frame
+    //----------------------------------------------------------------------------------------------------------------------
+    InputAccumulator m_input;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief target rate from MVP_TARGET_FPS (default 60, 0 draws as soon as asked), the timer holds
+    /// a requested frame back until the pacer says to start it
+    //----------------------------------------------------------------------------------------------------------------------
+    FramePacer m_pacer;
+    QTimer m_frameTimer;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief time from the oldest input of a frame to its swap, H prints it
+    //----------------------------------------------------------------------------------------------------------------------
+    LatencyHistogram m_latency;
+    bool m_frameHasInput=false;
+    InputAccumulator::Clock::time_point m_frameInput;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief ask for a frame at the next paced slot, replaces calling update() directly
+    //----------------------------------------------------------------------------------------------------------------------
+    void scheduleFrame();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief connected to frameSwapped, records the latency and the frame cost
+    //----------------------------------------------------------------------------------------------------------------------
+    void framePresented();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief true while a subsystem needs more frames to finish what it started without any input
+    //----------------------------------------------------------------------------------------------------------------------
+    bool hasPendingWork() const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief idle frames still to draw after the last one with work, enough for the profiler to read
+    /// back that frame's gpu times (FrameProfiler::c_latency)
+    //----------------------------------------------------------------------------------------------------------------------
+    int m_trailingFrames=0;
+    bool m_frameRequested=false;
+    std::atomic<bool> m_frameRequestPosted{false};
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief scale mode draws the scene in to m_sceneFBO at the size m_scaler picks to keep the
+    /// frame inside its budget (MVP_RENDER_BUDGET ms, default the pacer's period) and stretches it
+    /// over the window, the overlay is still drawn at full size. U toggles it
+    //----------------------------------------------------------------------------------------------------------------------
+    ResolutionScaler m_scaler;
+    bool m_scaleMode=false;
+    std::unique_ptr<QOpenGLFramebufferObject> m_sceneFBO;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the window is multisampled so the scene texture is drawn over it with the ScaleBlit
+    /// program rather than blitted, the VAO is empty as the triangle comes from gl_VertexID
+    //----------------------------------------------------------------------------------------------------------------------
+    bool m_scaleSupported=false;
+    GLuint m_scaleBlitVAO=0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the profiler frame last given to m_scaler, each one is only counted once
+    //----------------------------------------------------------------------------------------------------------------------
+    uint64_t m_scaleSampleFrame=0;
+    bool m_scaleSampled=false;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the size the scene is drawn at this frame, the window's unless it is being scaled
+    //----------------------------------------------------------------------------------------------------------------------
+    int m_renderWidth=0;
+    int m_renderHeight=0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief give m_scaler the newest frame time and bind the scene target at its size
+    /// @returns true if the scene is going to m_sceneFBO rather than the window
+    //----------------------------------------------------------------------------------------------------------------------
+    bool beginScaledScene();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief stretch m_sceneFBO over the window and go back to drawing to it, scale mode is turned
+    /// off if that raises a GL error so the window never keeps showing a stale frame
+    //----------------------------------------------------------------------------------------------------------------------
+    void endScaledScene();
+    static constexpr int c_scaleLines=2;
+    void formatScaleLine(int _line, char *_buffer, size_t _size) const;
 };
 
 
@@ -0,0 +1,191 @@
+#ifndef OFFSCREENRENDERER_H_
+#define OFFSCREENRENDERER_H_
+#include "TransformState.h"
+#include "PackedMesh.h"
+#include "TransformUBO.h"
+#include "FrameProfiler.h"
+#include "InputSession.h"
+#include <ngl/Types.h>
+#include <ngl/Vec3.h>
+#include <QOpenGLFramebufferObject>
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file OffscreenRenderer.h
+/// @brief headless batch rendering of scripted frames to image files
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/10/26
+/// @class OffscreenRenderer
+/// @brief draws the Phong triangle (or a MeshConvert file) into an FBO for each frame of a script. Each frame is read
+/// back with glReadPixels into one of a ring of pixel buffer objects and fenced, the pixels of
+/// frame N are only mapped when frame N+c_numPBOs needs its buffer, so the readback overlaps the
+/// rendering of the c_numPBOs-1 frames in between. Mapped frames are copied out and written as PPM files by a pool of encoder
+/// threads. Needs a current GL context (e.g. a QOffscreenSurface) for its whole lifetime.
+/// replay() instead draws a recorded InputSession with no readback and reports the frame times
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the settings for one frame of a batch, see OffscreenRenderer::parseScript
+//----------------------------------------------------------------------------------------------------------------------
+struct BatchFrame
+{
+  ngl::Vec3 position=ngl::Vec3(0.0f,0.0f,0.0f);
+  ngl::Vec3 rotation=ngl::Vec3(0.0f,0.0f,0.0f);
+  ngl::Vec3 scale=ngl::Vec3(1.0f,1.0f,1.0f);
+  ngl::Vec3 eye=ngl::Vec3(0.0f,1.0f,1.0f);
+  ngl::Vec3 target=ngl::Vec3(0.0f,0.0f,0.0f);
+  ngl::Vec3 up=ngl::Vec3(0.0f,1.0f,0.0f);
+  float fov=45.0f;
+  float zNear=0.05f;
+  float zFar=350.0f;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the results of OffscreenRenderer::replay, written as flat "key": value pairs so the
+/// PerfCompare tool can diff two runs without a JSON parser
+//----------------------------------------------------------------------------------------------------------------------
+struct ReplayReport
+{
+  std::string session;
+  size_t frames=0;
+  size_t events=0;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief events the offscreen path has nothing to apply to, the keys that toggle modes
+  //----------------------------------------------------------------------------------------------------------------------
+  size_t ignored=0;
+  double seconds=0.0;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the wall time of each frame including a glFinish so the gpu work is counted
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<float> frameMs;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the profiler summaries, these only cover the last FrameProfiler::c_historySize frames
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<std::string> stageNames;
+  std::vector<FrameProfiler::Summary> stages;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the _p (0-1) percentile of frameMs
+  //----------------------------------------------------------------------------------------------------------------------
+  float percentile(float _p) const;
+  void print(std::ostream &_out) const;
+  bool writeJSON(const std::string &_fname) const;
+};
+
+class OffscreenRenderer
+{
+  public :
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief number of pixel buffer objects in the readback ring
+    //----------------------------------------------------------------------------------------------------------------------
+    static constexpr int c_numPBOs=3;
+    struct Stats
+    {
+      size_t frames=0;
+      double seconds=0.0;
+      double framesPerSecond=0.0;
+      //----------------------------------------------------------------------------------------------------------------------
+      /// @brief time spent waiting for readback fences and for a free encoder slot
+      //----------------------------------------------------------------------------------------------------------------------
+      double readbackWaitMs=0.0;
+      double encodeWaitMs=0.0;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief ctor, builds the FBO, PBOs, shader and geometry
+    /// @param [in] _width the image width
+    /// @param [in] _height the image height
+    /// @param [in] _meshFile a file made by MeshConvert to draw, empty for the triangle
+    /// @param [in] _encodeThreads threads writing images, 0 means one per spare core
+    //----------------------------------------------------------------------------------------------------------------------
+    OffscreenRenderer(int _width, int _height, const std::string &_meshFile="", unsigned int _encodeThreads=0);
+    ~OffscreenRenderer();
+    OffscreenRenderer(const OffscreenRenderer &)=delete;
+    OffscreenRenderer &operator=(const OffscreenRenderer &)=delete;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief render every frame and write them to files
+    /// @param [in] _frames the frames to render
+    /// @param [in] _outPattern pattern taking the frame number e.g. out/frame%04d.ppm, see frameName
+    /// @returns false if the pattern is invalid or any image failed to write
+    //----------------------------------------------------------------------------------------------------------------------
+    bool render(const std::vector<BatchFrame> &_frames, const std::string &_outPattern);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief false if the shader, mesh or FBO couldn't be created
+    //----------------------------------------------------------------------------------------------------------------------
+    bool isValid() const { return m_valid; }
+    const Stats &stats() const { return m_stats; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief read a script, one frame per line made of keyword value pairs
+    /// position x y z | rotation x y z | scale x y z | eye x y z | target x y z | up x y z |
+    /// fov f | near f | far f | repeat n | spin x y z
+    /// values not given keep the previous frame's, repeat n emits n frames from the line adding
+    /// spin to the rotation each time, # starts a comment
+    /// @returns false on a read or syntax error
+    //----------------------------------------------------------------------------------------------------------------------
+    static bool parseScript(const std::string &_fname, std::vector<BatchFrame> &_frames);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief put a frame number in to an output pattern, the pattern is never used as a printf
+    /// format so it must have exactly one %d with an optional 0 flag and width (e.g. %04d), %% for a
+    /// literal %, and nothing else after a %
+    /// @param [out] _name the file name
+    /// @returns false if the pattern isn't like that
+    //----------------------------------------------------------------------------------------------------------------------
+    static bool frameName(const std::string &_pattern, size_t _frame, std::string &_name);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief draw a recorded session, the keys and mouse events before each frame marker are
+    /// applied as NGLScene does (InputSession::applyTransformKey and applyMouseEvent, merged per
+    /// frame like InputAccumulator) starting from NGLScene's initial camera
+    /// @param [in] _session the loaded session
+    /// @param [in] _realtime wait for each frame's recorded time, otherwise run as fast as possible
+    /// @param [out] _report the frame times and stage summaries
+    /// @returns false if the renderer isn't valid
+    //----------------------------------------------------------------------------------------------------------------------
+    bool replay(const InputSession &_session, bool _realtime, ReplayReport &_report);
+
+  private :
+    struct EncodeJob
+    {
+      std::string fname;
+      std::vector<unsigned char> pixels;
+    };
+    void drawFrame(const BatchFrame &_frame);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief upload m_transform and draw the mesh in to the bound FBO
+    //----------------------------------------------------------------------------------------------------------------------
+    void drawTransform(const ngl::Vec3 &_eye);
+    void collect(size_t _frame, const std::string &_outPattern);
+    void encodeLoop();
+
+    int m_width;
+    int m_height;
+    bool m_valid=false;
+    std::unique_ptr<QOpenGLFramebufferObject> m_fbo;
+    std::array<GLuint,c_numPBOs> m_pbos;
+    std::array<GLsync,c_numPBOs> m_fences;
+    std::unique_ptr<PackedMesh> m_mesh;
+    TransformState m_transform;
+    std::unique_ptr<TransformUBO> m_transformUBO;
+    std::vector<std::thread> m_encoders;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief frames waiting to be encoded, m_pending also counts the ones being written and is
+    /// kept under m_maxPending so a slow disk holds the render loop up instead of using memory
+    //----------------------------------------------------------------------------------------------------------------------
+    std::deque<EncodeJob> m_queue;
+    std::mutex m_queueLock;
+    std::condition_variable m_queueChanged;
+    size_t m_pending=0;
+    size_t m_maxPending;
+    bool m_quit=false;
+    bool m_writeFailed=false;
+    Stats m_stats;
+};
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef PACKEDMESH_H_
+#define PACKEDMESH_H_
+#include <ngl/AbstractVAO.h>
+#include <ngl/Vec3.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file PackedMesh.h
+/// @brief single interleaved vertex buffer with optionally quantized positions and normals
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/10/26
+/// @class PackedMesh
+/// @brief an alternative to the separate float position / normal buffers, the vertices are
+/// interleaved in one buffer of a SimpleIndexVAO and can be stored as
+/// - Float : xyz float position, xyz float normal (24 bytes)
+/// - HalfOct : xyz half float position, octahedral normal in two snorm16 (12 bytes)
+/// - UNorm16Oct : xyz unorm16 position relative to the bounding box, octahedral normal (12 bytes)
+/// PhongVertex.glsl decodes the quantized forms when the uniforms from setDecodeUniforms are set
+//----------------------------------------------------------------------------------------------------------------------
+
+class PackedMesh
+{
+  public :
+    enum class Format { Float, HalfOct, UNorm16Oct };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief gpu memory used by a layout
+    //----------------------------------------------------------------------------------------------------------------------
+    struct MemoryStats
+    {
+      Format format;
+      size_t bytesPerVertex=0;
+      size_t vertexBytes=0;
+      size_t indexBytes=0;
+      size_t totalBytes=0;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief build the buffer, needs a valid GL context
+    /// @param [in] _positions xyz per vertex
+    /// @param [in] _normals xyz per vertex
+    /// @param [in] _numVerts the number of vertices
+    /// @param [in] _indices triangle indices, if null the vertices are drawn in order
+    /// @param [in] _numIndices the number of indices
+    /// @param [in] _format how to store the vertices
+    //----------------------------------------------------------------------------------------------------------------------
+    PackedMesh(const float *_positions, const float *_normals, size_t _numVerts,
+               const uint32_t *_indices, size_t _numIndices, Format _format);
+    void draw() const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief set the decode uniforms of the current shader for this mesh, clearDecodeUniforms
+    /// sets them back for the plain float buffers
+    //----------------------------------------------------------------------------------------------------------------------
+    void setDecodeUniforms() const;
+    static void clearDecodeUniforms();
+
+    Format format() const { return m_format; }
+    const MemoryStats &memory() const { return m_memory; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief largest distance between an original and a decoded position
+    //----------------------------------------------------------------------------------------------------------------------
+    float maxPositionError() const { return m_maxPositionError; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the memory a mesh of this size would use in a layout, separateFloatBytes is the
+    /// original two buffer float layout for comparison
+    //----------------------------------------------------------------------------------------------------------------------
+    static size_t bytesPerVertex(Format _format);
+    static MemoryStats memoryFor(Format _format, size_t _numVerts, size_t _numIndices);
+    static size_t separateFloatBytes(size_t _numVerts, size_t _numIndices);
+    static const char *formatName(Format _format);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the encoders, public so the tools can check the round trip
+    //----------------------------------------------------------------------------------------------------------------------
+    static uint16_t floatToHalf(float _v);
+    static float halfToFloat(uint16_t _h);
+    static void octEncode(const float *_n, int16_t *_out);
+    static void octDecode(const int16_t *_e, float *_out);
+
+  private :
+    Format m_format;
+    std::unique_ptr<ngl::AbstractVAO> m_vao;
+    ngl::Vec3 m_boundsMin;
+    ngl::Vec3 m_boundsExtent;
+    MemoryStats m_memory;
+    float m_maxPositionError=0.0f;
+};
+
+#endif
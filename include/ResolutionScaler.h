@@ -0,0 +1,81 @@
+#ifndef RESOLUTIONSCALER_H_
+#define RESOLUTIONSCALER_H_
+#include <cstddef>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file ResolutionScaler.h
+/// @brief picks the scale the scene is rendered at so the frame fits a time budget
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/10/26
+/// @class ResolutionScaler
+/// @brief fed one measured frame time per frame, kept as an exponential moving average. Over
+/// budget the scale drops straight to where the average says the frame would fit, assuming the
+/// cost goes with the number of pixels (the scale squared); under c_growBelow of the budget it
+/// grows one c_step at a time and only if the same model says the bigger frame still fits, so it
+/// doesn't bounce between two sizes. After each change the next c_settleFrames samples are
+/// ignored as they were measured at the old size (the gpu times arrive a few frames late). The
+/// samples should be the gpu time, a cpu bound frame gains nothing from a smaller scale
+//----------------------------------------------------------------------------------------------------------------------
+
+class ResolutionScaler
+{
+  public :
+    enum class Decision { Hold, Down, Up, Settle };
+    static constexpr float c_minScale=0.5f;
+    static constexpr float c_maxScale=1.0f;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief scales are multiples of this so the render target is only reallocated on a real change
+    //----------------------------------------------------------------------------------------------------------------------
+    static constexpr float c_step=0.05f;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief fractions of the budget, going down aims for c_aim, going up needs the average under
+    /// c_growBelow and the predicted cost under c_aim
+    //----------------------------------------------------------------------------------------------------------------------
+    static constexpr float c_aim=0.9f;
+    static constexpr float c_growBelow=0.75f;
+    static constexpr int c_settleFrames=8;
+    static constexpr float c_smoothing=0.2f;
+    explicit ResolutionScaler(float _budgetMs=1000.0f/60.0f);
+    void setBudget(float _ms);
+    float budgetMs() const { return m_budgetMs; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief add a frame time in ms
+    /// @returns true if the scale changed
+    //----------------------------------------------------------------------------------------------------------------------
+    bool addSample(float _frameMs);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief back to c_maxScale with no history
+    //----------------------------------------------------------------------------------------------------------------------
+    void reset();
+    float scale() const { return m_scale; }
+    float averageMs() const { return m_averageMs; }
+    Decision decision() const { return m_decision; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief true while samples are still being ignored after a change
+    //----------------------------------------------------------------------------------------------------------------------
+    bool settling() const { return m_settle>0; }
+    static const char *decisionName(Decision _decision);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the number of changes and the scales either side of the last one
+    //----------------------------------------------------------------------------------------------------------------------
+    size_t changes() const { return m_changes; }
+    float previousScale() const { return m_previousScale; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief a window dimension at _scale, at least one pixel
+    //----------------------------------------------------------------------------------------------------------------------
+    static int scaled(int _size, float _scale);
+
+  private :
+    void change(float _scale, Decision _decision);
+    float m_budgetMs;
+    float m_scale=c_maxScale;
+    float m_previousScale=c_maxScale;
+    float m_averageMs=0.0f;
+    size_t m_samples=0;
+    int m_settle=0;
+    size_t m_changes=0;
+    Decision m_decision=Decision::Hold;
+};
+
+#endif
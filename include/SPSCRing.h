@@ -0,0 +1,100 @@
+#ifndef SPSCRING_H_
+#define SPSCRING_H_
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file SPSCRing.h
+/// @brief lock free single producer / single consumer byte ring buffer
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/10/26
+/// @class SPSCRing
+/// @brief one thread writes with tryWrite, one other thread reads with read / peek, the head
+/// and tail only ever increase and are masked into the buffer so the capacity must be a power
+/// of two, writes are all or nothing so a full ring drops the record rather than blocking
+//----------------------------------------------------------------------------------------------------------------------
+
+class SPSCRing
+{
+  public :
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief ctor
+    /// @param [in] _capacity size in bytes, rounded up to a power of two
+    //----------------------------------------------------------------------------------------------------------------------
+    explicit SPSCRing(size_t _capacity)
+    {
+      size_t size=1;
+      while(size < _capacity)
+        size<<=1;
+      m_buffer.resize(size);
+      m_mask=size-1;
+    }
+    size_t capacity() const { return m_buffer.size(); }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief producer side, write two parts (usually header and payload) as one record
+    /// @returns false if there was not enough space, nothing is written in that case
+    //----------------------------------------------------------------------------------------------------------------------
+    bool tryWrite(const void *_a, size_t _aSize, const void *_b=nullptr, size_t _bSize=0)
+    {
+      size_t head=m_head.load(std::memory_order_relaxed);
+      size_t tail=m_tail.load(std::memory_order_acquire);
+      if(capacity()-(head-tail) < _aSize+_bSize)
+        return false;
+      copyIn(head,_a,_aSize);
+      copyIn(head+_aSize,_b,_bSize);
+      m_head.store(head+_aSize+_bSize,std::memory_order_release);
+      return true;
+    }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief consumer side, bytes available to read
+    //----------------------------------------------------------------------------------------------------------------------
+    size_t available() const
+    {
+      return m_head.load(std::memory_order_acquire)-m_tail.load(std::memory_order_relaxed);
+    }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief consumer side, copy _size bytes out without consuming them
+    //----------------------------------------------------------------------------------------------------------------------
+    void peek(void *_dest, size_t _size) const
+    {
+      copyOut(m_tail.load(std::memory_order_relaxed),_dest,_size);
+    }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief consumer side, copy _size bytes out and release the space to the producer
+    //----------------------------------------------------------------------------------------------------------------------
+    void read(void *_dest, size_t _size)
+    {
+      size_t tail=m_tail.load(std::memory_order_relaxed);
+      copyOut(tail,_dest,_size);
+      m_tail.store(tail+_size,std::memory_order_release);
+    }
+
+  private :
+    void copyIn(size_t _pos, const void *_src, size_t _size)
+    {
+      if(_size==0)
+        return;
+      size_t offset=_pos & m_mask;
+      size_t first=std::min(_size,capacity()-offset);
+      std::memcpy(&m_buffer[offset],_src,first);
+      std::memcpy(&m_buffer[0],static_cast<const char *>(_src)+first,_size-first);
+    }
+    void copyOut(size_t _pos, void *_dest, size_t _size) const
+    {
+      size_t offset=_pos & m_mask;
+      size_t first=std::min(_size,capacity()-offset);
+      std::memcpy(_dest,&m_buffer[offset],first);
+      std::memcpy(static_cast<char *>(_dest)+first,&m_buffer[0],_size-first);
+    }
+    std::vector<char> m_buffer;
+    size_t m_mask;
+    // keep the producer and consumer indices on separate cache lines
+    alignas(64) std::atomic<size_t> m_head{0};
+    alignas(64) std::atomic<size_t> m_tail{0};
+};
+
+#endif
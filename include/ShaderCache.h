@@ -0,0 +1,86 @@
+#ifndef SHADERCACHE_H_
+#define SHADERCACHE_H_
+#include <ngl/Types.h>
+#include <ngl/ShaderLib.h>
+#include <cstdint>
+#include <initializer_list>
+#include <set>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file ShaderCache.h
+/// @brief on disk cache of linked shader program binaries
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/10/26
+/// @class ShaderCache
+/// @brief programs are created through ngl::ShaderLib as usual but each one is keyed by a hash
+/// of its shader sources, the defines and the GL vendor / renderer / version strings. If a
+/// binary with that key is on disk it is loaded with glProgramBinary instead of compiling, if
+/// not (or the driver rejects it) the program is compiled and linked from source and the new
+/// binary saved. Needs GL 4.1 or ARB_get_program_binary, without it every program is compiled
+//----------------------------------------------------------------------------------------------------------------------
+
+class ShaderCache
+{
+  public :
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief one shader of a program, shaders shared between programs are only compiled once
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Stage
+    {
+      std::string name;
+      ngl::ShaderType type;
+      std::string path;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief accumulated time in ms for each phase of loading plus the hit / miss counts
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Stats
+    {
+      unsigned int hits=0;
+      unsigned int misses=0;
+      float hashMs=0.0f;
+      float binaryLoadMs=0.0f;
+      float compileMs=0.0f;
+      float linkMs=0.0f;
+      float storeMs=0.0f;
+      float totalMs() const { return hashMs+binaryLoadMs+compileMs+linkMs+storeMs; }
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief ctor needs a valid GL context for the driver strings
+    /// @param [in] _dir where to keep the binaries, created if needed
+    /// @param [in] _defines added after the #version line of every shader and part of the key
+    //----------------------------------------------------------------------------------------------------------------------
+    ShaderCache(const std::string &_dir, const std::string &_defines="");
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief create _program in ngl::ShaderLib from the cache or from source
+    /// @returns false if the sources couldn't be read or the program failed to compile / link
+    //----------------------------------------------------------------------------------------------------------------------
+    bool loadProgram(const std::string &_program, std::initializer_list<Stage> _stages);
+    const Stats &stats() const { return m_stats; }
+    bool binariesSupported() const { return m_supported; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief 64 bit FNV-1a, exposed so tools can compute the same keys
+    //----------------------------------------------------------------------------------------------------------------------
+    static uint64_t hash(const std::string &_data, uint64_t _seed=14695981039346656037ULL);
+
+  private :
+    std::string injectDefines(const std::string &_source) const;
+    std::string cacheFile(const std::string &_program, uint64_t _key) const;
+    bool loadBinary(GLuint _id, const std::string &_file, uint64_t _key);
+    void storeBinary(GLuint _id, const std::string &_file, uint64_t _key);
+
+    std::string m_dir;
+    std::string m_defines;
+    std::string m_driver;
+    bool m_supported=false;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief shaders already compiled in to ShaderLib on a miss
+    //----------------------------------------------------------------------------------------------------------------------
+    std::set<std::string> m_compiled;
+    Stats m_stats;
+};
+
+#endif
@@ -0,0 +1,192 @@
+#ifndef SHADERRELOADER_H_
+#define SHADERRELOADER_H_
+#include "ShaderCache.h"
+#include <ngl/Types.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+class QFileSystemWatcher;
+class QOffscreenSurface;
+class QOpenGLContext;
+class QThread;
+class QTimer;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file ShaderReloader.h
+/// @brief rebuilds shader programs in the background when their sources change on disk
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/10/26
+/// @class ShaderReloader
+/// @brief a QFileSystemWatcher on the shader directory queues a rebuild of every watched program
+/// using a changed file. With KHR_parallel_shader_compile (or the ARB version) the new program is
+/// compiled and linked on the render context by the driver's own threads and poll() just asks if it
+/// has completed, otherwise a worker thread with a context shared with the window's does the
+/// compile and link. Either way the linked program is read back with glGetProgramBinary, loaded in
+/// to a scratch program (on the worker's context when there is one) and only if the driver takes it
+/// is it loaded in to the existing ngl::ShaderLib program with glProgramBinary, the same way
+/// ShaderCache does, so the program id and name stay the same and the old program is drawn with
+/// right up to that point. Nothing here waits on a compile
+//----------------------------------------------------------------------------------------------------------------------
+
+class ShaderReloader
+{
+  public :
+    using Clock=std::chrono::steady_clock;
+    using Stage=ShaderCache::Stage;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief called on the render thread after a program has been replaced, the uniforms and
+    /// block bindings went with the old one so anything set once at startup has to be set again
+    //----------------------------------------------------------------------------------------------------------------------
+    using ReloadedFunc=std::function<void(const std::string &_program)>;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief asks the window for a frame so poll() gets called, from the gui thread when a rebuild
+    /// is queued and from the worker when one finishes, so it has to be thread safe
+    //----------------------------------------------------------------------------------------------------------------------
+    using FrameRequestFunc=std::function<void()>;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the outcome of the last rebuild for the overlay, only changes in poll() apart from
+    /// pending which also counts a rebuild as soon as it is queued
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Status
+    {
+      std::string program;
+      bool ok=true;
+      //----------------------------------------------------------------------------------------------------------------------
+      /// @brief from the file change being seen to the program being ready, includes the debounce
+      //----------------------------------------------------------------------------------------------------------------------
+      float buildMs=0.0f;
+      //----------------------------------------------------------------------------------------------------------------------
+      /// @brief the first line of the compile or link log when the build failed
+      //----------------------------------------------------------------------------------------------------------------------
+      std::string error;
+      unsigned int reloads=0;
+      unsigned int failures=0;
+      size_t pending=0;
+    };
+    static constexpr int c_debounceMs=50;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief start watching, call on the gui thread with _context current
+    /// @param [in] _context the window's context, must not be current on another thread
+    /// @param [in] _dir the directory the shader sources are in
+    /// @param [in] _reloaded called after each successful reload
+    /// @param [in] _requestFrame called whenever poll() has something to do
+    //----------------------------------------------------------------------------------------------------------------------
+    ShaderReloader(QOpenGLContext *_context, const std::string &_dir, ReloadedFunc _reloaded, FrameRequestFunc _requestFrame);
+    ~ShaderReloader();
+    ShaderReloader(const ShaderReloader &)=delete;
+    ShaderReloader &operator=(const ShaderReloader &)=delete;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief rebuild _program whenever one of its stages changes, the stages are the ones it was
+    /// created from and _program must already be in ngl::ShaderLib
+    //----------------------------------------------------------------------------------------------------------------------
+    void watch(const std::string &_program, std::initializer_list<Stage> _stages);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief call once a frame with the context current, swaps in any program that has finished
+    /// building and never waits on one that hasn't
+    //----------------------------------------------------------------------------------------------------------------------
+    void poll();
+    const Status &status() const { return m_status; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief false without program binaries, there is no way to hand a program over without them
+    //----------------------------------------------------------------------------------------------------------------------
+    bool isValid() const { return m_valid; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief true when the driver compiles in parallel, false when the worker thread does
+    //----------------------------------------------------------------------------------------------------------------------
+    bool isParallel() const { return m_parallel; }
+
+  private :
+    class Worker;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief one rebuild of a program, made on the gui thread and finished by the driver or the worker
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Build
+    {
+      std::string program;
+      unsigned int generation=0;
+      std::vector<std::pair<GLenum,std::string>> sources;
+      Clock::time_point changed;
+      // the objects the parallel path is waiting on
+      GLuint id=0;
+      std::vector<GLuint> shaders;
+      // the results
+      bool ok=false;
+      std::string log;
+      GLenum format=0;
+      std::vector<char> binary;
+    };
+    struct Program
+    {
+      std::vector<Stage> stages;
+      //----------------------------------------------------------------------------------------------------------------------
+      /// @brief bumped for each rebuild, a build finishing after a newer one was started is dropped
+      //----------------------------------------------------------------------------------------------------------------------
+      unsigned int generation=0;
+      //----------------------------------------------------------------------------------------------------------------------
+      /// @brief the binary last loaded, restored if the driver won't take a new one and can't give the old one back
+      //----------------------------------------------------------------------------------------------------------------------
+      GLenum format=0;
+      std::vector<char> binary;
+    };
+    void fileChanged(const std::string &_path);
+    void rebuildChanged();
+    std::unique_ptr<Build> makeBuild(const std::string &_program);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief compile and link _build's sources in to a new program
+    /// @param [in] _wait if true wait for the results and read them back, the worker's path
+    //----------------------------------------------------------------------------------------------------------------------
+    static void startBuild(Build &_build, bool _wait);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief read the status, logs and binary of a completed build, check the binary loads in to a
+    /// scratch program then delete its GL objects
+    //----------------------------------------------------------------------------------------------------------------------
+    static void finishBuild(Build &_build);
+    void apply(Build &_build);
+    void run();
+
+    bool m_valid=false;
+    bool m_parallel=false;
+    std::string m_dir;
+    ReloadedFunc m_reloaded;
+    FrameRequestFunc m_requestFrame;
+    std::map<std::string,Program> m_programs;
+    Status m_status;
+    std::unique_ptr<QFileSystemWatcher> m_watcher;
+    std::unique_ptr<QTimer> m_debounce;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief files changed since the debounce timer was started and when the first change was seen
+    //----------------------------------------------------------------------------------------------------------------------
+    std::set<std::string> m_changed;
+    Clock::time_point m_firstChange;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the parallel path's builds in the driver, only touched on the gui thread
+    //----------------------------------------------------------------------------------------------------------------------
+    std::vector<std::unique_ptr<Build>> m_compiling;
+    // the worker path
+    std::unique_ptr<QOffscreenSurface> m_surface;
+    std::unique_ptr<QOpenGLContext> m_context;
+    std::unique_ptr<Worker> m_worker;
+    QThread *m_guiThread=nullptr;
+    std::mutex m_lock;
+    std::condition_variable m_buildAdded;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief builds waiting to start (the parallel path starts them in poll as it needs the
+    /// context current) and finished ones waiting to be applied
+    //----------------------------------------------------------------------------------------------------------------------
+    std::deque<std::unique_ptr<Build>> m_queued;
+    std::deque<std::unique_ptr<Build>> m_built;
+    size_t m_building=0;
+    bool m_quit=false;
+};
+
+#endif
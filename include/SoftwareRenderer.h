@@ -0,0 +1,170 @@
+#ifndef SOFTWARERENDERER_H_
+#define SOFTWARERENDERER_H_
+#include <ngl/Vec3.h>
+#include <ngl/Vec4.h>
+#include <ngl/Mat3.h>
+#include <ngl/Mat4.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file SoftwareRenderer.h
+/// @brief a headless cpu implementation of the Phong pipeline used by NGLScene
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/10/26
+/// @class SoftwareRenderer
+/// @brief tile based, multithreaded rasterizer which runs the same maths as shaders/PhongVertex.glsl
+/// and shaders/PhongFragment.glsl using the MVP / MV / normalMatrix / M values from
+/// NGLScene::loadMatricesToShader, the result is an RGBA8 image (top row first)
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief mirrors the Lights struct in the Phong shaders, defaults match NGLScene::initializeGL
+//----------------------------------------------------------------------------------------------------------------------
+struct PhongLight
+{
+  ngl::Vec4 position=ngl::Vec4(0.0f,2.0f,2.0f,0.0f);
+  ngl::Vec4 ambient=ngl::Vec4(0.0f,0.0f,0.0f,1.0f);
+  ngl::Vec4 diffuse=ngl::Vec4(1.0f,1.0f,1.0f,1.0f);
+  ngl::Vec4 specular=ngl::Vec4(0.8f,0.8f,0.8f,1.0f);
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief mirrors the Materials struct in PhongFragment.glsl, defaults are the gold material
+//----------------------------------------------------------------------------------------------------------------------
+struct PhongMaterial
+{
+  ngl::Vec4 ambient=ngl::Vec4(0.274725f,0.1995f,0.0745f,0.0f);
+  ngl::Vec4 diffuse=ngl::Vec4(0.75164f,0.60648f,0.22648f,0.0f);
+  ngl::Vec4 specular=ngl::Vec4(0.628281f,0.555802f,0.3666065f,0.0f);
+  float shininess=51.2f;
+};
+
+class SoftwareRenderer
+{
+  public :
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief ctor
+    /// @param [in] _width the image width
+    /// @param [in] _height the image height
+    /// @param [in] _numThreads the number of worker threads, 0 means use all cores
+    //----------------------------------------------------------------------------------------------------------------------
+    SoftwareRenderer(int _width, int _height, unsigned int _numThreads=0);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief resize the colour and depth buffers, contents are undefined until the next clear
+    //----------------------------------------------------------------------------------------------------------------------
+    void resize(int _width, int _height);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief set the number of threads used for each stage, 0 means use all cores
+    //----------------------------------------------------------------------------------------------------------------------
+    void setNumThreads(unsigned int _numThreads);
+    unsigned int numThreads() const { return m_numThreads; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief set the same matrices NGLScene::loadMatricesToShader sends to the shader
+    //----------------------------------------------------------------------------------------------------------------------
+    void setMatrices(const ngl::Mat4 &_MVP, const ngl::Mat4 &_MV, const ngl::Mat3 &_normalMatrix, const ngl::Mat4 &_M);
+    void setViewerPos(const ngl::Vec3 &_pos) { m_viewerPos=_pos; }
+    void setLight(const PhongLight &_light) { m_light=_light; }
+    void setMaterial(const PhongMaterial &_material) { m_material=_material; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief mirrors the Normalize uniform in PhongVertex.glsl
+    //----------------------------------------------------------------------------------------------------------------------
+    void setNormalize(bool _normalize) { m_normalize=_normalize; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief equivalent of glPolygonMode(GL_FRONT_AND_BACK,GL_LINE)
+    //----------------------------------------------------------------------------------------------------------------------
+    void setWireframe(bool _wireframe) { m_wireframe=_wireframe; }
+    void setClearColour(float _r, float _g, float _b, float _a);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief clear the colour and depth buffers
+    //----------------------------------------------------------------------------------------------------------------------
+    void clear();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief draw a list of GL_TRIANGLES with the current state
+    /// @param [in] _verts the vertex positions
+    /// @param [in] _normals the per vertex normals
+    /// @param [in] _numVerts the number of vertices (3 per triangle)
+    //----------------------------------------------------------------------------------------------------------------------
+    void drawTriangles(const ngl::Vec3 *_verts, const ngl::Vec3 *_normals, size_t _numVerts);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the RGBA8 colour buffer, top row first
+    //----------------------------------------------------------------------------------------------------------------------
+    const std::vector<uint8_t> &image() const { return m_colour; }
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief write the colour buffer as a binary ppm
+    //----------------------------------------------------------------------------------------------------------------------
+    bool writePPM(const std::string &_fname) const;
+
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief number of varyings we interpolate (fragmentNormal, lightDir, halfVector)
+    //----------------------------------------------------------------------------------------------------------------------
+    static constexpr int c_numVaryings=9;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief tiles are square and this many pixels wide
+    //----------------------------------------------------------------------------------------------------------------------
+    static constexpr int c_tileSize=64;
+
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief a post vertex shader vertex, clip position plus varyings
+    //----------------------------------------------------------------------------------------------------------------------
+    struct ClipVertex
+    {
+      float pos[4];
+      float var[c_numVaryings];
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief a triangle after clipping and the viewport transform
+    //----------------------------------------------------------------------------------------------------------------------
+    struct ScreenTriangle
+    {
+      float x[3];
+      float y[3];
+      float z[3];
+      float invW[3];
+      float var[3][c_numVaryings];
+      float area;
+      int minX, minY, maxX, maxY;
+    };
+
+  private :
+    void runParallel(size_t _count, void (SoftwareRenderer::*_func)(size_t, size_t, unsigned int));
+    void vertexStage(size_t _begin, size_t _end, unsigned int _thread);
+    void setupStage(size_t _begin, size_t _end, unsigned int _thread);
+    void rasterStage(size_t _begin, size_t _end, unsigned int _thread);
+    void emitTriangle(const ClipVertex &_a, const ClipVertex &_b, const ClipVertex &_c, unsigned int _thread);
+    void rasterTile(int _tile);
+    void shade(const float *_var, uint8_t *_out) const;
+
+    int m_width;
+    int m_height;
+    int m_tilesX;
+    int m_tilesY;
+    unsigned int m_numThreads;
+    bool m_wireframe=false;
+    bool m_normalize=false;
+    float m_clearColour[4]={0.4f,0.4f,0.4f,1.0f};
+    float m_MVP[16];
+    float m_MV[16];
+    float m_M[16];
+    float m_normalMatrix[9];
+    ngl::Vec3 m_viewerPos=ngl::Vec3(0.0f,1.0f,1.0f);
+    PhongLight m_light;
+    PhongMaterial m_material;
+    std::vector<uint8_t> m_colour;
+    std::vector<float> m_depth;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief per draw scratch, inputs, shaded vertices, and per thread triangle lists / tile bins
+    //----------------------------------------------------------------------------------------------------------------------
+    const ngl::Vec3 *m_inVerts=nullptr;
+    const ngl::Vec3 *m_inNormals=nullptr;
+    std::vector<ClipVertex> m_clipVerts;
+    std::vector<std::vector<ScreenTriangle>> m_triangles;
+    std::vector<std::vector<std::vector<uint32_t>>> m_bins;
+};
+
+#endif
@@ -0,0 +1,208 @@
+#ifndef TRSCOMPOSE_H_
+#define TRSCOMPOSE_H_
+#include <ngl/Vec3.h>
+#include <ngl/Mat3.h>
+#include <ngl/Mat4.h>
+#include <cmath>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file TRSCompose.h
+/// @brief closed form translate * euler rotate * scale matrices
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/10/26
+/// @class TRSCompose
+/// @brief builds the model matrix straight from position, euler angles (degrees) and scale instead of
+/// multiplying five 4x4 matrices, and the normal matrix as R*S^-1 instead of a general 3x3 inverse.
+/// The rotation order is a template parameter so each order is its own expanded expression, the
+/// SinCos based functions are constexpr so fixed transforms can be built at compile time.
+/// Everything is column major to match ngl::Mat4::m_openGL
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the order the axis matrices are multiplied in, XYZ is Rx*Ry*Rz so z is applied first
+//----------------------------------------------------------------------------------------------------------------------
+enum class EulerOrder { XYZ, XZY, YXZ, YZX, ZXY, ZYX };
+
+struct SinCos
+{
+  float s;
+  float c;
+};
+
+struct Rotation3
+{
+  float m[9];
+};
+
+struct Affine4
+{
+  float m[16];
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the expanded product of the three axis rotations for each order
+//----------------------------------------------------------------------------------------------------------------------
+template <EulerOrder O> struct EulerRotation;
+
+template <> struct EulerRotation<EulerOrder::XYZ>
+{
+  static constexpr Rotation3 matrix(SinCos _x, SinCos _y, SinCos _z)
+  {
+    return Rotation3{{ _y.c*_z.c, _x.c*_z.s + _x.s*_y.s*_z.c, _x.s*_z.s - _x.c*_y.s*_z.c,
+                       -_y.c*_z.s, _x.c*_z.c - _x.s*_y.s*_z.s, _x.s*_z.c + _x.c*_y.s*_z.s,
+                       _y.s, -_x.s*_y.c, _x.c*_y.c }};
+  }
+};
+
+template <> struct EulerRotation<EulerOrder::XZY>
+{
+  static constexpr Rotation3 matrix(SinCos _x, SinCos _y, SinCos _z)
+  {
+    return Rotation3{{ _y.c*_z.c, _x.s*_y.s + _x.c*_y.c*_z.s, _x.s*_y.c*_z.s - _x.c*_y.s,
+                       -_z.s, _x.c*_z.c, _x.s*_z.c,
+                       _y.s*_z.c, _x.c*_y.s*_z.s - _x.s*_y.c, _x.c*_y.c + _x.s*_y.s*_z.s }};
+  }
+};
+
+template <> struct EulerRotation<EulerOrder::YXZ>
+{
+  static constexpr Rotation3 matrix(SinCos _x, SinCos _y, SinCos _z)
+  {
+    return Rotation3{{ _y.c*_z.c + _x.s*_y.s*_z.s, _x.c*_z.s, _x.s*_y.c*_z.s - _y.s*_z.c,
+                       _x.s*_y.s*_z.c - _y.c*_z.s, _x.c*_z.c, _y.s*_z.s + _x.s*_y.c*_z.c,
+                       _x.c*_y.s, -_x.s, _x.c*_y.c }};
+  }
+};
+
+template <> struct EulerRotation<EulerOrder::YZX>
+{
+  static constexpr Rotation3 matrix(SinCos _x, SinCos _y, SinCos _z)
+  {
+    return Rotation3{{ _y.c*_z.c, _z.s, -_y.s*_z.c,
+                       _x.s*_y.s - _x.c*_y.c*_z.s, _x.c*_z.c, _x.s*_y.c + _x.c*_y.s*_z.s,
+                       _x.c*_y.s + _x.s*_y.c*_z.s, -_x.s*_z.c, _x.c*_y.c - _x.s*_y.s*_z.s }};
+  }
+};
+
+template <> struct EulerRotation<EulerOrder::ZXY>
+{
+  static constexpr Rotation3 matrix(SinCos _x, SinCos _y, SinCos _z)
+  {
+    return Rotation3{{ _y.c*_z.c - _x.s*_y.s*_z.s, _y.c*_z.s + _x.s*_y.s*_z.c, -_x.c*_y.s,
+                       -_x.c*_z.s, _x.c*_z.c, _x.s,
+                       _y.s*_z.c + _x.s*_y.c*_z.s, _y.s*_z.s - _x.s*_y.c*_z.c, _x.c*_y.c }};
+  }
+};
+
+template <> struct EulerRotation<EulerOrder::ZYX>
+{
+  static constexpr Rotation3 matrix(SinCos _x, SinCos _y, SinCos _z)
+  {
+    return Rotation3{{ _y.c*_z.c, _y.c*_z.s, -_y.s,
+                       _x.s*_y.s*_z.c - _x.c*_z.s, _x.c*_z.c + _x.s*_y.s*_z.s, _x.s*_y.c,
+                       _x.s*_z.s + _x.c*_y.s*_z.c, _x.c*_y.s*_z.s - _x.s*_z.c, _x.c*_y.c }};
+  }
+};
+
+class TRSCompose
+{
+  public :
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the sin / cos of an angle in degrees, the same float maths ngl::Mat4::rotateX uses
+    //----------------------------------------------------------------------------------------------------------------------
+    static SinCos angle(float _deg)
+    {
+      float rad=_deg*(3.14159265358979323846f/180.0f);
+      return SinCos{std::sin(rad),std::cos(rad)};
+    }
+    template <EulerOrder O>
+    static constexpr Rotation3 rotation(SinCos _x, SinCos _y, SinCos _z)
+    {
+      return EulerRotation<O>::matrix(_x,_y,_z);
+    }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief T*R*S, the rotation columns scaled with the position as the last column
+    //----------------------------------------------------------------------------------------------------------------------
+    static constexpr Affine4 affine(const Rotation3 &_r, float _px, float _py, float _pz, float _sx, float _sy, float _sz)
+    {
+      return Affine4{{ _r.m[0]*_sx, _r.m[1]*_sx, _r.m[2]*_sx, 0.0f,
+                       _r.m[3]*_sy, _r.m[4]*_sy, _r.m[5]*_sy, 0.0f,
+                       _r.m[6]*_sz, _r.m[7]*_sz, _r.m[8]*_sz, 0.0f,
+                       _px, _py, _pz, 1.0f }};
+    }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief S*R*T, rows scaled and the position rotated and scaled into the last column
+    //----------------------------------------------------------------------------------------------------------------------
+    static constexpr Affine4 affineReversed(const Rotation3 &_r, float _px, float _py, float _pz, float _sx, float _sy, float _sz)
+    {
+      return Affine4{{ _r.m[0]*_sx, _r.m[1]*_sy, _r.m[2]*_sz, 0.0f,
+                       _r.m[3]*_sx, _r.m[4]*_sy, _r.m[5]*_sz, 0.0f,
+                       _r.m[6]*_sx, _r.m[7]*_sy, _r.m[8]*_sz, 0.0f,
+                       _sx*(_r.m[0]*_px+_r.m[3]*_py+_r.m[6]*_pz),
+                       _sy*(_r.m[1]*_px+_r.m[4]*_py+_r.m[7]*_pz),
+                       _sz*(_r.m[2]*_px+_r.m[5]*_py+_r.m[8]*_pz), 1.0f }};
+    }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief inverse transpose of R*S, as R is orthonormal that is R*S^-1
+    //----------------------------------------------------------------------------------------------------------------------
+    static constexpr Rotation3 normal(const Rotation3 &_r, float _sx, float _sy, float _sz)
+    {
+      return Rotation3{{ _r.m[0]/_sx, _r.m[1]/_sx, _r.m[2]/_sx,
+                         _r.m[3]/_sy, _r.m[4]/_sy, _r.m[5]/_sy,
+                         _r.m[6]/_sz, _r.m[7]/_sz, _r.m[8]/_sz }};
+    }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the model and normal matrix from degrees, _normal can be null if it isn't needed
+    //----------------------------------------------------------------------------------------------------------------------
+    template <EulerOrder O>
+    static void compose(const ngl::Vec3 &_pos, const ngl::Vec3 &_rot, const ngl::Vec3 &_scale, ngl::Mat4 &_M, ngl::Mat3 *_normal=nullptr)
+    {
+      Rotation3 r=rotation<O>(angle(_rot.m_x),angle(_rot.m_y),angle(_rot.m_z));
+      store(affine(r,_pos.m_x,_pos.m_y,_pos.m_z,_scale.m_x,_scale.m_y,_scale.m_z),_M);
+      if(_normal)
+        store(normal(r,_scale.m_x,_scale.m_y,_scale.m_z),*_normal);
+    }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief S*R*T with R in order O, e.g. ZYX gives the S*Rz*Ry*Rx*T the overlay shows
+    //----------------------------------------------------------------------------------------------------------------------
+    template <EulerOrder O>
+    static void composeReversed(const ngl::Vec3 &_pos, const ngl::Vec3 &_rot, const ngl::Vec3 &_scale, ngl::Mat4 &_M)
+    {
+      Rotation3 r=rotation<O>(angle(_rot.m_x),angle(_rot.m_y),angle(_rot.m_z));
+      store(affineReversed(r,_pos.m_x,_pos.m_y,_pos.m_z,_scale.m_x,_scale.m_y,_scale.m_z),_M);
+    }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief T*_M for an affine _M, only the last column changes
+    //----------------------------------------------------------------------------------------------------------------------
+    static void translated(const ngl::Mat4 &_M, const ngl::Vec3 &_pos, ngl::Mat4 &_out)
+    {
+      _out=_M;
+      _out.m_openGL[12]+=_pos.m_x;
+      _out.m_openGL[13]+=_pos.m_y;
+      _out.m_openGL[14]+=_pos.m_z;
+    }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief _a*_b for 3x3s, used to take a model normal matrix into view space
+    //----------------------------------------------------------------------------------------------------------------------
+    static void multiply(const ngl::Mat3 &_a, const ngl::Mat3 &_b, ngl::Mat3 &_out)
+    {
+      const float *a=_a.m_openGL;
+      const float *b=_b.m_openGL;
+      for(int c=0; c<3; ++c)
+        for(int r=0; r<3; ++r)
+          _out.m_openGL[c*3+r]=a[r]*b[c*3]+a[3+r]*b[c*3+1]+a[6+r]*b[c*3+2];
+    }
+    static void store(const Affine4 &_a, ngl::Mat4 &_M)
+    {
+      for(int i=0; i<16; ++i)
+        _M.m_openGL[i]=_a.m[i];
+    }
+    static void store(const Rotation3 &_r, ngl::Mat3 &_N)
+    {
+      for(int i=0; i<9; ++i)
+        _N.m_openGL[i]=_r.m[i];
+    }
+};
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef TEXTOVERLAY_H_
+#define TEXTOVERLAY_H_
+#include <ngl/Types.h>
+#include <ngl/Mat4.h>
+#include <ngl/Vec3.h>
+#include <QFont>
+#include <array>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file TextOverlay.h
+/// @brief cached text overlay, all glyphs live in one atlas texture and one vertex buffer
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/10/26
+/// @class TextOverlay
+/// @brief the overlay is split into blocks of fixed capacity lines, each line is formatted into
+/// a preallocated buffer and its glyph quads only regenerated (and re-uploaded) when the text
+/// actually changes, the whole overlay is then drawn with a single glDrawArrays call
+//----------------------------------------------------------------------------------------------------------------------
+
+class TextOverlay
+{
+  public :
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief max chars per line, quads for unused chars are degenerate
+    //----------------------------------------------------------------------------------------------------------------------
+    static constexpr int c_lineCapacity=64;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief ctor needs a valid GL context as it builds the atlas and buffers
+    /// @param [in] _font the font to use
+    //----------------------------------------------------------------------------------------------------------------------
+    TextOverlay(const QFont &_font);
+    ~TextOverlay();
+    TextOverlay(const TextOverlay &)=delete;
+    TextOverlay &operator=(const TextOverlay &)=delete;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief set the size of the screen in pixels used to place the text
+    //----------------------------------------------------------------------------------------------------------------------
+    void setScreenSize(int _w, int _h);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief add a block of lines
+    /// @param [in] _x the left of the block in pixels
+    /// @param [in] _y the top of the first line in pixels
+    /// @param [in] _numLines the number of lines to reserve
+    /// @param [in] _lineSpacing the distance between lines in pixels
+    /// @returns the block id to use with setLine / setMatrix
+    //----------------------------------------------------------------------------------------------------------------------
+    int addBlock(int _x, int _y, int _numLines, int _lineSpacing=18);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief set the text and colour of a line, only regenerates if either has changed
+    //----------------------------------------------------------------------------------------------------------------------
+    void setLine(int _block, int _line, const char *_text, const ngl::Vec3 &_colour);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief printf style version of setLine, formats into the line's own buffer
+    //----------------------------------------------------------------------------------------------------------------------
+    void setLinef(int _block, int _line, const ngl::Vec3 &_colour, const char *_fmt, ...);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief write the four rows of a matrix to lines _firstLine to _firstLine+3 in the same
+    /// format as the per line overlay, nothing is formatted if the values are unchanged
+    /// @returns true if the values changed
+    //----------------------------------------------------------------------------------------------------------------------
+    bool setMatrix(int _block, int _firstLine, const ngl::Mat4 &_m, const ngl::Vec3 &_colour);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief upload any changed blocks and draw the whole overlay in one call
+    //----------------------------------------------------------------------------------------------------------------------
+    void draw();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief number of lines whose glyph geometry was rebuilt since the last draw
+    //----------------------------------------------------------------------------------------------------------------------
+    unsigned int linesRebuilt() const { return m_linesRebuiltLastDraw; }
+
+  private :
+    struct Glyph
+    {
+      float u0, v0, u1, v1;
+      float width;
+      float advance;
+    };
+    struct Line
+    {
+      std::array<char,c_lineCapacity+1> text;
+      ngl::Vec3 colour;
+      bool dirty=true;
+    };
+    struct Block
+    {
+      int x;
+      int y;
+      int lineSpacing;
+      size_t firstVertex;
+      std::vector<Line> lines;
+      std::vector<float> matrixCache;
+      bool dirty=true;
+    };
+    void buildAtlas(const QFont &_font);
+    void buildLine(const Block &_block, int _line);
+    void createShader();
+
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief x,y in pixels, u,v, r,g,b per vertex
+    //----------------------------------------------------------------------------------------------------------------------
+    static constexpr int c_floatsPerVertex=7;
+    static constexpr int c_vertsPerGlyph=6;
+    std::array<Glyph,128> m_glyphs;
+    float m_lineHeight=0.0f;
+    std::vector<Block> m_blocks;
+    std::vector<float> m_vertices;
+    GLuint m_texture=0;
+    GLuint m_vao=0;
+    GLuint m_vbo=0;
+    size_t m_bufferVerts=0;
+    int m_screenWidth=1024;
+    int m_screenHeight=720;
+    unsigned int m_linesRebuilt=0;
+    unsigned int m_linesRebuiltLastDraw=0;
+};
+
+#endif
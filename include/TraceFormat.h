@@ -0,0 +1,59 @@
+#ifndef TRACEFORMAT_H_
+#define TRACEFORMAT_H_
+#include <cstdint>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file TraceFormat.h
+/// @brief on disk layout of the frame trace files written by FrameTrace and read by TraceDecode
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/10/26
+/// the file is a TraceFileHeader followed by records, each record is a TraceRecordHeader then
+/// payloadSize bytes, all values are little endian as written by the host
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace trace
+{
+  constexpr uint32_t c_magic=0x5450564d; // "MVPT"
+  constexpr uint32_t c_version=1;
+
+  enum class RecordType : uint16_t
+  {
+    FRAME_MATRICES=1,   ///< payload is MatrixRecord
+    CLIP_POINTS=2       ///< payload is PointsRecord followed by count * 4 floats (x,y,z,w)
+  };
+
+  struct TraceFileHeader
+  {
+    uint32_t magic;
+    uint32_t version;
+  };
+
+  struct TraceRecordHeader
+  {
+    uint16_t type;
+    uint16_t reserved;
+    uint32_t payloadSize;
+  };
+
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the matrices for a frame, each in OpenGL column major order
+  //----------------------------------------------------------------------------------------------------------------------
+  struct MatrixRecord
+  {
+    uint64_t frame;
+    float MVP[16];
+    float M[16];
+    float view[16];
+    float project[16];
+  };
+
+  struct PointsRecord
+  {
+    uint64_t frame;
+    uint32_t count;
+    uint32_t reserved;
+  };
+}
+
+#endif
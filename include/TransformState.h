@@ -0,0 +1,124 @@
+#ifndef TRANSFORMSTATE_H_
+#define TRANSFORMSTATE_H_
+#include <ngl/Vec3.h>
+#include <ngl/Mat3.h>
+#include <ngl/Mat4.h>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file TransformState.h
+/// @brief dirty tracked model / view / projection state for NGLScene
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/10/26
+/// @class TransformState
+/// @brief holds the position, rotation and scale inputs plus the camera matrices, the derived
+/// matrices (M, MV, MVP, normalMatrix) are only rebuilt when one of their inputs has been
+/// changed, and the shader upload is skipped when nothing has changed since the last one
+//----------------------------------------------------------------------------------------------------------------------
+
+class TransformState
+{
+  public :
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief per frame counters, a recompute is one matrix rebuilt, a cache hit is one matrix reused
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Stats
+    {
+      unsigned int recomputes=0;
+      unsigned int cacheHits=0;
+      unsigned int uploads=0;
+      unsigned int uploadsSkipped=0;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief ctor, everything starts as identity with unit scale
+    //----------------------------------------------------------------------------------------------------------------------
+    TransformState();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief setters for the inputs, each only flags the parts of the chain that depend on it
+    //----------------------------------------------------------------------------------------------------------------------
+    void setPosition(const ngl::Vec3 &_pos);
+    void setRotation(const ngl::Vec3 &_rot);
+    void setScale(const ngl::Vec3 &_scale);
+    void setView(const ngl::Mat4 &_view);
+    void setProject(const ngl::Mat4 &_project);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief convenience for the key handlers, add to the current values
+    //----------------------------------------------------------------------------------------------------------------------
+    void translate(float _x, float _y, float _z);
+    void rotate(float _x, float _y, float _z);
+    void scale(float _x, float _y, float _z);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief back to identity camera, zero position / rotation and unit scale
+    //----------------------------------------------------------------------------------------------------------------------
+    void reset();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief force everything to be rebuilt and re-uploaded (e.g. after a shader change)
+    //----------------------------------------------------------------------------------------------------------------------
+    void invalidate();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief start a new frame, resets the per frame counters
+    //----------------------------------------------------------------------------------------------------------------------
+    void beginFrame();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief rebuild any dirty matrices
+    /// @returns true if anything was rebuilt
+    //----------------------------------------------------------------------------------------------------------------------
+    bool update();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief check if the uniforms need to be sent to the shader, this also counts the
+    /// upload or skip for the frame stats, call markUploaded once the upload is done
+    //----------------------------------------------------------------------------------------------------------------------
+    bool needsUpload();
+    void markUploaded() { m_uploadPending=false; }
+
+    const ngl::Vec3 &position() const { return m_pos; }
+    const ngl::Vec3 &rotation() const { return m_rot; }
+    const ngl::Vec3 &scaleValue() const { return m_scale; }
+    const ngl::Mat4 &view() const { return m_view; }
+    const ngl::Mat4 &project() const { return m_project; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the derived matrices, only valid after update()
+    //----------------------------------------------------------------------------------------------------------------------
+    const ngl::Mat4 &M() const { return m_M; }
+    const ngl::Mat4 &MV() const { return m_MV; }
+    const ngl::Mat4 &MVP() const { return m_MVP; }
+    const ngl::Mat3 &normalMatrix() const { return m_normalMatrix; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the S*Rz*Ry*Rx*T product shown as the "Model Matrix" in the overlay
+    //----------------------------------------------------------------------------------------------------------------------
+    const ngl::Mat4 &modelDisplay() const { return m_modelDisplay; }
+    const Stats &frameStats() const { return m_stats; }
+
+  private :
+    enum DirtyBits : unsigned int
+    {
+      TRANSLATE = 1<<0,
+      ROTATE    = 1<<1,
+      SCALE     = 1<<2,
+      VIEW      = 1<<3,
+      PROJECT   = 1<<4,
+      ALL       = TRANSLATE | ROTATE | SCALE | VIEW | PROJECT
+    };
+    void rebuild(bool _dirty, unsigned int _count=1);
+
+    ngl::Vec3 m_pos;
+    ngl::Vec3 m_rot;
+    ngl::Vec3 m_scale;
+    ngl::Mat4 m_view;
+    ngl::Mat4 m_project;
+    ngl::Mat4 m_M;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the normal matrices of the model and view on their own, multiplied for the MV one
+    //----------------------------------------------------------------------------------------------------------------------
+    ngl::Mat3 m_modelNormal;
+    ngl::Mat3 m_viewNormal;
+    ngl::Mat4 m_MV;
+    ngl::Mat4 m_MVP;
+    ngl::Mat3 m_normalMatrix;
+    ngl::Mat4 m_modelDisplay;
+    unsigned int m_dirty=ALL;
+    bool m_uploadPending=true;
+    Stats m_stats;
+};
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef TRANSFORMUBO_H_
+#define TRANSFORMUBO_H_
+#include <ngl/Types.h>
+#include <ngl/Mat3.h>
+#include <ngl/Mat4.h>
+#include <array>
+#include <cstddef>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file TransformUBO.h
+/// @brief ring buffered uniform buffer for the Phong transform block
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/10/26
+/// @class TransformUBO
+/// @brief holds the std140 Transforms block of PhongVertex.glsl for up to _maxObjects objects in
+/// each of three regions, each region protected by a fence like the InstancedRenderer ring. A
+/// frame fills its blocks with set, writes them all with one upload (nothing with a persistent
+/// mapping, one glBufferSubData without) and binds each object's block with glBindBufferRange.
+/// The block index is resolved once per program by bindBlock after linking
+//----------------------------------------------------------------------------------------------------------------------
+
+class TransformUBO
+{
+  public :
+    static constexpr int c_numRegions=3;
+    static constexpr GLuint c_bindingPoint=0;
+    static constexpr const char *c_blockName="Transforms";
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the std140 layout of the Transforms block, the mat3 columns are padded to vec4
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Block
+    {
+      float MVP[16];
+      float MV[16];
+      float M[16];
+      float normalMatrix[12];
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief ctor needs a valid GL context
+    /// @param [in] _maxObjects the number of blocks in each region
+    //----------------------------------------------------------------------------------------------------------------------
+    explicit TransformUBO(size_t _maxObjects);
+    ~TransformUBO();
+    TransformUBO(const TransformUBO &)=delete;
+    TransformUBO &operator=(const TransformUBO &)=delete;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief point a linked program's Transforms block at c_bindingPoint
+    /// @returns false if the program has no such block
+    //----------------------------------------------------------------------------------------------------------------------
+    static bool bindBlock(GLuint _program);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief start writing _count blocks (clamped to the max) to the next region, waits if the
+    /// gpu is still reading it
+    //----------------------------------------------------------------------------------------------------------------------
+    void begin(size_t _count);
+    void set(size_t _index, const ngl::Mat4 &_MVP, const ngl::Mat4 &_MV, const ngl::Mat4 &_M, const ngl::Mat3 &_normalMatrix);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the single write of all the blocks set since begin
+    //----------------------------------------------------------------------------------------------------------------------
+    void upload();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief make block _index of the current region the one the shaders see
+    //----------------------------------------------------------------------------------------------------------------------
+    void bind(size_t _index) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief fence the region after the draws using it, does nothing if begin wasn't called
+    //----------------------------------------------------------------------------------------------------------------------
+    void end();
+    size_t maxObjects() const { return m_maxObjects; }
+    bool persistentMapped() const { return m_mapped!=nullptr; }
+
+  private :
+    void waitForRegion(int _region);
+    size_t regionOffset() const { return static_cast<size_t>(m_region)*m_maxObjects*m_stride; }
+    GLuint m_buffer=0;
+    size_t m_maxObjects;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief sizeof(Block) rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+    //----------------------------------------------------------------------------------------------------------------------
+    size_t m_stride;
+    size_t m_count=0;
+    int m_region=0;
+    bool m_open=false;
+    std::array<GLsync,c_numRegions> m_fences;
+    unsigned char *m_mapped=nullptr;
+    std::vector<unsigned char> m_staging;
+};
+
+#endif
@@ -0,0 +1,80 @@
+#version 430 core
+/// @brief the vertex passed in
+layout (location = 0) in vec3 inVert;
+/// @brief the normal passed in
+layout (location = 1) in vec3 inNormal;
+/// @brief the in uv
+layout (location = 2) in vec2 inUV;
+/// @brief the index of this vertex's draw, the command's baseInstance through a per instance attribute
+layout (location = 3) in uint drawID;
+/// @brief flag to indicate if model has unit normals if not normalize
+uniform bool Normalize;
+// the eye position of the camera
+uniform vec3 viewerPos;
+/// @brief the current fragment normal for the vert being processed
+out  vec3 fragmentNormal;
+
+
+struct Lights
+{
+  vec4 position;
+  vec4 ambient;
+  vec4 diffuse;
+  vec4 specular;
+};
+
+// array of lights
+uniform Lights light;
+// direction of the lights used for shading
+out vec3 lightDir;
+// out the blinn half vector
+out vec3 halfVector;
+out vec3 eyeDirection;
+out vec3 vPosition;
+
+/// @brief per draw matrices from BatchRenderer, layout must match BatchRenderer::Draw
+struct Draw
+{
+  mat4 M;
+  /// @brief inverse transpose of MV
+  mat3 normalMatrix;
+};
+layout (std430, binding = 0) readonly buffer Draws
+{
+  Draw draws[];
+};
+
+/// @brief the camera matrices are shared by every draw
+uniform mat4 V;
+uniform mat4 VP;
+
+
+void main()
+{
+// calculate the fragments surface normal
+fragmentNormal = (draws[drawID].normalMatrix*inNormal);
+
+
+if (Normalize == true)
+{
+ fragmentNormal = normalize(fragmentNormal);
+}
+// calculate the vertex position
+vec4 worldPosition = draws[drawID].M * vec4(inVert, 1.0);
+gl_Position = VP*worldPosition;
+
+eyeDirection = normalize(viewerPos - worldPosition.xyz);
+// Get vertex position in eye coordinates
+// Transform the vertex to eye co-ordinates for frag shader
+/// @brief the vertex in eye co-ordinates  homogeneous
+vec4 eyeCord=V*worldPosition;
+
+vPosition = eyeCord.xyz / eyeCord.w;;
+
+float dist;
+
+lightDir=vec3(light.position.xyz-eyeCord.xyz);
+dist = length(lightDir);
+lightDir/= dist;
+halfVector = normalize(eyeDirection + lightDir);
+}
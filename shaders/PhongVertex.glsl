@@ -5,6 +5,8 @@ layout (location = 0) in vec3 inVert;
 layout (location = 1) in vec3 inNormal;
 /// @brief the in uv
 layout (location = 2) in vec2 inUV;
+/// @brief clip space position from the compute transform, used when computedClip is set
+layout (location = 3) in vec4 inClip;
 /// @brief flag to indicate if model has unit normals if not normalize
 uniform bool Normalize;
 // the eye position of the camera
@@ -30,16 +32,46 @@ out vec3 halfVector;
 out vec3 eyeDirection;
 out vec3 vPosition;
 
+#ifdef LEGACY_UNIFORMS
+// the original individually set matrices, only built for UniformBench
 uniform mat4 MV;
 uniform mat4 MVP;
 uniform mat3 normalMatrix;
 uniform mat4 M;
+#else
+/// @brief per object matrices from TransformUBO, layout must match TransformUBO::Block
+layout (std140) uniform Transforms
+{
+  mat4 MVP;
+  mat4 MV;
+  mat4 M;
+  mat3 normalMatrix;
+};
+#endif
+/// @brief set for the PackedMesh layouts, positions are unorm16 relative to the bounding box
+uniform bool quantizedPosition;
+uniform vec3 boundsMin;
+uniform vec3 boundsExtent;
+/// @brief set when the normal is octahedral encoded in inNormal.xy
+uniform bool octNormal;
+/// @brief set by ComputeTransform, the position has already been through the MVP
+uniform bool computedClip;
 
+vec3 octDecode(vec2 e)
+{
+  vec3 n=vec3(e.xy,1.0-abs(e.x)-abs(e.y));
+  float t=max(-n.z,0.0);
+  n.x+=n.x>=0.0 ? -t : t;
+  n.y+=n.y>=0.0 ? -t : t;
+  return normalize(n);
+}
 
 void main()
 {
+vec3 position = quantizedPosition ? boundsMin+inVert*boundsExtent : inVert;
+vec3 normal = octNormal ? octDecode(inNormal.xy) : inNormal;
 // calculate the fragments surface normal
-fragmentNormal = (normalMatrix*inNormal);
+fragmentNormal = (normalMatrix*normal);
 
 
 if (Normalize == true)
@@ -47,14 +79,14 @@ if (Normalize == true)
  fragmentNormal = normalize(fragmentNormal);
 }
 // calculate the vertex position
-gl_Position = MVP*vec4(inVert,1.0);
+gl_Position = computedClip ? inClip : MVP*vec4(position,1.0);
 
-vec4 worldPosition = M * vec4(inVert, 1.0);
+vec4 worldPosition = M * vec4(position, 1.0);
 eyeDirection = normalize(viewerPos - worldPosition.xyz);
 // Get vertex position in eye coordinates
 // Transform the vertex to eye co-ordinates for frag shader
 /// @brief the vertex in eye co-ordinates  homogeneous
-vec4 eyeCord=MV*vec4(inVert,1);
+vec4 eyeCord=MV*vec4(position,1);
 
 vPosition = eyeCord.xyz / eyeCord.w;;
 
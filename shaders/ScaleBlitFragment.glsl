@@ -0,0 +1,11 @@
+#version 330 core
+/// @brief our output fragment colour
+layout (location =0) out vec4 fragColour;
+/// @brief the scene drawn at the scaled size, filtered linearly as it is stretched
+uniform sampler2D scene;
+in vec2 vertUV;
+
+void main()
+{
+  fragColour=vec4(texture(scene,vertUV).rgb,1.0);
+}
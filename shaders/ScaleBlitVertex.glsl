@@ -0,0 +1,10 @@
+#version 330 core
+/// @brief one triangle covering the screen made from gl_VertexID, drawn with an empty VAO
+out vec2 vertUV;
+
+void main()
+{
+  vec2 corner=vec2(float((gl_VertexID<<1)&2),float(gl_VertexID&2));
+  vertUV=corner;
+  gl_Position=vec4(corner*2.0-1.0,0.0,1.0);
+}
@@ -0,0 +1,15 @@
+#version 330 core
+/// @brief our output fragment colour
+layout (location =0) out vec4 fragColour;
+/// @brief the glyph atlas, coverage is stored in the red channel
+uniform sampler2D atlas;
+in vec2 vertUV;
+in vec3 vertColour;
+
+void main()
+{
+  float coverage=texture(atlas,vertUV).r;
+  if(coverage <= 0.0)
+    discard;
+  fragColour=vec4(vertColour,coverage);
+}
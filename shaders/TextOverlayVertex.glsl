@@ -0,0 +1,18 @@
+#version 330 core
+/// @brief the glyph corner in pixels, origin top left
+layout (location = 0) in vec2 inPos;
+/// @brief the atlas uv
+layout (location = 1) in vec2 inUV;
+/// @brief the colour of the line
+layout (location = 2) in vec3 inColour;
+/// @brief 2.0/screen width and 2.0/screen height
+uniform vec2 scale;
+out vec2 vertUV;
+out vec3 vertColour;
+
+void main()
+{
+  vertUV=inUV;
+  vertColour=inColour;
+  gl_Position=vec4(inPos.x*scale.x-1.0,1.0-inPos.y*scale.y,0.0,1.0);
+}
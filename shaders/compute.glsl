@@ -1,11 +1,25 @@
 #version 430
-uniform float roll;
-uniform image2D destTex;
-layout (local_size_x = 16, local_size_y = 16) in;
+/// @brief transforms a buffer of positions in to clip space for ComputeTransform, one vertex
+/// per invocation
+layout (local_size_x = 256) in;
+/// @brief tightly packed xyz positions, the same buffer is used as the vertex attribute
+layout (std430, binding = 0) readonly buffer Positions
+{
+  float positions[];
+};
+/// @brief the clip space results, drawn through inClip in PhongVertex.glsl or read back
+layout (std430, binding = 1) writeonly buffer ClipPositions
+{
+  vec4 clipPositions[];
+};
+uniform mat4 MVP;
+uniform int vertexCount;
+
 void main()
 {
-    ivec2 storePos = ivec2(gl_GlobalInvocationID.xy);
-    float localCoef = length(vec2(ivec2(gl_LocalInvocationID.xy)-8)/8.0);
-    float globalCoef = sin(float(gl_WorkGroupID.x+gl_WorkGroupID.y)*0.1 + roll)*0.5;
-    imageStore(destTex, storePos, vec4(1.0-globalCoef*localCoef, 0.0, 0.0, 0.0));
+  int i = int(gl_GlobalInvocationID.x);
+  if(i >= vertexCount)
+    return;
+  vec3 p = vec3(positions[3*i], positions[3*i+1], positions[3*i+2]);
+  clipPositions[i] = MVP*vec4(p,1.0);
 }
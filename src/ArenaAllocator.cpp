@@ -0,0 +1,74 @@
+#include "ArenaAllocator.h"
+#include <algorithm>
+#include <iterator>
+
+constexpr size_t ArenaAllocator::c_invalid;
+
+ArenaAllocator::ArenaAllocator(size_t _capacity) :
+  m_capacity(_capacity)
+{
+  if(m_capacity)
+    m_free[0]=m_capacity;
+}
+
+size_t ArenaAllocator::allocate(size_t _size)
+{
+  if(_size==0)
+    return c_invalid;
+  // best fit, the arenas only hold a few hundred meshes so a scan is fine
+  auto best=m_free.end();
+  for(auto range=m_free.begin(); range!=m_free.end(); ++range)
+  {
+    if(range->second>=_size && (best==m_free.end() || range->second<best->second))
+    {
+      best=range;
+      if(range->second==_size)
+        break;
+    }
+  }
+  if(best==m_free.end())
+    return c_invalid;
+  size_t offset=best->first;
+  size_t remaining=best->second-_size;
+  m_free.erase(best);
+  if(remaining)
+    m_free[offset+_size]=remaining;
+  m_allocated[offset]=_size;
+  m_used+=_size;
+  return offset;
+}
+
+void ArenaAllocator::release(size_t _offset)
+{
+  auto allocated=m_allocated.find(_offset);
+  if(allocated==m_allocated.end())
+    return;
+  size_t size=allocated->second;
+  m_allocated.erase(allocated);
+  m_used-=size;
+  // merge with the free range after then the one before
+  auto next=m_free.lower_bound(_offset);
+  if(next!=m_free.end() && _offset+size==next->first)
+  {
+    size+=next->second;
+    next=m_free.erase(next);
+  }
+  if(next!=m_free.begin())
+  {
+    auto prev=std::prev(next);
+    if(prev->first+prev->second==_offset)
+    {
+      prev->second+=size;
+      return;
+    }
+  }
+  m_free[_offset]=size;
+}
+
+size_t ArenaAllocator::largestFree() const
+{
+  size_t largest=0;
+  for(const auto &range : m_free)
+    largest=std::max(largest,range.second);
+  return largest;
+}
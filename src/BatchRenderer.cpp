@@ -0,0 +1,238 @@
+#include "BatchRenderer.h"
+#include <ngl/ShaderLib.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+constexpr int BatchRenderer::c_numRegions;
+constexpr GLuint BatchRenderer::c_bindingPoint;
+constexpr const char *BatchRenderer::c_program;
+
+BatchRenderer::BatchRenderer(size_t _maxVerts, size_t _maxIndices, size_t _maxDraws) :
+  m_vertexArena(_maxVerts),
+  m_indexArena(_maxIndices),
+  m_maxDraws(std::max<size_t>(_maxDraws,1))
+{
+  m_fences.fill(nullptr);
+  GLint alignment=256;
+  glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT,&alignment);
+  size_t align=static_cast<size_t>(std::max(alignment,1));
+  m_drawStride=(m_maxDraws*sizeof(Draw)+align-1)/align*align;
+
+  glGenVertexArrays(1,&m_vao);
+  glBindVertexArray(m_vao);
+  // position and normal interleaved like the InstancedRenderer mesh
+  glGenBuffers(1,&m_vertexBuffer);
+  glBindBuffer(GL_ARRAY_BUFFER,m_vertexBuffer);
+  glBufferData(GL_ARRAY_BUFFER,static_cast<GLsizeiptr>(_maxVerts*6*sizeof(float)),nullptr,GL_STATIC_DRAW);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0,3,GL_FLOAT,GL_FALSE,6*sizeof(float),reinterpret_cast<void *>(0));
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1,3,GL_FLOAT,GL_FALSE,6*sizeof(float),reinterpret_cast<void *>(3*sizeof(float)));
+  // 0,1,2... advanced once per instance, with baseInstance set to the draw index each draw's
+  // single instance reads its own index
+  std::vector<GLuint> ids(m_maxDraws);
+  for(size_t i=0; i<m_maxDraws; ++i)
+    ids[i]=static_cast<GLuint>(i);
+  glGenBuffers(1,&m_drawIDBuffer);
+  glBindBuffer(GL_ARRAY_BUFFER,m_drawIDBuffer);
+  glBufferData(GL_ARRAY_BUFFER,static_cast<GLsizeiptr>(ids.size()*sizeof(GLuint)),ids.data(),GL_STATIC_DRAW);
+  glEnableVertexAttribArray(3);
+  glVertexAttribIPointer(3,1,GL_UNSIGNED_INT,0,nullptr);
+  glVertexAttribDivisor(3,1);
+  glGenBuffers(1,&m_indexBuffer);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,m_indexBuffer);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER,static_cast<GLsizeiptr>(_maxIndices*sizeof(uint32_t)),nullptr,GL_STATIC_DRAW);
+  glBindVertexArray(0);
+
+  GLsizeiptr ringSize=static_cast<GLsizeiptr>(c_numRegions*(m_drawStride+m_maxDraws*sizeof(Command)));
+  glGenBuffers(1,&m_frameBuffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER,m_frameBuffer);
+  GLint major=0;
+  GLint minor=0;
+  glGetIntegerv(GL_MAJOR_VERSION,&major);
+  glGetIntegerv(GL_MINOR_VERSION,&minor);
+  if(major > 4 || (major==4 && minor >= 4))
+  {
+    GLbitfield flags=GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_SHADER_STORAGE_BUFFER,ringSize,nullptr,flags);
+    m_mapped=static_cast<unsigned char *>(glMapBufferRange(GL_SHADER_STORAGE_BUFFER,0,ringSize,flags));
+  }
+  if(m_mapped==nullptr)
+  {
+    glBufferData(GL_SHADER_STORAGE_BUFFER,ringSize,nullptr,GL_STREAM_DRAW);
+    m_drawStaging.resize(m_maxDraws);
+    m_commandStaging.resize(m_maxDraws);
+  }
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER,0);
+  glBindBuffer(GL_ARRAY_BUFFER,0);
+  m_drawMeshes.reserve(m_maxDraws);
+}
+
+BatchRenderer::~BatchRenderer()
+{
+  for(auto &fence : m_fences)
+  {
+    if(fence)
+      glDeleteSync(fence);
+  }
+  if(m_mapped)
+  {
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER,m_frameBuffer);
+    glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+  }
+  GLuint buffers[]={m_vertexBuffer,m_indexBuffer,m_drawIDBuffer,m_frameBuffer};
+  glDeleteBuffers(4,buffers);
+  glDeleteVertexArrays(1,&m_vao);
+}
+
+int BatchRenderer::addMesh(const float *_positions, const float *_normals, size_t _numVerts, const uint32_t *_indices, size_t _numIndices)
+{
+  size_t firstVertex=m_vertexArena.allocate(_numVerts);
+  if(firstVertex==ArenaAllocator::c_invalid)
+    return -1;
+  size_t firstIndex=m_indexArena.allocate(_numIndices);
+  if(firstIndex==ArenaAllocator::c_invalid)
+  {
+    m_vertexArena.release(firstVertex);
+    return -1;
+  }
+  std::vector<float> vertices;
+  vertices.reserve(_numVerts*6);
+  for(size_t i=0; i<_numVerts; ++i)
+  {
+    vertices.insert(vertices.end(),{_positions[i*3],_positions[i*3+1],_positions[i*3+2]});
+    vertices.insert(vertices.end(),{_normals[i*3],_normals[i*3+1],_normals[i*3+2]});
+  }
+  glBindBuffer(GL_ARRAY_BUFFER,m_vertexBuffer);
+  glBufferSubData(GL_ARRAY_BUFFER,static_cast<GLintptr>(firstVertex*6*sizeof(float)),
+                  static_cast<GLsizeiptr>(vertices.size()*sizeof(float)),vertices.data());
+  glBindBuffer(GL_ARRAY_BUFFER,0);
+  // the element binding is part of the VAO so go through it rather than change another one's
+  glBindVertexArray(m_vao);
+  glBufferSubData(GL_ELEMENT_ARRAY_BUFFER,static_cast<GLintptr>(firstIndex*sizeof(uint32_t)),
+                  static_cast<GLsizeiptr>(_numIndices*sizeof(uint32_t)),_indices);
+  glBindVertexArray(0);
+
+  Mesh mesh;
+  mesh.firstVertex=firstVertex;
+  mesh.firstIndex=firstIndex;
+  mesh.numIndices=static_cast<GLuint>(_numIndices);
+  ++m_meshCount;
+  auto slot=std::find_if(m_meshes.begin(),m_meshes.end(),[](const Mesh &_m){ return _m.numIndices==0; });
+  if(slot!=m_meshes.end())
+  {
+    *slot=mesh;
+    return static_cast<int>(slot-m_meshes.begin());
+  }
+  m_meshes.push_back(mesh);
+  return static_cast<int>(m_meshes.size()-1);
+}
+
+void BatchRenderer::removeMesh(int _mesh)
+{
+  if(_mesh<0 || static_cast<size_t>(_mesh)>=m_meshes.size() || m_meshes[static_cast<size_t>(_mesh)].numIndices==0)
+    return;
+  Mesh &mesh=m_meshes[static_cast<size_t>(_mesh)];
+  m_vertexArena.release(mesh.firstVertex);
+  m_indexArena.release(mesh.firstIndex);
+  mesh=Mesh();
+  --m_meshCount;
+}
+
+void BatchRenderer::waitForRegion(int _region)
+{
+  GLsync &fence=m_fences[static_cast<size_t>(_region)];
+  if(fence==nullptr)
+    return;
+  GLenum result=glClientWaitSync(fence,0,0);
+  while(result==GL_TIMEOUT_EXPIRED)
+    result=glClientWaitSync(fence,GL_SYNC_FLUSH_COMMANDS_BIT,1000000);
+  glDeleteSync(fence);
+  fence=nullptr;
+}
+
+void BatchRenderer::begin()
+{
+  waitForRegion(m_region);
+  m_drawMeshes.clear();
+}
+
+bool BatchRenderer::add(int _mesh, const ngl::Mat4 &_M, const ngl::Mat3 &_normalMatrix)
+{
+  if(m_drawMeshes.size()>=m_maxDraws || _mesh<0 || static_cast<size_t>(_mesh)>=m_meshes.size())
+    return false;
+  Draw *draws=m_mapped ? reinterpret_cast<Draw *>(m_mapped+drawOffset()) : m_drawStaging.data();
+  Draw &draw=draws[m_drawMeshes.size()];
+  std::memcpy(draw.M,&_M.m_openGL[0],sizeof(draw.M));
+  for(int c=0; c<3; ++c)
+  {
+    draw.normalMatrix[c*4+0]=_normalMatrix.m_openGL[c*3+0];
+    draw.normalMatrix[c*4+1]=_normalMatrix.m_openGL[c*3+1];
+    draw.normalMatrix[c*4+2]=_normalMatrix.m_openGL[c*3+2];
+    draw.normalMatrix[c*4+3]=0.0f;
+  }
+  m_drawMeshes.push_back(_mesh);
+  return true;
+}
+
+void BatchRenderer::draw(const ngl::Mat4 &_view, const ngl::Mat4 &_project, bool _multiDraw)
+{
+  auto start=std::chrono::high_resolution_clock::now();
+  size_t count=m_drawMeshes.size();
+  Command *commands=m_mapped ? reinterpret_cast<Command *>(m_mapped+commandOffset()) : m_commandStaging.data();
+  size_t triangles=0;
+  for(size_t i=0; i<count; ++i)
+  {
+    const Mesh &mesh=m_meshes[static_cast<size_t>(m_drawMeshes[i])];
+    Command &command=commands[i];
+    command.count=mesh.numIndices;
+    command.instanceCount=1;
+    command.firstIndex=static_cast<GLuint>(mesh.firstIndex);
+    command.baseVertex=static_cast<GLint>(mesh.firstVertex);
+    command.baseInstance=static_cast<GLuint>(i);
+    triangles+=mesh.numIndices/3;
+  }
+  if(m_mapped==nullptr && count)
+  {
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER,m_frameBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER,static_cast<GLintptr>(drawOffset()),static_cast<GLsizeiptr>(count*sizeof(Draw)),m_drawStaging.data());
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER,static_cast<GLintptr>(commandOffset()),static_cast<GLsizeiptr>(count*sizeof(Command)),commands);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER,0);
+  }
+
+  ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+  (*shader)[c_program]->use();
+  shader->setUniform("V",_view);
+  shader->setUniform("VP",_project*_view);
+  glBindBufferRange(GL_SHADER_STORAGE_BUFFER,c_bindingPoint,m_frameBuffer,static_cast<GLintptr>(drawOffset()),
+                    static_cast<GLsizeiptr>(m_maxDraws*sizeof(Draw)));
+  glBindVertexArray(m_vao);
+  if(_multiDraw)
+  {
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER,m_frameBuffer);
+    if(count)
+      glMultiDrawElementsIndirect(GL_TRIANGLES,GL_UNSIGNED_INT,reinterpret_cast<void *>(commandOffset()),static_cast<GLsizei>(count),0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER,0);
+  }
+  else
+  {
+    // what the same draws cost one call at a time, the mapping is write only so the commands
+    // come from the meshes again
+    for(size_t i=0; i<count; ++i)
+    {
+      const Mesh &mesh=m_meshes[static_cast<size_t>(m_drawMeshes[i])];
+      glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES,static_cast<GLsizei>(mesh.numIndices),GL_UNSIGNED_INT,
+                                                    reinterpret_cast<void *>(mesh.firstIndex*sizeof(uint32_t)),1,
+                                                    static_cast<GLint>(mesh.firstVertex),static_cast<GLuint>(i));
+    }
+  }
+  glBindVertexArray(0);
+
+  m_fences[static_cast<size_t>(m_region)]=glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE,0);
+  m_region=(m_region+1)%c_numRegions;
+  m_stats.draws=count;
+  m_stats.drawCalls=count==0 ? 0 : (_multiDraw ? 1 : count);
+  m_stats.triangles=triangles;
+  m_stats.submitMs=std::chrono::duration<float,std::milli>(std::chrono::high_resolution_clock::now()-start).count();
+}
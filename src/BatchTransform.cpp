@@ -0,0 +1,175 @@
+#include "BatchTransform.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+  #define BATCHTRANSFORM_X86
+  #include <immintrin.h>
+#endif
+
+namespace
+{
+//----------------------------------------------------------------------------------------------------------------------
+// scalar reference path, also used to mop up the tail of the SIMD loops
+//----------------------------------------------------------------------------------------------------------------------
+void transformScalar(const float *_m, const float *_x, const float *_y, const float *_z,
+                     float *_ox, float *_oy, float *_oz, float *_ow, size_t _begin, size_t _end)
+{
+  for(size_t i=_begin; i<_end; ++i)
+  {
+    float x=_x[i];
+    float y=_y[i];
+    float z=_z[i];
+    _ox[i]=_m[0]*x + _m[4]*y + _m[8]*z  + _m[12];
+    _oy[i]=_m[1]*x + _m[5]*y + _m[9]*z  + _m[13];
+    _oz[i]=_m[2]*x + _m[6]*y + _m[10]*z + _m[14];
+    _ow[i]=_m[3]*x + _m[7]*y + _m[11]*z + _m[15];
+  }
+}
+
+#ifdef BATCHTRANSFORM_X86
+//----------------------------------------------------------------------------------------------------------------------
+// each kernel broadcasts the matrix once then does one row of the matrix per output array
+//----------------------------------------------------------------------------------------------------------------------
+__attribute__((target("sse2")))
+size_t transformSSE(const float *_m, const float *_x, const float *_y, const float *_z,
+                    float *_ox, float *_oy, float *_oz, float *_ow, size_t _n)
+{
+  __m128 m[16];
+  for(int i=0; i<16; ++i)
+    m[i]=_mm_set1_ps(_m[i]);
+  float *out[4]={_ox,_oy,_oz,_ow};
+  size_t i=0;
+  for(; i+4<=_n; i+=4)
+  {
+    __m128 x=_mm_loadu_ps(_x+i);
+    __m128 y=_mm_loadu_ps(_y+i);
+    __m128 z=_mm_loadu_ps(_z+i);
+    for(int r=0; r<4; ++r)
+    {
+      __m128 v=_mm_add_ps(_mm_mul_ps(m[r],x),_mm_mul_ps(m[4+r],y));
+      v=_mm_add_ps(v,_mm_add_ps(_mm_mul_ps(m[8+r],z),m[12+r]));
+      _mm_storeu_ps(out[r]+i,v);
+    }
+  }
+  return i;
+}
+
+__attribute__((target("avx2,fma")))
+size_t transformAVX2(const float *_m, const float *_x, const float *_y, const float *_z,
+                     float *_ox, float *_oy, float *_oz, float *_ow, size_t _n)
+{
+  __m256 m[16];
+  for(int i=0; i<16; ++i)
+    m[i]=_mm256_set1_ps(_m[i]);
+  float *out[4]={_ox,_oy,_oz,_ow};
+  size_t i=0;
+  for(; i+8<=_n; i+=8)
+  {
+    __m256 x=_mm256_loadu_ps(_x+i);
+    __m256 y=_mm256_loadu_ps(_y+i);
+    __m256 z=_mm256_loadu_ps(_z+i);
+    for(int r=0; r<4; ++r)
+    {
+      __m256 v=_mm256_fmadd_ps(m[8+r],z,m[12+r]);
+      v=_mm256_fmadd_ps(m[4+r],y,v);
+      v=_mm256_fmadd_ps(m[r],x,v);
+      _mm256_storeu_ps(out[r]+i,v);
+    }
+  }
+  return i;
+}
+
+__attribute__((target("avx512f")))
+size_t transformAVX512(const float *_m, const float *_x, const float *_y, const float *_z,
+                       float *_ox, float *_oy, float *_oz, float *_ow, size_t _n)
+{
+  __m512 m[16];
+  for(int i=0; i<16; ++i)
+    m[i]=_mm512_set1_ps(_m[i]);
+  float *out[4]={_ox,_oy,_oz,_ow};
+  size_t i=0;
+  for(; i+16<=_n; i+=16)
+  {
+    __m512 x=_mm512_loadu_ps(_x+i);
+    __m512 y=_mm512_loadu_ps(_y+i);
+    __m512 z=_mm512_loadu_ps(_z+i);
+    for(int r=0; r<4; ++r)
+    {
+      __m512 v=_mm512_fmadd_ps(m[8+r],z,m[12+r]);
+      v=_mm512_fmadd_ps(m[4+r],y,v);
+      v=_mm512_fmadd_ps(m[r],x,v);
+      _mm512_storeu_ps(out[r]+i,v);
+    }
+  }
+  return i;
+}
+#endif
+
+SimdPath detectPath()
+{
+#ifdef BATCHTRANSFORM_X86
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx512f"))
+    return SimdPath::AVX512;
+  if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return SimdPath::AVX2;
+  if(__builtin_cpu_supports("sse2"))
+    return SimdPath::SSE;
+#endif
+  return SimdPath::Scalar;
+}
+
+} // end anon namespace
+
+SimdPath BatchTransform::bestPath()
+{
+  static const SimdPath s_best=detectPath();
+  return s_best;
+}
+
+bool BatchTransform::isSupported(SimdPath _path)
+{
+  // the paths are ordered by width so anything up to the best path will run
+  if(_path==SimdPath::Auto)
+    return true;
+  return static_cast<int>(_path) <= static_cast<int>(bestPath());
+}
+
+const char *BatchTransform::pathName(SimdPath _path)
+{
+  switch(_path)
+  {
+    case SimdPath::Scalar : return "scalar";
+    case SimdPath::SSE : return "sse";
+    case SimdPath::AVX2 : return "avx2";
+    case SimdPath::AVX512 : return "avx512";
+    case SimdPath::Auto : return "auto";
+  }
+  return "unknown";
+}
+
+void BatchTransform::transform(const ngl::Mat4 &_m, const VertexBatchSoA &_in, ClipBatchSoA &_out, SimdPath _path)
+{
+  _out.resize(_in.size());
+  if(_in.size()==0)
+    return;
+  transform(&_m.m_openGL[0],_in.x.data(),_in.y.data(),_in.z.data(),
+            _out.x.data(),_out.y.data(),_out.z.data(),_out.w.data(),_in.size(),_path);
+}
+
+void BatchTransform::transform(const float *_m, const float *_x, const float *_y, const float *_z,
+                               float *_ox, float *_oy, float *_oz, float *_ow, size_t _n, SimdPath _path)
+{
+  if(_path==SimdPath::Auto || !isSupported(_path))
+    _path=bestPath();
+  size_t done=0;
+  switch(_path)
+  {
+#ifdef BATCHTRANSFORM_X86
+    case SimdPath::AVX512 : done=transformAVX512(_m,_x,_y,_z,_ox,_oy,_oz,_ow,_n); break;
+    case SimdPath::AVX2 : done=transformAVX2(_m,_x,_y,_z,_ox,_oy,_oz,_ow,_n); break;
+    case SimdPath::SSE : done=transformSSE(_m,_x,_y,_z,_ox,_oy,_oz,_ow,_n); break;
+#endif
+    default : break;
+  }
+  transformScalar(_m,_x,_y,_z,_ox,_oy,_oz,_ow,done,_n);
+}
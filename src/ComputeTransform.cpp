@@ -0,0 +1,92 @@
+#include "ComputeTransform.h"
+#include <ngl/ShaderLib.h>
+
+constexpr const char *ComputeTransform::c_program;
+constexpr GLuint ComputeTransform::c_groupSize;
+
+ComputeTransform::ComputeTransform(const float *_positions, const float *_normals, size_t _numVerts,
+                                   const uint32_t *_indices, size_t _numIndices) :
+  m_numVerts(_numVerts),
+  m_numIndices(static_cast<GLsizei>(_indices ? _numIndices : 0))
+{
+  GLsizeiptr vec3Size=static_cast<GLsizeiptr>(_numVerts*3*sizeof(float));
+  glGenVertexArrays(1,&m_vao);
+  glBindVertexArray(m_vao);
+  // the positions are both the compute input and attribute 0, they still feed the lighting
+  glGenBuffers(1,&m_positions);
+  glBindBuffer(GL_ARRAY_BUFFER,m_positions);
+  glBufferData(GL_ARRAY_BUFFER,vec3Size,_positions,GL_STATIC_DRAW);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0,3,GL_FLOAT,GL_FALSE,0,nullptr);
+  if(_normals)
+  {
+    glGenBuffers(1,&m_normals);
+    glBindBuffer(GL_ARRAY_BUFFER,m_normals);
+    glBufferData(GL_ARRAY_BUFFER,vec3Size,_normals,GL_STATIC_DRAW);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1,3,GL_FLOAT,GL_FALSE,0,nullptr);
+  }
+  // the compute output is vec4 per vertex in std430 so it is also a plain attribute array
+  glGenBuffers(1,&m_clip);
+  glBindBuffer(GL_ARRAY_BUFFER,m_clip);
+  glBufferData(GL_ARRAY_BUFFER,static_cast<GLsizeiptr>(_numVerts*4*sizeof(float)),nullptr,GL_DYNAMIC_COPY);
+  glEnableVertexAttribArray(3);
+  glVertexAttribPointer(3,4,GL_FLOAT,GL_FALSE,0,nullptr);
+  if(m_numIndices)
+  {
+    glGenBuffers(1,&m_indices);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,m_indices);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,static_cast<GLsizeiptr>(_numIndices*sizeof(uint32_t)),_indices,GL_STATIC_DRAW);
+  }
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER,0);
+}
+
+ComputeTransform::~ComputeTransform()
+{
+  GLuint buffers[]={m_positions,m_normals,m_clip,m_indices};
+  glDeleteBuffers(4,buffers);
+  glDeleteVertexArrays(1,&m_vao);
+}
+
+void ComputeTransform::dispatch(const ngl::Mat4 &_MVP)
+{
+  ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+  (*shader)[c_program]->use();
+  shader->setUniform("MVP",_MVP);
+  shader->setUniform("vertexCount",static_cast<int>(m_numVerts));
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER,0,m_positions);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER,1,m_clip);
+  glDispatchCompute(static_cast<GLuint>((m_numVerts+c_groupSize-1)/c_groupSize),1,1);
+  // the results are next used as a vertex attribute or copied back
+  glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+}
+
+void ComputeTransform::draw() const
+{
+  ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+  shader->setUniform("computedClip",1);
+  glBindVertexArray(m_vao);
+  if(m_numIndices)
+    glDrawElements(GL_TRIANGLES,m_numIndices,GL_UNSIGNED_INT,nullptr);
+  else
+    glDrawArrays(GL_TRIANGLES,0,static_cast<GLsizei>(m_numVerts));
+  glBindVertexArray(0);
+  shader->setUniform("computedClip",0);
+}
+
+void ComputeTransform::readBack(ClipBatchSoA &_out)
+{
+  m_staging.resize(m_numVerts*4);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER,m_clip);
+  glGetBufferSubData(GL_SHADER_STORAGE_BUFFER,0,static_cast<GLsizeiptr>(m_staging.size()*sizeof(float)),m_staging.data());
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER,0);
+  _out.resize(m_numVerts);
+  for(size_t i=0; i<m_numVerts; ++i)
+  {
+    _out.x[i]=m_staging[4*i];
+    _out.y[i]=m_staging[4*i+1];
+    _out.z[i]=m_staging[4*i+2];
+    _out.w[i]=m_staging[4*i+3];
+  }
+}
@@ -0,0 +1,38 @@
+#include "FramePacer.h"
+#include <algorithm>
+
+constexpr float FramePacer::c_marginMs;
+
+FramePacer::FramePacer(float _targetFps)
+{
+  setTargetRate(_targetFps);
+}
+
+void FramePacer::setTargetRate(float _fps)
+{
+  m_targetFps=std::max(_fps,0.0f);
+  m_periodMs=m_targetFps>0.0f ? 1000.0f/m_targetFps : 0.0f;
+}
+
+int FramePacer::delayMs(Clock::time_point _now) const
+{
+  if(m_periodMs==0.0f || !m_presented)
+    return 0;
+  float sinceLast=std::chrono::duration<float,std::milli>(_now-m_lastPresent).count();
+  float wait=m_periodMs-sinceLast-m_predictedMs-c_marginMs;
+  return wait>0.0f ? static_cast<int>(wait) : 0;
+}
+
+void FramePacer::frameStarted(Clock::time_point _now)
+{
+  m_frameStart=_now;
+}
+
+void FramePacer::framePresented(Clock::time_point _now)
+{
+  float cost=std::chrono::duration<float,std::milli>(_now-m_frameStart).count();
+  // a slow frame is believed straight away, fast ones only pull the prediction down slowly
+  m_predictedMs=cost>m_predictedMs ? cost : 0.9f*m_predictedMs+0.1f*cost;
+  m_lastPresent=_now;
+  m_presented=true;
+}
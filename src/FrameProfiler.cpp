@@ -0,0 +1,263 @@
+#include "FrameProfiler.h"
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+//----------------------------------------------------------------------------------------------------------------------
+// min, mean and 99th percentile of the recorded (non negative) values
+//----------------------------------------------------------------------------------------------------------------------
+void rollingStats(std::vector<float> &_values, float &_min, float &_avg, float &_p99)
+{
+  _min=_avg=_p99=0.0f;
+  if(_values.empty())
+    return;
+  std::sort(_values.begin(),_values.end());
+  double sum=0.0;
+  for(float v : _values)
+    sum+=v;
+  _min=_values.front();
+  _avg=static_cast<float>(sum/_values.size());
+  _p99=_values[std::min(_values.size()-1,_values.size()*99/100)];
+}
+
+void writeValue(std::ostream &_out, float _v, const char *_missing)
+{
+  if(_v<0.0f)
+    _out<<_missing;
+  else
+    _out<<_v;
+}
+} // end anon namespace
+
+FrameProfiler::~FrameProfiler()
+{
+  if(!m_queries.empty())
+    glDeleteQueries(static_cast<GLsizei>(m_queries.size()),m_queries.data());
+}
+
+int FrameProfiler::addStage(const std::string &_name)
+{
+  m_names.push_back(_name);
+  m_summaries.resize(m_names.size());
+  m_cpuStart.resize(m_names.size());
+  return static_cast<int>(m_names.size())-1;
+}
+
+void FrameProfiler::initGL()
+{
+  m_queries.resize(c_latency*m_names.size()*2);
+  glGenQueries(static_cast<GLsizei>(m_queries.size()),m_queries.data());
+  for(int i=0; i<c_latency; ++i)
+  {
+    m_issued[i].assign(m_names.size(),0);
+    m_slotPending[i]=false;
+    m_slotFrame[i]=0;
+  }
+  m_history.resize(c_historySize);
+  for(auto &r : m_history)
+  {
+    r.cpuMs.assign(m_names.size(),-1.0f);
+    r.gpuMs.assign(m_names.size(),-1.0f);
+  }
+}
+
+void FrameProfiler::beginFrame()
+{
+  // this frame's query set was last used c_latency frames ago, read it back if the gpu has
+  // finished with it otherwise give up on those results rather than stall
+  int slot=static_cast<int>(m_frame%c_latency);
+  if(m_slotPending[slot])
+    resolve(slot);
+  std::fill(m_issued[slot].begin(),m_issued[slot].end(),0);
+  m_slotFrame[slot]=m_frame;
+  summarise();
+
+  Record &record=m_history[m_frame%c_historySize];
+  record.frame=m_frame;
+  record.valid=true;
+  std::fill(record.cpuMs.begin(),record.cpuMs.end(),-1.0f);
+  std::fill(record.gpuMs.begin(),record.gpuMs.end(),-1.0f);
+}
+
+void FrameProfiler::endFrame()
+{
+  m_slotPending[m_frame%c_latency]=true;
+  ++m_frame;
+}
+
+void FrameProfiler::begin(int _stage)
+{
+  int slot=static_cast<int>(m_frame%c_latency);
+  // there is one query pair per stage per frame, a second run would overwrite the first
+  assert(!m_issued[slot][_stage] && "a profiler stage can only be timed once a frame");
+  glQueryCounter(query(slot,_stage,0),GL_TIMESTAMP);
+  m_cpuStart[_stage]=std::chrono::high_resolution_clock::now();
+}
+
+void FrameProfiler::end(int _stage)
+{
+  float ms=std::chrono::duration<float,std::milli>(std::chrono::high_resolution_clock::now()-m_cpuStart[_stage]).count();
+  int slot=static_cast<int>(m_frame%c_latency);
+  glQueryCounter(query(slot,_stage,1),GL_TIMESTAMP);
+  m_issued[slot][_stage]=1;
+  // replaced like the query pair so both columns always cover the same span
+  m_history[m_frame%c_historySize].cpuMs[_stage]=ms;
+}
+
+void FrameProfiler::resolve(int _slot)
+{
+  m_slotPending[_slot]=false;
+  // stages nest (FRAME_STAGE ends after the others) so no single query is known to be the last
+  // one the gpu writes, every query is checked before any result is read so reading never blocks
+  bool any=false;
+  for(size_t s=0; s<m_names.size(); ++s)
+  {
+    if(!m_issued[_slot][s])
+      continue;
+    any=true;
+    for(int q=0; q<2; ++q)
+    {
+      GLint available=GL_FALSE;
+      glGetQueryObjectiv(query(_slot,static_cast<int>(s),q),GL_QUERY_RESULT_AVAILABLE,&available);
+      if(available!=GL_TRUE)
+      {
+        ++m_gpuDropped;
+        return;
+      }
+    }
+  }
+  if(!any)
+    return;
+  Record &record=m_history[m_slotFrame[_slot]%c_historySize];
+  if(!record.valid || record.frame!=m_slotFrame[_slot])
+    return;
+  for(size_t s=0; s<m_names.size(); ++s)
+  {
+    if(!m_issued[_slot][s])
+      continue;
+    GLuint64 start=0;
+    GLuint64 end=0;
+    glGetQueryObjectui64v(query(_slot,static_cast<int>(s),0),GL_QUERY_RESULT,&start);
+    glGetQueryObjectui64v(query(_slot,static_cast<int>(s),1),GL_QUERY_RESULT,&end);
+    record.gpuMs[s]=static_cast<float>(end-start)/1.0e6f;
+  }
+  m_hasLatest=true;
+  m_latestFrame=record.frame;
+}
+
+bool FrameProfiler::latest(int _stage, uint64_t &_frame, float &_cpuMs, float &_gpuMs) const
+{
+  if(!m_hasLatest)
+    return false;
+  // the record is only reused c_historySize frames on
+  const Record &record=m_history[m_latestFrame%c_historySize];
+  if(record.frame!=m_latestFrame || record.cpuMs[_stage]<0.0f || record.gpuMs[_stage]<0.0f)
+    return false;
+  _frame=m_latestFrame;
+  _cpuMs=record.cpuMs[_stage];
+  _gpuMs=record.gpuMs[_stage];
+  return true;
+}
+
+void FrameProfiler::summarise()
+{
+  std::vector<float> cpu;
+  std::vector<float> gpu;
+  cpu.reserve(c_historySize);
+  gpu.reserve(c_historySize);
+  for(size_t s=0; s<m_names.size(); ++s)
+  {
+    cpu.clear();
+    gpu.clear();
+    for(const auto &r : m_history)
+    {
+      if(!r.valid)
+        continue;
+      if(r.cpuMs[s]>=0.0f)
+        cpu.push_back(r.cpuMs[s]);
+      if(r.gpuMs[s]>=0.0f)
+        gpu.push_back(r.gpuMs[s]);
+    }
+    Summary &sum=m_summaries[s];
+    rollingStats(cpu,sum.cpuMin,sum.cpuAvg,sum.cpuP99);
+    rollingStats(gpu,sum.gpuMin,sum.gpuAvg,sum.gpuP99);
+  }
+}
+
+std::vector<const FrameProfiler::Record *> FrameProfiler::orderedHistory() const
+{
+  std::vector<const Record *> records;
+  for(const auto &r : m_history)
+    if(r.valid)
+      records.push_back(&r);
+  std::sort(records.begin(),records.end(),[](const Record *_a, const Record *_b){ return _a->frame<_b->frame; });
+  return records;
+}
+
+bool FrameProfiler::writeCSV(const std::string &_fname) const
+{
+  std::ofstream file(_fname.c_str());
+  if(!file.is_open())
+  {
+    std::cerr<<"FrameProfiler unable to write "<<_fname<<'\n';
+    return false;
+  }
+  file<<"frame,stage,cpu_ms,gpu_ms\n";
+  for(const Record *r : orderedHistory())
+  {
+    for(size_t s=0; s<m_names.size(); ++s)
+    {
+      if(r->cpuMs[s]<0.0f && r->gpuMs[s]<0.0f)
+        continue;
+      file<<r->frame<<','<<m_names[s]<<',';
+      writeValue(file,r->cpuMs[s],"");
+      file<<',';
+      writeValue(file,r->gpuMs[s],"");
+      file<<'\n';
+    }
+  }
+  return static_cast<bool>(file);
+}
+
+bool FrameProfiler::writeJSON(const std::string &_fname) const
+{
+  std::ofstream file(_fname.c_str());
+  if(!file.is_open())
+  {
+    std::cerr<<"FrameProfiler unable to write "<<_fname<<'\n';
+    return false;
+  }
+  file<<"{\n  \"gpuDropped\": "<<m_gpuDropped<<",\n  \"stages\": [\n";
+  for(size_t s=0; s<m_names.size(); ++s)
+  {
+    const Summary &sum=m_summaries[s];
+    file<<"    {\"name\": \""<<m_names[s]<<"\", "
+        <<"\"cpu\": {\"min\": "<<sum.cpuMin<<", \"avg\": "<<sum.cpuAvg<<", \"p99\": "<<sum.cpuP99<<"}, "
+        <<"\"gpu\": {\"min\": "<<sum.gpuMin<<", \"avg\": "<<sum.gpuAvg<<", \"p99\": "<<sum.gpuP99<<"}}"
+        <<(s+1<m_names.size() ? ",\n" : "\n");
+  }
+  file<<"  ],\n  \"frames\": [\n";
+  std::vector<const Record *> records=orderedHistory();
+  for(size_t i=0; i<records.size(); ++i)
+  {
+    const Record *r=records[i];
+    file<<"    {\"frame\": "<<r->frame<<", \"cpu\": [";
+    for(size_t s=0; s<m_names.size(); ++s)
+    {
+      file<<(s ? ", " : "");
+      writeValue(file,r->cpuMs[s],"null");
+    }
+    file<<"], \"gpu\": [";
+    for(size_t s=0; s<m_names.size(); ++s)
+    {
+      file<<(s ? ", " : "");
+      writeValue(file,r->gpuMs[s],"null");
+    }
+    file<<"]}"<<(i+1<records.size() ? ",\n" : "\n");
+  }
+  file<<"  ]\n}\n";
+  return static_cast<bool>(file);
+}
@@ -0,0 +1,140 @@
+#include "FrameTrace.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+FrameTrace::FrameTrace(size_t _ringSize) : m_ring(_ringSize)
+{
+}
+
+FrameTrace::~FrameTrace()
+{
+  stop();
+}
+
+bool FrameTrace::start(const std::string &_fname)
+{
+  if(m_running)
+    stop();
+  m_file=std::fopen(_fname.c_str(),"wb");
+  if(m_file==nullptr)
+  {
+    std::cerr<<"FrameTrace unable to open "<<_fname<<'\n';
+    return false;
+  }
+  trace::TraceFileHeader header={trace::c_magic,trace::c_version};
+  std::fwrite(&header,sizeof(header),1,m_file);
+  m_dropped=0;
+  m_written=0;
+  m_running=true;
+  m_drainThread=std::thread(&FrameTrace::drainLoop,this);
+  m_enabled=true;
+  std::cout<<"FrameTrace writing to "<<_fname<<'\n';
+  return true;
+}
+
+void FrameTrace::stop()
+{
+  if(!m_running)
+    return;
+  m_enabled=false;
+  m_running=false;
+  m_drainThread.join();
+  std::fclose(m_file);
+  m_file=nullptr;
+  std::cout<<"FrameTrace stopped "<<m_written<<" records written "<<m_dropped<<" dropped\n";
+}
+
+void FrameTrace::toggle(const std::string &_fname)
+{
+  if(m_running)
+    stop();
+  else
+    start(_fname);
+}
+
+bool FrameTrace::push(trace::RecordType _type, const void *_payload, uint32_t _size)
+{
+  trace::TraceRecordHeader header;
+  header.type=static_cast<uint16_t>(_type);
+  header.reserved=0;
+  header.payloadSize=_size;
+  if(!m_ring.tryWrite(&header,sizeof(header),_payload,_size))
+  {
+    m_dropped.fetch_add(1,std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+void FrameTrace::recordMatrices(uint64_t _frame, const ngl::Mat4 &_MVP, const ngl::Mat4 &_M, const ngl::Mat4 &_view, const ngl::Mat4 &_project)
+{
+  if(!isEnabled())
+    return;
+  trace::MatrixRecord record;
+  record.frame=_frame;
+  std::memcpy(record.MVP,&_MVP.m_openGL[0],sizeof(record.MVP));
+  std::memcpy(record.M,&_M.m_openGL[0],sizeof(record.M));
+  std::memcpy(record.view,&_view.m_openGL[0],sizeof(record.view));
+  std::memcpy(record.project,&_project.m_openGL[0],sizeof(record.project));
+  push(trace::RecordType::FRAME_MATRICES,&record,sizeof(record));
+}
+
+void FrameTrace::recordPoints(uint64_t _frame, const ClipBatchSoA &_points)
+{
+  if(!isEnabled())
+    return;
+  // pack as a PointsRecord followed by x,y,z,w per point
+  size_t count=_points.size();
+  size_t headerFloats=sizeof(trace::PointsRecord)/sizeof(float);
+  m_pointScratch.resize(headerFloats+count*4);
+  trace::PointsRecord record;
+  record.frame=_frame;
+  record.count=static_cast<uint32_t>(count);
+  record.reserved=0;
+  std::memcpy(m_pointScratch.data(),&record,sizeof(record));
+  float *p=m_pointScratch.data()+headerFloats;
+  for(size_t i=0; i<count; ++i)
+  {
+    *p++=_points.x[i];
+    *p++=_points.y[i];
+    *p++=_points.z[i];
+    *p++=_points.w[i];
+  }
+  push(trace::RecordType::CLIP_POINTS,m_pointScratch.data(),static_cast<uint32_t>(m_pointScratch.size()*sizeof(float)));
+}
+
+bool FrameTrace::drainOnce(std::vector<char> &_scratch)
+{
+  // records are only published whole so if a header is visible so is its payload
+  size_t available=m_ring.available();
+  if(available < sizeof(trace::TraceRecordHeader))
+    return false;
+  size_t total=0;
+  while(available-total >= sizeof(trace::TraceRecordHeader))
+  {
+    trace::TraceRecordHeader header;
+    m_ring.peek(&header,sizeof(header));
+    size_t size=sizeof(header)+header.payloadSize;
+    _scratch.resize(size);
+    m_ring.read(_scratch.data(),size);
+    std::fwrite(_scratch.data(),size,1,m_file);
+    m_written.fetch_add(1,std::memory_order_relaxed);
+    total+=size;
+  }
+  return true;
+}
+
+void FrameTrace::drainLoop()
+{
+  std::vector<char> scratch;
+  while(m_running.load(std::memory_order_acquire))
+  {
+    if(!drainOnce(scratch))
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  // the producer has stopped so empty whatever is left
+  while(drainOnce(scratch))
+    ;
+  std::fflush(m_file);
+}
@@ -0,0 +1,322 @@
+#include "FrustumCuller.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+  #define FRUSTUMCULLER_X86
+  #include <immintrin.h>
+#endif
+
+namespace
+{
+enum class Containment { Outside, Intersect, Inside };
+
+//----------------------------------------------------------------------------------------------------------------------
+// a box is outside if it is fully behind any plane, inside if fully in front of all of them
+//----------------------------------------------------------------------------------------------------------------------
+Containment testBox(const FrustumCuller::Planes &_planes, const float *_c, const float *_e)
+{
+  Containment result=Containment::Inside;
+  for(const auto &p : _planes)
+  {
+    float d=p[0]*_c[0]+p[1]*_c[1]+p[2]*_c[2]+p[3];
+    float r=std::abs(p[0])*_e[0]+std::abs(p[1])*_e[1]+std::abs(p[2])*_e[2];
+    if(d+r<0.0f)
+      return Containment::Outside;
+    if(d-r<0.0f)
+      result=Containment::Intersect;
+  }
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// the object kernels append the ids of the visible boxes in [_begin,_end) to _out, the SIMD
+// ones return where they stopped so the scalar version can do the tail
+//----------------------------------------------------------------------------------------------------------------------
+void cullScalar(const FrustumCuller::Planes &_planes, const std::array<const float *,3> &_c, const std::array<const float *,3> &_e,
+                const uint32_t *_ids, size_t _begin, size_t _end, std::vector<uint32_t> &_out)
+{
+  for(size_t i=_begin; i<_end; ++i)
+  {
+    bool visible=true;
+    for(const auto &p : _planes)
+    {
+      float d=p[0]*_c[0][i]+p[1]*_c[1][i]+p[2]*_c[2][i]+p[3];
+      float r=std::abs(p[0])*_e[0][i]+std::abs(p[1])*_e[1][i]+std::abs(p[2])*_e[2][i];
+      if(d+r<0.0f)
+      {
+        visible=false;
+        break;
+      }
+    }
+    if(visible)
+      _out.push_back(_ids[i]);
+  }
+}
+
+#ifdef FRUSTUMCULLER_X86
+__attribute__((target("sse2")))
+size_t cullSSE(const FrustumCuller::Planes &_planes, const std::array<const float *,3> &_c, const std::array<const float *,3> &_e,
+               const uint32_t *_ids, size_t _n, std::vector<uint32_t> &_out)
+{
+  __m128 plane[6][4];
+  __m128 absNormal[6][3];
+  for(int p=0; p<6; ++p)
+  {
+    for(int k=0; k<4; ++k)
+      plane[p][k]=_mm_set1_ps(_planes[p][k]);
+    for(int k=0; k<3; ++k)
+      absNormal[p][k]=_mm_set1_ps(std::abs(_planes[p][k]));
+  }
+  __m128 zero=_mm_setzero_ps();
+  size_t i=0;
+  for(; i+4<=_n; i+=4)
+  {
+    __m128 cx=_mm_loadu_ps(_c[0]+i);
+    __m128 cy=_mm_loadu_ps(_c[1]+i);
+    __m128 cz=_mm_loadu_ps(_c[2]+i);
+    __m128 ex=_mm_loadu_ps(_e[0]+i);
+    __m128 ey=_mm_loadu_ps(_e[1]+i);
+    __m128 ez=_mm_loadu_ps(_e[2]+i);
+    __m128 visible=_mm_castsi128_ps(_mm_set1_epi32(-1));
+    for(int p=0; p<6; ++p)
+    {
+      __m128 d=_mm_add_ps(_mm_add_ps(_mm_mul_ps(plane[p][0],cx),_mm_mul_ps(plane[p][1],cy)),
+                          _mm_add_ps(_mm_mul_ps(plane[p][2],cz),plane[p][3]));
+      __m128 r=_mm_add_ps(_mm_add_ps(_mm_mul_ps(absNormal[p][0],ex),_mm_mul_ps(absNormal[p][1],ey)),
+                          _mm_mul_ps(absNormal[p][2],ez));
+      visible=_mm_and_ps(visible,_mm_cmpge_ps(_mm_add_ps(d,r),zero));
+    }
+    int mask=_mm_movemask_ps(visible);
+    for(int b=0; b<4; ++b)
+      if(mask & (1<<b))
+        _out.push_back(_ids[i+b]);
+  }
+  return i;
+}
+
+__attribute__((target("avx2,fma")))
+size_t cullAVX2(const FrustumCuller::Planes &_planes, const std::array<const float *,3> &_c, const std::array<const float *,3> &_e,
+                const uint32_t *_ids, size_t _n, std::vector<uint32_t> &_out)
+{
+  __m256 plane[6][4];
+  __m256 absNormal[6][3];
+  for(int p=0; p<6; ++p)
+  {
+    for(int k=0; k<4; ++k)
+      plane[p][k]=_mm256_set1_ps(_planes[p][k]);
+    for(int k=0; k<3; ++k)
+      absNormal[p][k]=_mm256_set1_ps(std::abs(_planes[p][k]));
+  }
+  __m256 zero=_mm256_setzero_ps();
+  size_t i=0;
+  for(; i+8<=_n; i+=8)
+  {
+    __m256 cx=_mm256_loadu_ps(_c[0]+i);
+    __m256 cy=_mm256_loadu_ps(_c[1]+i);
+    __m256 cz=_mm256_loadu_ps(_c[2]+i);
+    __m256 ex=_mm256_loadu_ps(_e[0]+i);
+    __m256 ey=_mm256_loadu_ps(_e[1]+i);
+    __m256 ez=_mm256_loadu_ps(_e[2]+i);
+    __m256 visible=_mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for(int p=0; p<6; ++p)
+    {
+      // d + r = n.c + w + |n|.e
+      __m256 v=_mm256_fmadd_ps(plane[p][0],cx,plane[p][3]);
+      v=_mm256_fmadd_ps(plane[p][1],cy,v);
+      v=_mm256_fmadd_ps(plane[p][2],cz,v);
+      v=_mm256_fmadd_ps(absNormal[p][0],ex,v);
+      v=_mm256_fmadd_ps(absNormal[p][1],ey,v);
+      v=_mm256_fmadd_ps(absNormal[p][2],ez,v);
+      visible=_mm256_and_ps(visible,_mm256_cmp_ps(v,zero,_CMP_GE_OQ));
+    }
+    int mask=_mm256_movemask_ps(visible);
+    while(mask)
+    {
+      int b=__builtin_ctz(static_cast<unsigned int>(mask));
+      _out.push_back(_ids[i+b]);
+      mask&=mask-1;
+    }
+  }
+  return i;
+}
+#endif
+
+} // end anon namespace
+
+FrustumCuller::FrustumCuller(float _cellSize) :
+  m_cellSize(std::max(_cellSize,0.001f))
+{
+}
+
+void FrustumCuller::clear()
+{
+  m_min.clear();
+  m_max.clear();
+  m_dirty=true;
+}
+
+uint32_t FrustumCuller::addObject(const ngl::Vec3 &_min, const ngl::Vec3 &_max)
+{
+  m_min.push_back(_min);
+  m_max.push_back(_max);
+  m_dirty=true;
+  return static_cast<uint32_t>(m_min.size()-1);
+}
+
+FrustumCuller::Planes FrustumCuller::extractPlanes(const ngl::Mat4 &_VP)
+{
+  // m_openGL is column major so row r is m[r], m[4+r], m[8+r], m[12+r]
+  const float *m=&_VP.m_openGL[0];
+  auto row=[m](int _r, int _k) { return m[_k*4+_r]; };
+  Planes planes;
+  for(int axis=0; axis<3; ++axis)
+  {
+    for(int k=0; k<4; ++k)
+    {
+      planes[axis*2][k]=row(3,k)+row(axis,k);
+      planes[axis*2+1][k]=row(3,k)-row(axis,k);
+    }
+  }
+  for(auto &p : planes)
+  {
+    float len=std::sqrt(p[0]*p[0]+p[1]*p[1]+p[2]*p[2]);
+    if(len>0.0f)
+    {
+      for(auto &v : p)
+        v/=len;
+    }
+  }
+  return planes;
+}
+
+void FrustumCuller::build()
+{
+  size_t count=m_min.size();
+  m_cells.clear();
+  for(int k=0; k<3; ++k)
+  {
+    m_centre[k].resize(count);
+    m_extent[k].resize(count);
+  }
+  m_ids.resize(count);
+  m_dirty=false;
+  if(count==0)
+    return;
+
+  // grid bounds are over the box centres, each object lives in exactly one cell
+  std::vector<ngl::Vec3> centres(count);
+  ngl::Vec3 lo=(m_min[0]+m_max[0])*0.5f;
+  ngl::Vec3 hi=lo;
+  for(size_t i=0; i<count; ++i)
+  {
+    centres[i]=(m_min[i]+m_max[i])*0.5f;
+    lo.set(std::min(lo.m_x,centres[i].m_x),std::min(lo.m_y,centres[i].m_y),std::min(lo.m_z,centres[i].m_z));
+    hi.set(std::max(hi.m_x,centres[i].m_x),std::max(hi.m_y,centres[i].m_y),std::max(hi.m_z,centres[i].m_z));
+  }
+  // keep the cell count sensible for very sparse scenes by growing the cells
+  float cellSize=m_cellSize;
+  std::array<size_t,3> dims;
+  for(;;)
+  {
+    dims={{static_cast<size_t>((hi.m_x-lo.m_x)/cellSize)+1,
+           static_cast<size_t>((hi.m_y-lo.m_y)/cellSize)+1,
+           static_cast<size_t>((hi.m_z-lo.m_z)/cellSize)+1}};
+    if(dims[0]*dims[1]*dims[2]<=std::max<size_t>(count,4096))
+      break;
+    cellSize*=2.0f;
+  }
+  std::vector<uint32_t> cellOf(count);
+  std::vector<uint32_t> offsets(dims[0]*dims[1]*dims[2]+1,0);
+  for(size_t i=0; i<count; ++i)
+  {
+    size_t x=std::min(dims[0]-1,static_cast<size_t>((centres[i].m_x-lo.m_x)/cellSize));
+    size_t y=std::min(dims[1]-1,static_cast<size_t>((centres[i].m_y-lo.m_y)/cellSize));
+    size_t z=std::min(dims[2]-1,static_cast<size_t>((centres[i].m_z-lo.m_z)/cellSize));
+    cellOf[i]=static_cast<uint32_t>((z*dims[1]+y)*dims[0]+x);
+    ++offsets[cellOf[i]+1];
+  }
+  for(size_t c=1; c<offsets.size(); ++c)
+    offsets[c]+=offsets[c-1];
+  // counting sort into cell order
+  std::vector<uint32_t> cursor(offsets.begin(),offsets.end()-1);
+  for(size_t i=0; i<count; ++i)
+  {
+    uint32_t dst=cursor[cellOf[i]]++;
+    m_ids[dst]=static_cast<uint32_t>(i);
+    const ngl::Vec3 &mn=m_min[i];
+    const ngl::Vec3 &mx=m_max[i];
+    m_centre[0][dst]=centres[i].m_x;
+    m_centre[1][dst]=centres[i].m_y;
+    m_centre[2][dst]=centres[i].m_z;
+    m_extent[0][dst]=(mx.m_x-mn.m_x)*0.5f;
+    m_extent[1][dst]=(mx.m_y-mn.m_y)*0.5f;
+    m_extent[2][dst]=(mx.m_z-mn.m_z)*0.5f;
+  }
+  // cell bounds are the union of their objects' bounds as objects can hang over the cell edge
+  for(size_t c=0; c+1<offsets.size(); ++c)
+  {
+    if(offsets[c]==offsets[c+1])
+      continue;
+    Cell cell;
+    cell.first=offsets[c];
+    cell.count=offsets[c+1]-offsets[c];
+    float cmin[3];
+    float cmax[3];
+    for(int k=0; k<3; ++k)
+    {
+      cmin[k]=m_centre[k][cell.first]-m_extent[k][cell.first];
+      cmax[k]=m_centre[k][cell.first]+m_extent[k][cell.first];
+      for(uint32_t i=cell.first+1; i<cell.first+cell.count; ++i)
+      {
+        cmin[k]=std::min(cmin[k],m_centre[k][i]-m_extent[k][i]);
+        cmax[k]=std::max(cmax[k],m_centre[k][i]+m_extent[k][i]);
+      }
+      cell.centre[k]=(cmin[k]+cmax[k])*0.5f;
+      cell.extent[k]=(cmax[k]-cmin[k])*0.5f;
+    }
+    m_cells.push_back(cell);
+  }
+}
+
+const std::vector<uint32_t> &FrustumCuller::cull(const ngl::Mat4 &_VP, SimdPath _path)
+{
+  auto start=std::chrono::high_resolution_clock::now();
+  if(m_dirty)
+    build();
+  if(_path==SimdPath::Auto || !BatchTransform::isSupported(_path))
+    _path=BatchTransform::bestPath();
+  Planes planes=extractPlanes(_VP);
+  m_visible.clear();
+  m_stats=Stats();
+  m_stats.total=m_ids.size();
+  for(const auto &cell : m_cells)
+  {
+    ++m_stats.cellsTested;
+    Containment c=testBox(planes,cell.centre,cell.extent);
+    if(c==Containment::Outside)
+      continue;
+    const uint32_t *ids=&m_ids[cell.first];
+    if(c==Containment::Inside)
+    {
+      m_visible.insert(m_visible.end(),ids,ids+cell.count);
+      continue;
+    }
+    m_stats.objectsTested+=cell.count;
+    std::array<const float *,3> centre={{&m_centre[0][cell.first],&m_centre[1][cell.first],&m_centre[2][cell.first]}};
+    std::array<const float *,3> extent={{&m_extent[0][cell.first],&m_extent[1][cell.first],&m_extent[2][cell.first]}};
+    size_t done=0;
+#ifdef FRUSTUMCULLER_X86
+    // there is no AVX-512 kernel, cells are rarely big enough to fill 16 lanes
+    if(_path==SimdPath::AVX2 || _path==SimdPath::AVX512)
+      done=cullAVX2(planes,centre,extent,ids,cell.count,m_visible);
+    else if(_path==SimdPath::SSE)
+      done=cullSSE(planes,centre,extent,ids,cell.count,m_visible);
+#endif
+    cullScalar(planes,centre,extent,ids,done,cell.count,m_visible);
+  }
+  m_stats.visible=m_visible.size();
+  m_stats.cullMs=std::chrono::duration<float,std::milli>(std::chrono::high_resolution_clock::now()-start).count();
+  return m_visible;
+}
@@ -0,0 +1,220 @@
+#include "InputSession.h"
+#include <ngl/Util.h>
+#include <Qt>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+  const char *c_header="# mvp input session 1";
+  const InputSession::EventType c_types[]={InputSession::EventType::Frame,InputSession::EventType::Key,
+                                           InputSession::EventType::MousePress,InputSession::EventType::MouseMove,
+                                           InputSession::EventType::MouseRelease,InputSession::EventType::Wheel};
+}
+
+bool InputSession::start(const std::string &_fname)
+{
+  stop();
+  m_file.open(_fname.c_str());
+  if(!m_file.is_open())
+  {
+    std::cerr<<"InputSession unable to open "<<_fname<<'\n';
+    return false;
+  }
+  m_file<<c_header<<'\n'<<std::fixed<<std::setprecision(3);
+  m_start=Clock::now();
+  std::cout<<"recording input to "<<_fname<<'\n';
+  return true;
+}
+
+void InputSession::stop()
+{
+  if(!m_file.is_open())
+    return;
+  m_file.close();
+  std::cout<<"input recording stopped\n";
+}
+
+void InputSession::toggle(const std::string &_fname)
+{
+  if(isRecording())
+    stop();
+  else
+    start(_fname);
+}
+
+void InputSession::record(EventType _type, uint64_t _frame, int _code, int _buttons, int _x, int _y)
+{
+  if(!m_file.is_open())
+    return;
+  double ms=std::chrono::duration<double,std::milli>(Clock::now()-m_start).count();
+  m_file<<ms<<' '<<_frame<<' '<<typeName(_type)<<' '<<_code<<' '<<_buttons<<' '<<_x<<' '<<_y<<'\n';
+}
+
+bool InputSession::load(const std::string &_fname)
+{
+  std::ifstream file(_fname.c_str());
+  if(!file.is_open())
+  {
+    std::cerr<<"InputSession unable to open "<<_fname<<'\n';
+    return false;
+  }
+  m_events.clear();
+  std::string text;
+  int lineNumber=0;
+  while(std::getline(file,text))
+  {
+    ++lineNumber;
+    text=text.substr(0,text.find('#'));
+    std::istringstream line(text);
+    Event event;
+    std::string type;
+    if(!(line>>event.ms))
+      continue;
+    bool found=false;
+    if(line>>event.frame>>type>>event.code>>event.buttons>>event.x>>event.y)
+      for(auto t : c_types)
+        if(type==typeName(t))
+        {
+          event.type=t;
+          found=true;
+        }
+    if(!found)
+    {
+      std::cerr<<_fname<<':'<<lineNumber<<" bad event \""<<text<<"\"\n";
+      return false;
+    }
+    m_events.push_back(event);
+  }
+  return true;
+}
+
+size_t InputSession::frameCount() const
+{
+  size_t frames=0;
+  for(const auto &e : m_events)
+    frames+=e.type==EventType::Frame ? 1 : 0;
+  return frames;
+}
+
+const char *InputSession::typeName(EventType _type)
+{
+  switch(_type)
+  {
+    case EventType::Frame : return "frame";
+    case EventType::Key : return "key";
+    case EventType::MousePress : return "press";
+    case EventType::MouseMove : return "move";
+    case EventType::MouseRelease : return "release";
+    case EventType::Wheel : return "wheel";
+  }
+  return "unknown";
+}
+
+bool InputSession::applyTransformKey(TransformState &_transform, int _key, float _aspect)
+{
+  switch (_key)
+  {
+  // position
+  case Qt::Key_Up : _transform.translate(0.0f,0.1f,0.0f); break;
+  case Qt::Key_Down : _transform.translate(0.0f,-0.1f,0.0f); break;
+  case Qt::Key_Left : _transform.translate(-0.1f,0.0f,0.0f); break;
+  case Qt::Key_Right : _transform.translate(0.1f,0.0f,0.0f); break;
+  case Qt::Key_I : _transform.translate(0.0f,0.0f,-0.1f); break;
+  case Qt::Key_O : _transform.translate(0.0f,0.0f,0.1f); break;
+
+  case Qt::Key_1 : _transform.rotate(2.0f,0.0f,0.0f); break;
+  case Qt::Key_2 : _transform.rotate(-2.0f,0.0f,0.0f); break;
+  case Qt::Key_3 : _transform.rotate(0.0f,2.0f,0.0f); break;
+  case Qt::Key_4 : _transform.rotate(0.0f,-2.0f,0.0f); break;
+  case Qt::Key_5 : _transform.rotate(0.0f,0.0f,2.0f); break;
+  case Qt::Key_6 : _transform.rotate(0.0f,0.0f,-2.0f); break;
+
+
+  case Qt::Key_8 : _transform.scale(0.1f,0.0f,0.0f); break;
+  case Qt::Key_9 : _transform.scale(0.0f,0.1f,0.0f); break;
+  case Qt::Key_0 : _transform.scale(0.0f,0.0f,0.1f); break;
+  case Qt::Key_Minus : _transform.scale(-0.1f,0.0f,0.0f); break;
+  case Qt::Key_Equal : _transform.scale(0.0f,-0.1f,0.0f); break;
+  case Qt::Key_Backspace : _transform.scale(0.0f,0.0f,-0.1f); break;
+
+
+  case Qt::Key_P :
+    _transform.setProject(ngl::perspective(35.0,_aspect,0.1f,500));
+  break;
+  case Qt::Key_M :
+    _transform.setProject(ngl::ortho(-10,10,-10,10,10,-10));
+  break;
+  case Qt::Key_V :
+    _transform.setView(ngl::lookAt(ngl::Vec3(0,0,2),ngl::Vec3(0,0,0),ngl::Vec3(0,1,0)));
+  break;
+  case Qt::Key_Space :
+    _transform.reset();
+  break;
+  default : return false;
+  }
+  return true;
+}
+
+bool InputSession::applyMouseEvent(EventType _type, int _code, int _buttons, int _x, int _y, WinParams &_win,
+                                   InputAccumulator &_input)
+{
+  switch(_type)
+  {
+  case EventType::MousePress :
+    // store where the button went down and start rotating or translating
+    if(_code==Qt::LeftButton)
+    {
+      _win.origX=_x;
+      _win.origY=_y;
+      _win.rotate=true;
+    }
+    else if(_code==Qt::RightButton)
+    {
+      _win.origXPos=_x;
+      _win.origYPos=_y;
+      _win.translate=true;
+    }
+  break;
+  case EventType::MouseRelease :
+    if(_code==Qt::LeftButton)
+      _win.rotate=false;
+    if(_code==Qt::RightButton)
+      _win.translate=false;
+  break;
+  case EventType::MouseMove :
+    // _buttons is the state during the move rather than the button that changed
+    if(_win.rotate && _buttons==Qt::LeftButton)
+    {
+      int diffx=_x-_win.origX;
+      int diffy=_y-_win.origY;
+      _input.addSpin(static_cast<int>(0.5f*diffy),static_cast<int>(0.5f*diffx));
+      _win.origX=_x;
+      _win.origY=_y;
+      return true;
+    }
+    if(_win.translate && _buttons==Qt::RightButton)
+    {
+      int diffX=_x-_win.origXPos;
+      int diffY=_y-_win.origYPos;
+      _win.origXPos=_x;
+      _win.origYPos=_y;
+      _input.addMove(INCREMENT*diffX,-INCREMENT*diffY,0.0f);
+      return true;
+    }
+  break;
+  case EventType::Wheel :
+    // the sign of the delta zooms in or out, 0 means no change
+    if(_code!=0)
+    {
+      _input.addMove(0.0f,0.0f,_code>0 ? ZOOM : -ZOOM);
+      return true;
+    }
+  break;
+  case EventType::Frame :
+  case EventType::Key :
+  break;
+  }
+  return false;
+}
@@ -0,0 +1,174 @@
+#include "InstancedRenderer.h"
+#include "TRSCompose.h"
+#include <ngl/Mat3.h>
+#include <ngl/Mat4.h>
+#include <ngl/ShaderLib.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+constexpr int InstancedRenderer::c_numRegions;
+constexpr int InstancedRenderer::c_floatsPerInstance;
+constexpr size_t InstancedRenderer::c_fillGrain;
+
+InstancedRenderer::InstancedRenderer(const ngl::Vec3 *_verts, const ngl::Vec3 *_normals, size_t _numVerts, size_t _maxInstances) :
+  m_numVerts(static_cast<GLsizei>(_numVerts)),
+  m_maxInstances(std::max<size_t>(_maxInstances,1)),
+  m_instanceCount(m_maxInstances)
+{
+  m_fences.fill(nullptr);
+  // interleave position and normal for the mesh
+  std::vector<float> mesh;
+  mesh.reserve(_numVerts*6);
+  for(size_t i=0; i<_numVerts; ++i)
+  {
+    mesh.insert(mesh.end(),{_verts[i].m_x,_verts[i].m_y,_verts[i].m_z});
+    mesh.insert(mesh.end(),{_normals[i].m_x,_normals[i].m_y,_normals[i].m_z});
+  }
+  glGenVertexArrays(1,&m_vao);
+  glBindVertexArray(m_vao);
+  glGenBuffers(1,&m_meshBuffer);
+  glBindBuffer(GL_ARRAY_BUFFER,m_meshBuffer);
+  glBufferData(GL_ARRAY_BUFFER,static_cast<GLsizeiptr>(mesh.size()*sizeof(float)),mesh.data(),GL_STATIC_DRAW);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0,3,GL_FLOAT,GL_FALSE,6*sizeof(float),reinterpret_cast<void *>(0));
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1,3,GL_FLOAT,GL_FALSE,6*sizeof(float),reinterpret_cast<void *>(3*sizeof(float)));
+
+  GLsizeiptr ringSize=static_cast<GLsizeiptr>(m_maxInstances*c_numRegions*c_floatsPerInstance*sizeof(float));
+  glGenBuffers(1,&m_instanceBuffer);
+  glBindBuffer(GL_ARRAY_BUFFER,m_instanceBuffer);
+  GLint major=0;
+  GLint minor=0;
+  glGetIntegerv(GL_MAJOR_VERSION,&major);
+  glGetIntegerv(GL_MINOR_VERSION,&minor);
+  if(major > 4 || (major==4 && minor >= 4))
+  {
+    GLbitfield flags=GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_ARRAY_BUFFER,ringSize,nullptr,flags);
+    m_mapped=static_cast<float *>(glMapBufferRange(GL_ARRAY_BUFFER,0,ringSize,flags));
+  }
+  if(m_mapped==nullptr)
+  {
+    glBufferData(GL_ARRAY_BUFFER,ringSize,nullptr,GL_STREAM_DRAW);
+    m_staging.resize(m_maxInstances*c_floatsPerInstance);
+  }
+  // mat4 takes locations 3-6 and the mat3 7-9, all advance once per instance
+  for(GLuint i=0; i<7; ++i)
+  {
+    glEnableVertexAttribArray(3+i);
+    glVertexAttribDivisor(3+i,1);
+  }
+  glBindVertexArray(0);
+}
+
+InstancedRenderer::~InstancedRenderer()
+{
+  for(auto &fence : m_fences)
+  {
+    if(fence)
+      glDeleteSync(fence);
+  }
+  if(m_mapped)
+  {
+    glBindBuffer(GL_ARRAY_BUFFER,m_instanceBuffer);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+  }
+  glDeleteBuffers(1,&m_instanceBuffer);
+  glDeleteBuffers(1,&m_meshBuffer);
+  glDeleteVertexArrays(1,&m_vao);
+}
+
+void InstancedRenderer::setInstanceCount(size_t _count)
+{
+  m_instanceCount=std::min(std::max<size_t>(_count,1),m_maxInstances);
+}
+
+void InstancedRenderer::fillInstances(const TransformState &_transform, size_t _begin, size_t _end, float *_out) const
+{
+  // instances are laid out on a grid in the xy plane, each one gets a different y rotation
+  // and a scale between 0.5 and 1.5 of the current values
+  size_t side=static_cast<size_t>(std::ceil(std::sqrt(static_cast<float>(m_instanceCount))));
+  float spacing=4.0f/side;
+  const ngl::Vec3 &pos=_transform.position();
+  const ngl::Vec3 &rot=_transform.rotation();
+  const ngl::Vec3 &scale=_transform.scaleValue();
+  // the view part of the normal matrix is the same for every instance
+  ngl::Mat3 viewNormal=_transform.view();
+  viewNormal.inverse().transpose();
+  SinCos sx=TRSCompose::angle(rot.m_x);
+  SinCos sz=TRSCompose::angle(rot.m_z);
+  for(size_t i=_begin; i<_end; ++i)
+  {
+    float sweep=static_cast<float>(i)/m_instanceCount;
+    float s=spacing*(0.5f+static_cast<float>(i%16)/15.0f);
+    // closed form T*Rx*Ry*Rz*S, only the y rotation and scale differ between instances
+    Rotation3 r=TRSCompose::rotation<EulerOrder::XYZ>(sx,TRSCompose::angle(rot.m_y+360.0f*sweep),sz);
+    ngl::Mat4 M;
+    TRSCompose::store(TRSCompose::affine(r,pos.m_x+((i%side)+0.5f)*spacing-2.0f,pos.m_y+((i/side)+0.5f)*spacing-2.0f,pos.m_z,
+                                         scale.m_x*s,scale.m_y*s,scale.m_z*s),M);
+    ngl::Mat3 modelNormal;
+    TRSCompose::store(TRSCompose::normal(r,scale.m_x*s,scale.m_y*s,scale.m_z*s),modelNormal);
+    ngl::Mat3 normalMatrix;
+    TRSCompose::multiply(viewNormal,modelNormal,normalMatrix);
+
+    float *out=_out+(i-_begin)*c_floatsPerInstance;
+    std::copy(&M.m_openGL[0],&M.m_openGL[0]+16,out);
+    for(int c=0; c<3; ++c)
+    {
+      out[16+c*4+0]=normalMatrix.m_openGL[c*3+0];
+      out[16+c*4+1]=normalMatrix.m_openGL[c*3+1];
+      out[16+c*4+2]=normalMatrix.m_openGL[c*3+2];
+      out[16+c*4+3]=0.0f;
+    }
+  }
+}
+
+void InstancedRenderer::waitForRegion(int _region)
+{
+  GLsync &fence=m_fences[static_cast<size_t>(_region)];
+  if(fence==nullptr)
+    return;
+  GLenum result=glClientWaitSync(fence,0,0);
+  while(result==GL_TIMEOUT_EXPIRED)
+    result=glClientWaitSync(fence,GL_SYNC_FLUSH_COMMANDS_BIT,1000000);
+  glDeleteSync(fence);
+  fence=nullptr;
+}
+
+void InstancedRenderer::draw(const TransformState &_transform, JobSystem &_jobs)
+{
+  size_t regionFloats=m_maxInstances*c_floatsPerInstance;
+  waitForRegion(m_region);
+  float *dest=m_mapped ? m_mapped+m_region*regionFloats : m_staging.data();
+
+  auto start=std::chrono::high_resolution_clock::now();
+  _jobs.wait(_jobs.parallelFor("instance fill",m_instanceCount,c_fillGrain,[this,&_transform,dest](size_t _begin, size_t _end)
+  {
+    fillInstances(_transform,_begin,_end,dest+_begin*c_floatsPerInstance);
+  }));
+  m_fillTime=std::chrono::duration<float,std::milli>(std::chrono::high_resolution_clock::now()-start).count();
+
+  glBindVertexArray(m_vao);
+  glBindBuffer(GL_ARRAY_BUFFER,m_instanceBuffer);
+  size_t regionOffset=m_region*regionFloats*sizeof(float);
+  if(m_mapped==nullptr)
+    glBufferSubData(GL_ARRAY_BUFFER,static_cast<GLintptr>(regionOffset),
+                    static_cast<GLsizeiptr>(m_instanceCount*c_floatsPerInstance*sizeof(float)),dest);
+  // point the instance attributes at this frame's region
+  GLsizei stride=c_floatsPerInstance*sizeof(float);
+  for(GLuint i=0; i<4; ++i)
+    glVertexAttribPointer(3+i,4,GL_FLOAT,GL_FALSE,stride,reinterpret_cast<void *>(regionOffset+i*4*sizeof(float)));
+  for(GLuint i=0; i<3; ++i)
+    glVertexAttribPointer(7+i,3,GL_FLOAT,GL_FALSE,stride,reinterpret_cast<void *>(regionOffset+(16+i*4)*sizeof(float)));
+
+  ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+  (*shader)["PhongInstanced"]->use();
+  shader->setUniform("V",_transform.view());
+  shader->setUniform("VP",_transform.project()*_transform.view());
+  glDrawArraysInstanced(GL_TRIANGLES,0,m_numVerts,static_cast<GLsizei>(m_instanceCount));
+  glBindVertexArray(0);
+
+  m_fences[static_cast<size_t>(m_region)]=glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE,0);
+  m_region=(m_region+1)%c_numRegions;
+}
@@ -0,0 +1,244 @@
+#include "JobSystem.h"
+#include <algorithm>
+
+namespace
+{
+  // which JobSystem (if any) the current thread is a worker of, and its queue
+  thread_local const JobSystem *t_system=nullptr;
+  thread_local unsigned int t_index=0;
+}
+
+JobSystem::JobSystem(unsigned int _numThreads) :
+  m_queues(_numThreads==0 ? std::max(1u,std::thread::hardware_concurrency()) : _numThreads)
+{
+  m_frameStart=std::chrono::high_resolution_clock::now();
+  // queue 0 belongs to the owning thread, the rest to the workers
+  for(unsigned int i=1; i<m_queues.size(); ++i)
+    m_workers.emplace_back(&JobSystem::workerLoop,this,i);
+}
+
+JobSystem::~JobSystem()
+{
+  waitAll();
+  {
+    std::lock_guard<std::mutex> lock(m_wakeLock);
+    m_quit=true;
+  }
+  m_wake.notify_all();
+  for(auto &w : m_workers)
+    w.join();
+}
+
+unsigned int JobSystem::currentIndex() const
+{
+  return t_system==this ? t_index : 0;
+}
+
+void JobSystem::beginFrame()
+{
+  waitAll();
+  m_tasks.clear();
+  m_steals=0;
+  m_frameStart=std::chrono::high_resolution_clock::now();
+}
+
+JobSystem::TaskId JobSystem::add(const char *_name, std::function<void()> _func, std::initializer_list<TaskId> _deps)
+{
+  return add(_name,std::move(_func),std::vector<TaskId>(_deps));
+}
+
+JobSystem::TaskId JobSystem::add(const char *_name, std::function<void()> _func, const std::vector<TaskId> &_deps)
+{
+  m_tasks.emplace_back();
+  Task &task=m_tasks.back();
+  TaskId id=m_tasks.size()-1;
+  task.name=_name;
+  task.func=std::move(_func);
+  ++m_outstanding;
+  // pending starts at one so the task can't be scheduled while we register the dependencies
+  for(auto dep : _deps)
+  {
+    Task &parent=m_tasks[dep];
+    std::lock_guard<std::mutex> lock(parent.lock);
+    if(!parent.done)
+    {
+      parent.successors.push_back(&task);
+      ++task.pending;
+    }
+  }
+  if(--task.pending==0)
+    push(&task,currentIndex());
+  return id;
+}
+
+std::vector<JobSystem::TaskId> JobSystem::parallelFor(const char *_name, size_t _count, size_t _grain,
+                                                      std::function<void(size_t,size_t)> _func, std::initializer_list<TaskId> _deps)
+{
+  std::vector<TaskId> ids;
+  _grain=std::max<size_t>(_grain,1);
+  std::vector<TaskId> deps(_deps);
+  for(size_t begin=0; begin<_count; begin+=_grain)
+  {
+    size_t end=std::min(_count,begin+_grain);
+    ids.push_back(add(_name,[_func,begin,end](){ _func(begin,end); },deps));
+  }
+  return ids;
+}
+
+void JobSystem::push(Task *_task, unsigned int _queue)
+{
+  {
+    WorkQueue &queue=m_queues[_queue];
+    std::lock_guard<std::mutex> lock(queue.lock);
+    queue.tasks.push_back(_task);
+  }
+  ++m_ready;
+  // take the lock so a worker can't miss the wake between checking m_ready and sleeping
+  {
+    std::lock_guard<std::mutex> lock(m_wakeLock);
+  }
+  m_wake.notify_one();
+}
+
+JobSystem::Task *JobSystem::pop(unsigned int _index)
+{
+  // newest work from our own queue first as it is most likely to be in cache
+  {
+    WorkQueue &queue=m_queues[_index];
+    std::lock_guard<std::mutex> lock(queue.lock);
+    if(!queue.tasks.empty())
+    {
+      Task *task=queue.tasks.back();
+      queue.tasks.pop_back();
+      --m_ready;
+      return task;
+    }
+  }
+  // then steal the oldest work from everyone else
+  size_t count=m_queues.size();
+  for(size_t i=1; i<count; ++i)
+  {
+    WorkQueue &queue=m_queues[(_index+i)%count];
+    std::lock_guard<std::mutex> lock(queue.lock);
+    if(!queue.tasks.empty())
+    {
+      Task *task=queue.tasks.front();
+      queue.tasks.pop_front();
+      --m_ready;
+      ++m_steals;
+      return task;
+    }
+  }
+  return nullptr;
+}
+
+void JobSystem::execute(Task *_task, unsigned int _index)
+{
+  _task->thread=_index;
+  _task->start=std::chrono::high_resolution_clock::now();
+  _task->func();
+  _task->end=std::chrono::high_resolution_clock::now();
+  std::vector<Task *> successors;
+  {
+    std::lock_guard<std::mutex> lock(_task->lock);
+    _task->done=true;
+    successors.swap(_task->successors);
+  }
+  for(auto s : successors)
+  {
+    if(--s->pending==0)
+      push(s,_index);
+  }
+  _task->finished.store(true,std::memory_order_release);
+  if(--m_outstanding==0)
+  {
+    std::lock_guard<std::mutex> lock(m_wakeLock);
+    m_wake.notify_all();
+  }
+}
+
+bool JobSystem::runOne()
+{
+  unsigned int index=currentIndex();
+  Task *task=pop(index);
+  if(task==nullptr)
+    return false;
+  execute(task,index);
+  return true;
+}
+
+void JobSystem::workerLoop(unsigned int _index)
+{
+  t_system=this;
+  t_index=_index;
+  for(;;)
+  {
+    Task *task=pop(_index);
+    if(task!=nullptr)
+    {
+      execute(task,_index);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(m_wakeLock);
+    m_wake.wait(lock,[this](){ return m_quit || m_ready > 0; });
+    if(m_quit)
+      return;
+  }
+}
+
+void JobSystem::wait(TaskId _task)
+{
+  const Task &task=m_tasks[_task];
+  while(!task.finished.load(std::memory_order_acquire))
+  {
+    if(!runOne())
+      std::this_thread::yield();
+  }
+}
+
+void JobSystem::wait(const std::vector<TaskId> &_tasks)
+{
+  for(auto t : _tasks)
+    wait(t);
+}
+
+void JobSystem::waitAll()
+{
+  while(m_outstanding > 0)
+  {
+    if(!runOne())
+      std::this_thread::yield();
+  }
+}
+
+std::vector<JobSystem::TaskTiming> JobSystem::timings() const
+{
+  std::vector<TaskTiming> out;
+  out.reserve(m_tasks.size());
+  for(const auto &task : m_tasks)
+  {
+    if(!task.finished.load(std::memory_order_acquire))
+      continue;
+    TaskTiming t;
+    t.name=task.name;
+    t.thread=task.thread;
+    t.startMs=std::chrono::duration<float,std::milli>(task.start-m_frameStart).count();
+    t.durationMs=std::chrono::duration<float,std::milli>(task.end-task.start).count();
+    out.push_back(t);
+  }
+  return out;
+}
+
+JobSystem::Stats JobSystem::frameStats() const
+{
+  Stats stats;
+  for(const auto &task : m_tasks)
+  {
+    if(!task.finished.load(std::memory_order_acquire))
+      continue;
+    ++stats.tasks;
+    stats.busyMs+=std::chrono::duration<float,std::milli>(task.end-task.start).count();
+  }
+  stats.steals=m_steals;
+  return stats;
+}
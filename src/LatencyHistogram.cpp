@@ -0,0 +1,57 @@
+#include "LatencyHistogram.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <ostream>
+#include <string>
+
+constexpr float LatencyHistogram::c_bucketMs;
+constexpr int LatencyHistogram::c_numBuckets;
+
+void LatencyHistogram::add(float _ms)
+{
+  _ms=std::max(_ms,0.0f);
+  int bucket=std::min(static_cast<int>(_ms/c_bucketMs),c_numBuckets-1);
+  ++m_buckets[static_cast<size_t>(bucket)];
+  m_min=m_count ? std::min(m_min,_ms) : _ms;
+  m_max=std::max(m_max,_ms);
+  m_sum+=_ms;
+  ++m_count;
+}
+
+void LatencyHistogram::reset()
+{
+  *this=LatencyHistogram();
+}
+
+float LatencyHistogram::percentile(float _p) const
+{
+  if(m_count==0)
+    return 0.0f;
+  size_t target=static_cast<size_t>(std::ceil(std::min(std::max(_p,0.0f),1.0f)*m_count));
+  size_t seen=0;
+  for(int i=0; i<c_numBuckets; ++i)
+  {
+    seen+=m_buckets[static_cast<size_t>(i)];
+    if(seen>=target && seen>0)
+      return i==c_numBuckets-1 ? m_max : (i+1)*c_bucketMs;
+  }
+  return m_max;
+}
+
+void LatencyHistogram::print(std::ostream &_out) const
+{
+  _out<<"latency samples "<<m_count<<" min "<<minMs()<<" mean "<<meanMs()<<" p50 "<<percentile(0.5f)
+      <<" p90 "<<percentile(0.9f)<<" p99 "<<percentile(0.99f)<<" max "<<m_max<<" ms\n";
+  size_t largest=*std::max_element(m_buckets.begin(),m_buckets.end());
+  if(largest==0)
+    return;
+  for(int i=0; i<c_numBuckets; ++i)
+  {
+    size_t n=m_buckets[static_cast<size_t>(i)];
+    if(n==0)
+      continue;
+    _out<<std::setw(6)<<i*c_bucketMs<<(i==c_numBuckets-1 ? "+ ms " : "   ms ")<<std::setw(7)<<n<<' '
+        <<std::string(std::max<size_t>(1,n*50/largest),'#')<<'\n';
+  }
+}
@@ -0,0 +1,110 @@
+#include "MappedMesh.h"
+#include <iostream>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #define MAPPEDMESH_MMAP
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#else
+  #include <fstream>
+#endif
+
+MappedMesh::~MappedMesh()
+{
+  close();
+}
+
+bool MappedMesh::open(const std::string &_fname)
+{
+  close();
+#ifdef MAPPEDMESH_MMAP
+  int fd=::open(_fname.c_str(),O_RDONLY);
+  if(fd<0)
+  {
+    std::cerr<<"MappedMesh unable to open "<<_fname<<'\n';
+    return false;
+  }
+  struct stat info;
+  if(fstat(fd,&info)!=0 || info.st_size<static_cast<off_t>(sizeof(meshfile::MeshFileHeader)))
+  {
+    std::cerr<<"MappedMesh "<<_fname<<" is too small to be a mesh\n";
+    ::close(fd);
+    return false;
+  }
+  m_size=static_cast<size_t>(info.st_size);
+  void *data=mmap(nullptr,m_size,PROT_READ,MAP_PRIVATE,fd,0);
+  // the mapping keeps the file alive
+  ::close(fd);
+  if(data==MAP_FAILED)
+  {
+    std::cerr<<"MappedMesh unable to map "<<_fname<<'\n';
+    m_size=0;
+    return false;
+  }
+  m_data=static_cast<const unsigned char *>(data);
+#else
+  std::ifstream file(_fname.c_str(),std::ios::binary | std::ios::ate);
+  if(!file.is_open() || file.tellg()<static_cast<std::streamoff>(sizeof(meshfile::MeshFileHeader)))
+  {
+    std::cerr<<"MappedMesh unable to read "<<_fname<<'\n';
+    return false;
+  }
+  m_fallback.resize(static_cast<size_t>(file.tellg()));
+  file.seekg(0);
+  file.read(reinterpret_cast<char *>(m_fallback.data()),static_cast<std::streamsize>(m_fallback.size()));
+  m_size=m_fallback.size();
+  m_data=m_fallback.data();
+#endif
+
+  // check every section lies inside the file before anyone dereferences it, the sizes are
+  // compared against the gaps between offsets so a huge offset can't wrap round the sum
+  const meshfile::MeshFileHeader &h=header();
+  uint64_t vertexBytes=uint64_t(h.vertexCount)*3*sizeof(float);
+  uint64_t indexBytes=uint64_t(h.indexCount)*sizeof(uint32_t);
+  bool valid=h.magic==meshfile::c_magic &&
+             h.version==meshfile::c_version &&
+             h.fileSize==m_size &&
+             h.positionOffset%meshfile::c_sectionAlignment==0 &&
+             h.normalOffset%meshfile::c_sectionAlignment==0 &&
+             h.indexOffset%meshfile::c_sectionAlignment==0 &&
+             h.positionOffset>=sizeof(meshfile::MeshFileHeader) &&
+             h.positionOffset<=h.normalOffset &&
+             h.normalOffset<=h.indexOffset &&
+             h.indexOffset<=m_size &&
+             vertexBytes<=h.normalOffset-h.positionOffset &&
+             vertexBytes<=h.indexOffset-h.normalOffset &&
+             indexBytes<=m_size-h.indexOffset &&
+             h.indexCount%3==0;
+  if(!valid)
+  {
+    std::cerr<<"MappedMesh "<<_fname<<" is not a valid version "<<meshfile::c_version<<" mesh\n";
+    close();
+    return false;
+  }
+  // everything that reads the mesh on the cpu indexes the positions with these unchecked
+  const uint32_t *index=indices();
+  for(uint32_t i=0; i<h.indexCount; ++i)
+    if(index[i]>=h.vertexCount)
+    {
+      std::cerr<<"MappedMesh "<<_fname<<" index "<<i<<" is "<<index[i]<<" but there are only "<<h.vertexCount<<" vertices\n";
+      close();
+      return false;
+    }
+  return true;
+}
+
+void MappedMesh::close()
+{
+  if(m_data==nullptr)
+    return;
+#ifdef MAPPEDMESH_MMAP
+  munmap(const_cast<unsigned char *>(m_data),m_size);
+#else
+  m_fallback.clear();
+  m_fallback.shrink_to_fit();
+#endif
+  m_data=nullptr;
+  m_size=0;
+}
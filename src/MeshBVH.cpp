@@ -0,0 +1,578 @@
+#include "MeshBVH.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+  #define MESHBVH_X86
+  #include <immintrin.h>
+#endif
+
+constexpr int MeshBVH::c_packetWidth;
+constexpr int MeshBVH::c_bins;
+constexpr int MeshBVH::c_maxLeafPackets;
+constexpr int MeshBVH::c_maxDepth;
+
+namespace
+{
+// the cost of visiting a node relative to testing a packet, for the surface area heuristic
+constexpr float c_traversalCost=1.0f;
+constexpr int W=MeshBVH::c_packetWidth;
+
+struct Bounds
+{
+  float min[3]={std::numeric_limits<float>::max(),std::numeric_limits<float>::max(),std::numeric_limits<float>::max()};
+  float max[3]={-std::numeric_limits<float>::max(),-std::numeric_limits<float>::max(),-std::numeric_limits<float>::max()};
+  void grow(const float *_p)
+  {
+    for(int a=0; a<3; ++a)
+    {
+      min[a]=std::min(min[a],_p[a]);
+      max[a]=std::max(max[a],_p[a]);
+    }
+  }
+  // Bounds or a MeshBVH::Reference
+  template <typename B>
+  void growBounds(const B &_b)
+  {
+    grow(_b.min);
+    grow(_b.max);
+  }
+  // half the surface area, only ever compared
+  float area() const
+  {
+    float d[3]={max[0]-min[0],max[1]-min[1],max[2]-min[2]};
+    return d[0]<0.0f ? 0.0f : d[0]*d[1]+d[1]*d[2]+d[2]*d[0];
+  }
+};
+
+size_t packetsFor(size_t _triangles)
+{
+  return (_triangles+W-1)/W;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// the packet kernels test every lane, if any is hit closer than _t they update _t, _u, _v and
+// return the closest lane, otherwise -1. Zero edges (the padding) give a zero determinant
+//----------------------------------------------------------------------------------------------------------------------
+int packetScalar(const MeshBVH::Packet &_p, const MeshBVH::Ray &_r, float &_t, float &_u, float &_v)
+{
+  int lane=-1;
+  for(int i=0; i<W; ++i)
+  {
+    float e1x=_p.e1[0][i], e1y=_p.e1[1][i], e1z=_p.e1[2][i];
+    float e2x=_p.e2[0][i], e2y=_p.e2[1][i], e2z=_p.e2[2][i];
+    float px=_r.dir[1]*e2z-_r.dir[2]*e2y;
+    float py=_r.dir[2]*e2x-_r.dir[0]*e2z;
+    float pz=_r.dir[0]*e2y-_r.dir[1]*e2x;
+    float det=e1x*px+e1y*py+e1z*pz;
+    if(det==0.0f)
+      continue;
+    float inv=1.0f/det;
+    float tx=_r.origin[0]-_p.v0[0][i];
+    float ty=_r.origin[1]-_p.v0[1][i];
+    float tz=_r.origin[2]-_p.v0[2][i];
+    float u=(tx*px+ty*py+tz*pz)*inv;
+    float qx=ty*e1z-tz*e1y;
+    float qy=tz*e1x-tx*e1z;
+    float qz=tx*e1y-ty*e1x;
+    float v=(_r.dir[0]*qx+_r.dir[1]*qy+_r.dir[2]*qz)*inv;
+    float t=(e2x*qx+e2y*qy+e2z*qz)*inv;
+    if(u>=0.0f && v>=0.0f && u+v<=1.0f && t>0.0f && t<_t)
+    {
+      _t=t;
+      _u=u;
+      _v=v;
+      lane=i;
+    }
+  }
+  return lane;
+}
+
+#ifdef MESHBVH_X86
+//----------------------------------------------------------------------------------------------------------------------
+// the SIMD kernels find the lanes that pass with a mask then pick the closest of those in scalar
+//----------------------------------------------------------------------------------------------------------------------
+__attribute__((target("sse2")))
+int packetSSE(const MeshBVH::Packet &_p, const MeshBVH::Ray &_r, float &_t, float &_u, float &_v)
+{
+  const __m128 dx=_mm_set1_ps(_r.dir[0]);
+  const __m128 dy=_mm_set1_ps(_r.dir[1]);
+  const __m128 dz=_mm_set1_ps(_r.dir[2]);
+  const __m128 zero=_mm_setzero_ps();
+  const __m128 one=_mm_set1_ps(1.0f);
+  int lane=-1;
+  for(int h=0; h<W; h+=4)
+  {
+    __m128 e1x=_mm_loadu_ps(_p.e1[0]+h), e1y=_mm_loadu_ps(_p.e1[1]+h), e1z=_mm_loadu_ps(_p.e1[2]+h);
+    __m128 e2x=_mm_loadu_ps(_p.e2[0]+h), e2y=_mm_loadu_ps(_p.e2[1]+h), e2z=_mm_loadu_ps(_p.e2[2]+h);
+    __m128 px=_mm_sub_ps(_mm_mul_ps(dy,e2z),_mm_mul_ps(dz,e2y));
+    __m128 py=_mm_sub_ps(_mm_mul_ps(dz,e2x),_mm_mul_ps(dx,e2z));
+    __m128 pz=_mm_sub_ps(_mm_mul_ps(dx,e2y),_mm_mul_ps(dy,e2x));
+    __m128 det=_mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x,px),_mm_mul_ps(e1y,py)),_mm_mul_ps(e1z,pz));
+    __m128 inv=_mm_div_ps(one,det);
+    __m128 tx=_mm_sub_ps(_mm_set1_ps(_r.origin[0]),_mm_loadu_ps(_p.v0[0]+h));
+    __m128 ty=_mm_sub_ps(_mm_set1_ps(_r.origin[1]),_mm_loadu_ps(_p.v0[1]+h));
+    __m128 tz=_mm_sub_ps(_mm_set1_ps(_r.origin[2]),_mm_loadu_ps(_p.v0[2]+h));
+    __m128 u=_mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx,px),_mm_mul_ps(ty,py)),_mm_mul_ps(tz,pz)),inv);
+    __m128 qx=_mm_sub_ps(_mm_mul_ps(ty,e1z),_mm_mul_ps(tz,e1y));
+    __m128 qy=_mm_sub_ps(_mm_mul_ps(tz,e1x),_mm_mul_ps(tx,e1z));
+    __m128 qz=_mm_sub_ps(_mm_mul_ps(tx,e1y),_mm_mul_ps(ty,e1x));
+    __m128 v=_mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx,qx),_mm_mul_ps(dy,qy)),_mm_mul_ps(dz,qz)),inv);
+    __m128 t=_mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x,qx),_mm_mul_ps(e2y,qy)),_mm_mul_ps(e2z,qz)),inv);
+    __m128 mask=_mm_and_ps(_mm_cmpneq_ps(det,zero),_mm_cmpge_ps(u,zero));
+    mask=_mm_and_ps(mask,_mm_and_ps(_mm_cmpge_ps(v,zero),_mm_cmple_ps(_mm_add_ps(u,v),one)));
+    mask=_mm_and_ps(mask,_mm_and_ps(_mm_cmpgt_ps(t,zero),_mm_cmplt_ps(t,_mm_set1_ps(_t))));
+    int bits=_mm_movemask_ps(mask);
+    if(!bits)
+      continue;
+    float ts[4], us[4], vs[4];
+    _mm_storeu_ps(ts,t);
+    _mm_storeu_ps(us,u);
+    _mm_storeu_ps(vs,v);
+    for(int i=0; i<4; ++i)
+      if((bits>>i)&1 && ts[i]<_t)
+      {
+        _t=ts[i];
+        _u=us[i];
+        _v=vs[i];
+        lane=h+i;
+      }
+  }
+  return lane;
+}
+
+__attribute__((target("avx2,fma")))
+int packetAVX2(const MeshBVH::Packet &_p, const MeshBVH::Ray &_r, float &_t, float &_u, float &_v)
+{
+  static_assert(W==8,"the AVX2 kernel does a whole packet at once");
+  const __m256 dx=_mm256_set1_ps(_r.dir[0]);
+  const __m256 dy=_mm256_set1_ps(_r.dir[1]);
+  const __m256 dz=_mm256_set1_ps(_r.dir[2]);
+  const __m256 zero=_mm256_setzero_ps();
+  const __m256 one=_mm256_set1_ps(1.0f);
+  __m256 e1x=_mm256_loadu_ps(_p.e1[0]), e1y=_mm256_loadu_ps(_p.e1[1]), e1z=_mm256_loadu_ps(_p.e1[2]);
+  __m256 e2x=_mm256_loadu_ps(_p.e2[0]), e2y=_mm256_loadu_ps(_p.e2[1]), e2z=_mm256_loadu_ps(_p.e2[2]);
+  __m256 px=_mm256_fmsub_ps(dy,e2z,_mm256_mul_ps(dz,e2y));
+  __m256 py=_mm256_fmsub_ps(dz,e2x,_mm256_mul_ps(dx,e2z));
+  __m256 pz=_mm256_fmsub_ps(dx,e2y,_mm256_mul_ps(dy,e2x));
+  __m256 det=_mm256_fmadd_ps(e1z,pz,_mm256_fmadd_ps(e1y,py,_mm256_mul_ps(e1x,px)));
+  __m256 inv=_mm256_div_ps(one,det);
+  __m256 tx=_mm256_sub_ps(_mm256_set1_ps(_r.origin[0]),_mm256_loadu_ps(_p.v0[0]));
+  __m256 ty=_mm256_sub_ps(_mm256_set1_ps(_r.origin[1]),_mm256_loadu_ps(_p.v0[1]));
+  __m256 tz=_mm256_sub_ps(_mm256_set1_ps(_r.origin[2]),_mm256_loadu_ps(_p.v0[2]));
+  __m256 u=_mm256_mul_ps(_mm256_fmadd_ps(tz,pz,_mm256_fmadd_ps(ty,py,_mm256_mul_ps(tx,px))),inv);
+  __m256 qx=_mm256_fmsub_ps(ty,e1z,_mm256_mul_ps(tz,e1y));
+  __m256 qy=_mm256_fmsub_ps(tz,e1x,_mm256_mul_ps(tx,e1z));
+  __m256 qz=_mm256_fmsub_ps(tx,e1y,_mm256_mul_ps(ty,e1x));
+  __m256 v=_mm256_mul_ps(_mm256_fmadd_ps(dz,qz,_mm256_fmadd_ps(dy,qy,_mm256_mul_ps(dx,qx))),inv);
+  __m256 t=_mm256_mul_ps(_mm256_fmadd_ps(e2z,qz,_mm256_fmadd_ps(e2y,qy,_mm256_mul_ps(e2x,qx))),inv);
+  __m256 mask=_mm256_and_ps(_mm256_cmp_ps(det,zero,_CMP_NEQ_OQ),_mm256_cmp_ps(u,zero,_CMP_GE_OQ));
+  mask=_mm256_and_ps(mask,_mm256_and_ps(_mm256_cmp_ps(v,zero,_CMP_GE_OQ),_mm256_cmp_ps(_mm256_add_ps(u,v),one,_CMP_LE_OQ)));
+  mask=_mm256_and_ps(mask,_mm256_and_ps(_mm256_cmp_ps(t,zero,_CMP_GT_OQ),_mm256_cmp_ps(t,_mm256_set1_ps(_t),_CMP_LT_OQ)));
+  int bits=_mm256_movemask_ps(mask);
+  if(!bits)
+    return -1;
+  float ts[8], us[8], vs[8];
+  _mm256_storeu_ps(ts,t);
+  _mm256_storeu_ps(us,u);
+  _mm256_storeu_ps(vs,v);
+  int lane=-1;
+  for(int i=0; i<8; ++i)
+    if((bits>>i)&1 && ts[i]<_t)
+    {
+      _t=ts[i];
+      _u=us[i];
+      _v=vs[i];
+      lane=i;
+    }
+  return lane;
+}
+#endif
+
+using PacketFunc=int (*)(const MeshBVH::Packet &, const MeshBVH::Ray &, float &, float &, float &);
+
+PacketFunc packetKernel(SimdPath _path)
+{
+  if(_path==SimdPath::Auto || !BatchTransform::isSupported(_path))
+    _path=BatchTransform::bestPath();
+#ifdef MESHBVH_X86
+  // there is no AVX-512 kernel, a packet is only 8 wide
+  if(_path==SimdPath::AVX2 || _path==SimdPath::AVX512)
+    return packetAVX2;
+  if(_path==SimdPath::SSE)
+    return packetSSE;
+#endif
+  return packetScalar;
+}
+
+MeshBVH::Ray makeRay(const ngl::Vec3 &_origin, const ngl::Vec3 &_dir)
+{
+  MeshBVH::Ray ray;
+  const float o[3]={_origin.m_x,_origin.m_y,_origin.m_z};
+  const float d[3]={_dir.m_x,_dir.m_y,_dir.m_z};
+  for(int a=0; a<3; ++a)
+  {
+    ray.origin[a]=o[a];
+    ray.dir[a]=d[a];
+    // a large finite value rather than inf so a box face through the origin gives 0 not NaN
+    ray.invDir[a]=std::abs(d[a])>1e-20f ? 1.0f/d[a] : std::copysign(1e20f,d[a]);
+  }
+  return ray;
+}
+
+// the entry distance of the ray in to a node, false if it misses or is further than _tMax
+template <typename N>
+bool hitBox(const N &_node, const MeshBVH::Ray &_r, float _tMax, float &_tNear)
+{
+  float tMin=0.0f;
+  for(int a=0; a<3; ++a)
+  {
+    float t0=(_node.min[a]-_r.origin[a])*_r.invDir[a];
+    float t1=(_node.max[a]-_r.origin[a])*_r.invDir[a];
+    tMin=std::max(tMin,std::min(t0,t1));
+    _tMax=std::min(_tMax,std::max(t0,t1));
+  }
+  _tNear=tMin;
+  return tMin<=_tMax;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// general 4x4 inverse by cofactors, works on either row or column major arrays
+//----------------------------------------------------------------------------------------------------------------------
+bool invert(const float *_m, float *_out)
+{
+  float inv[16];
+  inv[0]=_m[5]*_m[10]*_m[15]-_m[5]*_m[11]*_m[14]-_m[9]*_m[6]*_m[15]+_m[9]*_m[7]*_m[14]+_m[13]*_m[6]*_m[11]-_m[13]*_m[7]*_m[10];
+  inv[4]=-_m[4]*_m[10]*_m[15]+_m[4]*_m[11]*_m[14]+_m[8]*_m[6]*_m[15]-_m[8]*_m[7]*_m[14]-_m[12]*_m[6]*_m[11]+_m[12]*_m[7]*_m[10];
+  inv[8]=_m[4]*_m[9]*_m[15]-_m[4]*_m[11]*_m[13]-_m[8]*_m[5]*_m[15]+_m[8]*_m[7]*_m[13]+_m[12]*_m[5]*_m[11]-_m[12]*_m[7]*_m[9];
+  inv[12]=-_m[4]*_m[9]*_m[14]+_m[4]*_m[10]*_m[13]+_m[8]*_m[5]*_m[14]-_m[8]*_m[6]*_m[13]-_m[12]*_m[5]*_m[10]+_m[12]*_m[6]*_m[9];
+  inv[1]=-_m[1]*_m[10]*_m[15]+_m[1]*_m[11]*_m[14]+_m[9]*_m[2]*_m[15]-_m[9]*_m[3]*_m[14]-_m[13]*_m[2]*_m[11]+_m[13]*_m[3]*_m[10];
+  inv[5]=_m[0]*_m[10]*_m[15]-_m[0]*_m[11]*_m[14]-_m[8]*_m[2]*_m[15]+_m[8]*_m[3]*_m[14]+_m[12]*_m[2]*_m[11]-_m[12]*_m[3]*_m[10];
+  inv[9]=-_m[0]*_m[9]*_m[15]+_m[0]*_m[11]*_m[13]+_m[8]*_m[1]*_m[15]-_m[8]*_m[3]*_m[13]-_m[12]*_m[1]*_m[11]+_m[12]*_m[3]*_m[9];
+  inv[13]=_m[0]*_m[9]*_m[14]-_m[0]*_m[10]*_m[13]-_m[8]*_m[1]*_m[14]+_m[8]*_m[2]*_m[13]+_m[12]*_m[1]*_m[10]-_m[12]*_m[2]*_m[9];
+  inv[2]=_m[1]*_m[6]*_m[15]-_m[1]*_m[7]*_m[14]-_m[5]*_m[2]*_m[15]+_m[5]*_m[3]*_m[14]+_m[13]*_m[2]*_m[7]-_m[13]*_m[3]*_m[6];
+  inv[6]=-_m[0]*_m[6]*_m[15]+_m[0]*_m[7]*_m[14]+_m[4]*_m[2]*_m[15]-_m[4]*_m[3]*_m[14]-_m[12]*_m[2]*_m[7]+_m[12]*_m[3]*_m[6];
+  inv[10]=_m[0]*_m[5]*_m[15]-_m[0]*_m[7]*_m[13]-_m[4]*_m[1]*_m[15]+_m[4]*_m[3]*_m[13]+_m[12]*_m[1]*_m[7]-_m[12]*_m[3]*_m[5];
+  inv[14]=-_m[0]*_m[5]*_m[14]+_m[0]*_m[6]*_m[13]+_m[4]*_m[1]*_m[14]-_m[4]*_m[2]*_m[13]-_m[12]*_m[1]*_m[6]+_m[12]*_m[2]*_m[5];
+  inv[3]=-_m[1]*_m[6]*_m[11]+_m[1]*_m[7]*_m[10]+_m[5]*_m[2]*_m[11]-_m[5]*_m[3]*_m[10]-_m[9]*_m[2]*_m[7]+_m[9]*_m[3]*_m[6];
+  inv[7]=_m[0]*_m[6]*_m[11]-_m[0]*_m[7]*_m[10]-_m[4]*_m[2]*_m[11]+_m[4]*_m[3]*_m[10]+_m[8]*_m[2]*_m[7]-_m[8]*_m[3]*_m[6];
+  inv[11]=-_m[0]*_m[5]*_m[11]+_m[0]*_m[7]*_m[9]+_m[4]*_m[1]*_m[11]-_m[4]*_m[3]*_m[9]-_m[8]*_m[1]*_m[7]+_m[8]*_m[3]*_m[5];
+  inv[15]=_m[0]*_m[5]*_m[10]-_m[0]*_m[6]*_m[9]-_m[4]*_m[1]*_m[10]+_m[4]*_m[2]*_m[9]+_m[8]*_m[1]*_m[6]-_m[8]*_m[2]*_m[5];
+  float det=_m[0]*inv[0]+_m[1]*inv[4]+_m[2]*inv[8]+_m[3]*inv[12];
+  if(det==0.0f)
+    return false;
+  det=1.0f/det;
+  for(int i=0; i<16; ++i)
+    _out[i]=inv[i]*det;
+  return true;
+}
+
+// _m column major, w divided out
+void transformPoint(const float *_m, float _x, float _y, float _z, float *_out)
+{
+  float p[4];
+  for(int r=0; r<4; ++r)
+    p[r]=_m[r]*_x+_m[4+r]*_y+_m[8+r]*_z+_m[12+r];
+  for(int r=0; r<3; ++r)
+    _out[r]=p[r]/p[3];
+}
+} // end anon namespace
+
+MeshBVH::MeshBVH(const float *_positions, size_t _numVerts, const uint32_t *_indices, size_t _numIndices)
+{
+  auto start=std::chrono::high_resolution_clock::now();
+  size_t numTris=_numIndices/3;
+  m_stats.triangles=numTris;
+  if(numTris==0 || _numVerts==0)
+    return;
+  // the bounds of every triangle, the builder only looks at these and sorts them in place so
+  // each node's triangles are contiguous
+  std::vector<Reference> refs(numTris);
+  for(size_t t=0; t<numTris; ++t)
+  {
+    Bounds b;
+    for(int k=0; k<3; ++k)
+      b.grow(_positions+3*_indices[3*t+k]);
+    std::copy(b.min,b.min+3,refs[t].min);
+    std::copy(b.max,b.max+3,refs[t].max);
+    refs[t].triangle=static_cast<uint32_t>(t);
+  }
+
+  struct Task
+  {
+    uint32_t node;
+    size_t begin;
+    size_t end;
+    int depth;
+  };
+  m_nodes.reserve(2*packetsFor(numTris));
+  m_nodes.push_back(Node());
+  std::vector<Task> tasks={{0,0,numTris,0}};
+  while(!tasks.empty())
+  {
+    Task task=tasks.back();
+    tasks.pop_back();
+    m_stats.depth=std::max(m_stats.depth,task.depth);
+    Bounds bounds;
+    Bounds centroidBounds;
+    for(size_t i=task.begin; i<task.end; ++i)
+    {
+      bounds.growBounds(refs[i]);
+      float c[3];
+      refs[i].centroid(c);
+      centroidBounds.grow(c);
+    }
+    Node &node=m_nodes[task.node];
+    std::copy(bounds.min,bounds.min+3,node.min);
+    std::copy(bounds.max,bounds.max+3,node.max);
+    size_t count=task.end-task.begin;
+    size_t packets=packetsFor(count);
+    if(count<=static_cast<size_t>(W) || task.depth>=c_maxDepth)
+    {
+      makePackets(node,&refs[task.begin],count,_positions,_indices);
+      continue;
+    }
+
+    // bin the centroids on all three axes in one pass over the triangles then sweep the bins of
+    // each axis from both ends for the split costs
+    float scale[3];
+    for(int a=0; a<3; ++a)
+    {
+      float extent=centroidBounds.max[a]-centroidBounds.min[a];
+      scale[a]=extent>0.0f ? c_bins/extent : 0.0f;
+    }
+    Bounds binBounds[3][c_bins];
+    size_t binCount[3][c_bins]={};
+    for(size_t i=task.begin; i<task.end; ++i)
+      for(int a=0; a<3; ++a)
+      {
+        int b=std::min(c_bins-1,static_cast<int>((refs[i].centre(a)-centroidBounds.min[a])*scale[a]));
+        binBounds[a][b].growBounds(refs[i]);
+        ++binCount[a][b];
+      }
+    float bestCost=std::numeric_limits<float>::max();
+    int bestAxis=-1;
+    int bestSplit=0;
+    float parentArea=std::max(bounds.area(),std::numeric_limits<float>::min());
+    for(int a=0; a<3; ++a)
+    {
+      if(scale[a]==0.0f)
+        continue;
+      float rightArea[c_bins];
+      size_t rightCount[c_bins];
+      Bounds right;
+      size_t n=0;
+      for(int b=c_bins-1; b>0; --b)
+      {
+        right.growBounds(binBounds[a][b]);
+        n+=binCount[a][b];
+        rightArea[b]=right.area();
+        rightCount[b]=n;
+      }
+      Bounds left;
+      n=0;
+      for(int b=1; b<c_bins; ++b)
+      {
+        left.growBounds(binBounds[a][b-1]);
+        n+=binCount[a][b-1];
+        if(n==0 || rightCount[b]==0)
+          continue;
+        float cost=c_traversalCost+(left.area()*packetsFor(n)+rightArea[b]*packetsFor(rightCount[b]))/parentArea;
+        if(cost<bestCost)
+        {
+          bestCost=cost;
+          bestAxis=a;
+          bestSplit=b;
+        }
+      }
+    }
+
+    size_t mid=task.begin+count/2;
+    if(bestAxis<0)
+    {
+      // every centroid is in the same place, a big enough leaf is split anywhere
+      if(packets<=static_cast<size_t>(c_maxLeafPackets))
+      {
+        makePackets(node,&refs[task.begin],count,_positions,_indices);
+        continue;
+      }
+    }
+    else
+    {
+      if(bestCost>=static_cast<float>(packets) && packets<=static_cast<size_t>(c_maxLeafPackets))
+      {
+        makePackets(node,&refs[task.begin],count,_positions,_indices);
+        continue;
+      }
+      float scale=c_bins/(centroidBounds.max[bestAxis]-centroidBounds.min[bestAxis]);
+      float cmin=centroidBounds.min[bestAxis];
+      auto it=std::partition(refs.begin()+static_cast<std::ptrdiff_t>(task.begin),refs.begin()+static_cast<std::ptrdiff_t>(task.end),
+                             [&](const Reference &_r)
+      {
+        return std::min(c_bins-1,static_cast<int>((_r.centre(bestAxis)-cmin)*scale))<bestSplit;
+      });
+      mid=static_cast<size_t>(it-refs.begin());
+    }
+    // the children are next to each other so a node only needs the first
+    uint32_t left=static_cast<uint32_t>(m_nodes.size());
+    node.first=left;
+    node.count=0;
+    m_nodes.push_back(Node());
+    m_nodes.push_back(Node());
+    tasks.push_back({left+1,mid,task.end,task.depth+1});
+    tasks.push_back({left,task.begin,mid,task.depth+1});
+  }
+  m_nodes.shrink_to_fit();
+  m_packets.shrink_to_fit();
+  m_stats.nodes=m_nodes.size();
+  m_stats.packets=m_packets.size();
+  m_stats.bytes=m_nodes.size()*sizeof(Node)+m_packets.size()*sizeof(Packet);
+  m_stats.buildMs=std::chrono::duration<float,std::milli>(std::chrono::high_resolution_clock::now()-start).count();
+}
+
+void MeshBVH::makePackets(Node &_node, const Reference *_refs, size_t _count, const float *_positions, const uint32_t *_indices)
+{
+  _node.first=static_cast<uint32_t>(m_packets.size());
+  _node.count=static_cast<uint32_t>(packetsFor(_count));
+  ++m_stats.leaves;
+  for(size_t i=0; i<_count; i+=W)
+  {
+    Packet packet={};
+    for(int lane=0; lane<W; ++lane)
+    {
+      packet.triangle[lane]=std::numeric_limits<uint32_t>::max();
+      if(i+lane>=_count)
+        continue;
+      uint32_t t=_refs[i+lane].triangle;
+      const float *p0=_positions+3*_indices[3*t];
+      const float *p1=_positions+3*_indices[3*t+1];
+      const float *p2=_positions+3*_indices[3*t+2];
+      for(int a=0; a<3; ++a)
+      {
+        packet.v0[a][lane]=p0[a];
+        packet.e1[a][lane]=p1[a]-p0[a];
+        packet.e2[a][lane]=p2[a]-p0[a];
+      }
+      packet.triangle[lane]=t;
+    }
+    m_packets.push_back(packet);
+  }
+}
+
+MeshBVH::Hit MeshBVH::intersect(const ngl::Vec3 &_origin, const ngl::Vec3 &_dir, SimdPath _path) const
+{
+  Hit hit;
+  if(m_nodes.empty())
+    return hit;
+  PacketFunc test=packetKernel(_path);
+  Ray ray=makeRay(_origin,_dir);
+  float best=std::numeric_limits<float>::max();
+  float tNear;
+  if(!hitBox(m_nodes[0],ray,best,tNear))
+    return hit;
+  const Packet *bestPacket=nullptr;
+  int bestLane=-1;
+  // each interior node on the way down pushes at most one child
+  uint32_t stack[c_maxDepth+1];
+  float stackNear[c_maxDepth+1];
+  int size=0;
+  uint32_t current=0;
+  for(;;)
+  {
+    ++hit.nodesVisited;
+    const Node &node=m_nodes[current];
+    if(node.count)
+    {
+      for(uint32_t p=node.first; p<node.first+node.count; ++p)
+      {
+        ++hit.packetsTested;
+        int lane=test(m_packets[p],ray,best,hit.u,hit.v);
+        if(lane>=0)
+        {
+          bestPacket=&m_packets[p];
+          bestLane=lane;
+        }
+      }
+    }
+    else
+    {
+      float nearLeft, nearRight;
+      bool left=hitBox(m_nodes[node.first],ray,best,nearLeft);
+      bool right=hitBox(m_nodes[node.first+1],ray,best,nearRight);
+      if(left && right)
+      {
+        bool leftFirst=nearLeft<=nearRight;
+        stack[size]=leftFirst ? node.first+1 : node.first;
+        stackNear[size++]=leftFirst ? nearRight : nearLeft;
+        current=leftFirst ? node.first : node.first+1;
+        continue;
+      }
+      if(left || right)
+      {
+        current=left ? node.first : node.first+1;
+        continue;
+      }
+    }
+    // anything found since a node was pushed may now be closer than it
+    while(size>0 && stackNear[size-1]>best)
+      --size;
+    if(size==0)
+      break;
+    current=stack[--size];
+  }
+  if(bestPacket)
+  {
+    hit.hit=true;
+    hit.triangle=bestPacket->triangle[bestLane];
+    hit.distance=best;
+    const float *v0[3]={bestPacket->v0[0],bestPacket->v0[1],bestPacket->v0[2]};
+    float p[3];
+    for(int a=0; a<3; ++a)
+      p[a]=v0[a][bestLane]+hit.u*bestPacket->e1[a][bestLane]+hit.v*bestPacket->e2[a][bestLane];
+    hit.position.set(p[0],p[1],p[2]);
+  }
+  return hit;
+}
+
+MeshBVH::Hit MeshBVH::intersectAll(const ngl::Vec3 &_origin, const ngl::Vec3 &_dir, SimdPath _path) const
+{
+  Hit hit;
+  PacketFunc test=packetKernel(_path);
+  Ray ray=makeRay(_origin,_dir);
+  float best=std::numeric_limits<float>::max();
+  for(const auto &packet : m_packets)
+  {
+    ++hit.packetsTested;
+    int lane=test(packet,ray,best,hit.u,hit.v);
+    if(lane>=0)
+    {
+      hit.hit=true;
+      hit.triangle=packet.triangle[lane];
+      hit.position.set(packet.v0[0][lane]+hit.u*packet.e1[0][lane]+hit.v*packet.e2[0][lane],
+                       packet.v0[1][lane]+hit.u*packet.e1[1][lane]+hit.v*packet.e2[1][lane],
+                       packet.v0[2][lane]+hit.u*packet.e1[2][lane]+hit.v*packet.e2[2][lane]);
+    }
+  }
+  hit.distance=hit.hit ? best : 0.0f;
+  return hit;
+}
+
+bool MeshBVH::unproject(const ngl::Mat4 &_MVP, float _ndcX, float _ndcY, ngl::Vec3 &_origin, ngl::Vec3 &_dir)
+{
+  float inv[16];
+  if(!invert(_MVP.m_openGL,inv))
+    return false;
+  float nearPoint[3];
+  float farPoint[3];
+  transformPoint(inv,_ndcX,_ndcY,-1.0f,nearPoint);
+  transformPoint(inv,_ndcX,_ndcY,1.0f,farPoint);
+  float d[3]={farPoint[0]-nearPoint[0],farPoint[1]-nearPoint[1],farPoint[2]-nearPoint[2]};
+  float length=std::sqrt(d[0]*d[0]+d[1]*d[1]+d[2]*d[2]);
+  if(!(length>0.0f))
+    return false;
+  _origin.set(nearPoint[0],nearPoint[1],nearPoint[2]);
+  _dir.set(d[0]/length,d[1]/length,d[2]/length);
+  return true;
+}
@@ -0,0 +1,553 @@
+#include "MeshImport.h"
+#include "MeshFormat.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <unordered_map>
+
+namespace
+{
+bool readFile(const std::string &_fname, std::string &_out)
+{
+  std::ifstream file(_fname.c_str(),std::ios::binary | std::ios::ate);
+  if(!file.is_open())
+  {
+    std::cerr<<"unable to open "<<_fname<<'\n';
+    return false;
+  }
+  _out.resize(static_cast<size_t>(file.tellg()));
+  file.seekg(0);
+  file.read(&_out[0],static_cast<std::streamsize>(_out.size()));
+  return true;
+}
+
+bool endsWith(const std::string &_s, const char *_suffix)
+{
+  size_t n=std::strlen(_suffix);
+  if(_s.size()<n)
+    return false;
+  for(size_t i=0; i<n; ++i)
+    if(std::tolower(static_cast<unsigned char>(_s[_s.size()-n+i]))!=_suffix[i])
+      return false;
+  return true;
+}
+
+const char *skipSpace(const char *_p)
+{
+  while(*_p==' ' || *_p=='\t')
+    ++_p;
+  return _p;
+}
+
+const char *nextLine(const char *_p)
+{
+  while(*_p!='\0' && *_p!='\n')
+    ++_p;
+  return *_p=='\n' ? _p+1 : _p;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// obj indices are 1 based and negative ones count back from the end
+//----------------------------------------------------------------------------------------------------------------------
+long resolveIndex(long _index, size_t _count)
+{
+  return _index<0 ? static_cast<long>(_count)+_index : _index-1;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// ply scalar types
+//----------------------------------------------------------------------------------------------------------------------
+enum class PlyType { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64, Invalid };
+
+PlyType plyType(const std::string &_name)
+{
+  if(_name=="char" || _name=="int8") return PlyType::Int8;
+  if(_name=="uchar" || _name=="uint8") return PlyType::UInt8;
+  if(_name=="short" || _name=="int16") return PlyType::Int16;
+  if(_name=="ushort" || _name=="uint16") return PlyType::UInt16;
+  if(_name=="int" || _name=="int32") return PlyType::Int32;
+  if(_name=="uint" || _name=="uint32") return PlyType::UInt32;
+  if(_name=="float" || _name=="float32") return PlyType::Float32;
+  if(_name=="double" || _name=="float64") return PlyType::Float64;
+  return PlyType::Invalid;
+}
+
+size_t plySize(PlyType _type)
+{
+  switch(_type)
+  {
+    case PlyType::Int8 : case PlyType::UInt8 : return 1;
+    case PlyType::Int16 : case PlyType::UInt16 : return 2;
+    case PlyType::Int32 : case PlyType::UInt32 : case PlyType::Float32 : return 4;
+    case PlyType::Float64 : return 8;
+    default : return 0;
+  }
+}
+
+template <typename T>
+double readAs(const char *_p)
+{
+  T v;
+  std::memcpy(&v,_p,sizeof(T));
+  return static_cast<double>(v);
+}
+
+double readBinary(PlyType _type, const char *_p)
+{
+  switch(_type)
+  {
+    case PlyType::Int8 : return readAs<int8_t>(_p);
+    case PlyType::UInt8 : return readAs<uint8_t>(_p);
+    case PlyType::Int16 : return readAs<int16_t>(_p);
+    case PlyType::UInt16 : return readAs<uint16_t>(_p);
+    case PlyType::Int32 : return readAs<int32_t>(_p);
+    case PlyType::UInt32 : return readAs<uint32_t>(_p);
+    case PlyType::Float32 : return readAs<float>(_p);
+    case PlyType::Float64 : return readAs<double>(_p);
+    default : return 0.0;
+  }
+}
+
+struct PlyProperty
+{
+  std::string name;
+  PlyType type;
+  bool isList=false;
+  PlyType countType=PlyType::Invalid;
+};
+
+struct PlyElement
+{
+  std::string name;
+  size_t count=0;
+  std::vector<PlyProperty> properties;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+// reads values in order from either the ascii or binary body
+//----------------------------------------------------------------------------------------------------------------------
+class PlyReader
+{
+  public :
+    PlyReader(const char *_p, const char *_end, bool _binary) : m_p(_p), m_end(_end), m_binary(_binary) {}
+    bool read(PlyType _type, double &_value)
+    {
+      if(m_binary)
+      {
+        size_t size=plySize(_type);
+        if(m_p+size>m_end)
+          return false;
+        _value=readBinary(_type,m_p);
+        m_p+=size;
+        return true;
+      }
+      while(m_p<m_end && std::isspace(static_cast<unsigned char>(*m_p)))
+        ++m_p;
+      if(m_p>=m_end)
+        return false;
+      char *next=nullptr;
+      _value=std::strtod(m_p,&next);
+      if(next==m_p)
+        return false;
+      m_p=next;
+      return true;
+    }
+  private :
+    const char *m_p;
+    const char *m_end;
+    bool m_binary;
+};
+} // end anon namespace
+
+namespace meshfile
+{
+
+bool loadOBJ(const std::string &_fname, MeshData &_mesh)
+{
+  std::string text;
+  if(!readFile(_fname,text))
+    return false;
+  _mesh=MeshData();
+  std::vector<float> v;
+  std::vector<float> vn;
+  // a vertex is a unique position / normal pair
+  std::unordered_map<uint64_t,uint32_t> vertexMap;
+  bool missingNormals=false;
+  std::vector<uint32_t> polygon;
+  const char *p=text.c_str();
+  while(*p!='\0')
+  {
+    p=skipSpace(p);
+    if(p[0]=='v' && (p[1]==' ' || p[1]=='\t'))
+    {
+      char *end=nullptr;
+      const char *q=p+2;
+      for(int i=0; i<3; ++i)
+      {
+        v.push_back(std::strtof(q,&end));
+        q=end;
+      }
+    }
+    else if(p[0]=='v' && p[1]=='n' && (p[2]==' ' || p[2]=='\t'))
+    {
+      char *end=nullptr;
+      const char *q=p+3;
+      for(int i=0; i<3; ++i)
+      {
+        vn.push_back(std::strtof(q,&end));
+        q=end;
+      }
+    }
+    else if(p[0]=='f' && (p[1]==' ' || p[1]=='\t'))
+    {
+      polygon.clear();
+      const char *q=skipSpace(p+2);
+      while(*q!='\0' && *q!='\n' && *q!='\r')
+      {
+        char *end=nullptr;
+        long vi=resolveIndex(std::strtol(q,&end,10),v.size()/3);
+        if(end==q)
+          break;
+        q=end;
+        long ni=-1;
+        if(*q=='/')
+        {
+          ++q;
+          // skip the texture coordinate
+          if(*q!='/')
+          {
+            std::strtol(q,&end,10);
+            q=end;
+          }
+          if(*q=='/')
+          {
+            ++q;
+            ni=resolveIndex(std::strtol(q,&end,10),vn.size()/3);
+            q=end;
+          }
+        }
+        if(vi<0 || static_cast<size_t>(vi)>=v.size()/3)
+        {
+          std::cerr<<_fname<<" face index out of range\n";
+          return false;
+        }
+        if(ni>=0 && static_cast<size_t>(ni)>=vn.size()/3)
+          ni=-1;
+        if(ni<0)
+          missingNormals=true;
+        uint64_t key=(static_cast<uint64_t>(vi)<<32) | static_cast<uint32_t>(ni);
+        auto found=vertexMap.find(key);
+        if(found==vertexMap.end())
+        {
+          uint32_t index=static_cast<uint32_t>(_mesh.vertexCount());
+          found=vertexMap.emplace(key,index).first;
+          _mesh.positions.insert(_mesh.positions.end(),&v[vi*3],&v[vi*3]+3);
+          if(ni>=0)
+            _mesh.normals.insert(_mesh.normals.end(),&vn[ni*3],&vn[ni*3]+3);
+          else
+            _mesh.normals.insert(_mesh.normals.end(),{0.0f,0.0f,0.0f});
+        }
+        polygon.push_back(found->second);
+        q=skipSpace(q);
+      }
+      for(size_t i=2; i<polygon.size(); ++i)
+        _mesh.indices.insert(_mesh.indices.end(),{polygon[0],polygon[i-1],polygon[i]});
+    }
+    p=nextLine(p);
+  }
+  if(_mesh.indices.empty())
+  {
+    std::cerr<<_fname<<" has no faces\n";
+    return false;
+  }
+  if(missingNormals)
+    computeNormals(_mesh);
+  return true;
+}
+
+bool loadPLY(const std::string &_fname, MeshData &_mesh)
+{
+  std::string text;
+  if(!readFile(_fname,text))
+    return false;
+  _mesh=MeshData();
+  size_t headerEnd=text.find("end_header");
+  if(text.compare(0,3,"ply")!=0 || headerEnd==std::string::npos)
+  {
+    std::cerr<<_fname<<" is not a ply file\n";
+    return false;
+  }
+  std::istringstream header(text.substr(0,headerEnd));
+  std::string line;
+  std::vector<PlyElement> elements;
+  bool binary=false;
+  while(std::getline(header,line))
+  {
+    std::istringstream tokens(line);
+    std::string keyword;
+    tokens>>keyword;
+    if(keyword=="format")
+    {
+      std::string format;
+      tokens>>format;
+      if(format=="binary_little_endian")
+        binary=true;
+      else if(format!="ascii")
+      {
+        std::cerr<<_fname<<" unsupported ply format "<<format<<'\n';
+        return false;
+      }
+    }
+    else if(keyword=="element")
+    {
+      PlyElement element;
+      tokens>>element.name>>element.count;
+      elements.push_back(element);
+    }
+    else if(keyword=="property" && !elements.empty())
+    {
+      PlyProperty property;
+      std::string type;
+      tokens>>type;
+      if(type=="list")
+      {
+        std::string countType;
+        tokens>>countType>>type;
+        property.isList=true;
+        property.countType=plyType(countType);
+      }
+      property.type=plyType(type);
+      tokens>>property.name;
+      if(property.type==PlyType::Invalid || (property.isList && property.countType==PlyType::Invalid))
+      {
+        std::cerr<<_fname<<" unsupported ply property "<<line<<'\n';
+        return false;
+      }
+      elements.back().properties.push_back(property);
+    }
+  }
+  // the body starts on the line after end_header
+  size_t bodyStart=text.find('\n',headerEnd);
+  if(bodyStart==std::string::npos)
+    bodyStart=text.size();
+  else
+    ++bodyStart;
+  PlyReader reader(text.data()+bodyStart,text.data()+text.size(),binary);
+
+  bool hasNormals=false;
+  std::vector<uint32_t> polygon;
+  for(const auto &element : elements)
+  {
+    bool isVertex=element.name=="vertex";
+    bool isFace=element.name=="face";
+    // map the vertex properties we care about to x,y,z,nx,ny,nz slots
+    std::vector<int> slot(element.properties.size(),-1);
+    if(isVertex)
+    {
+      const char *names[]={"x","y","z","nx","ny","nz"};
+      for(size_t i=0; i<element.properties.size(); ++i)
+        for(int s=0; s<6; ++s)
+          if(element.properties[i].name==names[s])
+            slot[i]=s;
+      hasNormals=std::count(slot.begin(),slot.end(),3)+std::count(slot.begin(),slot.end(),4)+std::count(slot.begin(),slot.end(),5)==3;
+      _mesh.positions.reserve(element.count*3);
+      _mesh.normals.reserve(element.count*3);
+    }
+    for(size_t e=0; e<element.count; ++e)
+    {
+      float values[6]={0.0f,0.0f,0.0f,0.0f,0.0f,0.0f};
+      for(size_t i=0; i<element.properties.size(); ++i)
+      {
+        const PlyProperty &property=element.properties[i];
+        double value;
+        if(!property.isList)
+        {
+          if(!reader.read(property.type,value))
+          {
+            std::cerr<<_fname<<" truncated ply body\n";
+            return false;
+          }
+          if(slot[i]>=0)
+            values[slot[i]]=static_cast<float>(value);
+          continue;
+        }
+        double count;
+        if(!reader.read(property.countType,count))
+        {
+          std::cerr<<_fname<<" truncated ply body\n";
+          return false;
+        }
+        bool indices=isFace && (property.name=="vertex_indices" || property.name=="vertex_index");
+        polygon.clear();
+        for(size_t c=0; c<static_cast<size_t>(count); ++c)
+        {
+          if(!reader.read(property.type,value))
+          {
+            std::cerr<<_fname<<" truncated ply body\n";
+            return false;
+          }
+          polygon.push_back(static_cast<uint32_t>(value));
+        }
+        if(indices)
+        {
+          for(size_t c=2; c<polygon.size(); ++c)
+            _mesh.indices.insert(_mesh.indices.end(),{polygon[0],polygon[c-1],polygon[c]});
+        }
+      }
+      if(isVertex)
+      {
+        _mesh.positions.insert(_mesh.positions.end(),values,values+3);
+        _mesh.normals.insert(_mesh.normals.end(),values+3,values+6);
+      }
+    }
+  }
+  size_t vertexCount=_mesh.vertexCount();
+  if(_mesh.indices.empty() ||
+     std::any_of(_mesh.indices.begin(),_mesh.indices.end(),[vertexCount](uint32_t _i){ return _i>=vertexCount; }))
+  {
+    std::cerr<<_fname<<" has no faces or a face index out of range\n";
+    return false;
+  }
+  if(!hasNormals)
+    computeNormals(_mesh);
+  return true;
+}
+
+bool loadText(const std::string &_fname, MeshData &_mesh)
+{
+  if(endsWith(_fname,".obj"))
+    return loadOBJ(_fname,_mesh);
+  if(endsWith(_fname,".ply"))
+    return loadPLY(_fname,_mesh);
+  std::cerr<<_fname<<" is not an obj or ply file\n";
+  return false;
+}
+
+void computeNormals(MeshData &_mesh)
+{
+  const std::vector<float> &p=_mesh.positions;
+  std::vector<float> &n=_mesh.normals;
+  n.assign(p.size(),0.0f);
+  for(size_t t=0; t+2<_mesh.indices.size(); t+=3)
+  {
+    const uint32_t *tri=&_mesh.indices[t];
+    float e1[3];
+    float e2[3];
+    for(int k=0; k<3; ++k)
+    {
+      e1[k]=p[tri[1]*3+k]-p[tri[0]*3+k];
+      e2[k]=p[tri[2]*3+k]-p[tri[0]*3+k];
+    }
+    // the cross product's length is twice the area so bigger faces count for more
+    float fn[3]={e1[1]*e2[2]-e1[2]*e2[1],e1[2]*e2[0]-e1[0]*e2[2],e1[0]*e2[1]-e1[1]*e2[0]};
+    for(int v=0; v<3; ++v)
+      for(int k=0; k<3; ++k)
+        n[tri[v]*3+k]+=fn[k];
+  }
+  for(size_t i=0; i<n.size(); i+=3)
+  {
+    float len=std::sqrt(n[i]*n[i]+n[i+1]*n[i+1]+n[i+2]*n[i+2]);
+    if(len>0.0f)
+    {
+      n[i]/=len;
+      n[i+1]/=len;
+      n[i+2]/=len;
+    }
+    else
+    {
+      n[i+1]=1.0f;
+    }
+  }
+}
+
+void makeSuperellipsoid(float _e1, float _e2, size_t _rings, float _radius, MeshData &_mesh)
+{
+  auto power=[](float _v, float _e){ return std::copysign(std::pow(std::abs(_v),_e),_v); };
+  _mesh=MeshData();
+  size_t segments=2*_rings;
+  for(size_t r=0; r<=_rings; ++r)
+  {
+    float theta=static_cast<float>(M_PI)*r/_rings-0.5f*static_cast<float>(M_PI);
+    for(size_t s=0; s<=segments; ++s)
+    {
+      float phi=2.0f*static_cast<float>(M_PI)*s/segments;
+      float ct=power(std::cos(theta),_e1);
+      _mesh.positions.insert(_mesh.positions.end(),{_radius*ct*power(std::cos(phi),_e2),_radius*power(std::sin(theta),_e1),
+                                                    _radius*ct*power(std::sin(phi),_e2)});
+    }
+  }
+  // the poles and the seam repeat vertices so every row is the same length
+  uint32_t row=static_cast<uint32_t>(segments+1);
+  for(uint32_t r=0; r<_rings; ++r)
+    for(uint32_t s=0; s<segments; ++s)
+    {
+      uint32_t i=r*row+s;
+      _mesh.indices.insert(_mesh.indices.end(),{i,i+row,i+1,i+1,i+row,i+row+1});
+    }
+  computeNormals(_mesh);
+}
+
+bool writeMesh(const std::string &_fname, const MeshData &_mesh)
+{
+  if(_mesh.normals.size()!=_mesh.positions.size() || _mesh.indices.size()%3!=0)
+  {
+    std::cerr<<"writeMesh needs one normal per position and whole triangles\n";
+    return false;
+  }
+  MeshFileHeader header;
+  std::memset(&header,0,sizeof(header));
+  header.magic=c_magic;
+  header.version=c_version;
+  header.vertexCount=static_cast<uint32_t>(_mesh.vertexCount());
+  header.indexCount=static_cast<uint32_t>(_mesh.indices.size());
+  for(int k=0; k<3; ++k)
+  {
+    header.boundsMin[k]=std::numeric_limits<float>::max();
+    header.boundsMax[k]=-std::numeric_limits<float>::max();
+  }
+  for(size_t i=0; i<_mesh.positions.size(); ++i)
+  {
+    header.boundsMin[i%3]=std::min(header.boundsMin[i%3],_mesh.positions[i]);
+    header.boundsMax[i%3]=std::max(header.boundsMax[i%3],_mesh.positions[i]);
+  }
+  uint64_t vertexBytes=_mesh.positions.size()*sizeof(float);
+  header.positionOffset=alignSection(sizeof(MeshFileHeader));
+  header.normalOffset=alignSection(header.positionOffset+vertexBytes);
+  header.indexOffset=alignSection(header.normalOffset+vertexBytes);
+  header.fileSize=header.indexOffset+_mesh.indices.size()*sizeof(uint32_t);
+
+  std::FILE *file=std::fopen(_fname.c_str(),"wb");
+  if(file==nullptr)
+  {
+    std::cerr<<"unable to write "<<_fname<<'\n';
+    return false;
+  }
+  const char zeros[c_sectionAlignment]={};
+  auto padTo=[file,&zeros](uint64_t _offset)
+  {
+    long pos=std::ftell(file);
+    if(pos>=0 && static_cast<uint64_t>(pos)<_offset)
+      std::fwrite(zeros,1,static_cast<size_t>(_offset-static_cast<uint64_t>(pos)),file);
+  };
+  std::fwrite(&header,sizeof(header),1,file);
+  padTo(header.positionOffset);
+  std::fwrite(_mesh.positions.data(),sizeof(float),_mesh.positions.size(),file);
+  padTo(header.normalOffset);
+  std::fwrite(_mesh.normals.data(),sizeof(float),_mesh.normals.size(),file);
+  padTo(header.indexOffset);
+  std::fwrite(_mesh.indices.data(),sizeof(uint32_t),_mesh.indices.size(),file);
+  bool ok=std::ferror(file)==0;
+  ok=std::fclose(file)==0 && ok;
+  if(!ok)
+    std::cerr<<"error writing "<<_fname<<'\n';
+  return ok;
+}
+
+} // end meshfile namespace
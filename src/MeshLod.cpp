@@ -0,0 +1,95 @@
+#include "MeshLod.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+constexpr float MeshLod::c_levelRatio;
+constexpr size_t MeshLod::c_minTriangles;
+constexpr float MeshLod::c_pixelError;
+constexpr float MeshLod::c_hysteresis;
+
+MeshLod::Chain MeshLod::simplify(const float *_positions, size_t _numVerts, const uint32_t *_indices, size_t _numIndices,
+                                 size_t _maxLevels)
+{
+  auto start=std::chrono::high_resolution_clock::now();
+  Chain chain;
+  // the bounding box centre and the furthest vertex from it are close enough to the minimal sphere
+  float lo[3]={std::numeric_limits<float>::max(),std::numeric_limits<float>::max(),std::numeric_limits<float>::max()};
+  float hi[3]={-lo[0],-lo[1],-lo[2]};
+  for(size_t i=0; i<_numVerts*3; ++i)
+  {
+    lo[i%3]=std::min(lo[i%3],_positions[i]);
+    hi[i%3]=std::max(hi[i%3],_positions[i]);
+  }
+  chain.centre.set((lo[0]+hi[0])*0.5f,(lo[1]+hi[1])*0.5f,(lo[2]+hi[2])*0.5f);
+  for(size_t i=0; i<_numVerts; ++i)
+  {
+    float dx=_positions[i*3]-chain.centre.m_x;
+    float dy=_positions[i*3+1]-chain.centre.m_y;
+    float dz=_positions[i*3+2]-chain.centre.m_z;
+    chain.radius=std::max(chain.radius,std::sqrt(dx*dx+dy*dy+dz*dz));
+  }
+
+  std::vector<size_t> targets;
+  for(size_t t=static_cast<size_t>(_numIndices/3*c_levelRatio); t>=c_minTriangles && targets.size()+1<_maxLevels;
+      t=static_cast<size_t>(t*c_levelRatio))
+    targets.push_back(t);
+  // the levels come back finest first, fewer if the mesh couldn't be reduced that far
+  chain.levels=meshfile::simplify(_positions,_numVerts,_indices,_numIndices,targets);
+  chain.buildMs=std::chrono::duration<float,std::milli>(std::chrono::high_resolution_clock::now()-start).count();
+  return chain;
+}
+
+MeshLod::MeshLod(const float *_positions, const float *_normals, size_t _numVerts,
+                 const uint32_t *_indices, size_t _numIndices, Chain _chain)
+  : m_centre(_chain.centre), m_radius(_chain.radius)
+{
+  auto start=std::chrono::high_resolution_clock::now();
+  Level source;
+  source.triangles=_numIndices/3;
+  source.mesh.reset(new PackedMesh(_positions,_normals,_numVerts,_indices,_numIndices,PackedMesh::Format::Float));
+  m_levels.push_back(std::move(source));
+  for(auto &simplified : _chain.levels)
+  {
+    Level level;
+    level.triangles=simplified.triangleCount();
+    level.error=simplified.error;
+    const meshfile::MeshData &mesh=simplified.mesh;
+    level.mesh.reset(new PackedMesh(mesh.positions.data(),mesh.normals.data(),mesh.vertexCount(),
+                                    mesh.indices.data(),mesh.indices.size(),PackedMesh::Format::Float));
+    m_levels.push_back(std::move(level));
+  }
+  m_buildMs=_chain.buildMs+std::chrono::duration<float,std::milli>(std::chrono::high_resolution_clock::now()-start).count();
+}
+
+size_t MeshLod::select(const ngl::Mat4 &_MVP, int _width, int _height)
+{
+  // clip w of the centre is the depth the sphere is seen at
+  const float *m=_MVP.m_openGL;
+  float w=m[3]*m_centre.m_x+m[7]*m_centre.m_y+m[11]*m_centre.m_z+m[15];
+  if(w<=m_radius*std::sqrt(m[3]*m[3]+m[7]*m[7]+m[11]*m[11]))
+  {
+    // the camera is inside or touching the bounds, everything is close
+    m_pixelsPerUnit=0.0f;
+    m_current=0;
+    return m_current;
+  }
+  // how far a unit step in object space moves the projection in x and y, the larger is used
+  float sx=std::sqrt(m[0]*m[0]+m[4]*m[4]+m[8]*m[8])*0.5f*_width;
+  float sy=std::sqrt(m[1]*m[1]+m[5]*m[5]+m[9]*m[9])*0.5f*_height;
+  m_pixelsPerUnit=std::max(sx,sy)/w;
+  // finer as soon as the current level shows, coarser only once the next is well under the threshold
+  while(m_current>0 && m_levels[m_current].error*m_pixelsPerUnit>c_pixelError)
+    --m_current;
+  while(m_current+1<m_levels.size() && m_levels[m_current+1].error*m_pixelsPerUnit<c_pixelError*c_hysteresis)
+    ++m_current;
+  return m_current;
+}
+
+void MeshLod::draw() const
+{
+  const PackedMesh &mesh=*m_levels[m_current].mesh;
+  mesh.setDecodeUniforms();
+  mesh.draw();
+}
@@ -0,0 +1,513 @@
+#include "MeshSimplify.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+//----------------------------------------------------------------------------------------------------------------------
+// symmetric 4x4 quadric, a b c d / e f g / h i / j, planes counts the face planes summed into it
+//----------------------------------------------------------------------------------------------------------------------
+struct Quadric
+{
+  double q[10]={};
+  double planes=0.0;
+  static Quadric plane(double _a, double _b, double _c, double _d, double _weight)
+  {
+    Quadric p;
+    double v[4]={_a,_b,_c,_d};
+    int k=0;
+    for(int i=0; i<4; ++i)
+      for(int j=i; j<4; ++j)
+        p.q[k++]=_weight*v[i]*v[j];
+    return p;
+  }
+  Quadric &operator+=(const Quadric &_o)
+  {
+    for(int i=0; i<10; ++i)
+      q[i]+=_o.q[i];
+    planes+=_o.planes;
+    return *this;
+  }
+  double error(const double *_p) const
+  {
+    double x=_p[0], y=_p[1], z=_p[2];
+    return q[0]*x*x+2.0*q[1]*x*y+2.0*q[2]*x*z+2.0*q[3]*x
+          +q[4]*y*y+2.0*q[5]*y*z+2.0*q[6]*y
+          +q[7]*z*z+2.0*q[8]*z
+          +q[9];
+  }
+  //----------------------------------------------------------------------------------------------------------------------
+  // the point where the gradient is zero, false if the 3x3 part is close to singular
+  //----------------------------------------------------------------------------------------------------------------------
+  bool optimum(double *_out) const
+  {
+    double a=q[0], b=q[1], c=q[2], e=q[4], f=q[5], h=q[7];
+    double det=a*(e*h-f*f)-b*(b*h-f*c)+c*(b*f-e*c);
+    if(std::abs(det)<1e-12)
+      return false;
+    double r0=-q[3], r1=-q[6], r2=-q[8];
+    _out[0]=(r0*(e*h-f*f)-b*(r1*h-f*r2)+c*(r1*f-e*r2))/det;
+    _out[1]=(a*(r1*h-f*r2)-r0*(b*h-f*c)+c*(b*r2-r1*c))/det;
+    _out[2]=(a*(e*r2-r1*f)-b*(b*r2-r1*c)+r0*(b*f-e*c))/det;
+    return true;
+  }
+};
+
+struct Candidate
+{
+  double cost;
+  double target[3];
+  uint32_t v0;
+  uint32_t v1;
+  uint32_t stamp0;
+  uint32_t stamp1;
+  bool operator>(const Candidate &_o) const { return cost>_o.cost; }
+};
+
+// open edges get a plane at right angles to their face so the border isn't eaten away
+constexpr double c_boundaryWeight=1000.0;
+// a remaining face whose normal turns further than this is treated as flipped
+constexpr double c_minNormalDot=0.2;
+
+class Simplifier
+{
+  public :
+    Simplifier(const float *_positions, size_t _numVerts, const uint32_t *_indices, size_t _numIndices)
+    {
+      weld(_positions,_numVerts,_indices,_numIndices);
+      buildQuadrics();
+      for(uint32_t f=0; f<m_faces.size(); ++f)
+        for(int k=0; k<3; ++k)
+        {
+          uint32_t a=m_faces[f][k];
+          uint32_t b=m_faces[f][(k+1)%3];
+          // each interior edge is seen from both faces, only push it once
+          if(a<b || m_boundary.count(edgeKey(a,b)))
+            push(a,b);
+        }
+    }
+
+    std::vector<meshfile::SimplifiedMesh> run(const std::vector<size_t> &_targets)
+    {
+      std::vector<meshfile::SimplifiedMesh> levels;
+      double error=0.0;
+      for(size_t target : _targets)
+      {
+        while(m_liveFaces>target && !m_heap.empty())
+        {
+          Candidate c=m_heap.top();
+          m_heap.pop();
+          if(!m_alive[c.v0] || !m_alive[c.v1] || m_stamp[c.v0]!=c.stamp0 || m_stamp[c.v1]!=c.stamp1)
+            continue;
+          if(!canCollapse(c.v0,c.v1,c.target))
+            continue;
+          collapse(c.v0,c.v1,c.target);
+        }
+        if(m_liveFaces>target)
+          break;
+        // a coarser level never reports less than the one before so selection by error is monotonic
+        error=std::max(error,geometricError());
+        levels.push_back(extract(static_cast<float>(error)));
+      }
+      return levels;
+    }
+
+  private :
+    static uint64_t edgeKey(uint32_t _a, uint32_t _b)
+    {
+      return _a<_b ? (static_cast<uint64_t>(_a)<<32) | _b : (static_cast<uint64_t>(_b)<<32) | _a;
+    }
+
+    void weld(const float *_positions, size_t _numVerts, const uint32_t *_indices, size_t _numIndices)
+    {
+      struct Key
+      {
+        uint32_t bits[3];
+        bool operator==(const Key &_o) const { return std::memcmp(bits,_o.bits,sizeof(bits))==0; }
+      };
+      struct KeyHash
+      {
+        size_t operator()(const Key &_k) const
+        {
+          return (static_cast<size_t>(_k.bits[0])*73856093u) ^ (static_cast<size_t>(_k.bits[1])*19349663u) ^ (static_cast<size_t>(_k.bits[2])*83492791u);
+        }
+      };
+      std::unordered_map<Key,uint32_t,KeyHash> unique;
+      unique.reserve(_numVerts);
+      std::vector<uint32_t> remap(_numVerts);
+      for(size_t i=0; i<_numVerts; ++i)
+      {
+        Key key;
+        std::memcpy(key.bits,_positions+i*3,sizeof(key.bits));
+        auto it=unique.emplace(key,static_cast<uint32_t>(m_positions.size()));
+        if(it.second)
+          m_positions.push_back({{_positions[i*3],_positions[i*3+1],_positions[i*3+2]}});
+        remap[i]=it.first->second;
+      }
+      m_vertexFaces.resize(m_positions.size());
+      for(size_t i=0; i+2<_numIndices; i+=3)
+      {
+        std::array<uint32_t,3> f={{remap[_indices[i]],remap[_indices[i+1]],remap[_indices[i+2]]}};
+        if(f[0]==f[1] || f[1]==f[2] || f[0]==f[2])
+          continue;
+        uint32_t id=static_cast<uint32_t>(m_faces.size());
+        m_faces.push_back(f);
+        for(uint32_t v : f)
+          m_vertexFaces[v].push_back(id);
+      }
+      m_liveFaces=m_faces.size();
+      m_faceAlive.assign(m_faces.size(),true);
+      m_alive.assign(m_positions.size(),true);
+      m_stamp.assign(m_positions.size(),0);
+      m_source=m_positions;
+      m_parent.resize(m_positions.size());
+      for(uint32_t v=0; v<m_parent.size(); ++v)
+        m_parent[v]=v;
+    }
+
+    //----------------------------------------------------------------------------------------------------------------------
+    // the vertex each source vertex has been collapsed in to
+    //----------------------------------------------------------------------------------------------------------------------
+    uint32_t representative(uint32_t _v)
+    {
+      uint32_t root=_v;
+      while(m_parent[root]!=root)
+        root=m_parent[root];
+      while(m_parent[_v]!=root)
+      {
+        uint32_t next=m_parent[_v];
+        m_parent[_v]=root;
+        _v=next;
+      }
+      return root;
+    }
+
+    //----------------------------------------------------------------------------------------------------------------------
+    // the largest distance from a source vertex to the current surface in object space, each vertex
+    // is measured against the faces within two rings of the vertex it collapsed in to. The true
+    // nearest face can only be closer so this errs on the large side, and it says nothing about how
+    // far the inside of a source face has moved, only its corners
+    //----------------------------------------------------------------------------------------------------------------------
+    double geometricError()
+    {
+      double worst=0.0;
+      // the last source vertex each face was measured for, neighbouring rings share most faces
+      std::vector<uint32_t> measured(m_faces.size(),std::numeric_limits<uint32_t>::max());
+      for(uint32_t v=0; v<m_source.size(); ++v)
+      {
+        double best=std::numeric_limits<double>::max();
+        for(uint32_t f : m_vertexFaces[representative(v)])
+          if(m_faceAlive[f])
+            for(uint32_t corner : m_faces[f])
+              for(uint32_t g : m_vertexFaces[corner])
+                if(m_faceAlive[g] && measured[g]!=v)
+                {
+                  measured[g]=v;
+                  best=std::min(best,triangleDistance(m_source[v].data(),m_faces[g]));
+                }
+        if(best!=std::numeric_limits<double>::max())
+          worst=std::max(worst,best);
+      }
+      return worst;
+    }
+
+    //----------------------------------------------------------------------------------------------------------------------
+    // distance from _p to the closest point of a face, the regions of Ericson's Real-Time Collision
+    // Detection 5.1.5
+    //----------------------------------------------------------------------------------------------------------------------
+    double triangleDistance(const double *_p, const std::array<uint32_t,3> &_f) const
+    {
+      const double *a=m_positions[_f[0]].data();
+      const double *b=m_positions[_f[1]].data();
+      const double *c=m_positions[_f[2]].data();
+      auto dot=[](const double *_u, const double *_v){ return _u[0]*_v[0]+_u[1]*_v[1]+_u[2]*_v[2]; };
+      double ab[3]={b[0]-a[0],b[1]-a[1],b[2]-a[2]};
+      double ac[3]={c[0]-a[0],c[1]-a[1],c[2]-a[2]};
+      double ap[3]={_p[0]-a[0],_p[1]-a[1],_p[2]-a[2]};
+      double bp[3]={_p[0]-b[0],_p[1]-b[1],_p[2]-b[2]};
+      double cp[3]={_p[0]-c[0],_p[1]-c[1],_p[2]-c[2]};
+      double d1=dot(ab,ap), d2=dot(ac,ap);
+      double d3=dot(ab,bp), d4=dot(ac,bp);
+      double d5=dot(ab,cp), d6=dot(ac,cp);
+      double vc=d1*d4-d3*d2;
+      double vb=d5*d2-d1*d6;
+      double va=d3*d6-d5*d4;
+      // barycentric weights of the closest point on b and c
+      double v=0.0;
+      double w=0.0;
+      if(d1<=0.0 && d2<=0.0)
+        {}
+      else if(d3>=0.0 && d4<=d3)
+        v=1.0;
+      else if(d6>=0.0 && d5<=d6)
+        w=1.0;
+      else if(vc<=0.0 && d1>=0.0 && d3<=0.0)
+        v=d1/(d1-d3);
+      else if(vb<=0.0 && d2>=0.0 && d6<=0.0)
+        w=d2/(d2-d6);
+      else if(va<=0.0 && (d4-d3)>=0.0 && (d5-d6)>=0.0)
+      {
+        w=(d4-d3)/((d4-d3)+(d5-d6));
+        v=1.0-w;
+      }
+      else
+      {
+        double denom=va+vb+vc;
+        v=denom!=0.0 ? vb/denom : 0.0;
+        w=denom!=0.0 ? vc/denom : 0.0;
+      }
+      double d[3];
+      for(int k=0; k<3; ++k)
+        d[k]=_p[k]-(a[k]+v*ab[k]+w*ac[k]);
+      return std::sqrt(dot(d,d));
+    }
+
+    void faceNormal(const std::array<uint32_t,3> &_f, double *_n) const
+    {
+      const double *a=m_positions[_f[0]].data();
+      const double *b=m_positions[_f[1]].data();
+      const double *c=m_positions[_f[2]].data();
+      double e1[3]={b[0]-a[0],b[1]-a[1],b[2]-a[2]};
+      double e2[3]={c[0]-a[0],c[1]-a[1],c[2]-a[2]};
+      _n[0]=e1[1]*e2[2]-e1[2]*e2[1];
+      _n[1]=e1[2]*e2[0]-e1[0]*e2[2];
+      _n[2]=e1[0]*e2[1]-e1[1]*e2[0];
+    }
+
+    void buildQuadrics()
+    {
+      m_quadrics.assign(m_positions.size(),Quadric());
+      std::unordered_map<uint64_t,uint32_t> edgeUse;
+      edgeUse.reserve(m_faces.size()*2);
+      for(const auto &f : m_faces)
+      {
+        for(int k=0; k<3; ++k)
+          ++edgeUse[edgeKey(f[k],f[(k+1)%3])];
+        double n[3];
+        faceNormal(f,n);
+        double len=std::sqrt(n[0]*n[0]+n[1]*n[1]+n[2]*n[2]);
+        if(len==0.0)
+          continue;
+        n[0]/=len;
+        n[1]/=len;
+        n[2]/=len;
+        const double *p=m_positions[f[0]].data();
+        Quadric q=Quadric::plane(n[0],n[1],n[2],-(n[0]*p[0]+n[1]*p[1]+n[2]*p[2]),1.0);
+        q.planes=1.0;
+        for(uint32_t v : f)
+          m_quadrics[v]+=q;
+      }
+      for(const auto &f : m_faces)
+      {
+        double n[3];
+        faceNormal(f,n);
+        for(int k=0; k<3; ++k)
+        {
+          uint32_t a=f[k];
+          uint32_t b=f[(k+1)%3];
+          if(edgeUse[edgeKey(a,b)]!=1)
+            continue;
+          m_boundary.insert(edgeKey(a,b));
+          const double *pa=m_positions[a].data();
+          const double *pb=m_positions[b].data();
+          double e[3]={pb[0]-pa[0],pb[1]-pa[1],pb[2]-pa[2]};
+          // the plane through the edge at right angles to the face
+          double p[3]={e[1]*n[2]-e[2]*n[1],e[2]*n[0]-e[0]*n[2],e[0]*n[1]-e[1]*n[0]};
+          double len=std::sqrt(p[0]*p[0]+p[1]*p[1]+p[2]*p[2]);
+          if(len==0.0)
+            continue;
+          p[0]/=len;
+          p[1]/=len;
+          p[2]/=len;
+          Quadric q=Quadric::plane(p[0],p[1],p[2],-(p[0]*pa[0]+p[1]*pa[1]+p[2]*pa[2]),c_boundaryWeight);
+          m_quadrics[a]+=q;
+          m_quadrics[b]+=q;
+        }
+      }
+    }
+
+    void push(uint32_t _a, uint32_t _b)
+    {
+      Quadric q=m_quadrics[_a];
+      q+=m_quadrics[_b];
+      Candidate c;
+      c.v0=_a;
+      c.v1=_b;
+      c.stamp0=m_stamp[_a];
+      c.stamp1=m_stamp[_b];
+      if(!q.optimum(c.target))
+      {
+        // flat or linear neighbourhoods, take the best of the ends and the middle
+        const double *pa=m_positions[_a].data();
+        const double *pb=m_positions[_b].data();
+        double mid[3]={(pa[0]+pb[0])*0.5,(pa[1]+pb[1])*0.5,(pa[2]+pb[2])*0.5};
+        const double *options[3]={pa,pb,mid};
+        double best=q.error(pa);
+        std::copy(pa,pa+3,c.target);
+        for(int i=1; i<3; ++i)
+        {
+          double e=q.error(options[i]);
+          if(e<best)
+          {
+            best=e;
+            std::copy(options[i],options[i]+3,c.target);
+          }
+        }
+      }
+      // the mean squared distance to the planes, so the error doesn't grow just because more planes were merged
+      c.cost=q.error(c.target)/std::max(q.planes,1.0);
+      m_heap.push(c);
+    }
+
+    void neighbours(uint32_t _v, std::vector<uint32_t> &_out) const
+    {
+      _out.clear();
+      for(uint32_t f : m_vertexFaces[_v])
+        if(m_faceAlive[f])
+          for(uint32_t u : m_faces[f])
+            if(u!=_v)
+              _out.push_back(u);
+      std::sort(_out.begin(),_out.end());
+      _out.erase(std::unique(_out.begin(),_out.end()),_out.end());
+    }
+
+    bool canCollapse(uint32_t _v0, uint32_t _v1, const double *_target)
+    {
+      // link condition, an edge shared by two faces has exactly two common neighbours
+      neighbours(_v0,m_scratch0);
+      neighbours(_v1,m_scratch1);
+      size_t common=0;
+      for(size_t i=0, j=0; i<m_scratch0.size() && j<m_scratch1.size();)
+      {
+        if(m_scratch0[i]<m_scratch1[j])
+          ++i;
+        else if(m_scratch1[j]<m_scratch0[i])
+          ++j;
+        else
+        {
+          ++common;
+          ++i;
+          ++j;
+        }
+      }
+      if(common>2)
+        return false;
+      // none of the faces that survive may flip
+      for(uint32_t v : {_v0,_v1})
+        for(uint32_t f : m_vertexFaces[v])
+        {
+          if(!m_faceAlive[f])
+            continue;
+          const auto &face=m_faces[f];
+          bool hasBoth=(face[0]==_v0 || face[1]==_v0 || face[2]==_v0) && (face[0]==_v1 || face[1]==_v1 || face[2]==_v1);
+          if(hasBoth)
+            continue;
+          double before[3];
+          faceNormal(face,before);
+          std::array<double,3> saved=m_positions[v];
+          std::copy(_target,_target+3,m_positions[v].begin());
+          double after[3];
+          faceNormal(face,after);
+          m_positions[v]=saved;
+          double lb=std::sqrt(before[0]*before[0]+before[1]*before[1]+before[2]*before[2]);
+          double la=std::sqrt(after[0]*after[0]+after[1]*after[1]+after[2]*after[2]);
+          if(la==0.0 || lb==0.0)
+            return false;
+          if((before[0]*after[0]+before[1]*after[1]+before[2]*after[2])/(la*lb)<c_minNormalDot)
+            return false;
+        }
+      return true;
+    }
+
+    void collapse(uint32_t _v0, uint32_t _v1, const double *_target)
+    {
+      std::copy(_target,_target+3,m_positions[_v0].begin());
+      m_quadrics[_v0]+=m_quadrics[_v1];
+      for(uint32_t f : m_vertexFaces[_v1])
+      {
+        if(!m_faceAlive[f])
+          continue;
+        auto &face=m_faces[f];
+        if(face[0]==_v0 || face[1]==_v0 || face[2]==_v0)
+        {
+          m_faceAlive[f]=false;
+          --m_liveFaces;
+          continue;
+        }
+        for(auto &v : face)
+          if(v==_v1)
+            v=_v0;
+        m_vertexFaces[_v0].push_back(f);
+      }
+      auto &faces=m_vertexFaces[_v0];
+      faces.erase(std::remove_if(faces.begin(),faces.end(),[this](uint32_t _f){ return !m_faceAlive[_f]; }),faces.end());
+      m_vertexFaces[_v1].clear();
+      m_alive[_v1]=false;
+      m_parent[_v1]=_v0;
+      // only the edges around the moved vertex change cost, the stamps make their old entries stale
+      ++m_stamp[_v0];
+      ++m_stamp[_v1];
+      neighbours(_v0,m_scratch0);
+      for(uint32_t u : m_scratch0)
+        push(_v0,u);
+    }
+
+    meshfile::SimplifiedMesh extract(float _error) const
+    {
+      meshfile::SimplifiedMesh level;
+      level.error=_error;
+      std::vector<uint32_t> remap(m_positions.size(),~0u);
+      for(size_t f=0; f<m_faces.size(); ++f)
+      {
+        if(!m_faceAlive[f])
+          continue;
+        for(uint32_t v : m_faces[f])
+        {
+          if(remap[v]==~0u)
+          {
+            remap[v]=static_cast<uint32_t>(level.mesh.positions.size()/3);
+            for(int k=0; k<3; ++k)
+              level.mesh.positions.push_back(static_cast<float>(m_positions[v][k]));
+          }
+          level.mesh.indices.push_back(remap[v]);
+        }
+      }
+      meshfile::computeNormals(level.mesh);
+      return level;
+    }
+
+    std::vector<std::array<double,3>> m_positions;
+    // the welded positions before any collapse and the collapse forest over them
+    std::vector<std::array<double,3>> m_source;
+    std::vector<uint32_t> m_parent;
+    std::vector<std::array<uint32_t,3>> m_faces;
+    std::vector<std::vector<uint32_t>> m_vertexFaces;
+    std::vector<Quadric> m_quadrics;
+    std::vector<bool> m_faceAlive;
+    std::vector<bool> m_alive;
+    std::vector<uint32_t> m_stamp;
+    std::unordered_set<uint64_t> m_boundary;
+    std::priority_queue<Candidate,std::vector<Candidate>,std::greater<Candidate>> m_heap;
+    std::vector<uint32_t> m_scratch0;
+    std::vector<uint32_t> m_scratch1;
+    size_t m_liveFaces=0;
+};
+} // end anon namespace
+
+namespace meshfile
+{
+
+std::vector<SimplifiedMesh> simplify(const float *_positions, size_t _numVerts, const uint32_t *_indices,
+                                     size_t _numIndices, const std::vector<size_t> &_targets)
+{
+  Simplifier simplifier(_positions,_numVerts,_indices,_numIndices);
+  return simplifier.run(_targets);
+}
+
+}
@@ -0,0 +1,238 @@
+#include "MeshStreamer.h"
+#include "MappedMesh.h"
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QThread>
+#include <algorithm>
+#include <iostream>
+
+constexpr size_t MeshStreamer::c_chunkBytes;
+constexpr int MeshStreamer::c_maxChunksInFlight;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a GL context can only be made current on the QThread it lives in so the worker is one
+/// rather than a std::thread
+//----------------------------------------------------------------------------------------------------------------------
+class MeshStreamer::Worker : public QThread
+{
+  public :
+    explicit Worker(MeshStreamer &_streamer) : m_streamer(_streamer) {}
+  protected :
+    void run() override { m_streamer.run(); }
+  private :
+    MeshStreamer &m_streamer;
+};
+
+StreamedMesh::~StreamedMesh()
+{
+  GLuint buffers[]={m_vbo,m_ibo};
+  glDeleteBuffers(2,buffers);
+  if(m_vao)
+    glDeleteVertexArrays(1,&m_vao);
+}
+
+void StreamedMesh::draw() const
+{
+  glBindVertexArray(m_vao);
+  glDrawElements(GL_TRIANGLES,static_cast<GLsizei>(m_numIndices),GL_UNSIGNED_INT,nullptr);
+  glBindVertexArray(0);
+}
+
+MeshStreamer::MeshStreamer(QOpenGLContext *_share) :
+  m_guiThread(QThread::currentThread())
+{
+  // the surface has to be created on the gui thread, the context is then handed to the worker
+  m_surface.reset(new QOffscreenSurface);
+  m_surface->setFormat(_share->format());
+  m_surface->create();
+  m_context.reset(new QOpenGLContext);
+  m_context->setFormat(_share->format());
+  m_context->setShareContext(_share);
+  if(!m_context->create() || !m_context->shareContext())
+  {
+    std::cerr<<"MeshStreamer unable to create a shared context, meshes won't stream\n";
+    return;
+  }
+  m_worker.reset(new Worker(*this));
+  m_context->moveToThread(m_worker.get());
+  m_worker->start(QThread::LowPriority);
+  m_valid=true;
+}
+
+MeshStreamer::~MeshStreamer()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_quit=true;
+  }
+  m_requestAdded.notify_all();
+  if(m_worker)
+    m_worker->wait();
+  // anything still waiting on a fence is deleted with the render context
+  for(auto &u : m_uploaded)
+    glDeleteSync(u.fence);
+}
+
+void MeshStreamer::request(const std::string &_fname)
+{
+  if(!m_valid)
+    return;
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_requests.push_back({_fname,Clock::now()});
+  }
+  m_requestAdded.notify_one();
+}
+
+std::vector<std::unique_ptr<StreamedMesh>> MeshStreamer::poll()
+{
+  std::vector<std::unique_ptr<StreamedMesh>> ready;
+  std::lock_guard<std::mutex> lock(m_lock);
+  // in order, a later mesh isn't made resident before an earlier one
+  while(!m_uploaded.empty())
+  {
+    Uploaded &u=m_uploaded.front();
+    if(glClientWaitSync(u.fence,0,0)==GL_TIMEOUT_EXPIRED)
+      break;
+    glDeleteSync(u.fence);
+    m_bytesInFlight-=u.pendingBytes;
+    // the buffers are written, this context only needs its own vertex array pointing at them
+    StreamedMesh &mesh=*u.mesh;
+    glGenVertexArrays(1,&mesh.m_vao);
+    glBindVertexArray(mesh.m_vao);
+    glBindBuffer(GL_ARRAY_BUFFER,mesh.m_vbo);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0,3,GL_FLOAT,GL_FALSE,0,nullptr);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1,3,GL_FLOAT,GL_FALSE,0,reinterpret_cast<const void *>(mesh.m_normalOffset));
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,mesh.m_ibo);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER,0);
+
+    mesh.m_loadMs=std::chrono::duration<float,std::milli>(Clock::now()-u.requested).count();
+    m_lastMeshMs=mesh.m_loadMs;
+    m_lastMeshMBps=mesh.m_loadMs>0.0f ? mesh.m_bytes/(mesh.m_loadMs*1000.0f) : 0.0f;
+    ++m_meshesResident;
+    std::cout<<"streamed "<<mesh.m_name<<" "<<mesh.m_numVerts<<" vertices "<<mesh.m_numIndices/3<<" triangles "
+             <<mesh.m_bytes/(1024*1024)<<" MB in "<<mesh.m_loadMs<<" ms ("<<m_lastMeshMBps<<" MB/s)\n";
+    ready.push_back(std::move(u.mesh));
+    m_uploaded.pop_front();
+  }
+  return ready;
+}
+
+MeshStreamer::Stats MeshStreamer::stats() const
+{
+  Stats stats;
+  std::lock_guard<std::mutex> lock(m_lock);
+  stats.queueDepth=m_requests.size()+m_uploading+m_uploaded.size();
+  stats.bytesInFlight=m_bytesInFlight;
+  stats.bytesUploaded=m_bytesUploaded;
+  stats.meshesResident=m_meshesResident;
+  stats.lastMeshMs=m_lastMeshMs;
+  stats.lastMeshMBps=m_lastMeshMBps;
+  return stats;
+}
+
+void MeshStreamer::run()
+{
+  if(!m_context->makeCurrent(m_surface.get()))
+  {
+    std::cerr<<"MeshStreamer unable to make its context current, meshes won't stream\n";
+    m_context->moveToThread(m_guiThread);
+    return;
+  }
+  for(;;)
+  {
+    Request request;
+    {
+      std::unique_lock<std::mutex> lock(m_lock);
+      m_requestAdded.wait(lock,[this](){ return m_quit || !m_requests.empty(); });
+      if(m_quit)
+        break;
+      request=m_requests.front();
+      m_requests.pop_front();
+      m_uploading=1;
+    }
+    if(!upload(request))
+    {
+      std::cerr<<"MeshStreamer unable to stream "<<request.fname<<'\n';
+      std::lock_guard<std::mutex> lock(m_lock);
+      m_uploading=0;
+    }
+  }
+  for(auto &f : m_chunkFences)
+    glDeleteSync(f.first);
+  m_context->doneCurrent();
+  // back to the gui thread so it can be destroyed there
+  m_context->moveToThread(m_guiThread);
+}
+
+bool MeshStreamer::upload(const Request &_request)
+{
+  MappedMesh file;
+  if(!file.open(_request.fname) || file.indexCount()==0)
+    return false;
+  std::unique_ptr<StreamedMesh> mesh(new StreamedMesh);
+  mesh->m_name=_request.fname;
+  mesh->m_numVerts=file.vertexCount();
+  mesh->m_numIndices=file.indexCount();
+  mesh->m_normalOffset=file.header().normalOffset-file.header().positionOffset;
+  size_t vertexBytes=file.vertexBlockSize();
+  size_t indexBytes=file.indexCount()*sizeof(uint32_t);
+  mesh->m_bytes=vertexBytes+indexBytes;
+
+  // GL_COPY_WRITE_BUFFER as the element binding belongs to a vertex array and there isn't one here
+  GLuint buffers[2];
+  glGenBuffers(2,buffers);
+  mesh->m_vbo=buffers[0];
+  mesh->m_ibo=buffers[1];
+  glBindBuffer(GL_COPY_WRITE_BUFFER,mesh->m_vbo);
+  glBufferData(GL_COPY_WRITE_BUFFER,static_cast<GLsizeiptr>(vertexBytes),nullptr,GL_STATIC_DRAW);
+  uploadChunks(reinterpret_cast<const char *>(file.positions()),vertexBytes);
+  glBindBuffer(GL_COPY_WRITE_BUFFER,mesh->m_ibo);
+  glBufferData(GL_COPY_WRITE_BUFFER,static_cast<GLsizeiptr>(indexBytes),nullptr,GL_STATIC_DRAW);
+  uploadChunks(reinterpret_cast<const char *>(file.indices()),indexBytes);
+  glBindBuffer(GL_COPY_WRITE_BUFFER,0);
+
+  // the chunks still in flight are covered by the mesh's fence, which the render thread waits on
+  Uploaded uploaded;
+  uploaded.requested=_request.requested;
+  for(auto &f : m_chunkFences)
+  {
+    uploaded.pendingBytes+=f.second;
+    glDeleteSync(f.first);
+  }
+  m_chunkFences.clear();
+  uploaded.fence=glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE,0);
+  glFlush();
+  uploaded.mesh=std::move(mesh);
+  std::lock_guard<std::mutex> lock(m_lock);
+  m_uploaded.push_back(std::move(uploaded));
+  m_uploading=0;
+  return true;
+}
+
+void MeshStreamer::uploadChunks(const char *_data, size_t _size)
+{
+  for(size_t offset=0; offset<_size; offset+=c_chunkBytes)
+  {
+    // wait for the oldest chunk once the limit is reached, the flush makes sure it was submitted
+    if(m_chunkFences.size()>=static_cast<size_t>(c_maxChunksInFlight))
+    {
+      GLsync fence=m_chunkFences.front().first;
+      while(glClientWaitSync(fence,GL_SYNC_FLUSH_COMMANDS_BIT,1000000)==GL_TIMEOUT_EXPIRED)
+        ;
+      glDeleteSync(fence);
+      m_bytesInFlight-=m_chunkFences.front().second;
+      m_chunkFences.pop_front();
+    }
+    size_t size=std::min(c_chunkBytes,_size-offset);
+    // reading the mapping here is what pages the file in
+    glBufferSubData(GL_COPY_WRITE_BUFFER,static_cast<GLintptr>(offset),static_cast<GLsizeiptr>(size),_data+offset);
+    m_chunkFences.emplace_back(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE,0),size);
+    glFlush();
+    m_bytesInFlight+=size;
+    m_bytesUploaded+=size;
+  }
+}
@@ -2,11 +2,30 @@
 #include <QGuiApplication>
 
 #include "NGLScene.h"
+#include "SoftwareRenderer.h"
+#include "MappedMesh.h"
+#include "ShaderCache.h"
+#include "TRSCompose.h"
+#include "MeshImport.h"
 #include <ngl/NGLInit.h>
 #include <ngl/NGLStream.h>
 #include <ngl/VAOPrimitives.h>
 #include <ngl/ShaderLib.h>
 #include <ngl/MultiBufferVAO.h>
+#include <ngl/SimpleIndexVAO.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+// posted by requestFrame so a frame can be asked for from any thread
+const QEvent::Type c_frameRequestEvent=static_cast<QEvent::Type>(QEvent::registerEventType());
+} // end anon namespace
 
 const  std::array<ngl::Vec3,3> NGLScene::s_triVerts=
       {{
@@ -19,11 +38,97 @@ const  std::array<ngl::Vec3,3> NGLScene::s_triVerts=
 NGLScene::NGLScene()
 {
   setTitle("MVP Matrices");
-  m_view.identity();
-  m_project.identity();
-  m_scale.set(1.0,1.0,1.0);
   m_wireframe=false;
- 
+  // keep a SoA copy of the triangle for the batch transform
+  m_triBatch.resize(s_triVerts.size());
+  for(size_t i=0; i<s_triVerts.size(); ++i)
+  {
+    m_triBatch.x[i]=s_triVerts[i].m_x;
+    m_triBatch.y[i]=s_triVerts[i].m_y;
+    m_triBatch.z[i]=s_triVerts[i].m_z;
+  }
+  // tracing can be turned on without a rebuild by setting MVP_TRACE to the output file
+  if(const char *traceFile=std::getenv("MVP_TRACE"))
+    m_trace.start(traceFile);
+  // as can input recording with MVP_RECORD
+  if(const char *sessionFile=std::getenv("MVP_RECORD"))
+    m_session.start(sessionFile);
+  // in ProfileStage order
+  for(auto name : {"frame","matrix setup","load matrices","draw","job wait","overlay"})
+    m_profiler.addStage(name);
+  // frames are only drawn when input or requestFrame asks for one, at the paced slot
+  if(const char *fps=std::getenv("MVP_TARGET_FPS"))
+    m_pacer.setTargetRate(static_cast<float>(std::atof(fps)));
+  // the scale mode keeps frames inside the pacer's period unless given its own budget
+  if(const char *budget=std::getenv("MVP_RENDER_BUDGET"))
+    m_scaler.setBudget(static_cast<float>(std::atof(budget)));
+  else if(m_pacer.targetRate()>0.0f)
+    m_scaler.setBudget(1000.0f/m_pacer.targetRate());
+  m_frameTimer.setSingleShot(true);
+  m_frameTimer.setTimerType(Qt::PreciseTimer);
+  QObject::connect(&m_frameTimer,&QTimer::timeout,[this](){ update(); });
+  QObject::connect(this,&QOpenGLWindow::frameSwapped,[this](){ framePresented(); });
+}
+
+void NGLScene::scheduleFrame()
+{
+  // a frame is already on its way, the new input will be merged into it
+  if(m_frameTimer.isActive())
+    return;
+  m_frameTimer.start(m_pacer.delayMs(FramePacer::Clock::now()));
+}
+
+void NGLScene::requestFrame()
+{
+  // the event is handled on the gui thread, one is enough however many requests come in before it
+  if(!m_frameRequestPosted.exchange(true))
+    QCoreApplication::postEvent(this,new QEvent(c_frameRequestEvent));
+}
+
+bool NGLScene::event(QEvent *_event)
+{
+  if(_event->type()!=c_frameRequestEvent)
+    return QOpenGLWindow::event(_event);
+  m_frameRequestPosted=false;
+  m_frameRequested=true;
+  scheduleFrame();
+  return true;
+}
+
+void NGLScene::framePresented()
+{
+  auto now=FramePacer::Clock::now();
+  m_pacer.framePresented(now);
+  if(m_frameHasInput)
+    m_latency.add(std::chrono::duration<float,std::milli>(now-m_frameInput).count());
+  // input that arrived while this frame was being drawn still needs one, as does anything still
+  // working, after that a few more frames bring back the gpu times of the last one with work
+  bool work=m_input.pending() || hasPendingWork();
+  if(m_frameHasInput || m_frameRequested || work)
+    m_trailingFrames=FrameProfiler::c_latency;
+  else if(m_trailingFrames>0)
+    --m_trailingFrames;
+  m_frameHasInput=false;
+  m_frameRequested=false;
+  if(work || m_trailingFrames>0)
+    scheduleFrame();
+}
+
+bool NGLScene::hasPendingWork() const
+{
+  // a streamed mesh is only picked up by the poll in paintGL once its fence has signalled
+  if(m_streamer && m_streamer->stats().queueDepth>0)
+    return true;
+  // a shader rebuild is started and handed over by the poll in paintGL
+  if(m_shaderReloader && m_shaderReloader->status().pending>0)
+    return true;
+  // the LOD chain and pick BVH are built on workers and collected by paintGL
+  if(m_lodBuild.valid() || m_bvhBuild.valid())
+    return true;
+  // the scaler ignores the frames after a change, it needs them drawn to judge the new size
+  if(m_scaleMode && m_scaler.settling())
+    return true;
+  return false;
 }
 
 void NGLScene::createTriangle()
@@ -55,6 +160,16 @@ void NGLScene::createTriangle()
    // now unbind
     m_tri->unbind();
 
+    // a flat grid of copies for the culling mode
+    m_scenePositions.clear();
+    for(int z=0; z<c_sceneSide; ++z)
+      for(int x=0; x<c_sceneSide; ++x)
+        m_scenePositions.push_back(ngl::Vec3((x-c_sceneSide/2)*c_sceneSpacing,0.0f,(z-c_sceneSide/2)*c_sceneSpacing));
+
+    // the same triangle for the instanced mode
+    m_instanced.reset(new InstancedRenderer(&s_triVerts[0],&normals[0],s_triVerts.size(),c_maxInstances));
+    m_instanced->setInstanceCount(10000);
+
 
 
 
@@ -69,13 +184,16 @@ NGLScene::~NGLScene()
 
 void NGLScene::resizeGL( int _w, int _h )
 {
-  m_view=ngl::perspective( 45.0f, static_cast<float>( _w ) / _h, 0.05f, 350.0f );
+  m_transform.setView(ngl::perspective( 45.0f, static_cast<float>( _w ) / _h, 0.05f, 350.0f ));
   m_win.width  = static_cast<int>( _w * devicePixelRatio() );
   m_win.height = static_cast<int>( _h * devicePixelRatio() );
+  if(m_overlay)
+    m_overlay->setScreenSize(_w,_h);
 }
 
 void NGLScene::initializeGL()
 {
+  auto initStart=std::chrono::high_resolution_clock::now();
   // we must call this first before any other GL commands to load and link the
   // gl commands from the lib, if this is not done program will crash
   ngl::NGLInit::instance();
@@ -88,25 +206,44 @@ void NGLScene::initializeGL()
    // now to load the shader and set the values
   // grab an instance of shader manager
   ngl::ShaderLib *shader=ngl::ShaderLib::instance();
-  // we are creating a shader called Phong
-  shader->createShaderProgram("Phong");
-  // now we are going to create empty shaders for Frag and Vert
-  shader->attachShader("PhongVertex",ngl::ShaderType::VERTEX);
-  shader->attachShader("PhongFragment",ngl::ShaderType::FRAGMENT);
-  // attach the source
-  shader->loadShaderSource("PhongVertex","shaders/PhongVertex.glsl");
-  shader->loadShaderSource("PhongFragment","shaders/PhongFragment.glsl");
-  // compile the shaders
-  shader->compileShader("PhongVertex");
-  shader->compileShader("PhongFragment");
-  // add them to the program
-  shader->attachShaderToProgram("Phong","PhongVertex");
-  shader->attachShaderToProgram("Phong","PhongFragment");
-
-  // now we have associated this data we can link the shader
-  shader->linkProgramObject("Phong");
-  // and make it active ready to load values
-  (*shader)["Phong"]->use();
+  // the programs come from the binary cache when the sources and driver match, otherwise they
+  // are compiled and linked as usual and the binary stored for next time
+  auto shaderStart=std::chrono::high_resolution_clock::now();
+  const char *cacheDir=std::getenv("MVP_SHADER_CACHE");
+  ShaderCache cache(cacheDir ? cacheDir : ".shadercache");
+  const std::initializer_list<ShaderCache::Stage> phongStages=
+    {{"PhongVertex",ngl::ShaderType::VERTEX,"shaders/PhongVertex.glsl"},
+     {"PhongFragment",ngl::ShaderType::FRAGMENT,"shaders/PhongFragment.glsl"}};
+  // the instanced version shares the fragment shader but takes M and the normal matrix per instance
+  const std::initializer_list<ShaderCache::Stage> instancedStages=
+    {{"PhongInstancedVertex",ngl::ShaderType::VERTEX,"shaders/PhongInstancedVertex.glsl"},
+     {"PhongFragment",ngl::ShaderType::FRAGMENT,"shaders/PhongFragment.glsl"}};
+  // and the batched one reads them from a storage buffer indexed by draw
+  const std::initializer_list<ShaderCache::Stage> batchStages=
+    {{"PhongBatchVertex",ngl::ShaderType::VERTEX,"shaders/PhongBatchVertex.glsl"},
+     {"PhongFragment",ngl::ShaderType::FRAGMENT,"shaders/PhongFragment.glsl"}};
+  const std::initializer_list<ShaderCache::Stage> computeStages=
+    {{"ComputeTransformShader",ngl::ShaderType::COMPUTE,"shaders/compute.glsl"}};
+  const std::initializer_list<ShaderCache::Stage> scaleStages=
+    {{"ScaleBlitVertex",ngl::ShaderType::VERTEX,"shaders/ScaleBlitVertex.glsl"},
+     {"ScaleBlitFragment",ngl::ShaderType::FRAGMENT,"shaders/ScaleBlitFragment.glsl"}};
+  cache.loadProgram("Phong",phongStages);
+  cache.loadProgram("PhongInstanced",instancedStages);
+  // compute shaders are GL 4.3 so this fails on the 4.1 mac contexts
+  m_computeSupported=cache.loadProgram(ComputeTransform::c_program,computeStages);
+  // as are storage buffers and multi draw indirect
+  m_batchSupported=cache.loadProgram(BatchRenderer::c_program,batchStages);
+  // the scaled scene is stretched over the window by drawing it as a texture
+  m_scaleSupported=cache.loadProgram("ScaleBlit",scaleStages);
+  if(m_scaleSupported)
+  {
+    (*shader)["ScaleBlit"]->use();
+    shader->setUniform("scene",0);
+    glGenVertexArrays(1,&m_scaleBlitVAO);
+  }
+  // the matrices come from a uniform block rather than individual uniforms
+  TransformUBO::bindBlock(shader->getProgramID("Phong"));
+  float shaderTime=std::chrono::duration<float,std::milli>(std::chrono::high_resolution_clock::now()-shaderStart).count();
   // Now we will create a basic Camera from the graphics library
   // This is a static camera so it only needs to be set once
   // First create Values for the camera position
@@ -114,11 +251,70 @@ void NGLScene::initializeGL()
   ngl::Vec3 to(0,0,0);
   ngl::Vec3 up(0,1,0);
   // now load to our new camera
-  m_view=ngl::lookAt(from,to,up);
+  m_transform.setView(ngl::lookAt(from,to,up));
   // set the shape using FOV 45 Aspect Ratio based on Width and Height
   // The final two are near and far clipping planes of 0.5 and 10
-  m_project=ngl::perspective(45.0f,720.0f/576.0f,0.05f,350.0f);
-  shader->setUniform("viewerPos",from);
+  m_transform.setProject(ngl::perspective(45.0f,720.0f/576.0f,0.05f,350.0f));
+  // the Phong programs all get the same light and material, Phong is left active
+  if(m_batchSupported)
+    setShaderDefaults(BatchRenderer::c_program,from);
+  for(auto program : {"PhongInstanced","Phong"})
+    setShaderDefaults(program,from);
+  // edits to the shaders are picked up while running, MVP_SHADER_RELOAD=off turns that off
+  const char *reload=std::getenv("MVP_SHADER_RELOAD");
+  if(!reload || std::strcmp(reload,"off")!=0)
+  {
+    m_shaderReloader.reset(new ShaderReloader(context(),"shaders",[this,from](const std::string &_program)
+    {
+      // a new program starts with nothing set, and the matrices have to be uploaded again
+      if(_program=="Phong")
+        TransformUBO::bindBlock(ngl::ShaderLib::instance()->getProgramID(_program));
+      if(_program!=ComputeTransform::c_program)
+        setShaderDefaults(_program,from);
+      m_transform.invalidate();
+    },[this](){ requestFrame(); }));
+    m_shaderReloader->watch("Phong",phongStages);
+    m_shaderReloader->watch("PhongInstanced",instancedStages);
+    if(m_computeSupported)
+      m_shaderReloader->watch(ComputeTransform::c_program,computeStages);
+    if(m_batchSupported)
+      m_shaderReloader->watch(BatchRenderer::c_program,batchStages);
+  }
+
+  auto textStart=std::chrono::high_resolution_clock::now();
+  m_text.reset(  new  ngl::Text(QFont("Arial",18)));
+  m_text->setScreenSize(width(),height());
+  createOverlay();
+  m_profiler.initGL();
+  m_transformUBO.reset(new TransformUBO(c_sceneSide*c_sceneSide));
+  auto geometryStart=std::chrono::high_resolution_clock::now();
+  createTriangle();
+  // a converted binary mesh (see tools/MeshConvert) can be drawn in place of the triangle
+  if(const char *meshFile=std::getenv("MVP_MESH"))
+    loadMesh(meshFile);
+  // or streamed in the background so the window keeps drawing while it loads
+  if(const char *streamFile=std::getenv("MVP_STREAM_MESH"))
+  {
+    m_streamer.reset(new MeshStreamer(context()));
+    m_streamer->request(streamFile);
+  }
+  auto end=std::chrono::high_resolution_clock::now();
+
+  const ShaderCache::Stats &stats=cache.stats();
+  std::cout<<"startup "<<std::chrono::duration<float,std::milli>(end-initStart).count()<<" ms"
+           <<" shaders "<<shaderTime<<" ms (hits "<<stats.hits<<" misses "<<stats.misses
+           <<" hash "<<stats.hashMs<<" binary load "<<stats.binaryLoadMs<<" compile "<<stats.compileMs
+           <<" link "<<stats.linkMs<<" store "<<stats.storeMs<<")"
+           <<" text "<<std::chrono::duration<float,std::milli>(geometryStart-textStart).count()<<" ms"
+           <<" geometry "<<std::chrono::duration<float,std::milli>(end-geometryStart).count()<<" ms\n";
+
+}
+
+void NGLScene::setShaderDefaults(const std::string &_program, const ngl::Vec3 &_eye)
+{
+  ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+  (*shader)[_program]->use();
+  shader->setUniform("viewerPos",_eye);
   ngl::Vec4 lightPos(0.0f,2.0f,2.0f,0.0f);
   shader->setUniform("light.position",lightPos);
   shader->setUniform("light.ambient",0.0f,0.0f,0.0f,1.0f);
@@ -129,36 +325,367 @@ void NGLScene::initializeGL()
   shader->setUniform("material.diffuse",0.75164f,0.60648f,0.22648f,0.0f);
   shader->setUniform("material.specular",0.628281f,0.555802f,0.3666065f,0.0f);
   shader->setUniform("material.shininess",51.2f);
+}
 
+bool NGLScene::loadMesh(const std::string &_fname)
+{
+  auto start=std::chrono::high_resolution_clock::now();
+  // kept open as the source for the packed layouts
+  MappedMesh &mesh=m_meshFile;
+  if(!mesh.open(_fname))
+    return false;
+  // the positions and normals sections are uploaded straight from the mapping as one buffer
+  // with the normal attribute offset into it, the indices also come from the mapping
+  const meshfile::MeshFileHeader &header=mesh.header();
+  m_mesh=ngl::VAOFactory::createVAO(ngl::simpleIndexVAO,GL_TRIANGLES);
+  m_mesh->bind();
+  m_mesh->setData(ngl::SimpleIndexVAO::VertexData(mesh.vertexBlockSize(),*mesh.positions(),
+                                                 mesh.indexCount(),mesh.indices(),GL_UNSIGNED_INT));
+  m_mesh->setVertexAttributePointer(0,3,GL_FLOAT,0,0);
+  m_mesh->setVertexAttributePointer(1,3,GL_FLOAT,0,static_cast<unsigned int>((header.normalOffset-header.positionOffset)/sizeof(float)));
+  m_mesh->setNumIndices(mesh.indexCount());
+  m_mesh->unbind();
+  float ms=std::chrono::duration<float,std::milli>(std::chrono::high_resolution_clock::now()-start).count();
+  std::cout<<"loaded "<<_fname<<" "<<mesh.vertexCount()<<" vertices "<<mesh.indexCount()/3<<" triangles in "<<ms<<" ms\n";
+  return true;
+}
 
-  m_text.reset(  new  ngl::Text(QFont("Arial",18)));
-  m_text->setScreenSize(width(),height());
-  createTriangle();
+void NGLScene::createPackedMesh()
+{
+  if(m_vertexLayout<0)
+  {
+    m_packed.reset();
+    return;
+  }
+  PackedMesh::Format format=static_cast<PackedMesh::Format>(m_vertexLayout);
+  size_t numVerts=s_triVerts.size();
+  size_t numIndices=0;
+  if(m_meshFile.isOpen())
+  {
+    numVerts=m_meshFile.vertexCount();
+    numIndices=m_meshFile.indexCount();
+    m_packed.reset(new PackedMesh(m_meshFile.positions(),m_meshFile.normals(),numVerts,
+                                  m_meshFile.indices(),numIndices,format));
+  }
+  else
+  {
+    std::array<ngl::Vec3,3> normals;
+    normals.fill(ngl::Vec3(0.0f,1.0f,0.0f));
+    m_packed.reset(new PackedMesh(&s_triVerts[0].m_x,&normals[0].m_x,numVerts,nullptr,0,format));
+    numIndices=numVerts;
+  }
+  std::cout<<"vertex layouts for "<<numVerts<<" vertices\n";
+  std::cout<<"  separate float : 24 bytes/vertex "<<PackedMesh::separateFloatBytes(numVerts,numIndices)<<" bytes\n";
+  for(auto f : {PackedMesh::Format::Float,PackedMesh::Format::HalfOct,PackedMesh::Format::UNorm16Oct})
+  {
+    PackedMesh::MemoryStats stats=PackedMesh::memoryFor(f,numVerts,numIndices);
+    std::cout<<"  "<<PackedMesh::formatName(f)<<" : "<<stats.bytesPerVertex<<" bytes/vertex "<<stats.totalBytes<<" bytes"
+             <<(f==format ? " (active)" : "")<<'\n';
+  }
+  std::cout<<"  max position error "<<m_packed->maxPositionError()<<'\n';
+}
+
+void NGLScene::startMeshLodBuild()
+{
+  // the mapped file and the triangle both outlive the build, so the worker reads them in place
+  if(m_meshFile.isOpen())
+  {
+    const float *positions=m_meshFile.positions();
+    size_t numVerts=m_meshFile.vertexCount();
+    const uint32_t *indices=m_meshFile.indices();
+    size_t numIndices=m_meshFile.indexCount();
+    m_lodBuild=std::async(std::launch::async,[=](){ return MeshLod::simplify(positions,numVerts,indices,numIndices); });
+  }
+  else
+  {
+    m_lodBuild=std::async(std::launch::async,[]() -> MeshLod::Chain
+    {
+      std::array<uint32_t,3> indices={{0,1,2}};
+      return MeshLod::simplify(&s_triVerts[0].m_x,s_triVerts.size(),indices.data(),indices.size());
+    });
+  }
+  std::cout<<"building LOD chain\n";
+}
+
+void NGLScene::createMeshLod(MeshLod::Chain _chain)
+{
+  if(m_meshFile.isOpen())
+  {
+    m_lod.reset(new MeshLod(m_meshFile.positions(),m_meshFile.normals(),m_meshFile.vertexCount(),
+                            m_meshFile.indices(),m_meshFile.indexCount(),std::move(_chain)));
+  }
+  else
+  {
+    std::array<ngl::Vec3,3> normals;
+    normals.fill(ngl::Vec3(0.0f,1.0f,0.0f));
+    std::array<uint32_t,3> indices={{0,1,2}};
+    m_lod.reset(new MeshLod(&s_triVerts[0].m_x,&normals[0].m_x,s_triVerts.size(),indices.data(),indices.size(),
+                            std::move(_chain)));
+  }
+  std::cout<<"LOD chain built in "<<m_lod->buildTime()<<" ms\n";
+  for(size_t i=0; i<m_lod->numLevels(); ++i)
+    std::cout<<"  level "<<i<<" triangles "<<m_lod->level(i).triangles<<" error "<<m_lod->level(i).error<<'\n';
+}
+
+void NGLScene::startPickBVHBuild()
+{
+  // the tree copies the mesh in to its packets, the mapped file and the triangle outlive the build
+  if(m_meshFile.isOpen())
+  {
+    const float *positions=m_meshFile.positions();
+    size_t numVerts=m_meshFile.vertexCount();
+    const uint32_t *indices=m_meshFile.indices();
+    size_t numIndices=m_meshFile.indexCount();
+    m_bvhBuild=std::async(std::launch::async,[=]()
+    {
+      return std::unique_ptr<MeshBVH>(new MeshBVH(positions,numVerts,indices,numIndices));
+    });
+  }
+  else
+  {
+    m_bvhBuild=std::async(std::launch::async,[]() -> std::unique_ptr<MeshBVH>
+    {
+      std::array<uint32_t,3> indices={{0,1,2}};
+      return std::unique_ptr<MeshBVH>(new MeshBVH(&s_triVerts[0].m_x,s_triVerts.size(),indices.data(),indices.size()));
+    });
+  }
+  std::cout<<"building pick BVH\n";
+}
+
+bool NGLScene::drawsPickMesh() const
+{
+  // the same order as the draw in paintGL, LOD levels are close enough to the mesh they came from
+  if(m_instancedMode || m_batchMode || m_cullMode)
+    return false;
+  return m_computeMode || m_lodMode || m_packed || !m_streamed;
+}
+
+void NGLScene::pickUnderCursor()
+{
+  m_pick=MeshBVH::Hit();
+  if(m_cursorX<0 || width()<=0 || height()<=0)
+    return;
+  auto start=std::chrono::high_resolution_clock::now();
+  // the cursor is in window coordinates with y down
+  float ndcX=2.0f*m_cursorX/width()-1.0f;
+  float ndcY=1.0f-2.0f*m_cursorY/height();
+  ngl::Vec3 origin;
+  ngl::Vec3 dir;
+  if(MeshBVH::unproject(m_transform.MVP(),ndcX,ndcY,origin,dir))
+    m_pick=m_bvh->intersect(origin,dir);
+  m_pickUs=std::chrono::duration<float,std::micro>(std::chrono::high_resolution_clock::now()-start).count();
+}
+
+void NGLScene::createBatchScene()
+{
+  // room for the largest meshes made here
+  size_t meshes=c_batchSide*c_batchSide;
+  size_t maxRings=24;
+  m_batch.reset(new BatchRenderer(meshes*(maxRings+1)*(2*maxRings+1),meshes*maxRings*2*maxRings*6,meshes));
+  m_batchMeshes.clear();
+  m_batchTriangles=0;
+  auto start=std::chrono::high_resolution_clock::now();
+  for(size_t i=0; i<meshes; ++i)
+  {
+    meshfile::MeshData mesh;
+    // the exponents change across the grid and the tessellation from one mesh to the next
+    meshfile::makeSuperellipsoid(0.2f+0.15f*(i%c_batchSide),0.2f+0.15f*(i/c_batchSide),8+i%(maxRings-7),0.5f,mesh);
+    int id=m_batch->addMesh(mesh.positions.data(),mesh.normals.data(),mesh.vertexCount(),mesh.indices.data(),mesh.indices.size());
+    if(id<0)
+      break;
+    m_batchMeshes.push_back(id);
+    m_batchTriangles+=mesh.indices.size()/3;
+  }
+  float ms=std::chrono::duration<float,std::milli>(std::chrono::high_resolution_clock::now()-start).count();
+  std::cout<<"batch scene "<<m_batchMeshes.size()<<" meshes "<<m_batchTriangles<<" triangles in "<<ms<<" ms, arenas "
+           <<m_batch->vertexArena().used()<<" / "<<m_batch->vertexArena().capacity()<<" vertices "
+           <<m_batch->indexArena().used()<<" / "<<m_batch->indexArena().capacity()<<" indices\n";
+}
+
+void NGLScene::drawBatchScene()
+{
+  // the same grid layout as the cull scene, every mesh is under the current model matrix moved
+  // to its own place so they all share the normal matrix
+  m_batch->begin();
+  for(size_t i=0; i<m_batchMeshes.size(); ++i)
+  {
+    ngl::Vec3 p((static_cast<int>(i%c_batchSide)-c_batchSide/2)*c_batchSpacing,0.0f,
+                (static_cast<int>(i/c_batchSide)-c_batchSide/2)*c_batchSpacing);
+    ngl::Mat4 M;
+    TRSCompose::translated(m_transform.M(),p,M);
+    m_batch->add(m_batchMeshes[i],M,m_transform.normalMatrix());
+  }
+  m_batch->draw(m_transform.view(),m_transform.project(),m_batchMultiDraw);
+}
+
+size_t NGLScene::submittedTriangles() const
+{
+  size_t meshTriangles=m_meshFile.isOpen() ? m_meshFile.indexCount()/3 : 1;
+  if(m_instancedMode)
+    return m_instanced->instanceCount();
+  if(m_batchMode)
+    return m_batchTriangles;
+  if(m_cullMode)
+    return m_culler.visible().size();
+  if(m_computeMode)
+    return meshTriangles;
+  if(m_lodMode)
+    return m_lod->level(m_lod->current()).triangles;
+  if(m_streamed && !m_packed)
+    return m_streamed->indexCount()/3;
+  return meshTriangles;
+}
 
+const char *NGLScene::vertexLayoutName() const
+{
+  return m_packed ? PackedMesh::formatName(m_packed->format()) : "separate float";
+}
 
+size_t NGLScene::separateLayoutBytes() const
+{
+  if(m_meshFile.isOpen())
+    return PackedMesh::separateFloatBytes(m_meshFile.vertexCount(),m_meshFile.indexCount());
+  return PackedMesh::separateFloatBytes(s_triVerts.size(),0);
 }
 
+void NGLScene::createComputeTransform()
+{
+  if(m_meshFile.isOpen())
+  {
+    m_compute.reset(new ComputeTransform(m_meshFile.positions(),m_meshFile.normals(),m_meshFile.vertexCount(),
+                                         m_meshFile.indices(),m_meshFile.indexCount()));
+  }
+  else
+  {
+    std::array<ngl::Vec3,3> normals;
+    normals.fill(ngl::Vec3(0.0f,1.0f,0.0f));
+    m_compute.reset(new ComputeTransform(&s_triVerts[0].m_x,&normals[0].m_x,s_triVerts.size(),nullptr,0));
+  }
+}
 
 void NGLScene::loadMatricesToShader()
 {
-  ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+  // only rebuild and send the matrices when an input has changed since the last upload
+  m_transform.update();
+  if(!m_transform.needsUpload())
+    return;
+  // one block written to the ring and bound, it stays bound until the matrices change again
+  m_transformUBO->begin(1);
+  m_transformUBO->set(0,m_transform.MVP(),m_transform.MV(),m_transform.M(),m_transform.normalMatrix());
+  m_transformUBO->upload();
+  m_transformUBO->bind(0);
+  m_transform.markUploaded();
+}
+
+void NGLScene::cullScene()
+{
+  m_transform.update();
+  const ngl::Mat4 &M=m_transform.M();
+  // every object is the triangle under the current model matrix moved to its grid position,
+  // so the bounds only need rebuilding when the model matrix changes
+  if(m_culler.size()==0 || std::memcmp(&M.m_openGL[0],&m_cullModel.m_openGL[0],sizeof(M.m_openGL))!=0)
+  {
+    m_cullModel=M;
+    const float *m=&M.m_openGL[0];
+    ngl::Vec3 lo(std::numeric_limits<float>::max(),std::numeric_limits<float>::max(),std::numeric_limits<float>::max());
+    ngl::Vec3 hi=lo*-1.0f;
+    for(auto v : s_triVerts)
+    {
+      ngl::Vec3 p(m[0]*v.m_x+m[4]*v.m_y+m[8]*v.m_z+m[12],
+                  m[1]*v.m_x+m[5]*v.m_y+m[9]*v.m_z+m[13],
+                  m[2]*v.m_x+m[6]*v.m_y+m[10]*v.m_z+m[14]);
+      lo.set(std::min(lo.m_x,p.m_x),std::min(lo.m_y,p.m_y),std::min(lo.m_z,p.m_z));
+      hi.set(std::max(hi.m_x,p.m_x),std::max(hi.m_y,p.m_y),std::max(hi.m_z,p.m_z));
+    }
+    m_culler.clear();
+    for(auto p : m_scenePositions)
+      m_culler.addObject(p+lo,p+hi);
+  }
+  m_culler.cull(m_transform.project()*m_transform.view());
+}
+
+void NGLScene::drawCulledScene()
+{
+  // only the visible objects are submitted, their blocks are all written in one go then each
+  // draw just binds its own range
+  const ngl::Mat4 &view=m_transform.view();
+  const ngl::Mat4 &project=m_transform.project();
+  const std::vector<uint32_t> &visible=m_culler.visible();
+  m_transformUBO->begin(visible.size());
+  for(size_t i=0; i<visible.size(); ++i)
+  {
+    const ngl::Vec3 &p=m_scenePositions[visible[i]];
+    // T*M only moves the last column of the affine M
+    ngl::Mat4 M;
+    TRSCompose::translated(m_transform.M(),p,M);
+    ngl::Mat4 MV=view*M;
+    // a translation doesn't change the normal matrix so it is shared by all of them
+    m_transformUBO->set(i,project*MV,MV,M,m_transform.normalMatrix());
+  }
+  m_transformUBO->upload();
+  m_tri->bind();
+  for(size_t i=0; i<visible.size(); ++i)
+  {
+    m_transformUBO->bind(i);
+    m_tri->draw();
+  }
+  m_tri->unbind();
+}
 
-  ngl::Mat4 MV;
-  ngl::Mat3 normalMatrix;
-  ngl::Mat4 M;
-  M=m_tranMat * m_rX * m_rY*m_rZ*m_scaleMat;
-  MV=  m_view*M;
-  m_MVP= m_project*MV;
-  normalMatrix=MV;
-  normalMatrix.inverse().transpose();
-  shader->setUniform("MV",MV);
-  shader->setUniform("MVP",m_MVP);
-  shader->setUniform("normalMatrix",normalMatrix);
-  shader->setUniform("M",M);
+void NGLScene::renderSoftware(const std::string &_fname)
+{
+  // same triangle and normals as createTriangle
+  std::array<ngl::Vec3,3> normals;
+  normals.fill(ngl::Vec3(0.0f,1.0f,0.0f));
+  SoftwareRenderer renderer(m_win.width,m_win.height);
+  m_transform.update();
+  renderer.setMatrices(m_transform.MVP(),m_transform.MV(),m_transform.normalMatrix(),m_transform.M());
+  renderer.setViewerPos(ngl::Vec3(0,1,1));
+  renderer.setWireframe(m_wireframe);
+  renderer.clear();
+  renderer.drawTriangles(&s_triVerts[0],&normals[0],s_triVerts.size());
+  if(renderer.writePPM(_fname))
+    std::cout<<"software render written to "<<_fname<<'\n';
+  else
+    std::cerr<<"unable to write "<<_fname<<'\n';
 }
 
 void NGLScene::paintGL()
 {
+  // each stage is timed on the cpu and gpu, the gpu times arrive a few frames later
+  m_profiler.beginFrame();
+  m_profiler.begin(FRAME_STAGE);
+  m_pacer.frameStarted(FramePacer::Clock::now());
+  // everything since the last frame is applied in one go
+  InputAccumulator::Delta input=m_input.take();
+  input.apply(m_win,m_modelPos);
+  m_frameHasInput=input.events!=0;
+  m_frameInput=input.oldest;
+  m_session.record(InputSession::EventType::Frame,m_frame);
+  // a streamed mesh takes over once its upload has finished, this never waits on it
+  if(m_streamer)
+    for(auto &mesh : m_streamer->poll())
+      m_streamed=std::move(mesh);
+  // as does a shader that has finished rebuilding, until then the old one is drawn with
+  if(m_shaderReloader)
+    m_shaderReloader->poll();
+  // and a LOD chain once the worker has simplified it, it's uploaded here and switched on
+  if(m_lodBuild.valid() && m_lodBuild.wait_for(std::chrono::seconds(0))==std::future_status::ready)
+  {
+    createMeshLod(m_lodBuild.get());
+    m_lodMode=true;
+  }
+  // and the pick BVH
+  if(m_bvhBuild.valid() && m_bvhBuild.wait_for(std::chrono::seconds(0))==std::future_status::ready)
+  {
+    m_bvh=m_bvhBuild.get();
+    const MeshBVH::Stats &stats=m_bvh->stats();
+    std::cout<<"pick BVH built in "<<stats.buildMs<<" ms "<<stats.nodes<<" nodes "<<stats.packets<<" packets depth "
+             <<stats.depth<<" "<<stats.bytes/1024<<" KB\n";
+    m_pickMode=true;
+  }
+  // everything up to the overlay goes to the scaled target when there is one
+  bool scaled=beginScaledScene();
   // clear the screen and depth buffer
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -167,37 +694,311 @@ void NGLScene::paintGL()
   (*shader)["Phong"]->use();
 
 
-  m_scaleMat.scale(m_scale.m_x,m_scale.m_y,m_scale.m_z);
-  m_tranMat.translate(m_pos.m_x,m_pos.m_y,m_pos.m_z);
-  m_rX.rotateX(m_rot.m_x);
-  m_rY.rotateY(m_rot.m_y);
-  m_rZ.rotateZ(m_rot.m_z);
+  m_jobs.beginFrame();
+  {
+    FrameProfiler::Scope scope(m_profiler,SETUP_STAGE);
+    m_transform.beginFrame();
+    m_transform.update();
+    // cull and pick the LOD before any tasks start so nothing they read changes under them
+    if(m_batch)
+      m_batchStats=m_batch->stats();
+    if(m_cullMode && !m_instancedMode && !m_batchMode)
+      cullScene();
+    else if(m_lodMode && !m_instancedMode && !m_batchMode && !m_computeMode)
+      m_lod->select(m_transform.MVP(),m_renderWidth,m_renderHeight);
+    if(m_pickMode && drawsPickMesh())
+      pickUnderCursor();
+    m_frameTriangles=submittedTriangles();
+  }
+  // likewise the uniforms
+  if(!m_cullMode && !m_instancedMode && !m_batchMode)
+  {
+    FrameProfiler::Scope scope(m_profiler,UPLOAD_STAGE);
+    loadMatricesToShader();
+  }
 
+  // the cpu side stages run as tasks while this thread submits the GL work, the last frame's
+  // fill time is passed by value as the instanced draw below overwrites it. The clip verts are the
+  // triangle's three for the HUD and the trace, so they are kept up to date in compute mode too
+  JobSystem::TaskId clip=m_jobs.add("clip verts",[this]()
+  {
+    BatchTransform::transform(m_transform.MVP(),m_triBatch,m_clipVerts);
+  });
+  uint64_t frame=m_frame++;
+  m_jobs.add("trace",[this,frame]()
+  {
+    // these are no-ops unless tracing has been turned on
+    m_trace.recordMatrices(frame,m_transform.MVP(),m_transform.modelDisplay(),m_transform.view(),m_transform.project());
+    m_trace.recordPoints(frame,m_clipVerts);
+  },{clip});
+  if(m_cachedOverlay)
+  {
+    float fillTime=m_instanced->fillTime();
+    m_jobs.add("overlay text",[this,fillTime](){ updateOverlayCached(fillTime); },{clip});
+  }
 
   // draw
+  m_profiler.begin(DRAW_STAGE);
   glPolygonMode(GL_FRONT_AND_BACK,m_wireframe ? GL_LINE : GL_FILL);
 
-  loadMatricesToShader();
-  //prim->draw("bunny");
-  m_tri->bind();
-  m_tri->draw();
-  m_tri->unbind();
+  if(m_instancedMode)
+  {
+    m_instanced->draw(m_transform,m_jobs);
+  }
+  else if(m_batchMode)
+  {
+    drawBatchScene();
+  }
+  else if(m_cullMode)
+  {
+    drawCulledScene();
+  }
+  else if(m_computeMode)
+  {
+    // the compute pass does the MVP multiply the vertex shader would, the other matrices are
+    // still needed for the lighting
+    m_compute->dispatch(m_transform.MVP());
+    (*shader)["Phong"]->use();
+    m_compute->draw();
+  }
+  else if(m_lodMode)
+  {
+    m_lod->draw();
+    PackedMesh::clearDecodeUniforms();
+  }
+  else if(m_packed)
+  {
+    m_packed->setDecodeUniforms();
+    m_packed->draw();
+    PackedMesh::clearDecodeUniforms();
+  }
+  else if(m_streamed)
+  {
+    m_streamed->draw();
+  }
+  else if(m_mesh)
+  {
+    m_mesh->bind();
+    m_mesh->draw();
+    m_mesh->unbind();
+  }
+  else
+  {
+    //prim->draw("bunny");
+    m_tri->bind();
+    m_tri->draw();
+    m_tri->unbind();
+  }
   glPolygonMode(GL_FRONT_AND_BACK,GL_FILL);
+  // fence this frame's transform blocks, if any were written
+  m_transformUBO->end();
+  if(scaled)
+    endScaledScene();
+  m_profiler.end(DRAW_STAGE);
+
+  // help with anything left then draw the overlay, the time is what the overlay costs this thread
+  m_profiler.begin(JOBS_STAGE);
+  m_jobs.waitAll();
+  m_profiler.end(JOBS_STAGE);
+  m_profiler.begin(OVERLAY_STAGE);
+  auto overlayStart=std::chrono::high_resolution_clock::now();
+  if(m_cachedOverlay)
+    m_overlay->draw();
+  else
+    drawOverlayPerLine();
+  m_overlayTime=std::chrono::duration<float,std::milli>(std::chrono::high_resolution_clock::now()-overlayStart).count();
+  m_profiler.end(OVERLAY_STAGE);
+  m_jobStats=m_jobs.frameStats();
+  m_profiler.end(FRAME_STAGE);
+  m_profiler.endFrame();
+}
+
+bool NGLScene::beginScaledScene()
+{
+  m_renderWidth=m_win.width;
+  m_renderHeight=m_win.height;
+  if(!m_scaleMode)
+    return false;
+  // the frame's gpu time, a few frames late. That is the fill cost the scale controls, a frame
+  // held up by the cpu would only lose resolution for nothing
+  uint64_t frame=0;
+  float cpuMs=0.0f;
+  float gpuMs=0.0f;
+  if(m_profiler.latest(FRAME_STAGE,frame,cpuMs,gpuMs) && (!m_scaleSampled || frame!=m_scaleSampleFrame))
+  {
+    m_scaler.addSample(gpuMs);
+    m_scaleSampleFrame=frame;
+    m_scaleSampled=true;
+  }
+  // at full size the scene goes straight to the window and keeps its multisampling
+  if(m_scaler.scale()>=ResolutionScaler::c_maxScale)
+    return false;
+  m_renderWidth=ResolutionScaler::scaled(m_win.width,m_scaler.scale());
+  m_renderHeight=ResolutionScaler::scaled(m_win.height,m_scaler.scale());
+  if(!m_sceneFBO || m_sceneFBO->width()!=m_renderWidth || m_sceneFBO->height()!=m_renderHeight)
+  {
+    m_sceneFBO.reset(new QOpenGLFramebufferObject(m_renderWidth,m_renderHeight,QOpenGLFramebufferObject::Depth));
+    if(!m_sceneFBO->isValid())
+    {
+      std::cerr<<"unable to create the "<<m_renderWidth<<"x"<<m_renderHeight<<" scene target, render scale off\n";
+      m_scaleMode=false;
+      m_sceneFBO.reset();
+      m_renderWidth=m_win.width;
+      m_renderHeight=m_win.height;
+      return false;
+    }
+    // Qt leaves the texture nearest filtered, the stretch wants it smoothed
+    glBindTexture(GL_TEXTURE_2D,m_sceneFBO->texture());
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D,0);
+  }
+  m_sceneFBO->bind();
+  glViewport(0,0,m_renderWidth,m_renderHeight);
+  return true;
+}
+
+void NGLScene::endScaledScene()
+{
+  // errors left by anything earlier in the frame aren't this pass's, only what it raises is checked
+  GLenum error=glGetError();
+  for(int i=0; i<16 && error!=GL_NO_ERROR; ++i)
+    error=glGetError();
+  // the window has 4 samples (see main.cpp) and a blit in to a multisampled target is an error, so
+  // the scene texture is drawn over it instead which writes every pixel
+  glBindFramebuffer(GL_FRAMEBUFFER,defaultFramebufferObject());
+  glViewport(0,0,m_win.width,m_win.height);
+  glDisable(GL_DEPTH_TEST);
+  (*ngl::ShaderLib::instance())["ScaleBlit"]->use();
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D,m_sceneFBO->texture());
+  glBindVertexArray(m_scaleBlitVAO);
+  glDrawArrays(GL_TRIANGLES,0,3);
+  glBindVertexArray(0);
+  glBindTexture(GL_TEXTURE_2D,0);
+  glEnable(GL_DEPTH_TEST);
+  // nothing else this frame has cleared the window's depth
+  glClear(GL_DEPTH_BUFFER_BIT);
+  error=glGetError();
+  if(error!=GL_NO_ERROR)
+  {
+    std::cerr<<"GL error 0x"<<std::hex<<error<<std::dec<<" drawing the scaled scene, render scale off\n";
+    m_scaleMode=false;
+    m_sceneFBO.reset();
+  }
+}
+
+void NGLScene::formatScaleLine(int _line, char *_buffer, size_t _size) const
+{
+  if(!m_scaleMode)
+  {
+    std::snprintf(_buffer,_size,"%s",_line!=0 ? "" : m_scaleSupported ? "Render scale off (U to toggle)" : "Render scale unavailable");
+    return;
+  }
+  if(_line==0)
+    std::snprintf(_buffer,_size,"Render scale %0.2f %dx%d budget %0.1f ms (U)",m_scaler.scale(),m_renderWidth,
+                  m_renderHeight,m_scaler.budgetMs());
+  else
+    std::snprintf(_buffer,_size,"Frame avg %0.2f ms %s, %zu changes last %0.2f to %0.2f",m_scaler.averageMs(),
+                  ResolutionScaler::decisionName(m_scaler.decision()),m_scaler.changes(),m_scaler.previousScale(),
+                  m_scaler.scale());
+}
+
+void NGLScene::formatProfileLine(int _stage, char *_buffer, size_t _size) const
+{
+  const FrameProfiler::Summary &s=m_profiler.summary(_stage);
+  std::snprintf(_buffer,_size,"%-13s %6.3f %6.3f %6.3f  %6.3f %6.3f %6.3f",m_profiler.stageName(_stage).c_str(),
+                s.cpuMin,s.cpuAvg,s.cpuP99,s.gpuMin,s.gpuAvg,s.gpuP99);
+}
+
+bool NGLScene::formatShaderLine(int _line, char *_buffer, size_t _size) const
+{
+  const ShaderReloader *reloader=m_shaderReloader.get();
+  bool valid=reloader && reloader->isValid();
+  if(_line==0)
+  {
+    if(valid)
+      std::snprintf(_buffer,_size,"Shader reload %s pending %zu",reloader->isParallel() ? "parallel" : "worker",
+                    reloader->status().pending);
+    else
+      std::snprintf(_buffer,_size,"Shader reload %s",reloader ? "unavailable" : "off");
+    return true;
+  }
+  const ShaderReloader::Status &status=valid ? reloader->status() : ShaderReloader::Status();
+  if(_line==1)
+  {
+    if(!valid || status.reloads+status.failures==0)
+      std::snprintf(_buffer,_size,"%s",valid ? "edit shaders/*.glsl to rebuild" : "");
+    else
+      std::snprintf(_buffer,_size,"%s %s in %0.1f ms (%u ok %u failed)",status.program.c_str(),
+                    status.ok ? "reloaded" : "FAILED",status.buildMs,status.reloads,status.failures);
+    return status.ok;
+  }
+  // the full log is on stderr, the first line usually says where
+  std::snprintf(_buffer,_size,"%.60s",status.ok ? "" : status.error.c_str());
+  return status.ok;
+}
+
+void NGLScene::formatPickLine(int _line, char *_buffer, size_t _size) const
+{
+  if(!m_pickMode)
+  {
+    std::snprintf(_buffer,_size,"%s",_line!=0 ? "" : m_bvhBuild.valid() ? "Pick building BVH" : "Pick off (B to toggle)");
+    return;
+  }
+  if(!drawsPickMesh())
+  {
+    std::snprintf(_buffer,_size,"%s",_line==0 ? "Pick n/a in this mode (B)" : "");
+    return;
+  }
+  const MeshBVH::Stats &stats=m_bvh->stats();
+  if(_line==0)
+    std::snprintf(_buffer,_size,"Pick %0.2f us BVH %zu nodes %0.1f MB %0.0f ms (B)",m_pickUs,stats.nodes,
+                  stats.bytes/(1024.0f*1024.0f),stats.buildMs);
+  else if(!m_pick.hit)
+    std::snprintf(_buffer,_size,"%s",_line==1 ? "No hit" : "");
+  else if(_line==1)
+    std::snprintf(_buffer,_size,"Triangle %u distance %0.4f",m_pick.triangle,m_pick.distance);
+  else
+    std::snprintf(_buffer,_size,"Barycentric %0.3f %0.3f %0.3f",1.0f-m_pick.u-m_pick.v,m_pick.u,m_pick.v);
+}
+
+void NGLScene::formatBatchLine(int _line, char *_buffer, size_t _size) const
+{
+  if(!m_batchMode)
+  {
+    std::snprintf(_buffer,_size,"%s",_line!=0 ? "" : m_batchSupported ? "Batch off (D to toggle)" : "Batch needs GL 4.3");
+    return;
+  }
+  if(_line==0)
+    std::snprintf(_buffer,_size,"Batch %zu meshes %zu draws %zu calls submit %0.3f ms (D)",m_batch->meshCount(),
+                  m_batchStats.draws,m_batchStats.drawCalls,m_batchStats.submitMs);
+  else
+    std::snprintf(_buffer,_size,"%s arenas %0.0f%% verts %0.0f%% indices (A)",m_batchMultiDraw ? "Multi draw" : "Per draw",
+                  100.0f*m_batch->vertexArena().used()/m_batch->vertexArena().capacity(),
+                  100.0f*m_batch->indexArena().used()/m_batch->indexArena().capacity());
+}
+
+void NGLScene::drawOverlayPerLine()
+{
+  const ngl::Mat4 &MVP=m_transform.MVP();
+  const ngl::Mat4 &view=m_transform.view();
+  const ngl::Mat4 &project=m_transform.project();
   QString text;
   int tp=10;
   m_text->setColour(1.0,1.0,1.0);
   text.sprintf("MVP Matrix");
   m_text->renderText(tp,18*1,text );
-  text.sprintf("[ %+0.4f %+0.4f %+0.4f %+0.4f]",m_MVP.m_openGL[0],m_MVP.m_openGL[4],m_MVP.m_openGL[8],m_MVP.m_openGL[12]);
+  text.sprintf("[ %+0.4f %+0.4f %+0.4f %+0.4f]",MVP.m_openGL[0],MVP.m_openGL[4],MVP.m_openGL[8],MVP.m_openGL[12]);
   m_text->renderText(tp,18*2,text );
-  text.sprintf("[ %+0.4f %+0.4f %+0.4f %+0.4f]",m_MVP.m_openGL[1],m_MVP.m_openGL[5],m_MVP.m_openGL[9],m_MVP.m_openGL[13]);
+  text.sprintf("[ %+0.4f %+0.4f %+0.4f %+0.4f]",MVP.m_openGL[1],MVP.m_openGL[5],MVP.m_openGL[9],MVP.m_openGL[13]);
   m_text->renderText(tp,18*3,text );
-  text.sprintf("[ %+0.4f %+0.4f %+0.4f %+0.4f]",m_MVP.m_openGL[2],m_MVP.m_openGL[6],m_MVP.m_openGL[10],m_MVP.m_openGL[14]);
+  text.sprintf("[ %+0.4f %+0.4f %+0.4f %+0.4f]",MVP.m_openGL[2],MVP.m_openGL[6],MVP.m_openGL[10],MVP.m_openGL[14]);
   m_text->renderText(tp,18*4,text );
-  text.sprintf("[ %+0.4f %+0.4f %+0.4f %+0.4f]",m_MVP.m_openGL[3],m_MVP.m_openGL[7],m_MVP.m_openGL[11],m_MVP.m_openGL[15]);
+  text.sprintf("[ %+0.4f %+0.4f %+0.4f %+0.4f]",MVP.m_openGL[3],MVP.m_openGL[7],MVP.m_openGL[11],MVP.m_openGL[15]);
   m_text->renderText(tp,18*5,text );
 
-  ngl::Mat4 M=m_scaleMat*m_rZ*m_rY*m_rX*m_tranMat;
+  const ngl::Mat4 &M=m_transform.modelDisplay();
 
   tp=700;
   text.sprintf("Model Matrix");
@@ -214,13 +1015,13 @@ void NGLScene::paintGL()
   tp=10;
   text.sprintf("View Matrix");
   m_text->renderText(tp,18*34,text );
-  text.sprintf("[ %+0.4f %+0.4f %+0.4f %+0.4f]",m_view.m_openGL[0],m_view.m_openGL[4],m_view.m_openGL[8],m_view.m_openGL[12]);
+  text.sprintf("[ %+0.4f %+0.4f %+0.4f %+0.4f]",view.m_openGL[0],view.m_openGL[4],view.m_openGL[8],view.m_openGL[12]);
   m_text->renderText(tp,18*35,text );
-  text.sprintf("[ %+0.4f %+0.4f %+0.4f %+0.4f]",m_view.m_openGL[1],m_view.m_openGL[5],m_view.m_openGL[9],m_view.m_openGL[13]);
+  text.sprintf("[ %+0.4f %+0.4f %+0.4f %+0.4f]",view.m_openGL[1],view.m_openGL[5],view.m_openGL[9],view.m_openGL[13]);
   m_text->renderText(tp,18*36,text );
-  text.sprintf("[ %+0.4f %+0.4f %+0.4f %+0.4f]",m_view.m_openGL[2],m_view.m_openGL[6],m_view.m_openGL[10],m_view.m_openGL[14]);
+  text.sprintf("[ %+0.4f %+0.4f %+0.4f %+0.4f]",view.m_openGL[2],view.m_openGL[6],view.m_openGL[10],view.m_openGL[14]);
   m_text->renderText(tp,18*37,text );
-  text.sprintf("[ %+0.4f %+0.4f %+0.4f %+0.4f]",m_view.m_openGL[3],m_view.m_openGL[7],m_view.m_openGL[11],m_view.m_openGL[15]);
+  text.sprintf("[ %+0.4f %+0.4f %+0.4f %+0.4f]",view.m_openGL[3],view.m_openGL[7],view.m_openGL[11],view.m_openGL[15]);
   m_text->renderText(tp,18*38,text );
 
 
@@ -228,13 +1029,13 @@ void NGLScene::paintGL()
   tp=700;
   text.sprintf("Projection Matrix");
   m_text->renderText(tp,18*34,text );
-  text.sprintf("[ %+0.4f %+0.4f %+0.4f %+0.4f]",m_project.m_openGL[0],m_project.m_openGL[4],m_project.m_openGL[8],m_project.m_openGL[12]);
+  text.sprintf("[ %+0.4f %+0.4f %+0.4f %+0.4f]",project.m_openGL[0],project.m_openGL[4],project.m_openGL[8],project.m_openGL[12]);
   m_text->renderText(tp,18*35,text );
-  text.sprintf("[ %+0.4f %+0.4f %+0.4f %+0.4f]",m_project.m_openGL[1],m_project.m_openGL[5],m_project.m_openGL[9],m_project.m_openGL[13]);
+  text.sprintf("[ %+0.4f %+0.4f %+0.4f %+0.4f]",project.m_openGL[1],project.m_openGL[5],project.m_openGL[9],project.m_openGL[13]);
   m_text->renderText(tp,18*36,text );
-  text.sprintf("[ %+0.4f %+0.4f %+0.4f %+0.4f]",m_project.m_openGL[2],m_project.m_openGL[6],m_project.m_openGL[10],m_project.m_openGL[14]);
+  text.sprintf("[ %+0.4f %+0.4f %+0.4f %+0.4f]",project.m_openGL[2],project.m_openGL[6],project.m_openGL[10],project.m_openGL[14]);
   m_text->renderText(tp,18*37,text );
-  text.sprintf("[ %+0.4f %+0.4f %+0.4f %+0.4f]",m_project.m_openGL[3],m_project.m_openGL[7],m_project.m_openGL[11],m_project.m_openGL[15]);
+  text.sprintf("[ %+0.4f %+0.4f %+0.4f %+0.4f]",project.m_openGL[3],project.m_openGL[7],project.m_openGL[11],project.m_openGL[15]);
   m_text->renderText(tp,18*38,text );
 
   tp=10;
@@ -254,17 +1055,207 @@ void NGLScene::paintGL()
 
   m_text->renderText(tp,18*y++,text );
   m_text->setColour(1.0,1.0,0.0);
-  for(auto p : s_triVerts)
+  for(size_t i=0; i<m_clipVerts.size(); ++i)
   {
-    ngl::Vec4 pt=m_MVP*p;
-    std::cout<<"pt "<<pt<<M<<'\n';
+    ngl::Vec4 pt(m_clipVerts.x[i],m_clipVerts.y[i],m_clipVerts.z[i],m_clipVerts.w[i]);
     text.sprintf("[ %+0.4f %+0.4f %+0.4f %+0.4f]",pt.m_x,pt.m_y,pt.m_z,pt.m_w);
     m_text->renderText(tp,18*y++,text );
 
   }
+  y++;
+  const TransformState::Stats &stats=m_transform.frameStats();
+  m_text->setColour(1.0,1.0,1.0);
+  text.sprintf("Matrices rebuilt %u cached %u uploads %u skipped %u",
+               stats.recomputes,stats.cacheHits,stats.uploads,stats.uploadsSkipped);
+  m_text->renderText(tp,18*y++,text );
+  text.sprintf("Overlay per line %0.3f ms (T to toggle)",m_overlayTime);
+  m_text->renderText(tp,18*y++,text );
+  if(m_instancedMode)
+  {
+    text.sprintf("Instances %zu fill %0.3f ms",m_instanced->instanceCount(),m_instanced->fillTime());
+    m_text->renderText(tp,18*y++,text );
+  }
+  else if(m_cullMode)
+  {
+    const FrustumCuller::Stats &cull=m_culler.stats();
+    text.sprintf("Culled scene visible %zu / %zu cull %0.3f ms",cull.visible,cull.total,cull.cullMs);
+    m_text->renderText(tp,18*y++,text );
+  }
+  else if(m_computeMode)
+  {
+    text.sprintf("Compute transform %zu vertices (G to toggle)",m_compute->vertexCount());
+    m_text->renderText(tp,18*y++,text );
+  }
+  else if(m_streamer)
+  {
+    MeshStreamer::Stats stream=m_streamer->stats();
+    text.sprintf("Stream queue %zu in flight %zu KB done %zu MB %0.0f MB/s",stream.queueDepth,
+                 stream.bytesInFlight/1024,stream.bytesUploaded/(1024*1024),stream.lastMeshMBps);
+    m_text->renderText(tp,18*y++,text );
+  }
+  text.sprintf("Jobs %zu steals %zu busy %0.3f ms threads %u",
+               m_jobStats.tasks,m_jobStats.steals,m_jobStats.busyMs,m_jobs.numThreads());
+  m_text->renderText(tp,18*y++,text );
+  text.sprintf("Layout %s %zu bytes/vertex %zu bytes (K to cycle)",vertexLayoutName(),
+               m_packed ? m_packed->memory().bytesPerVertex : size_t(24),m_packed ? m_packed->memory().totalBytes : separateLayoutBytes());
+  m_text->renderText(tp,18*y++,text );
+  text.sprintf("Latency p50 %0.1f p99 %0.1f ms target %0.0f fps (H)",
+               m_latency.percentile(0.5f),m_latency.percentile(0.99f),m_pacer.targetRate());
+  m_text->renderText(tp,18*y++,text );
+  if(m_lodMode)
+    text.sprintf("Triangles %zu LOD %zu / %zu %0.1f px/unit (Z to toggle)",m_frameTriangles,m_lod->current(),
+                 m_lod->numLevels(),m_lod->pixelsPerUnit());
+  else
+    text.sprintf(m_lodBuild.valid() ? "Triangles %zu (building LOD)" : "Triangles %zu (Z for LOD)",m_frameTriangles);
+  m_text->renderText(tp,18*y++,text );
 
+  // the stage timings go between the vertex block and the view matrix
+  y=27;
+  text.sprintf("Stage ms  cpu min/avg/p99  gpu min/avg/p99 (E to export)");
+  m_text->renderText(tp,18*y++,text );
+  char line[128];
+  for(int i=0; i<NUM_PROFILE_STAGES; ++i)
+  {
+    formatProfileLine(i,line,sizeof(line));
+    m_text->renderText(tp,18*y++,line );
+  }
 
+  // the shader reload status has the right hand side between the model and projection matrices
+  tp=700;
+  for(int i=0; i<c_shaderLines; ++i)
+  {
+    if(formatShaderLine(i,line,sizeof(line)))
+      m_text->setColour(1.0,1.0,1.0);
+    else
+      m_text->setColour(1.0,0.0,0.0);
+    m_text->renderText(tp,18*(10+i),line );
+  }
+  m_text->setColour(1.0,1.0,1.0);
+  for(int i=0; i<c_pickLines; ++i)
+  {
+    formatPickLine(i,line,sizeof(line));
+    m_text->renderText(tp,18*(14+i),line );
+  }
+  for(int i=0; i<c_batchLines; ++i)
+  {
+    formatBatchLine(i,line,sizeof(line));
+    m_text->renderText(tp,18*(18+i),line );
+  }
+  for(int i=0; i<c_scaleLines; ++i)
+  {
+    formatScaleLine(i,line,sizeof(line));
+    m_text->renderText(tp,18*(21+i),line );
+  }
+}
 
+void NGLScene::createOverlay()
+{
+  // same layout as drawOverlayPerLine, each matrix gets a title line plus four rows
+  m_overlay.reset(new TextOverlay(QFont("Arial",18)));
+  m_overlay->setScreenSize(width(),height());
+  ngl::Vec3 white(1.0f,1.0f,1.0f);
+  m_overlayBlocks[MVP_BLOCK]=m_overlay->addBlock(10,18*1,5);
+  m_overlay->setLine(m_overlayBlocks[MVP_BLOCK],0,"MVP Matrix",white);
+  m_overlayBlocks[MODEL_BLOCK]=m_overlay->addBlock(700,18*1,5);
+  m_overlay->setLine(m_overlayBlocks[MODEL_BLOCK],0,"Model Matrix",white);
+  m_overlayBlocks[VIEW_BLOCK]=m_overlay->addBlock(10,18*34,5);
+  m_overlay->setLine(m_overlayBlocks[VIEW_BLOCK],0,"View Matrix",white);
+  m_overlayBlocks[PROJECT_BLOCK]=m_overlay->addBlock(700,18*34,5);
+  m_overlay->setLine(m_overlayBlocks[PROJECT_BLOCK],0,"Projection Matrix",white);
+  // the vertex block is the original verts, a gap, the transformed verts, a gap then the stats
+  int vertexBlock=m_overlay->addBlock(10,18*10,static_cast<int>(2*s_triVerts.size())+11);
+  m_overlayBlocks[VERTEX_BLOCK]=vertexBlock;
+  m_overlay->setLine(vertexBlock,0,"Original Triangle Vertices",white);
+  int line=1;
+  for(auto p : s_triVerts)
+    m_overlay->setLinef(vertexBlock,line++,white,"[ %+0.4f %+0.4f %+0.4f +1.0]",p.m_x,p.m_y,p.m_z);
+  m_overlay->setLine(vertexBlock,++line,"Transformed Triangle Vertices",ngl::Vec3(1.0f,0.0f,0.0f));
+  m_overlayBlocks[PROFILE_BLOCK]=m_overlay->addBlock(10,18*27,NUM_PROFILE_STAGES+1);
+  m_overlay->setLine(m_overlayBlocks[PROFILE_BLOCK],0,"Stage ms  cpu min/avg/p99  gpu min/avg/p99 (E to export)",white);
+  m_overlayBlocks[SHADER_BLOCK]=m_overlay->addBlock(700,18*10,c_shaderLines);
+  m_overlayBlocks[PICK_BLOCK]=m_overlay->addBlock(700,18*14,c_pickLines);
+  m_overlayBlocks[BATCH_BLOCK]=m_overlay->addBlock(700,18*18,c_batchLines);
+  m_overlayBlocks[SCALE_BLOCK]=m_overlay->addBlock(700,18*21,c_scaleLines);
+}
+
+void NGLScene::updateOverlayCached(float _fillTime)
+{
+  ngl::Vec3 white(1.0f,1.0f,1.0f);
+  int vertexBlock=m_overlayBlocks[VERTEX_BLOCK];
+  int line=static_cast<int>(s_triVerts.size())+3;
+  // the transformed verts only depend on the MVP so only reformat them when it changes
+  if(m_overlay->setMatrix(m_overlayBlocks[MVP_BLOCK],1,m_transform.MVP(),white))
+  {
+    for(size_t i=0; i<m_clipVerts.size(); ++i)
+      m_overlay->setLinef(vertexBlock,line+static_cast<int>(i),ngl::Vec3(1.0f,1.0f,0.0f),"[ %+0.4f %+0.4f %+0.4f %+0.4f]",
+                          m_clipVerts.x[i],m_clipVerts.y[i],m_clipVerts.z[i],m_clipVerts.w[i]);
+  }
+  m_overlay->setMatrix(m_overlayBlocks[MODEL_BLOCK],1,m_transform.modelDisplay(),white);
+  m_overlay->setMatrix(m_overlayBlocks[VIEW_BLOCK],1,m_transform.view(),white);
+  m_overlay->setMatrix(m_overlayBlocks[PROJECT_BLOCK],1,m_transform.project(),white);
+  line+=static_cast<int>(m_clipVerts.size())+1;
+  const TransformState::Stats &stats=m_transform.frameStats();
+  m_overlay->setLinef(vertexBlock,line++,white,"Matrices rebuilt %u cached %u uploads %u skipped %u",
+                      stats.recomputes,stats.cacheHits,stats.uploads,stats.uploadsSkipped);
+  m_overlay->setLinef(vertexBlock,line++,white,"Overlay cached %0.3f ms %u lines rebuilt (T to toggle)",
+                      m_overlayTime,m_overlay->linesRebuilt());
+  if(m_instancedMode)
+    m_overlay->setLinef(vertexBlock,line++,white,"Instances %zu fill %0.3f ms",m_instanced->instanceCount(),_fillTime);
+  else if(m_cullMode)
+    m_overlay->setLinef(vertexBlock,line++,white,"Culled scene visible %zu / %zu cull %0.3f ms",
+                        m_culler.stats().visible,m_culler.stats().total,m_culler.stats().cullMs);
+  else if(m_computeMode)
+    m_overlay->setLinef(vertexBlock,line++,white,"Compute transform %zu vertices (G to toggle)",m_compute->vertexCount());
+  else if(m_streamer)
+  {
+    MeshStreamer::Stats stream=m_streamer->stats();
+    m_overlay->setLinef(vertexBlock,line++,white,"Stream queue %zu in flight %zu KB done %zu MB %0.0f MB/s",stream.queueDepth,
+                        stream.bytesInFlight/1024,stream.bytesUploaded/(1024*1024),stream.lastMeshMBps);
+  }
+  else
+    m_overlay->setLine(vertexBlock,line++,"",white);
+  m_overlay->setLinef(vertexBlock,line++,white,"Jobs %zu steals %zu busy %0.3f ms threads %u",
+                      m_jobStats.tasks,m_jobStats.steals,m_jobStats.busyMs,m_jobs.numThreads());
+  m_overlay->setLinef(vertexBlock,line++,white,"Layout %s %zu bytes/vertex %zu bytes (K to cycle)",vertexLayoutName(),
+                      m_packed ? m_packed->memory().bytesPerVertex : size_t(24),m_packed ? m_packed->memory().totalBytes : separateLayoutBytes());
+  m_overlay->setLinef(vertexBlock,line++,white,"Latency p50 %0.1f p99 %0.1f ms target %0.0f fps (H)",
+                      m_latency.percentile(0.5f),m_latency.percentile(0.99f),m_pacer.targetRate());
+  if(m_lodMode)
+    m_overlay->setLinef(vertexBlock,line++,white,"Triangles %zu LOD %zu / %zu %0.1f px/unit (Z to toggle)",m_frameTriangles,
+                        m_lod->current(),m_lod->numLevels(),m_lod->pixelsPerUnit());
+  else
+    m_overlay->setLinef(vertexBlock,line++,white,m_lodBuild.valid() ? "Triangles %zu (building LOD)" : "Triangles %zu (Z for LOD)",
+                        m_frameTriangles);
+  // the summaries only change in FrameProfiler::beginFrame so are safe to read from this task
+  char text[128];
+  for(int i=0; i<NUM_PROFILE_STAGES; ++i)
+  {
+    formatProfileLine(i,text,sizeof(text));
+    m_overlay->setLine(m_overlayBlocks[PROFILE_BLOCK],i+1,text,white);
+  }
+  // the reload status only changes in ShaderReloader::poll which runs before the tasks
+  for(int i=0; i<c_shaderLines; ++i)
+  {
+    bool ok=formatShaderLine(i,text,sizeof(text));
+    m_overlay->setLine(m_overlayBlocks[SHADER_BLOCK],i,text,ok ? white : ngl::Vec3(1.0f,0.0f,0.0f));
+  }
+  // the pick is made in the setup stage before the tasks start
+  for(int i=0; i<c_pickLines; ++i)
+  {
+    formatPickLine(i,text,sizeof(text));
+    m_overlay->setLine(m_overlayBlocks[PICK_BLOCK],i,text,white);
+  }
+  for(int i=0; i<c_batchLines; ++i)
+  {
+    formatBatchLine(i,text,sizeof(text));
+    m_overlay->setLine(m_overlayBlocks[BATCH_BLOCK],i,text,white);
+  }
+  // the scale only changes at the start of the frame
+  for(int i=0; i<c_scaleLines; ++i)
+  {
+    formatScaleLine(i,text,sizeof(text));
+    m_overlay->setLine(m_overlayBlocks[SCALE_BLOCK],i,text,white);
+  }
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -273,6 +1264,7 @@ void NGLScene::keyPressEvent(QKeyEvent *_event)
 {
   // this method is called every time the main window recives a key event.
   // we then switch on the key value and set the camera in the GLWindow
+  m_session.record(InputSession::EventType::Key,m_frame,_event->key());
   switch (_event->key())
   {
   // escape key to quit
@@ -285,50 +1277,82 @@ void NGLScene::keyPressEvent(QKeyEvent *_event)
   case Qt::Key_F : showFullScreen(); break;
   // show windowed
   case Qt::Key_N : showNormal(); break;
-  // position
-  case Qt::Key_Up : m_pos.m_y+=0.1f; break;
-  case Qt::Key_Down : m_pos.m_y-=0.1f; break;
-  case Qt::Key_Left : m_pos.m_x-=0.1f; break;
-  case Qt::Key_Right : m_pos.m_x+=0.1f; break;
-  case Qt::Key_I : m_pos.m_z-=0.1f; break;
-  case Qt::Key_O : m_pos.m_z+=0.1f; break;
-
-  case Qt::Key_1 : m_rot.m_x+=2.0; break;
-  case Qt::Key_2 : m_rot.m_x-=2.0; break;
-  case Qt::Key_3 : m_rot.m_y+=2.0; break;
-  case Qt::Key_4 : m_rot.m_y-=2.0; break;
-  case Qt::Key_5 : m_rot.m_z+=2.0; break;
-  case Qt::Key_6 : m_rot.m_z-=2.0; break;
-
-
-  case Qt::Key_8 : m_scale.m_x+=0.1; break;
-  case Qt::Key_9 : m_scale.m_y+=0.1; break;
-  case Qt::Key_0 : m_scale.m_z+=0.1; break;
-  case Qt::Key_Minus : m_scale.m_x-=0.1; break;
-  case Qt::Key_Equal : m_scale.m_y-=0.1; break;
-  case Qt::Key_Backspace : m_scale.m_z-=0.1; break;
-
-
-  case Qt::Key_P :
-    m_project=ngl::perspective(35.0,float(width()/height()),0.1f,500);
+  // render the current frame on the cpu
+  case Qt::Key_R : renderSoftware("softwareRender.ppm"); break;
+  // switch between the cached and per line text overlay
+  case Qt::Key_T : m_cachedOverlay^=true; break;
+  // start / stop the binary frame trace
+  case Qt::Key_L : m_trace.toggle("frameTrace.bin"); break;
+  // start / stop recording the input for replaying with --replay
+  case Qt::Key_Y : m_session.toggle("inputSession.rec"); break;
+  // instanced mode and the number of instances
+  case Qt::Key_X : m_instancedMode^=true; break;
+  case Qt::Key_BracketLeft : m_instanced->setInstanceCount(m_instanced->instanceCount()/2); break;
+  case Qt::Key_BracketRight : m_instanced->setInstanceCount(m_instanced->instanceCount()*2); break;
+  // grid of objects drawn one at a time after frustum culling, the single triangle's uniforms
+  // are overwritten by the per object ones so force them to be sent again
+  case Qt::Key_C : m_cullMode^=true; m_transform.invalidate(); break;
+  // cycle the vertex layout of the single mesh between the original buffers and the packed ones
+  case Qt::Key_K : m_vertexLayout=m_vertexLayout<2 ? m_vertexLayout+1 : -1; createPackedMesh(); break;
+  // write the kept per stage timings for the dashboards
+  case Qt::Key_E :
+    if(m_profiler.writeCSV("frameProfile.csv") && m_profiler.writeJSON("frameProfile.json"))
+      std::cout<<"frame profile written to frameProfile.csv and frameProfile.json\n";
+  break;
+  // transform on the gpu with the compute shader
+  case Qt::Key_G :
+    if(m_computeSupported)
+    {
+      m_computeMode^=true;
+      if(m_computeMode && !m_compute)
+        createComputeTransform();
+    }
+  break;
+  // print the input to present latency histogram
+  case Qt::Key_H : m_latency.print(std::cout); break;
+  // draw the single mesh at the level its projected size needs
+  case Qt::Key_Z :
+    // the first press builds the chain in the background, LOD mode comes on when it arrives
+    if(m_lod)
+      m_lodMode^=true;
+    else if(!m_lodBuild.valid())
+      startMeshLodBuild();
+  break;
+  // pick the triangle under the cursor
+  case Qt::Key_B :
+    // as with the LOD chain the first press builds the tree in the background
+    if(m_bvh)
+      m_pickMode^=true;
+    else if(!m_bvhBuild.valid())
+      startPickBVHBuild();
   break;
-  case Qt::Key_M :
-    m_project=ngl::ortho(-10,10,-10,10,10,-10);
+  // many different meshes in one multi draw call, and the same draws one call at a time
+  case Qt::Key_D :
+    if(m_batchSupported)
+    {
+      m_batchMode^=true;
+      if(m_batchMode && !m_batch)
+        createBatchScene();
+    }
   break;
-  case Qt::Key_V :
-    m_view=ngl::lookAt(ngl::Vec3(0,0,2),ngl::Vec3(0,0,0),ngl::Vec3(0,1,0));
+  case Qt::Key_A : m_batchMultiDraw^=true; break;
+  // render the scene at whatever size keeps the frame inside its budget, starting from full size
+  case Qt::Key_U :
+    m_scaleMode=!m_scaleMode && m_scaleSupported;
+    m_scaler.reset();
+    m_scaleSampled=false;
+    if(!m_scaleMode)
+      m_sceneFBO.reset();
   break;
-  case Qt::Key_Space :
-    m_project.identity();
-    m_view.identity();
-    m_rot.set(0.0,0.0,0.0);
-    m_pos.set(0.0,0.0,0.0);
-    m_scaleMat.identity();
-    m_tranMat.identity();
-    m_scale.set(1.0,1.0,1.0);
+  // print the per task timings of the last frame
+  case Qt::Key_J :
+    for(const auto &t : m_jobs.timings())
+      std::cout<<t.name<<" thread "<<t.thread<<" start "<<t.startMs<<" ms duration "<<t.durationMs<<" ms\n";
   break;
-  default : break;
+  // everything that moves the model or camera, the replay shares it
+  default : InputSession::applyTransformKey(m_transform,_event->key(),float(width()/height())); break;
   }
-  // finally update the GLWindow and re-draw
-    update();
+  // finally ask for a re-draw at the next paced frame
+  m_input.addEvent();
+  scheduleFrame();
 }
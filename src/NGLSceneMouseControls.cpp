@@ -8,27 +8,15 @@ void NGLScene::mouseMoveEvent( QMouseEvent* _event )
   // note the method buttons() is the button state when event was called
   // that is different from button() which is used to check which button was
   // pressed when the mousePress/Release event is generated
-  if ( m_win.rotate && _event->buttons() == Qt::LeftButton )
-  {
-    int diffx = _event->x() - m_win.origX;
-    int diffy = _event->y() - m_win.origY;
-    m_win.spinXFace += static_cast<int>( 0.5f * diffy );
-    m_win.spinYFace += static_cast<int>( 0.5f * diffx );
-    m_win.origX = _event->x();
-    m_win.origY = _event->y();
-    update();
-  }
-  // right mouse translate code
-  else if ( m_win.translate && _event->buttons() == Qt::RightButton )
-  {
-    int diffX      = static_cast<int>( _event->x() - m_win.origXPos );
-    int diffY      = static_cast<int>( _event->y() - m_win.origYPos );
-    m_win.origXPos = _event->x();
-    m_win.origYPos = _event->y();
-    m_modelPos.m_x += INCREMENT * diffX;
-    m_modelPos.m_y -= INCREMENT * diffY;
-    update();
-  }
+  m_session.record( InputSession::EventType::MouseMove, m_frame, 0, static_cast<int>( _event->buttons() ), _event->x(), _event->y() );
+  // the pick is made with the next frame's matrices
+  m_cursorX = _event->x();
+  m_cursorY = _event->y();
+  if ( m_pickMode )
+    scheduleFrame();
+  // left drag rotates and right drag translates, InputSession shares this with the replay
+  if ( InputSession::applyMouseEvent( InputSession::EventType::MouseMove, 0, static_cast<int>( _event->buttons() ), _event->x(), _event->y(), m_win, m_input ) )
+    scheduleFrame();
 }
 
 
@@ -37,19 +25,8 @@ void NGLScene::mousePressEvent( QMouseEvent* _event )
 {
   // that method is called when the mouse button is pressed in this case we
   // store the value where the maouse was clicked (x,y) and set the Rotate flag to true
-  if ( _event->button() == Qt::LeftButton )
-  {
-    m_win.origX  = _event->x();
-    m_win.origY  = _event->y();
-    m_win.rotate = true;
-  }
-  // right mouse translate mode
-  else if ( _event->button() == Qt::RightButton )
-  {
-    m_win.origXPos  = _event->x();
-    m_win.origYPos  = _event->y();
-    m_win.translate = true;
-  }
+  m_session.record( InputSession::EventType::MousePress, m_frame, static_cast<int>( _event->button() ), static_cast<int>( _event->buttons() ), _event->x(), _event->y() );
+  InputSession::applyMouseEvent( InputSession::EventType::MousePress, static_cast<int>( _event->button() ), static_cast<int>( _event->buttons() ), _event->x(), _event->y(), m_win, m_input );
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -57,15 +34,8 @@ void NGLScene::mouseReleaseEvent( QMouseEvent* _event )
 {
   // that event is called when the mouse button is released
   // we then set Rotate to false
-  if ( _event->button() == Qt::LeftButton )
-  {
-    m_win.rotate = false;
-  }
-  // right mouse translate mode
-  if ( _event->button() == Qt::RightButton )
-  {
-    m_win.translate = false;
-  }
+  m_session.record( InputSession::EventType::MouseRelease, m_frame, static_cast<int>( _event->button() ), static_cast<int>( _event->buttons() ), _event->x(), _event->y() );
+  InputSession::applyMouseEvent( InputSession::EventType::MouseRelease, static_cast<int>( _event->button() ), static_cast<int>( _event->buttons() ), _event->x(), _event->y(), m_win, m_input );
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -73,13 +43,7 @@ void NGLScene::wheelEvent( QWheelEvent* _event )
 {
 
   // check the diff of the wheel position (0 means no change)
-  if ( _event->delta() > 0 )
-  {
-    m_modelPos.m_z += ZOOM;
-  }
-  else if ( _event->delta() < 0 )
-  {
-    m_modelPos.m_z -= ZOOM;
-  }
-  update();
+  m_session.record( InputSession::EventType::Wheel, m_frame, _event->delta() );
+  InputSession::applyMouseEvent( InputSession::EventType::Wheel, _event->delta(), 0, 0, 0, m_win, m_input );
+  scheduleFrame();
 }
@@ -0,0 +1,503 @@
+#include "OffscreenRenderer.h"
+#include "MappedMesh.h"
+#include "ShaderCache.h"
+#include <ngl/ShaderLib.h>
+#include <ngl/Util.h>
+#include <ngl/Vec4.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace
+{
+double elapsedMs(std::chrono::high_resolution_clock::time_point _start)
+{
+  return std::chrono::duration<double,std::milli>(std::chrono::high_resolution_clock::now()-_start).count();
+}
+
+bool readVec3(std::istringstream &_line, ngl::Vec3 &_v)
+{
+  return static_cast<bool>(_line>>_v.m_x>>_v.m_y>>_v.m_z);
+}
+
+// NGLScene's starting camera, the replayed keys are applied on top of it
+const ngl::Vec3 c_replayEye(0.0f,1.0f,1.0f);
+
+void writeStat(std::ostream &_out, const char *_key, double _value, bool _last=false)
+{
+  _out<<"  \""<<_key<<"\": "<<_value<<(_last ? "\n" : ",\n");
+}
+} // end anon namespace
+
+OffscreenRenderer::OffscreenRenderer(int _width, int _height, const std::string &_meshFile, unsigned int _encodeThreads) :
+  m_width(_width),
+  m_height(_height)
+{
+  m_pbos.fill(0);
+  m_fences.fill(nullptr);
+  ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+  const char *cacheDir=std::getenv("MVP_SHADER_CACHE");
+  ShaderCache cache(cacheDir ? cacheDir : ".shadercache");
+  if(!cache.loadProgram("Phong",{{"PhongVertex",ngl::ShaderType::VERTEX,"shaders/PhongVertex.glsl"},
+                                 {"PhongFragment",ngl::ShaderType::FRAGMENT,"shaders/PhongFragment.glsl"}}))
+    return;
+  TransformUBO::bindBlock(shader->getProgramID("Phong"));
+  m_transformUBO.reset(new TransformUBO(1));
+  // the same light and material as the interactive view
+  (*shader)["Phong"]->use();
+  shader->setUniform("light.position",ngl::Vec4(0.0f,2.0f,2.0f,0.0f));
+  shader->setUniform("light.ambient",0.0f,0.0f,0.0f,1.0f);
+  shader->setUniform("light.diffuse",1.0f,1.0f,1.0f,1.0f);
+  shader->setUniform("light.specular",0.8f,0.8f,0.8f,1.0f);
+  shader->setUniform("material.ambient",0.274725f,0.1995f,0.0745f,0.0f);
+  shader->setUniform("material.diffuse",0.75164f,0.60648f,0.22648f,0.0f);
+  shader->setUniform("material.specular",0.628281f,0.555802f,0.3666065f,0.0f);
+  shader->setUniform("material.shininess",51.2f);
+
+  if(_meshFile.empty())
+  {
+    const float verts[]={0.0f,0.5f,0.0f, 0.5f,-0.5f,0.0f, -0.5f,-0.5f,0.0f};
+    const float normals[]={0.0f,1.0f,0.0f, 0.0f,1.0f,0.0f, 0.0f,1.0f,0.0f};
+    m_mesh.reset(new PackedMesh(verts,normals,3,nullptr,0,PackedMesh::Format::Float));
+  }
+  else
+  {
+    MappedMesh mesh;
+    if(!mesh.open(_meshFile))
+      return;
+    m_mesh.reset(new PackedMesh(mesh.positions(),mesh.normals(),mesh.vertexCount(),
+                                mesh.indices(),mesh.indexCount(),PackedMesh::Format::Float));
+  }
+  m_mesh->setDecodeUniforms();
+
+  m_fbo.reset(new QOpenGLFramebufferObject(m_width,m_height,QOpenGLFramebufferObject::Depth));
+  if(!m_fbo->isValid())
+  {
+    std::cerr<<"OffscreenRenderer unable to create a "<<m_width<<"x"<<m_height<<" framebuffer\n";
+    return;
+  }
+  // each PBO holds one tightly packed RGB frame
+  glGenBuffers(c_numPBOs,m_pbos.data());
+  for(GLuint pbo : m_pbos)
+  {
+    glBindBuffer(GL_PIXEL_PACK_BUFFER,pbo);
+    glBufferData(GL_PIXEL_PACK_BUFFER,m_width*m_height*3,nullptr,GL_STREAM_READ);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER,0);
+
+  if(_encodeThreads==0)
+    _encodeThreads=std::max(2u,std::thread::hardware_concurrency())-1;
+  m_maxPending=2*_encodeThreads;
+  for(unsigned int i=0; i<_encodeThreads; ++i)
+    m_encoders.emplace_back(&OffscreenRenderer::encodeLoop,this);
+  m_valid=true;
+}
+
+OffscreenRenderer::~OffscreenRenderer()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_queueLock);
+    m_quit=true;
+  }
+  m_queueChanged.notify_all();
+  for(auto &t : m_encoders)
+    t.join();
+  for(GLsync fence : m_fences)
+    if(fence)
+      glDeleteSync(fence);
+  if(m_pbos[0])
+    glDeleteBuffers(c_numPBOs,m_pbos.data());
+}
+
+bool OffscreenRenderer::render(const std::vector<BatchFrame> &_frames, const std::string &_outPattern)
+{
+  m_stats=Stats();
+  std::string name;
+  if(!frameName(_outPattern,0,name))
+  {
+    std::cerr<<"output pattern "<<_outPattern<<" needs exactly one %d (e.g. frame%04d.ppm)\n";
+    return false;
+  }
+  if(!m_valid)
+    return false;
+  m_writeFailed=false;
+  auto start=std::chrono::high_resolution_clock::now();
+  m_fbo->bind();
+  glViewport(0,0,m_width,m_height);
+  glEnable(GL_DEPTH_TEST);
+  glClearColor(0.4f,0.4f,0.4f,1.0f);
+  glPixelStorei(GL_PACK_ALIGNMENT,1);
+  for(size_t i=0; i<_frames.size(); ++i)
+  {
+    // the slot for this frame still holds frame i-c_numPBOs, by now that readback has had the
+    // whole of the frames since to complete so mapping it rarely waits
+    size_t slot=i%c_numPBOs;
+    if(i>=c_numPBOs)
+      collect(i-c_numPBOs,_outPattern);
+    drawFrame(_frames[i]);
+    // with a pack buffer bound glReadPixels only queues the copy and returns straight away
+    glBindBuffer(GL_PIXEL_PACK_BUFFER,m_pbos[slot]);
+    glReadPixels(0,0,m_width,m_height,GL_RGB,GL_UNSIGNED_BYTE,nullptr);
+    m_fences[slot]=glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE,0);
+  }
+  size_t first=_frames.size()>c_numPBOs ? _frames.size()-c_numPBOs : 0;
+  for(size_t i=first; i<_frames.size(); ++i)
+    collect(i,_outPattern);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER,0);
+  m_fbo->release();
+
+  std::unique_lock<std::mutex> lock(m_queueLock);
+  m_queueChanged.wait(lock,[this](){ return m_pending==0; });
+  m_stats.frames=_frames.size();
+  m_stats.seconds=elapsedMs(start)/1000.0;
+  m_stats.framesPerSecond=m_stats.seconds>0.0 ? m_stats.frames/m_stats.seconds : 0.0;
+  return !m_writeFailed;
+}
+
+void OffscreenRenderer::drawFrame(const BatchFrame &_frame)
+{
+  m_transform.beginFrame();
+  m_transform.setPosition(_frame.position);
+  m_transform.setRotation(_frame.rotation);
+  m_transform.setScale(_frame.scale);
+  m_transform.setView(ngl::lookAt(_frame.eye,_frame.target,_frame.up));
+  m_transform.setProject(ngl::perspective(_frame.fov,static_cast<float>(m_width)/m_height,_frame.zNear,_frame.zFar));
+  drawTransform(_frame.eye);
+}
+
+void OffscreenRenderer::drawTransform(const ngl::Vec3 &_eye)
+{
+  m_transform.update();
+  ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+  if(m_transform.needsUpload())
+  {
+    m_transformUBO->begin(1);
+    m_transformUBO->set(0,m_transform.MVP(),m_transform.MV(),m_transform.M(),m_transform.normalMatrix());
+    m_transformUBO->upload();
+    m_transformUBO->bind(0);
+    m_transform.markUploaded();
+  }
+  shader->setUniform("viewerPos",_eye);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  m_mesh->draw();
+  m_transformUBO->end();
+}
+
+bool OffscreenRenderer::replay(const InputSession &_session, bool _realtime, ReplayReport &_report)
+{
+  _report.frames=_report.events=_report.ignored=0;
+  _report.frameMs.clear();
+  _report.frameMs.reserve(_session.frameCount());
+  if(!m_valid)
+    return false;
+  // the frame as a whole is timed for the report
+  enum Stage { INPUT_STAGE, DRAW_STAGE };
+  FrameProfiler profiler;
+  for(auto name : {"input","draw"})
+    profiler.addStage(name);
+  profiler.initGL();
+
+  m_transform.reset();
+  m_transform.setView(ngl::lookAt(c_replayEye,ngl::Vec3(0.0f,0.0f,0.0f),ngl::Vec3(0.0f,1.0f,0.0f)));
+  m_transform.setProject(ngl::perspective(45.0f,720.0f/576.0f,0.05f,350.0f));
+  // NGLScene works the aspect out in ints, the same here so P gives the same projection
+  float aspect=static_cast<float>(m_width/m_height);
+  m_fbo->bind();
+  glViewport(0,0,m_width,m_height);
+  glEnable(GL_DEPTH_TEST);
+  glClearColor(0.4f,0.4f,0.4f,1.0f);
+  // the mouse goes through the same accumulator as in the window and is applied at each frame
+  WinParams win;
+  ngl::Vec3 modelPos(0.0f,0.0f,0.0f);
+  InputAccumulator input;
+  auto start=std::chrono::high_resolution_clock::now();
+  auto frameStart=start;
+  bool inputStarted=false;
+  for(const auto &event : _session.events())
+  {
+    if(!inputStarted)
+    {
+      profiler.beginFrame();
+      profiler.begin(INPUT_STAGE);
+      frameStart=std::chrono::high_resolution_clock::now();
+      inputStarted=true;
+    }
+    if(event.type!=InputSession::EventType::Frame)
+    {
+      ++_report.events;
+      // only keys NGLScene uses for something other than the transforms are left out
+      if(event.type!=InputSession::EventType::Key)
+        InputSession::applyMouseEvent(event.type,event.code,event.buttons,event.x,event.y,win,input);
+      else if(!InputSession::applyTransformKey(m_transform,event.code,aspect))
+        ++_report.ignored;
+      continue;
+    }
+    input.take().apply(win,modelPos);
+    profiler.end(INPUT_STAGE);
+    if(_realtime)
+    {
+      // the wait isn't part of the frame
+      std::this_thread::sleep_until(start+std::chrono::microseconds(static_cast<int64_t>(event.ms*1000.0)));
+      frameStart=std::chrono::high_resolution_clock::now();
+    }
+    {
+      FrameProfiler::Scope scope(profiler,DRAW_STAGE);
+      m_transform.beginFrame();
+      drawTransform(c_replayEye);
+      // without the swap nothing waits for the gpu, finishing here puts its time in the frame
+      glFinish();
+    }
+    profiler.endFrame();
+    _report.frameMs.push_back(static_cast<float>(elapsedMs(frameStart)));
+    ++_report.frames;
+    inputStarted=false;
+  }
+  // events after the last frame marker never made it to the screen
+  if(inputStarted)
+  {
+    profiler.end(INPUT_STAGE);
+    profiler.endFrame();
+  }
+  m_fbo->release();
+  _report.seconds=elapsedMs(start)/1000.0;
+  // empty frames to bring the last gpu results back and into the summaries
+  for(int i=0; i<=FrameProfiler::c_latency; ++i)
+  {
+    profiler.beginFrame();
+    profiler.endFrame();
+  }
+  _report.stageNames.clear();
+  _report.stages.clear();
+  for(size_t i=0; i<profiler.numStages(); ++i)
+  {
+    _report.stageNames.push_back(profiler.stageName(static_cast<int>(i)));
+    _report.stages.push_back(profiler.summary(static_cast<int>(i)));
+  }
+  return true;
+}
+
+bool OffscreenRenderer::frameName(const std::string &_pattern, size_t _frame, std::string &_name)
+{
+  _name.clear();
+  int conversions=0;
+  for(size_t i=0; i<_pattern.size(); ++i)
+  {
+    if(_pattern[i]!='%')
+    {
+      _name+=_pattern[i];
+      continue;
+    }
+    if(++i<_pattern.size() && _pattern[i]=='%')
+    {
+      _name+='%';
+      continue;
+    }
+    bool zeroPad=i<_pattern.size() && _pattern[i]=='0';
+    size_t width=0;
+    for(; i<_pattern.size() && std::isdigit(static_cast<unsigned char>(_pattern[i])) && width<64; ++i)
+      width=width*10+static_cast<size_t>(_pattern[i]-'0');
+    if(i>=_pattern.size() || _pattern[i]!='d' || ++conversions>1)
+      return false;
+    std::string number=std::to_string(_frame);
+    if(number.size()<width)
+      _name.append(width-number.size(),zeroPad ? '0' : ' ');
+    _name+=number;
+  }
+  return conversions==1;
+}
+
+void OffscreenRenderer::collect(size_t _frame, const std::string &_outPattern)
+{
+  size_t slot=_frame%c_numPBOs;
+  auto start=std::chrono::high_resolution_clock::now();
+  // flush on the first wait in case the fence hasn't been submitted yet
+  GLbitfield flags=GL_SYNC_FLUSH_COMMANDS_BIT;
+  while(glClientWaitSync(m_fences[slot],flags,1000000)==GL_TIMEOUT_EXPIRED)
+    flags=0;
+  glDeleteSync(m_fences[slot]);
+  m_fences[slot]=nullptr;
+
+  EncodeJob job;
+  frameName(_outPattern,_frame,job.fname);
+  size_t size=static_cast<size_t>(m_width)*m_height*3;
+  glBindBuffer(GL_PIXEL_PACK_BUFFER,m_pbos[slot]);
+  const unsigned char *pixels=static_cast<const unsigned char *>(glMapBufferRange(GL_PIXEL_PACK_BUFFER,0,size,GL_MAP_READ_BIT));
+  if(pixels)
+    job.pixels.assign(pixels,pixels+size);
+  glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  m_stats.readbackWaitMs+=elapsedMs(start);
+
+  start=std::chrono::high_resolution_clock::now();
+  {
+    std::unique_lock<std::mutex> lock(m_queueLock);
+    m_queueChanged.wait(lock,[this](){ return m_pending<m_maxPending; });
+    m_queue.push_back(std::move(job));
+    ++m_pending;
+  }
+  m_queueChanged.notify_all();
+  m_stats.encodeWaitMs+=elapsedMs(start);
+}
+
+void OffscreenRenderer::encodeLoop()
+{
+  for(;;)
+  {
+    EncodeJob job;
+    {
+      std::unique_lock<std::mutex> lock(m_queueLock);
+      m_queueChanged.wait(lock,[this](){ return m_quit || !m_queue.empty(); });
+      if(m_queue.empty())
+        return;
+      job=std::move(m_queue.front());
+      m_queue.pop_front();
+    }
+    // binary PPM, GL rows start at the bottom so they are written in reverse
+    bool ok=false;
+    if(!job.pixels.empty())
+    {
+      std::ofstream file(job.fname.c_str(),std::ios::binary);
+      file<<"P6\n"<<m_width<<' '<<m_height<<"\n255\n";
+      size_t rowSize=static_cast<size_t>(m_width)*3;
+      for(int y=m_height-1; y>=0; --y)
+        file.write(reinterpret_cast<const char *>(&job.pixels[y*rowSize]),static_cast<std::streamsize>(rowSize));
+      ok=static_cast<bool>(file);
+    }
+    if(!ok)
+      std::cerr<<"OffscreenRenderer unable to write "<<job.fname<<'\n';
+    {
+      std::lock_guard<std::mutex> lock(m_queueLock);
+      m_writeFailed|=!ok;
+      --m_pending;
+    }
+    m_queueChanged.notify_all();
+  }
+}
+
+bool OffscreenRenderer::parseScript(const std::string &_fname, std::vector<BatchFrame> &_frames)
+{
+  std::ifstream file(_fname.c_str());
+  if(!file.is_open())
+  {
+    std::cerr<<"OffscreenRenderer unable to open "<<_fname<<'\n';
+    return false;
+  }
+  BatchFrame frame;
+  std::string text;
+  int lineNumber=0;
+  while(std::getline(file,text))
+  {
+    ++lineNumber;
+    text=text.substr(0,text.find('#'));
+    std::istringstream line(text);
+    std::string key;
+    int repeat=1;
+    ngl::Vec3 spin(0.0f,0.0f,0.0f);
+    bool any=false;
+    bool ok=true;
+    while(ok && line>>key)
+    {
+      any=true;
+      if(key=="position")
+        ok=readVec3(line,frame.position);
+      else if(key=="rotation")
+        ok=readVec3(line,frame.rotation);
+      else if(key=="scale")
+        ok=readVec3(line,frame.scale);
+      else if(key=="eye")
+        ok=readVec3(line,frame.eye);
+      else if(key=="target")
+        ok=readVec3(line,frame.target);
+      else if(key=="up")
+        ok=readVec3(line,frame.up);
+      else if(key=="spin")
+        ok=readVec3(line,spin);
+      else if(key=="fov")
+        ok=static_cast<bool>(line>>frame.fov);
+      else if(key=="near")
+        ok=static_cast<bool>(line>>frame.zNear);
+      else if(key=="far")
+        ok=static_cast<bool>(line>>frame.zFar);
+      else if(key=="repeat")
+        ok=static_cast<bool>(line>>repeat) && repeat>0;
+      else
+        ok=false;
+    }
+    if(!ok)
+    {
+      std::cerr<<_fname<<':'<<lineNumber<<" unknown keyword or bad value for "<<key<<'\n';
+      return false;
+    }
+    if(!any)
+      continue;
+    // the last frame emitted is the starting point for the next line
+    for(int i=0; i<repeat; ++i)
+    {
+      if(i>0)
+        frame.rotation+=spin;
+      _frames.push_back(frame);
+    }
+  }
+  return true;
+}
+
+float ReplayReport::percentile(float _p) const
+{
+  if(frameMs.empty())
+    return 0.0f;
+  std::vector<float> sorted(frameMs);
+  std::sort(sorted.begin(),sorted.end());
+  size_t i=static_cast<size_t>(_p*(sorted.size()-1)+0.5f);
+  return sorted[std::min(i,sorted.size()-1)];
+}
+
+void ReplayReport::print(std::ostream &_out) const
+{
+  _out<<session<<' '<<frames<<" frames "<<events<<" events ("<<ignored<<" ignored) in "<<seconds<<" s\n"
+      <<"frame ms p50 "<<percentile(0.5f)<<" p95 "<<percentile(0.95f)<<" p99 "<<percentile(0.99f)
+      <<" max "<<percentile(1.0f)<<'\n';
+  for(size_t i=0; i<stages.size(); ++i)
+    _out<<"  "<<stageNames[i]<<" cpu avg "<<stages[i].cpuAvg<<" p99 "<<stages[i].cpuP99
+        <<" gpu avg "<<stages[i].gpuAvg<<" p99 "<<stages[i].gpuP99<<'\n';
+}
+
+bool ReplayReport::writeJSON(const std::string &_fname) const
+{
+  std::ofstream file(_fname.c_str());
+  if(!file.is_open())
+  {
+    std::cerr<<"ReplayReport unable to write "<<_fname<<'\n';
+    return false;
+  }
+  // PerfCompare gates on the mean, p50, p95 and stage averages and prints the rest of the _ms
+  // values, the counts are there to spot a changed session
+  double sum=0.0;
+  for(float ms : frameMs)
+    sum+=ms;
+  file<<"{\n  \"session\": \""<<session<<"\",\n";
+  writeStat(file,"frames",static_cast<double>(frames));
+  writeStat(file,"events",static_cast<double>(events));
+  writeStat(file,"ignored",static_cast<double>(ignored));
+  writeStat(file,"seconds",seconds);
+  writeStat(file,"frame_mean_ms",frameMs.empty() ? 0.0 : sum/frameMs.size());
+  writeStat(file,"frame_p50_ms",percentile(0.5f));
+  writeStat(file,"frame_p95_ms",percentile(0.95f));
+  writeStat(file,"frame_p99_ms",percentile(0.99f));
+  writeStat(file,"frame_max_ms",percentile(1.0f),stages.empty());
+  for(size_t i=0; i<stages.size(); ++i)
+  {
+    std::string name="stage_"+stageNames[i];
+    std::replace(name.begin(),name.end(),' ','_');
+    writeStat(file,(name+"_cpu_avg_ms").c_str(),stages[i].cpuAvg);
+    writeStat(file,(name+"_cpu_p99_ms").c_str(),stages[i].cpuP99);
+    writeStat(file,(name+"_gpu_avg_ms").c_str(),stages[i].gpuAvg);
+    writeStat(file,(name+"_gpu_p99_ms").c_str(),stages[i].gpuP99,i+1==stages.size());
+  }
+  file<<"}\n";
+  return static_cast<bool>(file);
+}
@@ -0,0 +1,250 @@
+#include "PackedMesh.h"
+#include <ngl/ShaderLib.h>
+#include <ngl/SimpleIndexVAO.h>
+#include <ngl/VAOFactory.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+//----------------------------------------------------------------------------------------------------------------------
+// quantized vertices are 4 x uint16 / half position (the last is padding) then 2 x snorm16 normal
+//----------------------------------------------------------------------------------------------------------------------
+struct QuantizedVertex
+{
+  uint16_t position[4];
+  int16_t normal[2];
+};
+static_assert(sizeof(QuantizedVertex)==12,"quantized vertex must be tightly packed");
+} // end anon namespace
+
+PackedMesh::PackedMesh(const float *_positions, const float *_normals, size_t _numVerts,
+                       const uint32_t *_indices, size_t _numIndices, Format _format) :
+  m_format(_format)
+{
+  // without indices draw the vertices in order
+  std::vector<uint32_t> ordered;
+  if(_indices==nullptr)
+  {
+    ordered.resize(_numVerts);
+    for(size_t i=0; i<_numVerts; ++i)
+      ordered[i]=static_cast<uint32_t>(i);
+    _indices=ordered.data();
+    _numIndices=_numVerts;
+  }
+  float lo[3]={std::numeric_limits<float>::max(),std::numeric_limits<float>::max(),std::numeric_limits<float>::max()};
+  float hi[3]={-lo[0],-lo[1],-lo[2]};
+  for(size_t i=0; i<_numVerts*3; ++i)
+  {
+    lo[i%3]=std::min(lo[i%3],_positions[i]);
+    hi[i%3]=std::max(hi[i%3],_positions[i]);
+  }
+  // flat meshes still need a non zero extent to divide by
+  float extent[3];
+  for(int k=0; k<3; ++k)
+    extent[k]=hi[k]>lo[k] ? hi[k]-lo[k] : 1.0f;
+  if(_numVerts==0)
+    std::fill(lo,lo+3,0.0f);
+  m_boundsMin.set(lo[0],lo[1],lo[2]);
+  m_boundsExtent.set(extent[0],extent[1],extent[2]);
+
+  m_memory=memoryFor(_format,_numVerts,_numIndices);
+  std::vector<unsigned char> data(m_memory.vertexBytes);
+  if(_format==Format::Float)
+  {
+    float *out=reinterpret_cast<float *>(data.data());
+    for(size_t i=0; i<_numVerts; ++i)
+    {
+      std::copy(_positions+i*3,_positions+i*3+3,out+i*6);
+      std::copy(_normals+i*3,_normals+i*3+3,out+i*6+3);
+    }
+  }
+  else
+  {
+    QuantizedVertex *out=reinterpret_cast<QuantizedVertex *>(data.data());
+    for(size_t i=0; i<_numVerts; ++i)
+    {
+      QuantizedVertex &v=out[i];
+      float error=0.0f;
+      for(int k=0; k<3; ++k)
+      {
+        float p=_positions[i*3+k];
+        float decoded;
+        if(_format==Format::HalfOct)
+        {
+          v.position[k]=floatToHalf(p);
+          decoded=halfToFloat(v.position[k]);
+        }
+        else
+        {
+          float t=std::min(std::max((p-lo[k])/extent[k],0.0f),1.0f);
+          v.position[k]=static_cast<uint16_t>(std::lround(t*65535.0f));
+          decoded=lo[k]+(v.position[k]/65535.0f)*extent[k];
+        }
+        error+=(decoded-p)*(decoded-p);
+      }
+      v.position[3]=0;
+      m_maxPositionError=std::max(m_maxPositionError,std::sqrt(error));
+      octEncode(_normals+i*3,v.normal);
+    }
+  }
+
+  m_vao=ngl::VAOFactory::createVAO(ngl::simpleIndexVAO,GL_TRIANGLES);
+  m_vao->bind();
+  m_vao->setData(ngl::SimpleIndexVAO::VertexData(data.size(),*reinterpret_cast<const GLfloat *>(data.data()),
+                                                static_cast<unsigned int>(_numIndices),_indices,GL_UNSIGNED_INT));
+  // the data offsets are in floats
+  GLsizei stride=static_cast<GLsizei>(m_memory.bytesPerVertex);
+  switch(_format)
+  {
+    case Format::Float :
+      m_vao->setVertexAttributePointer(0,3,GL_FLOAT,stride,0);
+      m_vao->setVertexAttributePointer(1,3,GL_FLOAT,stride,3);
+    break;
+    case Format::HalfOct :
+      m_vao->setVertexAttributePointer(0,3,GL_HALF_FLOAT,stride,0);
+      m_vao->setVertexAttributePointer(1,2,GL_SHORT,stride,2,true);
+    break;
+    case Format::UNorm16Oct :
+      m_vao->setVertexAttributePointer(0,3,GL_UNSIGNED_SHORT,stride,0,true);
+      m_vao->setVertexAttributePointer(1,2,GL_SHORT,stride,2,true);
+    break;
+  }
+  m_vao->setNumIndices(_numIndices);
+  m_vao->unbind();
+}
+
+void PackedMesh::draw() const
+{
+  m_vao->bind();
+  m_vao->draw();
+  m_vao->unbind();
+}
+
+void PackedMesh::setDecodeUniforms() const
+{
+  ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+  shader->setUniform("quantizedPosition",m_format==Format::UNorm16Oct ? 1 : 0);
+  shader->setUniform("octNormal",m_format==Format::Float ? 0 : 1);
+  shader->setUniform("boundsMin",m_boundsMin);
+  shader->setUniform("boundsExtent",m_boundsExtent);
+}
+
+void PackedMesh::clearDecodeUniforms()
+{
+  ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+  shader->setUniform("quantizedPosition",0);
+  shader->setUniform("octNormal",0);
+}
+
+size_t PackedMesh::bytesPerVertex(Format _format)
+{
+  return _format==Format::Float ? 6*sizeof(float) : sizeof(QuantizedVertex);
+}
+
+PackedMesh::MemoryStats PackedMesh::memoryFor(Format _format, size_t _numVerts, size_t _numIndices)
+{
+  MemoryStats stats;
+  stats.format=_format;
+  stats.bytesPerVertex=bytesPerVertex(_format);
+  stats.vertexBytes=stats.bytesPerVertex*_numVerts;
+  stats.indexBytes=_numIndices*sizeof(uint32_t);
+  stats.totalBytes=stats.vertexBytes+stats.indexBytes;
+  return stats;
+}
+
+size_t PackedMesh::separateFloatBytes(size_t _numVerts, size_t _numIndices)
+{
+  return _numVerts*6*sizeof(float)+_numIndices*sizeof(uint32_t);
+}
+
+const char *PackedMesh::formatName(Format _format)
+{
+  switch(_format)
+  {
+    case Format::Float : return "interleaved float";
+    case Format::HalfOct : return "half + oct normal";
+    case Format::UNorm16Oct : return "unorm16 + oct normal";
+  }
+  return "unknown";
+}
+
+uint16_t PackedMesh::floatToHalf(float _v)
+{
+  uint32_t x;
+  std::memcpy(&x,&_v,sizeof(x));
+  uint16_t sign=static_cast<uint16_t>((x>>16) & 0x8000);
+  uint32_t exponent=(x>>23) & 0xff;
+  uint32_t mantissa=x & 0x7fffff;
+  if(exponent==0xff)
+    return static_cast<uint16_t>(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+  int e=static_cast<int>(exponent)-127+15;
+  if(e>=31)
+    return static_cast<uint16_t>(sign | 0x7c00);
+  if(e<=0)
+  {
+    // denormal half, or zero if it's too small
+    if(e<-10)
+      return sign;
+    mantissa|=0x800000;
+    uint32_t shift=static_cast<uint32_t>(14-e);
+    uint32_t h=mantissa>>shift;
+    uint32_t rest=mantissa & ((1u<<shift)-1);
+    uint32_t halfway=1u<<(shift-1);
+    if(rest>halfway || (rest==halfway && (h & 1)))
+      ++h;
+    return static_cast<uint16_t>(sign | h);
+  }
+  // round to nearest even, a carry out of the mantissa correctly bumps the exponent
+  uint32_t h=(static_cast<uint32_t>(e)<<10) | (mantissa>>13);
+  uint32_t rest=mantissa & 0x1fff;
+  if(rest>0x1000 || (rest==0x1000 && (h & 1)))
+    ++h;
+  return static_cast<uint16_t>(sign | h);
+}
+
+float PackedMesh::halfToFloat(uint16_t _h)
+{
+  float sign=(_h & 0x8000) ? -1.0f : 1.0f;
+  int exponent=(_h>>10) & 0x1f;
+  int mantissa=_h & 0x3ff;
+  if(exponent==0)
+    return sign*std::ldexp(static_cast<float>(mantissa),-24);
+  if(exponent==31)
+    return mantissa ? std::numeric_limits<float>::quiet_NaN() : sign*std::numeric_limits<float>::infinity();
+  return sign*std::ldexp(static_cast<float>(mantissa+1024),exponent-25);
+}
+
+void PackedMesh::octEncode(const float *_n, int16_t *_out)
+{
+  // project onto the octahedron then fold the lower half over the diagonals
+  float l1=std::abs(_n[0])+std::abs(_n[1])+std::abs(_n[2]);
+  float x=l1>0.0f ? _n[0]/l1 : 0.0f;
+  float y=l1>0.0f ? _n[1]/l1 : 0.0f;
+  if(_n[2]<0.0f)
+  {
+    float fx=(1.0f-std::abs(y))*(x>=0.0f ? 1.0f : -1.0f);
+    float fy=(1.0f-std::abs(x))*(y>=0.0f ? 1.0f : -1.0f);
+    x=fx;
+    y=fy;
+  }
+  _out[0]=static_cast<int16_t>(std::lround(std::min(std::max(x,-1.0f),1.0f)*32767.0f));
+  _out[1]=static_cast<int16_t>(std::lround(std::min(std::max(y,-1.0f),1.0f)*32767.0f));
+}
+
+void PackedMesh::octDecode(const int16_t *_e, float *_out)
+{
+  // same as octDecode in PhongVertex.glsl
+  float x=std::max(_e[0]/32767.0f,-1.0f);
+  float y=std::max(_e[1]/32767.0f,-1.0f);
+  float z=1.0f-std::abs(x)-std::abs(y);
+  float t=std::max(-z,0.0f);
+  x+=x>=0.0f ? -t : t;
+  y+=y>=0.0f ? -t : t;
+  float len=std::sqrt(x*x+y*y+z*z);
+  _out[0]=x/len;
+  _out[1]=y/len;
+  _out[2]=z/len;
+}
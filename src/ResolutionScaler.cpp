@@ -0,0 +1,93 @@
+#include "ResolutionScaler.h"
+#include <algorithm>
+#include <cmath>
+
+constexpr float ResolutionScaler::c_minScale;
+constexpr float ResolutionScaler::c_maxScale;
+constexpr float ResolutionScaler::c_step;
+constexpr float ResolutionScaler::c_aim;
+constexpr float ResolutionScaler::c_growBelow;
+constexpr int ResolutionScaler::c_settleFrames;
+constexpr float ResolutionScaler::c_smoothing;
+
+ResolutionScaler::ResolutionScaler(float _budgetMs)
+{
+  setBudget(_budgetMs);
+}
+
+void ResolutionScaler::setBudget(float _ms)
+{
+  m_budgetMs=std::max(_ms,0.1f);
+}
+
+void ResolutionScaler::reset()
+{
+  m_scale=m_previousScale=c_maxScale;
+  m_averageMs=0.0f;
+  m_samples=0;
+  m_settle=0;
+  m_changes=0;
+  m_decision=Decision::Hold;
+}
+
+bool ResolutionScaler::addSample(float _frameMs)
+{
+  if(m_settle>0)
+  {
+    --m_settle;
+    m_decision=Decision::Settle;
+    return false;
+  }
+  // the average restarts after a change so it only holds times at the current scale
+  m_averageMs=m_samples==0 ? _frameMs : m_averageMs+c_smoothing*(_frameMs-m_averageMs);
+  ++m_samples;
+  m_decision=Decision::Hold;
+  if(m_averageMs>m_budgetMs && m_scale>c_minScale)
+  {
+    // cost goes with the area so the scale that fits is the square root of the ratio, always at
+    // least one step down
+    float fit=m_scale*std::sqrt(c_aim*m_budgetMs/m_averageMs);
+    float next=std::floor(fit/c_step+1e-3f)*c_step;
+    change(std::max(std::min(next,m_scale-c_step),c_minScale),Decision::Down);
+    return true;
+  }
+  if(m_averageMs<c_growBelow*m_budgetMs && m_scale<c_maxScale)
+  {
+    float next=std::min(m_scale+c_step,c_maxScale);
+    float predicted=m_averageMs*(next*next)/(m_scale*m_scale);
+    if(predicted<c_aim*m_budgetMs)
+    {
+      change(next,Decision::Up);
+      return true;
+    }
+  }
+  return false;
+}
+
+void ResolutionScaler::change(float _scale, Decision _decision)
+{
+  m_previousScale=m_scale;
+  // snap to the step so repeated changes don't drift
+  m_scale=std::round(_scale/c_step)*c_step;
+  m_decision=_decision;
+  m_samples=0;
+  m_settle=c_settleFrames;
+  ++m_changes;
+}
+
+const char *ResolutionScaler::decisionName(Decision _decision)
+{
+  switch(_decision)
+  {
+    case Decision::Down : return "down";
+    case Decision::Up : return "up";
+    case Decision::Settle : return "settle";
+    case Decision::Hold : break;
+  }
+  return "hold";
+}
+
+int ResolutionScaler::scaled(int _size, float _scale)
+{
+  return std::max(1,static_cast<int>(std::lround(_size*_scale)));
+}
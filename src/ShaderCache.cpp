@@ -0,0 +1,218 @@
+#include "ShaderCache.h"
+#include <QDir>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+//----------------------------------------------------------------------------------------------------------------------
+// each cache file is this header followed by length bytes of program binary
+//----------------------------------------------------------------------------------------------------------------------
+struct BinaryHeader
+{
+  uint32_t magic;
+  uint32_t binaryFormat;
+  uint64_t key;
+  uint64_t length;
+};
+constexpr uint32_t c_binaryMagic=0x5350564d; // "MVPS"
+
+float elapsedMs(std::chrono::high_resolution_clock::time_point _start)
+{
+  return std::chrono::duration<float,std::milli>(std::chrono::high_resolution_clock::now()-_start).count();
+}
+
+std::string glString(GLenum _name)
+{
+  const GLubyte *s=glGetString(_name);
+  return s ? reinterpret_cast<const char *>(s) : "";
+}
+
+bool readSource(const std::string &_path, std::string &_out)
+{
+  std::ifstream file(_path.c_str());
+  if(!file.is_open())
+  {
+    std::cerr<<"ShaderCache unable to open "<<_path<<'\n';
+    return false;
+  }
+  std::stringstream buffer;
+  buffer<<file.rdbuf();
+  _out=buffer.str();
+  return true;
+}
+} // end anon namespace
+
+ShaderCache::ShaderCache(const std::string &_dir, const std::string &_defines) :
+  m_dir(_dir),
+  m_defines(_defines)
+{
+  m_driver=glString(GL_VENDOR)+"|"+glString(GL_RENDERER)+"|"+glString(GL_VERSION);
+  GLint formats=0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS,&formats);
+  m_supported=formats>0;
+  if(m_supported && !QDir().mkpath(QString::fromStdString(m_dir)))
+  {
+    std::cerr<<"ShaderCache unable to create "<<m_dir<<" programs will not be cached\n";
+    m_supported=false;
+  }
+}
+
+uint64_t ShaderCache::hash(const std::string &_data, uint64_t _seed)
+{
+  uint64_t h=_seed;
+  for(unsigned char c : _data)
+  {
+    h^=c;
+    h*=1099511628211ULL;
+  }
+  return h;
+}
+
+std::string ShaderCache::injectDefines(const std::string &_source) const
+{
+  if(m_defines.empty())
+    return _source;
+  // defines have to come after #version
+  size_t insertAt=0;
+  if(_source.compare(0,8,"#version")==0)
+  {
+    insertAt=_source.find('\n');
+    insertAt=insertAt==std::string::npos ? _source.size() : insertAt+1;
+  }
+  std::string source=_source;
+  source.insert(insertAt,m_defines+"\n");
+  return source;
+}
+
+std::string ShaderCache::cacheFile(const std::string &_program, uint64_t _key) const
+{
+  char key[17];
+  std::snprintf(key,sizeof(key),"%016llx",static_cast<unsigned long long>(_key));
+  return m_dir+"/"+_program+"-"+key+".bin";
+}
+
+bool ShaderCache::loadProgram(const std::string &_program, std::initializer_list<Stage> _stages)
+{
+  ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+  // the key covers everything that can change the binary, the stage names are included so
+  // swapping the order or type of two shaders changes it too
+  auto start=std::chrono::high_resolution_clock::now();
+  std::vector<std::string> sources;
+  uint64_t key=hash(m_driver);
+  key=hash(m_defines,key);
+  for(const auto &stage : _stages)
+  {
+    std::string source;
+    if(!readSource(stage.path,source))
+      return false;
+    sources.push_back(injectDefines(source));
+    key=hash(stage.name,key);
+    key=hash(std::to_string(static_cast<int>(stage.type)),key);
+    key=hash(sources.back(),key);
+  }
+  m_stats.hashMs+=elapsedMs(start);
+
+  shader->createShaderProgram(_program);
+  GLuint id=shader->getProgramID(_program);
+  std::string file=cacheFile(_program,key);
+  if(m_supported)
+  {
+    start=std::chrono::high_resolution_clock::now();
+    bool hit=loadBinary(id,file,key);
+    m_stats.binaryLoadMs+=elapsedMs(start);
+    if(hit)
+    {
+      // ShaderLib normally registers the uniforms when it links, do the same for the binary
+      (*shader)[_program]->autoRegisterUniforms();
+      ++m_stats.hits;
+      return true;
+    }
+  }
+  ++m_stats.misses;
+
+  start=std::chrono::high_resolution_clock::now();
+  size_t i=0;
+  for(const auto &stage : _stages)
+  {
+    if(m_compiled.insert(stage.name).second)
+    {
+      shader->attachShader(stage.name,stage.type);
+      shader->loadShaderSourceFromString(stage.name,sources[i]);
+      shader->compileShader(stage.name);
+    }
+    shader->attachShaderToProgram(_program,stage.name);
+    ++i;
+  }
+  m_stats.compileMs+=elapsedMs(start);
+
+  start=std::chrono::high_resolution_clock::now();
+  if(m_supported)
+    glProgramParameteri(id,GL_PROGRAM_BINARY_RETRIEVABLE_HINT,GL_TRUE);
+  shader->linkProgramObject(_program);
+  GLint linked=GL_FALSE;
+  glGetProgramiv(id,GL_LINK_STATUS,&linked);
+  m_stats.linkMs+=elapsedMs(start);
+  if(linked!=GL_TRUE)
+    return false;
+
+  if(m_supported)
+  {
+    start=std::chrono::high_resolution_clock::now();
+    storeBinary(id,file,key);
+    m_stats.storeMs+=elapsedMs(start);
+  }
+  return true;
+}
+
+bool ShaderCache::loadBinary(GLuint _id, const std::string &_file, uint64_t _key)
+{
+  std::ifstream file(_file.c_str(),std::ios::binary);
+  if(!file.is_open())
+    return false;
+  BinaryHeader header;
+  if(!file.read(reinterpret_cast<char *>(&header),sizeof(header)) ||
+     header.magic!=c_binaryMagic || header.key!=_key || header.length==0)
+    return false;
+  std::vector<char> binary(static_cast<size_t>(header.length));
+  if(!file.read(binary.data(),static_cast<std::streamsize>(binary.size())))
+    return false;
+  glProgramBinary(_id,header.binaryFormat,binary.data(),static_cast<GLsizei>(binary.size()));
+  // a driver update can make an old binary invalid even though the strings matched
+  GLint linked=GL_FALSE;
+  glGetProgramiv(_id,GL_LINK_STATUS,&linked);
+  return linked==GL_TRUE;
+}
+
+void ShaderCache::storeBinary(GLuint _id, const std::string &_file, uint64_t _key)
+{
+  GLint length=0;
+  glGetProgramiv(_id,GL_PROGRAM_BINARY_LENGTH,&length);
+  if(length<=0)
+    return;
+  std::vector<char> binary(static_cast<size_t>(length));
+  GLenum format=0;
+  glGetProgramBinary(_id,length,nullptr,&format,binary.data());
+  BinaryHeader header={c_binaryMagic,format,_key,static_cast<uint64_t>(length)};
+  // write to a temporary then rename over the old one, which is atomic on POSIX so a crash or a
+  // second instance never sees a missing or half written binary
+  std::string tmp=_file+".tmp";
+  {
+    std::ofstream file(tmp.c_str(),std::ios::binary);
+    file.write(reinterpret_cast<const char *>(&header),sizeof(header));
+    file.write(binary.data(),length);
+    if(!file)
+    {
+      std::cerr<<"ShaderCache unable to write "<<tmp<<'\n';
+      return;
+    }
+  }
+  if(std::rename(tmp.c_str(),_file.c_str())!=0)
+  {
+    std::cerr<<"ShaderCache unable to replace "<<_file<<'\n';
+    std::remove(tmp.c_str());
+  }
+}
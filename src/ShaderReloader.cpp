@@ -0,0 +1,462 @@
+#include "ShaderReloader.h"
+#include <ngl/ShaderLib.h>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QThread>
+#include <QTimer>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// KHR_parallel_shader_compile, the ARB version uses the same values
+#ifndef GL_COMPLETION_STATUS_KHR
+  #define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+#ifndef APIENTRYP
+  #define APIENTRYP *
+#endif
+
+constexpr int ShaderReloader::c_debounceMs;
+
+namespace
+{
+GLenum glShaderType(ngl::ShaderType _type)
+{
+  switch(_type)
+  {
+    case ngl::ShaderType::FRAGMENT : return GL_FRAGMENT_SHADER;
+    case ngl::ShaderType::GEOMETRY : return GL_GEOMETRY_SHADER;
+    case ngl::ShaderType::TESSCONTROL : return GL_TESS_CONTROL_SHADER;
+    case ngl::ShaderType::TESSEVAL : return GL_TESS_EVALUATION_SHADER;
+    case ngl::ShaderType::COMPUTE : return GL_COMPUTE_SHADER;
+    default : return GL_VERTEX_SHADER;
+  }
+}
+
+bool hasExtension(const char *_name)
+{
+  GLint count=0;
+  glGetIntegerv(GL_NUM_EXTENSIONS,&count);
+  for(GLint i=0; i<count; ++i)
+  {
+    const GLubyte *e=glGetStringi(GL_EXTENSIONS,static_cast<GLuint>(i));
+    if(e && std::strcmp(reinterpret_cast<const char *>(e),_name)==0)
+      return true;
+  }
+  return false;
+}
+
+std::string infoLog(GLuint _object, bool _program)
+{
+  GLint length=0;
+  if(_program)
+    glGetProgramiv(_object,GL_INFO_LOG_LENGTH,&length);
+  else
+    glGetShaderiv(_object,GL_INFO_LOG_LENGTH,&length);
+  if(length<=1)
+    return "";
+  std::vector<char> log(static_cast<size_t>(length));
+  if(_program)
+    glGetProgramInfoLog(_object,length,nullptr,log.data());
+  else
+    glGetShaderInfoLog(_object,length,nullptr,log.data());
+  return log.data();
+}
+
+std::string firstLine(const std::string &_log)
+{
+  std::istringstream lines(_log);
+  std::string line;
+  while(std::getline(lines,line))
+    if(line.find_first_not_of(" \t\r")!=std::string::npos)
+      return line;
+  return "unknown error";
+}
+} // end anon namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief as with MeshStreamer the worker has to be a QThread so its context can be made current on it
+//----------------------------------------------------------------------------------------------------------------------
+class ShaderReloader::Worker : public QThread
+{
+  public :
+    explicit Worker(ShaderReloader &_reloader) : m_reloader(_reloader) {}
+  protected :
+    void run() override { m_reloader.run(); }
+  private :
+    ShaderReloader &m_reloader;
+};
+
+ShaderReloader::ShaderReloader(QOpenGLContext *_context, const std::string &_dir, ReloadedFunc _reloaded,
+                               FrameRequestFunc _requestFrame) :
+  m_dir(_dir),
+  m_reloaded(_reloaded),
+  m_requestFrame(_requestFrame),
+  m_guiThread(QThread::currentThread())
+{
+  GLint formats=0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS,&formats);
+  if(formats<=0)
+  {
+    std::cerr<<"ShaderReloader no program binary formats, shaders won't be reloaded\n";
+    return;
+  }
+  // MVP_SHADER_RELOAD=worker skips the driver's parallel compile to try the other path
+  const char *mode=std::getenv("MVP_SHADER_RELOAD");
+  bool forceWorker=mode && std::strcmp(mode,"worker")==0;
+  const char *threadsFunc=nullptr;
+  if(hasExtension("GL_KHR_parallel_shader_compile"))
+    threadsFunc="glMaxShaderCompilerThreadsKHR";
+  else if(hasExtension("GL_ARB_parallel_shader_compile"))
+    threadsFunc="glMaxShaderCompilerThreadsARB";
+  if(threadsFunc && !forceWorker)
+  {
+    // the default count is up to the driver, ask for as many as it will give
+    using MaxThreadsFunc=void (APIENTRYP)(GLuint);
+    auto maxThreads=reinterpret_cast<MaxThreadsFunc>(_context->getProcAddress(threadsFunc));
+    if(maxThreads)
+      maxThreads(0xFFFFFFFF);
+    m_parallel=true;
+  }
+  else
+  {
+    m_surface.reset(new QOffscreenSurface);
+    m_surface->setFormat(_context->format());
+    m_surface->create();
+    m_context.reset(new QOpenGLContext);
+    m_context->setFormat(_context->format());
+    m_context->setShareContext(_context);
+    if(!m_context->create() || !m_context->shareContext())
+    {
+      std::cerr<<"ShaderReloader unable to create a shared context, shaders won't be reloaded\n";
+      return;
+    }
+    m_worker.reset(new Worker(*this));
+    m_context->moveToThread(m_worker.get());
+    m_worker->start(QThread::LowPriority);
+  }
+
+  m_watcher.reset(new QFileSystemWatcher);
+  m_watcher->addPath(QString::fromStdString(m_dir));
+  QObject::connect(m_watcher.get(),&QFileSystemWatcher::fileChanged,[this](const QString &_path)
+  {
+    fileChanged(_path.toStdString());
+  });
+  // editors that save by writing a new file and renaming it over the old one leave the watcher
+  // without the file, the directory changes though so pick them up again from there
+  QObject::connect(m_watcher.get(),&QFileSystemWatcher::directoryChanged,[this](const QString &)
+  {
+    QStringList watched=m_watcher->files();
+    for(const auto &program : m_programs)
+      for(const auto &stage : program.second.stages)
+      {
+        QString path=QString::fromStdString(stage.path);
+        if(!watched.contains(path) && QFileInfo(path).exists())
+        {
+          m_watcher->addPath(path);
+          watched.append(path);
+          fileChanged(stage.path);
+        }
+      }
+  });
+  // a save is often several writes, only rebuild once they stop
+  m_debounce.reset(new QTimer);
+  m_debounce->setSingleShot(true);
+  m_debounce->setInterval(c_debounceMs);
+  QObject::connect(m_debounce.get(),&QTimer::timeout,[this](){ rebuildChanged(); });
+  m_valid=true;
+  std::cout<<"watching "<<m_dir<<" for shader changes, compiling "<<(m_parallel ? "in parallel in the driver" : "on a worker thread")<<'\n';
+}
+
+ShaderReloader::~ShaderReloader()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_quit=true;
+  }
+  m_buildAdded.notify_all();
+  if(m_worker)
+    m_worker->wait();
+  // anything the driver is still compiling goes with the render context
+}
+
+void ShaderReloader::watch(const std::string &_program, std::initializer_list<Stage> _stages)
+{
+  if(!m_valid)
+    return;
+  Program &program=m_programs[_program];
+  program.stages.assign(_stages.begin(),_stages.end());
+  for(const auto &stage : _stages)
+    if(!m_watcher->files().contains(QString::fromStdString(stage.path)))
+      m_watcher->addPath(QString::fromStdString(stage.path));
+}
+
+void ShaderReloader::fileChanged(const std::string &_path)
+{
+  if(m_changed.empty())
+    m_firstChange=Clock::now();
+  m_changed.insert(_path);
+  QString path=QString::fromStdString(_path);
+  if(!m_watcher->files().contains(path) && QFileInfo(path).exists())
+    m_watcher->addPath(path);
+  m_debounce->start();
+}
+
+void ShaderReloader::rebuildChanged()
+{
+  std::vector<std::unique_ptr<Build>> builds;
+  for(const auto &program : m_programs)
+    for(const auto &stage : program.second.stages)
+      if(m_changed.count(stage.path))
+      {
+        builds.push_back(makeBuild(program.first));
+        break;
+      }
+  m_changed.clear();
+  if(builds.empty())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    for(auto &b : builds)
+      // a source that couldn't be read fails straight away
+      (b->sources.empty() ? m_built : m_queued).push_back(std::move(b));
+    m_status.pending=m_queued.size()+m_building+m_built.size()+m_compiling.size();
+  }
+  m_buildAdded.notify_one();
+  // the parallel path only starts its builds in poll
+  if(m_requestFrame)
+    m_requestFrame();
+}
+
+std::unique_ptr<ShaderReloader::Build> ShaderReloader::makeBuild(const std::string &_program)
+{
+  Program &program=m_programs[_program];
+  std::unique_ptr<Build> build(new Build);
+  build->program=_program;
+  build->generation=++program.generation;
+  build->changed=m_firstChange;
+  for(const auto &stage : program.stages)
+  {
+    std::ifstream file(stage.path.c_str());
+    std::stringstream source;
+    source<<file.rdbuf();
+    if(!file.is_open() || source.str().empty())
+    {
+      build->sources.clear();
+      build->log="unable to read "+stage.path;
+      return build;
+    }
+    build->sources.emplace_back(glShaderType(stage.type),source.str());
+  }
+  return build;
+}
+
+void ShaderReloader::startBuild(Build &_build, bool _wait)
+{
+  _build.id=glCreateProgram();
+  glProgramParameteri(_build.id,GL_PROGRAM_BINARY_RETRIEVABLE_HINT,GL_TRUE);
+  for(const auto &source : _build.sources)
+  {
+    GLuint shader=glCreateShader(source.first);
+    const char *text=source.second.c_str();
+    glShaderSource(shader,1,&text,nullptr);
+    glCompileShader(shader);
+    glAttachShader(_build.id,shader);
+    _build.shaders.push_back(shader);
+  }
+  glLinkProgram(_build.id);
+  if(_wait)
+    finishBuild(_build);
+}
+
+void ShaderReloader::finishBuild(Build &_build)
+{
+  // a failed compile also fails the link, its log is the one that says why
+  for(size_t i=0; i<_build.shaders.size(); ++i)
+  {
+    GLint compiled=GL_FALSE;
+    glGetShaderiv(_build.shaders[i],GL_COMPILE_STATUS,&compiled);
+    if(compiled!=GL_TRUE)
+      _build.log+=infoLog(_build.shaders[i],false);
+  }
+  GLint linked=GL_FALSE;
+  glGetProgramiv(_build.id,GL_LINK_STATUS,&linked);
+  _build.ok=linked==GL_TRUE;
+  if(!_build.ok && _build.log.empty())
+    _build.log=infoLog(_build.id,true);
+  if(_build.ok)
+  {
+    GLint length=0;
+    glGetProgramiv(_build.id,GL_PROGRAM_BINARY_LENGTH,&length);
+    if(length>0)
+    {
+      _build.binary.resize(static_cast<size_t>(length));
+      glGetProgramBinary(_build.id,length,nullptr,&_build.format,_build.binary.data());
+      // load it in to a program of its own first, here on the worker when there is one, so a binary
+      // the driver won't take never reaches the live program and any recompile on load is done
+      // off the frame
+      GLuint check=glCreateProgram();
+      glProgramBinary(check,_build.format,_build.binary.data(),length);
+      GLint loaded=GL_FALSE;
+      glGetProgramiv(check,GL_LINK_STATUS,&loaded);
+      glDeleteProgram(check);
+      if(loaded!=GL_TRUE)
+      {
+        _build.ok=false;
+        _build.log="the driver rejected the new program binary";
+      }
+    }
+    else
+    {
+      _build.ok=false;
+      _build.log="the driver returned no program binary";
+    }
+  }
+  for(GLuint shader : _build.shaders)
+  {
+    glDetachShader(_build.id,shader);
+    glDeleteShader(shader);
+  }
+  glDeleteProgram(_build.id);
+  _build.shaders.clear();
+  _build.id=0;
+}
+
+void ShaderReloader::poll()
+{
+  if(!m_valid)
+    return;
+  std::deque<std::unique_ptr<Build>> built;
+  std::deque<std::unique_ptr<Build>> queued;
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    built.swap(m_built);
+    if(m_parallel)
+      queued.swap(m_queued);
+  }
+  // the driver's threads do the work, this only submits it
+  for(auto &b : queued)
+  {
+    startBuild(*b,false);
+    m_compiling.push_back(std::move(b));
+  }
+  for(auto it=m_compiling.begin(); it!=m_compiling.end();)
+  {
+    GLint done=GL_FALSE;
+    glGetProgramiv((*it)->id,GL_COMPLETION_STATUS_KHR,&done);
+    if(done==GL_TRUE)
+    {
+      finishBuild(**it);
+      built.push_back(std::move(*it));
+      it=m_compiling.erase(it);
+    }
+    else
+      ++it;
+  }
+  for(auto &b : built)
+    apply(*b);
+  std::lock_guard<std::mutex> lock(m_lock);
+  m_status.pending=m_queued.size()+m_building+m_built.size()+m_compiling.size();
+}
+
+void ShaderReloader::apply(Build &_build)
+{
+  // the file was saved again while this was building, the newer build will report
+  if(_build.generation!=m_programs[_build.program].generation)
+    return;
+  ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+  if(_build.ok)
+  {
+    // the program id doesn't change so ShaderLib and everything holding the id carry on as they
+    // were. finishBuild has already loaded the binary once, the old one is kept in case the live
+    // load still fails, from the driver or from the last reload when the driver won't hand it out
+    // (programs linked without GL_PROGRAM_BINARY_RETRIEVABLE_HINT)
+    Program &program=m_programs[_build.program];
+    GLuint id=shader->getProgramID(_build.program);
+    GLint length=0;
+    glGetProgramiv(id,GL_PROGRAM_BINARY_LENGTH,&length);
+    std::vector<char> previous(static_cast<size_t>(std::max(length,0)));
+    GLenum previousFormat=0;
+    if(length>0)
+      glGetProgramBinary(id,length,nullptr,&previousFormat,previous.data());
+    else
+    {
+      previous=program.binary;
+      previousFormat=program.format;
+    }
+    glProgramBinary(id,_build.format,_build.binary.data(),static_cast<GLsizei>(_build.binary.size()));
+    GLint linked=GL_FALSE;
+    glGetProgramiv(id,GL_LINK_STATUS,&linked);
+    if(linked!=GL_TRUE)
+    {
+      _build.ok=false;
+      _build.log="the driver rejected the new program binary";
+      if(!previous.empty())
+        glProgramBinary(id,previousFormat,previous.data(),static_cast<GLsizei>(previous.size()));
+      else
+        _build.log+=" and there is no binary of the previous program to restore";
+    }
+    else
+    {
+      program.binary=std::move(_build.binary);
+      program.format=_build.format;
+      (*shader)[_build.program]->autoRegisterUniforms();
+      if(m_reloaded)
+        m_reloaded(_build.program);
+    }
+  }
+  m_status.program=_build.program;
+  m_status.ok=_build.ok;
+  m_status.buildMs=std::chrono::duration<float,std::milli>(Clock::now()-_build.changed).count();
+  if(_build.ok)
+  {
+    m_status.error.clear();
+    ++m_status.reloads;
+    std::cout<<"reloaded "<<_build.program<<" in "<<m_status.buildMs<<" ms\n";
+  }
+  else
+  {
+    m_status.error=firstLine(_build.log);
+    ++m_status.failures;
+    std::cerr<<"unable to reload "<<_build.program<<", keeping the previous program\n"<<_build.log<<'\n';
+  }
+}
+
+void ShaderReloader::run()
+{
+  if(!m_context->makeCurrent(m_surface.get()))
+  {
+    std::cerr<<"ShaderReloader unable to make its context current, shaders won't be reloaded\n";
+    m_context->moveToThread(m_guiThread);
+    return;
+  }
+  for(;;)
+  {
+    std::unique_ptr<Build> build;
+    {
+      std::unique_lock<std::mutex> lock(m_lock);
+      m_buildAdded.wait(lock,[this](){ return m_quit || !m_queued.empty(); });
+      if(m_quit)
+        break;
+      build=std::move(m_queued.front());
+      m_queued.pop_front();
+      m_building=1;
+    }
+    // the compile and link block this thread only
+    startBuild(*build,true);
+    {
+      std::lock_guard<std::mutex> lock(m_lock);
+      m_built.push_back(std::move(build));
+      m_building=0;
+    }
+    if(m_requestFrame)
+      m_requestFrame();
+  }
+  m_context->doneCurrent();
+  m_context->moveToThread(m_guiThread);
+}
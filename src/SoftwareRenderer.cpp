@@ -0,0 +1,358 @@
+#include "SoftwareRenderer.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <thread>
+
+constexpr int SoftwareRenderer::c_numVaryings;
+constexpr int SoftwareRenderer::c_tileSize;
+
+namespace
+{
+//----------------------------------------------------------------------------------------------------------------------
+// small helpers for the shader maths, matrices are OpenGL column major
+//----------------------------------------------------------------------------------------------------------------------
+inline void mulMat4(const float *_m, float _x, float _y, float _z, float *_out)
+{
+  for(int r=0; r<4; ++r)
+    _out[r]=_m[r]*_x + _m[4+r]*_y + _m[8+r]*_z + _m[12+r];
+}
+
+inline void normalize3(float *_v)
+{
+  float len=std::sqrt(_v[0]*_v[0] + _v[1]*_v[1] + _v[2]*_v[2]);
+  if(len > 0.0f)
+  {
+    _v[0]/=len; _v[1]/=len; _v[2]/=len;
+  }
+}
+
+inline float dot3(const float *_a, const float *_b)
+{
+  return _a[0]*_b[0] + _a[1]*_b[1] + _a[2]*_b[2];
+}
+
+inline float edge(float _ax, float _ay, float _bx, float _by, float _px, float _py)
+{
+  return (_bx-_ax)*(_py-_ay) - (_by-_ay)*(_px-_ax);
+}
+
+// linear blend of two clip vertices, used when clipping against the near plane
+SoftwareRenderer::ClipVertex lerpVertex(const SoftwareRenderer::ClipVertex &_a, const SoftwareRenderer::ClipVertex &_b, float _t)
+{
+  SoftwareRenderer::ClipVertex out;
+  for(int i=0; i<4; ++i)
+    out.pos[i]=_a.pos[i] + (_b.pos[i]-_a.pos[i])*_t;
+  for(int i=0; i<SoftwareRenderer::c_numVaryings; ++i)
+    out.var[i]=_a.var[i] + (_b.var[i]-_a.var[i])*_t;
+  return out;
+}
+
+} // end anon namespace
+
+SoftwareRenderer::SoftwareRenderer(int _width, int _height, unsigned int _numThreads)
+{
+  setNumThreads(_numThreads);
+  resize(_width,_height);
+  ngl::Mat4 identity;
+  setMatrices(identity,identity,ngl::Mat3(identity),identity);
+}
+
+void SoftwareRenderer::resize(int _width, int _height)
+{
+  m_width=std::max(_width,1);
+  m_height=std::max(_height,1);
+  m_tilesX=(m_width+c_tileSize-1)/c_tileSize;
+  m_tilesY=(m_height+c_tileSize-1)/c_tileSize;
+  m_colour.resize(static_cast<size_t>(m_width)*m_height*4);
+  m_depth.resize(static_cast<size_t>(m_width)*m_height);
+}
+
+void SoftwareRenderer::setNumThreads(unsigned int _numThreads)
+{
+  if(_numThreads==0)
+    _numThreads=std::max(1u,std::thread::hardware_concurrency());
+  m_numThreads=_numThreads;
+}
+
+void SoftwareRenderer::setMatrices(const ngl::Mat4 &_MVP, const ngl::Mat4 &_MV, const ngl::Mat3 &_normalMatrix, const ngl::Mat4 &_M)
+{
+  std::copy(&_MVP.m_openGL[0],&_MVP.m_openGL[0]+16,m_MVP);
+  std::copy(&_MV.m_openGL[0],&_MV.m_openGL[0]+16,m_MV);
+  std::copy(&_M.m_openGL[0],&_M.m_openGL[0]+16,m_M);
+  std::copy(&_normalMatrix.m_openGL[0],&_normalMatrix.m_openGL[0]+9,m_normalMatrix);
+}
+
+void SoftwareRenderer::setClearColour(float _r, float _g, float _b, float _a)
+{
+  m_clearColour[0]=_r;
+  m_clearColour[1]=_g;
+  m_clearColour[2]=_b;
+  m_clearColour[3]=_a;
+}
+
+void SoftwareRenderer::clear()
+{
+  uint8_t c[4];
+  for(int i=0; i<4; ++i)
+    c[i]=static_cast<uint8_t>(std::min(std::max(m_clearColour[i],0.0f),1.0f)*255.0f+0.5f);
+  for(size_t i=0; i<m_colour.size(); i+=4)
+    std::copy(c,c+4,&m_colour[i]);
+  std::fill(m_depth.begin(),m_depth.end(),1.0f);
+}
+
+void SoftwareRenderer::runParallel(size_t _count, void (SoftwareRenderer::*_func)(size_t, size_t, unsigned int))
+{
+  unsigned int numThreads=static_cast<unsigned int>(std::min<size_t>(m_numThreads,std::max<size_t>(_count,1)));
+  size_t chunk=(_count+numThreads-1)/numThreads;
+  std::vector<std::thread> workers;
+  workers.reserve(numThreads);
+  for(unsigned int t=1; t<numThreads; ++t)
+  {
+    size_t begin=std::min(_count,t*chunk);
+    size_t end=std::min(_count,begin+chunk);
+    workers.emplace_back(_func,this,begin,end,t);
+  }
+  (this->*_func)(0,std::min(_count,chunk),0);
+  for(auto &w : workers)
+    w.join();
+}
+
+void SoftwareRenderer::drawTriangles(const ngl::Vec3 *_verts, const ngl::Vec3 *_normals, size_t _numVerts)
+{
+  size_t numTris=_numVerts/3;
+  if(numTris==0)
+    return;
+  m_inVerts=_verts;
+  m_inNormals=_normals;
+  m_clipVerts.resize(numTris*3);
+  // the setup stage is split across the same threads as the raster stage, each thread
+  // bins its own contiguous range of triangles so submission order is kept per tile
+  m_triangles.resize(m_numThreads);
+  m_bins.resize(m_numThreads);
+  size_t numTiles=static_cast<size_t>(m_tilesX)*m_tilesY;
+  for(unsigned int t=0; t<m_numThreads; ++t)
+  {
+    m_triangles[t].clear();
+    m_bins[t].resize(numTiles);
+    for(auto &bin : m_bins[t])
+      bin.clear();
+  }
+  runParallel(numTris*3,&SoftwareRenderer::vertexStage);
+  runParallel(numTris,&SoftwareRenderer::setupStage);
+  runParallel(numTiles,&SoftwareRenderer::rasterStage);
+}
+
+void SoftwareRenderer::vertexStage(size_t _begin, size_t _end, unsigned int)
+{
+  // this is PhongVertex.glsl
+  const float *lightPos=&m_light.position.m_x;
+  for(size_t i=_begin; i<_end; ++i)
+  {
+    const ngl::Vec3 &v=m_inVerts[i];
+    const ngl::Vec3 &n=m_inNormals[i];
+    ClipVertex &out=m_clipVerts[i];
+    float *fragmentNormal=&out.var[0];
+    float *lightDir=&out.var[3];
+    float *halfVector=&out.var[6];
+    for(int r=0; r<3; ++r)
+      fragmentNormal[r]=m_normalMatrix[r]*n.m_x + m_normalMatrix[3+r]*n.m_y + m_normalMatrix[6+r]*n.m_z;
+    if(m_normalize)
+      normalize3(fragmentNormal);
+    mulMat4(m_MVP,v.m_x,v.m_y,v.m_z,out.pos);
+    float worldPosition[4];
+    mulMat4(m_M,v.m_x,v.m_y,v.m_z,worldPosition);
+    float eyeDirection[3]={m_viewerPos.m_x-worldPosition[0],
+                           m_viewerPos.m_y-worldPosition[1],
+                           m_viewerPos.m_z-worldPosition[2]};
+    normalize3(eyeDirection);
+    float eyeCord[4];
+    mulMat4(m_MV,v.m_x,v.m_y,v.m_z,eyeCord);
+    for(int r=0; r<3; ++r)
+      lightDir[r]=lightPos[r]-eyeCord[r];
+    normalize3(lightDir);
+    for(int r=0; r<3; ++r)
+      halfVector[r]=eyeDirection[r]+lightDir[r];
+    normalize3(halfVector);
+  }
+}
+
+void SoftwareRenderer::setupStage(size_t _begin, size_t _end, unsigned int _thread)
+{
+  for(size_t t=_begin; t<_end; ++t)
+  {
+    const ClipVertex *v=&m_clipVerts[t*3];
+    // trivial reject if all three are outside the same frustum plane
+    bool rejected=false;
+    for(int axis=0; axis<3 && !rejected; ++axis)
+    {
+      rejected = (v[0].pos[axis] >  v[0].pos[3] && v[1].pos[axis] >  v[1].pos[3] && v[2].pos[axis] >  v[2].pos[3]) ||
+                 (v[0].pos[axis] < -v[0].pos[3] && v[1].pos[axis] < -v[1].pos[3] && v[2].pos[axis] < -v[2].pos[3]);
+    }
+    if(rejected)
+      continue;
+    // clip against the near plane (z >= -w) which may give a quad
+    ClipVertex poly[4];
+    int count=0;
+    for(int i=0; i<3; ++i)
+    {
+      const ClipVertex &a=v[i];
+      const ClipVertex &b=v[(i+1)%3];
+      float da=a.pos[2]+a.pos[3];
+      float db=b.pos[2]+b.pos[3];
+      if(da >= 0.0f)
+        poly[count++]=a;
+      if((da >= 0.0f) != (db >= 0.0f))
+        poly[count++]=lerpVertex(a,b,da/(da-db));
+    }
+    for(int i=1; i+1<count; ++i)
+      emitTriangle(poly[0],poly[i],poly[i+1],_thread);
+  }
+}
+
+void SoftwareRenderer::emitTriangle(const ClipVertex &_a, const ClipVertex &_b, const ClipVertex &_c, unsigned int _thread)
+{
+  const ClipVertex *v[3]={&_a,&_b,&_c};
+  ScreenTriangle tri;
+  for(int i=0; i<3; ++i)
+  {
+    float invW=1.0f/v[i]->pos[3];
+    tri.invW[i]=invW;
+    // viewport transform, image rows are stored top first so flip y
+    tri.x[i]=(v[i]->pos[0]*invW*0.5f+0.5f)*m_width;
+    tri.y[i]=(0.5f-v[i]->pos[1]*invW*0.5f)*m_height;
+    tri.z[i]=v[i]->pos[2]*invW*0.5f+0.5f;
+    for(int j=0; j<c_numVaryings; ++j)
+      tri.var[i][j]=v[i]->var[j]*invW;
+  }
+  tri.area=edge(tri.x[0],tri.y[0],tri.x[1],tri.y[1],tri.x[2],tri.y[2]);
+  if(tri.area==0.0f || !std::isfinite(tri.area))
+    return;
+  // wireframe lines are centred on the edge so grow the bounds by a pixel
+  float pad=m_wireframe ? 1.0f : 0.0f;
+  tri.minX=std::max(0,static_cast<int>(std::floor(std::min({tri.x[0],tri.x[1],tri.x[2]})-pad)));
+  tri.minY=std::max(0,static_cast<int>(std::floor(std::min({tri.y[0],tri.y[1],tri.y[2]})-pad)));
+  tri.maxX=std::min(m_width-1,static_cast<int>(std::ceil(std::max({tri.x[0],tri.x[1],tri.x[2]})+pad)));
+  tri.maxY=std::min(m_height-1,static_cast<int>(std::ceil(std::max({tri.y[0],tri.y[1],tri.y[2]})+pad)));
+  if(tri.minX>tri.maxX || tri.minY>tri.maxY)
+    return;
+  uint32_t index=static_cast<uint32_t>(m_triangles[_thread].size());
+  m_triangles[_thread].push_back(tri);
+  for(int ty=tri.minY/c_tileSize; ty<=tri.maxY/c_tileSize; ++ty)
+    for(int tx=tri.minX/c_tileSize; tx<=tri.maxX/c_tileSize; ++tx)
+      m_bins[_thread][static_cast<size_t>(ty)*m_tilesX+tx].push_back(index);
+}
+
+void SoftwareRenderer::rasterStage(size_t _begin, size_t _end, unsigned int)
+{
+  for(size_t tile=_begin; tile<_end; ++tile)
+    rasterTile(static_cast<int>(tile));
+}
+
+void SoftwareRenderer::rasterTile(int _tile)
+{
+  int tileX0=(_tile%m_tilesX)*c_tileSize;
+  int tileY0=(_tile/m_tilesX)*c_tileSize;
+  int tileX1=std::min(tileX0+c_tileSize,m_width)-1;
+  int tileY1=std::min(tileY0+c_tileSize,m_height)-1;
+  float var[c_numVaryings];
+  // walk the bins in thread order which is the same as submission order
+  for(unsigned int t=0; t<m_numThreads; ++t)
+  {
+    for(uint32_t index : m_bins[t][static_cast<size_t>(_tile)])
+    {
+      const ScreenTriangle &tri=m_triangles[t][index];
+      int x0=std::max(tri.minX,tileX0);
+      int x1=std::min(tri.maxX,tileX1);
+      int y0=std::max(tri.minY,tileY0);
+      int y1=std::min(tri.maxY,tileY1);
+      float invArea=1.0f/tri.area;
+      // in wireframe mode we keep pixels within half a pixel of an edge
+      float edgeLen[3]={1.0f,1.0f,1.0f};
+      if(m_wireframe)
+      {
+        for(int e=0; e<3; ++e)
+        {
+          int a=(e+1)%3;
+          int b=(e+2)%3;
+          edgeLen[e]=std::sqrt((tri.x[b]-tri.x[a])*(tri.x[b]-tri.x[a]) + (tri.y[b]-tri.y[a])*(tri.y[b]-tri.y[a]));
+        }
+      }
+      float sign=tri.area > 0.0f ? 1.0f : -1.0f;
+      for(int y=y0; y<=y1; ++y)
+      {
+        float py=y+0.5f;
+        for(int x=x0; x<=x1; ++x)
+        {
+          float px=x+0.5f;
+          float w[3]={edge(tri.x[1],tri.y[1],tri.x[2],tri.y[2],px,py),
+                      edge(tri.x[2],tri.y[2],tri.x[0],tri.y[0],px,py),
+                      edge(tri.x[0],tri.y[0],tri.x[1],tri.y[1],px,py)};
+          if(m_wireframe)
+          {
+            float d[3]={sign*w[0]/edgeLen[0],sign*w[1]/edgeLen[1],sign*w[2]/edgeLen[2]};
+            float minD=std::min({d[0],d[1],d[2]});
+            if(minD < -0.5f || minD > 0.5f)
+              continue;
+          }
+          else if(sign*w[0] < 0.0f || sign*w[1] < 0.0f || sign*w[2] < 0.0f)
+          {
+            continue;
+          }
+          float b0=w[0]*invArea;
+          float b1=w[1]*invArea;
+          float b2=w[2]*invArea;
+          float z=b0*tri.z[0] + b1*tri.z[1] + b2*tri.z[2];
+          size_t pixel=static_cast<size_t>(y)*m_width+x;
+          if(z < 0.0f || z > 1.0f || z >= m_depth[pixel])
+            continue;
+          m_depth[pixel]=z;
+          // perspective correct varyings
+          float invW=1.0f/(b0*tri.invW[0] + b1*tri.invW[1] + b2*tri.invW[2]);
+          for(int i=0; i<c_numVaryings; ++i)
+            var[i]=(b0*tri.var[0][i] + b1*tri.var[1][i] + b2*tri.var[2][i])*invW;
+          shade(var,&m_colour[pixel*4]);
+        }
+      }
+    }
+  }
+}
+
+void SoftwareRenderer::shade(const float *_var, uint8_t *_out) const
+{
+  // this is pointLight() from PhongFragment.glsl
+  float N[3]={_var[0],_var[1],_var[2]};
+  float L[3]={_var[3],_var[4],_var[5]};
+  float H[3]={_var[6],_var[7],_var[8]};
+  normalize3(N);
+  normalize3(L);
+  float colour[4]={0.0f,0.0f,0.0f,0.0f};
+  float lambertTerm=dot3(N,L);
+  if(lambertTerm > 0.0f)
+  {
+    normalize3(H);
+    float specPower=std::pow(std::max(dot3(N,H),0.0f),m_material.shininess);
+    const float *md=&m_material.diffuse.m_x;
+    const float *ma=&m_material.ambient.m_x;
+    const float *ms=&m_material.specular.m_x;
+    const float *ld=&m_light.diffuse.m_x;
+    const float *la=&m_light.ambient.m_x;
+    const float *ls=&m_light.specular.m_x;
+    for(int i=0; i<4; ++i)
+      colour[i]=md[i]*ld[i]*lambertTerm + ma[i]*la[i] + ms[i]*ls[i]*specPower;
+  }
+  for(int i=0; i<4; ++i)
+    _out[i]=static_cast<uint8_t>(std::min(std::max(colour[i],0.0f),1.0f)*255.0f+0.5f);
+}
+
+bool SoftwareRenderer::writePPM(const std::string &_fname) const
+{
+  std::ofstream file(_fname,std::ios::binary);
+  if(!file.is_open())
+    return false;
+  file<<"P6\n"<<m_width<<' '<<m_height<<"\n255\n";
+  for(size_t i=0; i<m_colour.size(); i+=4)
+    file.write(reinterpret_cast<const char *>(&m_colour[i]),3);
+  return file.good();
+}
@@ -0,0 +1,296 @@
+#include "TextOverlay.h"
+#include <ngl/ShaderLib.h>
+#include <QFontMetrics>
+#include <QImage>
+#include <QPainter>
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+constexpr int TextOverlay::c_lineCapacity;
+constexpr int TextOverlay::c_floatsPerVertex;
+constexpr int TextOverlay::c_vertsPerGlyph;
+
+namespace
+{
+  // printable ascii, everything else maps to '?'
+  constexpr int c_firstChar=32;
+  constexpr int c_lastChar=126;
+  constexpr int c_atlasWidth=512;
+}
+
+TextOverlay::TextOverlay(const QFont &_font)
+{
+  buildAtlas(_font);
+  createShader();
+  glGenVertexArrays(1,&m_vao);
+  glGenBuffers(1,&m_vbo);
+  glBindVertexArray(m_vao);
+  glBindBuffer(GL_ARRAY_BUFFER,m_vbo);
+  GLsizei stride=c_floatsPerVertex*sizeof(float);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0,2,GL_FLOAT,GL_FALSE,stride,reinterpret_cast<void *>(0));
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1,2,GL_FLOAT,GL_FALSE,stride,reinterpret_cast<void *>(2*sizeof(float)));
+  glEnableVertexAttribArray(2);
+  glVertexAttribPointer(2,3,GL_FLOAT,GL_FALSE,stride,reinterpret_cast<void *>(4*sizeof(float)));
+  glBindVertexArray(0);
+}
+
+TextOverlay::~TextOverlay()
+{
+  glDeleteBuffers(1,&m_vbo);
+  glDeleteVertexArrays(1,&m_vao);
+  glDeleteTextures(1,&m_texture);
+}
+
+void TextOverlay::createShader()
+{
+  ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+  shader->createShaderProgram("TextOverlay");
+  shader->attachShader("TextOverlayVertex",ngl::ShaderType::VERTEX);
+  shader->attachShader("TextOverlayFragment",ngl::ShaderType::FRAGMENT);
+  shader->loadShaderSource("TextOverlayVertex","shaders/TextOverlayVertex.glsl");
+  shader->loadShaderSource("TextOverlayFragment","shaders/TextOverlayFragment.glsl");
+  shader->compileShader("TextOverlayVertex");
+  shader->compileShader("TextOverlayFragment");
+  shader->attachShaderToProgram("TextOverlay","TextOverlayVertex");
+  shader->attachShaderToProgram("TextOverlay","TextOverlayFragment");
+  shader->linkProgramObject("TextOverlay");
+  (*shader)["TextOverlay"]->use();
+  shader->setUniform("atlas",0);
+}
+
+void TextOverlay::buildAtlas(const QFont &_font)
+{
+  QFontMetrics metrics(_font);
+  int height=metrics.height();
+  m_lineHeight=static_cast<float>(height);
+  // work out how many rows of glyphs we need first
+  int x=0;
+  int rows=1;
+  for(int c=c_firstChar; c<=c_lastChar; ++c)
+  {
+    int w=metrics.width(QChar(c))+2;
+    if(x+w > c_atlasWidth)
+    {
+      x=0;
+      ++rows;
+    }
+    x+=w;
+  }
+  int atlasHeight=rows*(height+2);
+  QImage image(c_atlasWidth,atlasHeight,QImage::Format_ARGB32_Premultiplied);
+  image.fill(Qt::transparent);
+  QPainter painter(&image);
+  painter.setFont(_font);
+  painter.setPen(Qt::white);
+  x=0;
+  int y=0;
+  for(int c=c_firstChar; c<=c_lastChar; ++c)
+  {
+    int advance=metrics.width(QChar(c));
+    int w=advance+2;
+    if(x+w > c_atlasWidth)
+    {
+      x=0;
+      y+=height+2;
+    }
+    painter.drawText(x+1,y+1+metrics.ascent(),QString(QChar(c)));
+    Glyph &g=m_glyphs[c];
+    g.u0=static_cast<float>(x+1)/c_atlasWidth;
+    g.v0=static_cast<float>(y+1)/atlasHeight;
+    g.u1=static_cast<float>(x+1+advance)/c_atlasWidth;
+    g.v1=static_cast<float>(y+1+height)/atlasHeight;
+    g.width=static_cast<float>(advance);
+    g.advance=static_cast<float>(advance);
+    x+=w;
+  }
+  painter.end();
+  for(int c=0; c<c_firstChar; ++c)
+    m_glyphs[c]=m_glyphs['?'];
+  m_glyphs[127]=m_glyphs['?'];
+
+  // only the coverage is needed so upload the alpha as a single channel texture
+  std::vector<unsigned char> coverage(static_cast<size_t>(c_atlasWidth)*atlasHeight);
+  for(int row=0; row<atlasHeight; ++row)
+  {
+    const QRgb *line=reinterpret_cast<const QRgb *>(image.constScanLine(row));
+    for(int col=0; col<c_atlasWidth; ++col)
+      coverage[static_cast<size_t>(row)*c_atlasWidth+col]=static_cast<unsigned char>(qAlpha(line[col]));
+  }
+  glGenTextures(1,&m_texture);
+  glBindTexture(GL_TEXTURE_2D,m_texture);
+  glPixelStorei(GL_UNPACK_ALIGNMENT,1);
+  glTexImage2D(GL_TEXTURE_2D,0,GL_R8,c_atlasWidth,atlasHeight,0,GL_RED,GL_UNSIGNED_BYTE,coverage.data());
+  glPixelStorei(GL_UNPACK_ALIGNMENT,4);
+  glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_S,GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_T,GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D,0);
+}
+
+void TextOverlay::setScreenSize(int _w, int _h)
+{
+  m_screenWidth=std::max(_w,1);
+  m_screenHeight=std::max(_h,1);
+}
+
+int TextOverlay::addBlock(int _x, int _y, int _numLines, int _lineSpacing)
+{
+  Block block;
+  block.x=_x;
+  block.y=_y;
+  block.lineSpacing=_lineSpacing;
+  block.firstVertex=m_vertices.size()/c_floatsPerVertex;
+  block.lines.resize(static_cast<size_t>(_numLines));
+  for(auto &line : block.lines)
+  {
+    line.text[0]='\0';
+    line.colour.set(1.0f,1.0f,1.0f);
+  }
+  m_blocks.push_back(block);
+  m_vertices.resize(m_vertices.size()+static_cast<size_t>(_numLines)*c_lineCapacity*c_vertsPerGlyph*c_floatsPerVertex,0.0f);
+  return static_cast<int>(m_blocks.size()-1);
+}
+
+void TextOverlay::setLine(int _block, int _line, const char *_text, const ngl::Vec3 &_colour)
+{
+  Line &line=m_blocks[_block].lines[_line];
+  bool sameColour=line.colour.m_x==_colour.m_x && line.colour.m_y==_colour.m_y && line.colour.m_z==_colour.m_z;
+  if(sameColour && std::strncmp(line.text.data(),_text,c_lineCapacity)==0)
+    return;
+  std::strncpy(line.text.data(),_text,c_lineCapacity);
+  line.text[c_lineCapacity]='\0';
+  line.colour=_colour;
+  line.dirty=true;
+  m_blocks[_block].dirty=true;
+}
+
+void TextOverlay::setLinef(int _block, int _line, const ngl::Vec3 &_colour, const char *_fmt, ...)
+{
+  char buffer[c_lineCapacity+1];
+  va_list args;
+  va_start(args,_fmt);
+  std::vsnprintf(buffer,sizeof(buffer),_fmt,args);
+  va_end(args);
+  setLine(_block,_line,buffer,_colour);
+}
+
+bool TextOverlay::setMatrix(int _block, int _firstLine, const ngl::Mat4 &_m, const ngl::Vec3 &_colour)
+{
+  Block &block=m_blocks[_block];
+  const float *m=&_m.m_openGL[0];
+  if(block.matrixCache.size()==16 && std::equal(m,m+16,block.matrixCache.begin()))
+    return false;
+  block.matrixCache.assign(m,m+16);
+  for(int row=0; row<4; ++row)
+    setLinef(_block,_firstLine+row,_colour,"[ %+0.4f %+0.4f %+0.4f %+0.4f]",m[row],m[4+row],m[8+row],m[12+row]);
+  return true;
+}
+
+void TextOverlay::buildLine(const Block &_block, int _line)
+{
+  const Line &line=_block.lines[_line];
+  float *v=&m_vertices[(_block.firstVertex+static_cast<size_t>(_line)*c_lineCapacity*c_vertsPerGlyph)*c_floatsPerVertex];
+  float penX=static_cast<float>(_block.x);
+  float top=static_cast<float>(_block.y+_line*_block.lineSpacing);
+  float bottom=top+m_lineHeight;
+  const float r=line.colour.m_x;
+  const float g=line.colour.m_y;
+  const float b=line.colour.m_z;
+  bool ended=false;
+  for(int i=0; i<c_lineCapacity; ++i)
+  {
+    if(line.text[i]=='\0')
+      ended=true;
+    if(ended)
+    {
+      // zero area quad for the unused slots
+      std::fill(v,v+c_vertsPerGlyph*c_floatsPerVertex,0.0f);
+      v+=c_vertsPerGlyph*c_floatsPerVertex;
+      continue;
+    }
+    const Glyph &glyph=m_glyphs[static_cast<unsigned char>(line.text[i]) & 127];
+    float x0=penX;
+    float x1=penX+glyph.width;
+    const float quad[c_vertsPerGlyph][4]=
+    {
+      {x0,top,glyph.u0,glyph.v0},
+      {x0,bottom,glyph.u0,glyph.v1},
+      {x1,bottom,glyph.u1,glyph.v1},
+      {x0,top,glyph.u0,glyph.v0},
+      {x1,bottom,glyph.u1,glyph.v1},
+      {x1,top,glyph.u1,glyph.v0}
+    };
+    for(int q=0; q<c_vertsPerGlyph; ++q)
+    {
+      *v++=quad[q][0];
+      *v++=quad[q][1];
+      *v++=quad[q][2];
+      *v++=quad[q][3];
+      *v++=r;
+      *v++=g;
+      *v++=b;
+    }
+    penX+=glyph.advance;
+  }
+}
+
+void TextOverlay::draw()
+{
+  if(m_vertices.empty())
+    return;
+  glBindVertexArray(m_vao);
+  glBindBuffer(GL_ARRAY_BUFFER,m_vbo);
+  size_t numVerts=m_vertices.size()/c_floatsPerVertex;
+  bool reallocate=numVerts!=m_bufferVerts;
+  for(auto &block : m_blocks)
+  {
+    if(!block.dirty && !reallocate)
+      continue;
+    for(size_t i=0; i<block.lines.size(); ++i)
+    {
+      Line &line=block.lines[i];
+      if(line.dirty || reallocate)
+      {
+        buildLine(block,static_cast<int>(i));
+        line.dirty=false;
+        ++m_linesRebuilt;
+      }
+    }
+    if(!reallocate)
+    {
+      size_t offset=block.firstVertex*c_floatsPerVertex;
+      size_t size=block.lines.size()*c_lineCapacity*c_vertsPerGlyph*c_floatsPerVertex;
+      glBufferSubData(GL_ARRAY_BUFFER,static_cast<GLintptr>(offset*sizeof(float)),
+                      static_cast<GLsizeiptr>(size*sizeof(float)),&m_vertices[offset]);
+    }
+    block.dirty=false;
+  }
+  if(reallocate)
+  {
+    glBufferData(GL_ARRAY_BUFFER,static_cast<GLsizeiptr>(m_vertices.size()*sizeof(float)),m_vertices.data(),GL_DYNAMIC_DRAW);
+    m_bufferVerts=numVerts;
+  }
+  m_linesRebuiltLastDraw=m_linesRebuilt;
+  m_linesRebuilt=0;
+
+  ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+  (*shader)["TextOverlay"]->use();
+  shader->setUniform("scale",2.0f/m_screenWidth,2.0f/m_screenHeight);
+  GLboolean depth=glIsEnabled(GL_DEPTH_TEST);
+  glDisable(GL_DEPTH_TEST);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D,m_texture);
+  glDrawArrays(GL_TRIANGLES,0,static_cast<GLsizei>(numVerts));
+  glBindTexture(GL_TEXTURE_2D,0);
+  glDisable(GL_BLEND);
+  if(depth)
+    glEnable(GL_DEPTH_TEST);
+  glBindVertexArray(0);
+}
@@ -0,0 +1,129 @@
+#include "TransformState.h"
+#include "TRSCompose.h"
+
+TransformState::TransformState()
+{
+  m_scale.set(1.0f,1.0f,1.0f);
+  m_view.identity();
+  m_project.identity();
+}
+
+void TransformState::setPosition(const ngl::Vec3 &_pos)
+{
+  m_pos=_pos;
+  m_dirty|=TRANSLATE;
+}
+
+void TransformState::setRotation(const ngl::Vec3 &_rot)
+{
+  m_rot=_rot;
+  m_dirty|=ROTATE;
+}
+
+void TransformState::setScale(const ngl::Vec3 &_scale)
+{
+  m_scale=_scale;
+  m_dirty|=SCALE;
+}
+
+void TransformState::setView(const ngl::Mat4 &_view)
+{
+  m_view=_view;
+  m_dirty|=VIEW;
+}
+
+void TransformState::setProject(const ngl::Mat4 &_project)
+{
+  m_project=_project;
+  m_dirty|=PROJECT;
+}
+
+void TransformState::translate(float _x, float _y, float _z)
+{
+  setPosition(ngl::Vec3(m_pos.m_x+_x,m_pos.m_y+_y,m_pos.m_z+_z));
+}
+
+void TransformState::rotate(float _x, float _y, float _z)
+{
+  setRotation(ngl::Vec3(m_rot.m_x+_x,m_rot.m_y+_y,m_rot.m_z+_z));
+}
+
+void TransformState::scale(float _x, float _y, float _z)
+{
+  setScale(ngl::Vec3(m_scale.m_x+_x,m_scale.m_y+_y,m_scale.m_z+_z));
+}
+
+void TransformState::reset()
+{
+  m_view.identity();
+  m_project.identity();
+  m_pos.set(0.0f,0.0f,0.0f);
+  m_rot.set(0.0f,0.0f,0.0f);
+  m_scale.set(1.0f,1.0f,1.0f);
+  m_dirty=ALL;
+}
+
+void TransformState::invalidate()
+{
+  m_dirty=ALL;
+  m_uploadPending=true;
+}
+
+void TransformState::beginFrame()
+{
+  m_stats=Stats();
+}
+
+void TransformState::rebuild(bool _dirty, unsigned int _count)
+{
+  if(_dirty)
+    m_stats.recomputes+=_count;
+  else
+    m_stats.cacheHits+=_count;
+}
+
+bool TransformState::update()
+{
+  unsigned int dirty=m_dirty;
+  // M is T*Rx*Ry*Rz*S built in closed form, its normal matrix comes with it as R*S^-1
+  bool modelDirty=(dirty & (TRANSLATE | ROTATE | SCALE))!=0;
+  if(modelDirty)
+  {
+    TRSCompose::compose<EulerOrder::XYZ>(m_pos,m_rot,m_scale,m_M,&m_modelNormal);
+    TRSCompose::composeReversed<EulerOrder::ZYX>(m_pos,m_rot,m_scale,m_modelDisplay);
+  }
+  rebuild(modelDirty,3);
+  // the view can be anything so it still gets a general inverse, but only when it changes
+  if(dirty & VIEW)
+  {
+    m_viewNormal=m_view;
+    m_viewNormal.inverse().transpose();
+  }
+  rebuild(dirty & VIEW);
+  // MV and the normal matrix depend on the model and the view
+  bool mvDirty=modelDirty || (dirty & VIEW);
+  if(mvDirty)
+  {
+    m_MV=m_view*m_M;
+    TRSCompose::multiply(m_viewNormal,m_modelNormal,m_normalMatrix);
+  }
+  rebuild(mvDirty,2);
+  bool mvpDirty=mvDirty || (dirty & PROJECT);
+  if(mvpDirty)
+    m_MVP=m_project*m_MV;
+  rebuild(mvpDirty);
+
+  m_dirty=0;
+  if(mvpDirty)
+    m_uploadPending=true;
+  return mvpDirty;
+}
+
+bool TransformState::needsUpload()
+{
+  if(m_uploadPending)
+    ++m_stats.uploads;
+  else
+    ++m_stats.uploadsSkipped;
+  return m_uploadPending;
+}
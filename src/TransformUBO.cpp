@@ -0,0 +1,122 @@
+#include "TransformUBO.h"
+#include <algorithm>
+#include <cstring>
+
+constexpr int TransformUBO::c_numRegions;
+constexpr GLuint TransformUBO::c_bindingPoint;
+constexpr const char *TransformUBO::c_blockName;
+
+TransformUBO::TransformUBO(size_t _maxObjects) :
+  m_maxObjects(std::max<size_t>(_maxObjects,1))
+{
+  m_fences.fill(nullptr);
+  GLint alignment=256;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT,&alignment);
+  size_t align=static_cast<size_t>(std::max(alignment,1));
+  m_stride=(sizeof(Block)+align-1)/align*align;
+
+  GLsizeiptr ringSize=static_cast<GLsizeiptr>(c_numRegions*m_maxObjects*m_stride);
+  glGenBuffers(1,&m_buffer);
+  glBindBuffer(GL_UNIFORM_BUFFER,m_buffer);
+  GLint major=0;
+  GLint minor=0;
+  glGetIntegerv(GL_MAJOR_VERSION,&major);
+  glGetIntegerv(GL_MINOR_VERSION,&minor);
+  if(major > 4 || (major==4 && minor >= 4))
+  {
+    GLbitfield flags=GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_UNIFORM_BUFFER,ringSize,nullptr,flags);
+    m_mapped=static_cast<unsigned char *>(glMapBufferRange(GL_UNIFORM_BUFFER,0,ringSize,flags));
+  }
+  if(m_mapped==nullptr)
+  {
+    glBufferData(GL_UNIFORM_BUFFER,ringSize,nullptr,GL_STREAM_DRAW);
+    m_staging.resize(m_maxObjects*m_stride);
+  }
+  glBindBuffer(GL_UNIFORM_BUFFER,0);
+}
+
+TransformUBO::~TransformUBO()
+{
+  for(auto &fence : m_fences)
+  {
+    if(fence)
+      glDeleteSync(fence);
+  }
+  if(m_mapped)
+  {
+    glBindBuffer(GL_UNIFORM_BUFFER,m_buffer);
+    glUnmapBuffer(GL_UNIFORM_BUFFER);
+  }
+  glDeleteBuffers(1,&m_buffer);
+}
+
+bool TransformUBO::bindBlock(GLuint _program)
+{
+  GLuint index=glGetUniformBlockIndex(_program,c_blockName);
+  if(index==GL_INVALID_INDEX)
+    return false;
+  glUniformBlockBinding(_program,index,c_bindingPoint);
+  return true;
+}
+
+void TransformUBO::waitForRegion(int _region)
+{
+  GLsync &fence=m_fences[static_cast<size_t>(_region)];
+  if(fence==nullptr)
+    return;
+  GLenum result=glClientWaitSync(fence,0,0);
+  while(result==GL_TIMEOUT_EXPIRED)
+    result=glClientWaitSync(fence,GL_SYNC_FLUSH_COMMANDS_BIT,1000000);
+  glDeleteSync(fence);
+  fence=nullptr;
+}
+
+void TransformUBO::begin(size_t _count)
+{
+  waitForRegion(m_region);
+  m_count=std::min(_count,m_maxObjects);
+  m_open=true;
+}
+
+void TransformUBO::set(size_t _index, const ngl::Mat4 &_MVP, const ngl::Mat4 &_MV, const ngl::Mat4 &_M, const ngl::Mat3 &_normalMatrix)
+{
+  if(_index>=m_count)
+    return;
+  unsigned char *dest=m_mapped ? m_mapped+regionOffset() : m_staging.data();
+  Block *block=reinterpret_cast<Block *>(dest+_index*m_stride);
+  std::memcpy(block->MVP,&_MVP.m_openGL[0],sizeof(block->MVP));
+  std::memcpy(block->MV,&_MV.m_openGL[0],sizeof(block->MV));
+  std::memcpy(block->M,&_M.m_openGL[0],sizeof(block->M));
+  for(int c=0; c<3; ++c)
+  {
+    block->normalMatrix[c*4+0]=_normalMatrix.m_openGL[c*3+0];
+    block->normalMatrix[c*4+1]=_normalMatrix.m_openGL[c*3+1];
+    block->normalMatrix[c*4+2]=_normalMatrix.m_openGL[c*3+2];
+    block->normalMatrix[c*4+3]=0.0f;
+  }
+}
+
+void TransformUBO::upload()
+{
+  // the mapping is coherent so the writes in set are all that is needed
+  if(m_mapped || m_count==0)
+    return;
+  glBindBuffer(GL_UNIFORM_BUFFER,m_buffer);
+  glBufferSubData(GL_UNIFORM_BUFFER,static_cast<GLintptr>(regionOffset()),static_cast<GLsizeiptr>(m_count*m_stride),m_staging.data());
+  glBindBuffer(GL_UNIFORM_BUFFER,0);
+}
+
+void TransformUBO::bind(size_t _index) const
+{
+  glBindBufferRange(GL_UNIFORM_BUFFER,c_bindingPoint,m_buffer,static_cast<GLintptr>(regionOffset()+_index*m_stride),sizeof(Block));
+}
+
+void TransformUBO::end()
+{
+  if(!m_open)
+    return;
+  m_fences[static_cast<size_t>(m_region)]=glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE,0);
+  m_region=(m_region+1)%c_numRegions;
+  m_open=false;
+}
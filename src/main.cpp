@@ -2,14 +2,117 @@
 basic OpenGL demo modified from http://qt-project.org/doc/qt-5.0/qtgui/openglwindow.html
 ****************************************************************************/
 #include <QtGui/QGuiApplication>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <ngl/NGLInit.h>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include "NGLScene.h"
+#include "OffscreenRenderer.h"
+#include "InputSession.h"
 
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a 4.5 core context on an offscreen surface with NGL loaded, for the modes with no window
+//----------------------------------------------------------------------------------------------------------------------
+bool makeOffscreenContext(QOffscreenSurface &_surface, QOpenGLContext &_context)
+{
+  QSurfaceFormat format;
+  format.setMajorVersion(4);
+  format.setMinorVersion(5);
+  format.setProfile(QSurfaceFormat::CoreProfile);
+  _surface.setFormat(format);
+  _surface.create();
+  _context.setFormat(format);
+  if(!_context.create() || !_context.makeCurrent(&_surface))
+  {
+    std::cerr<<"unable to create an OpenGL context\n";
+    return false;
+  }
+  ngl::NGLInit::instance();
+  std::cout<<"GL_RENDERER "<<glGetString(GL_RENDERER)<<'\n';
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief MVPDemo --batch script outPattern [width height]
+/// renders every frame of the script with no window, for servers run with QT_QPA_PLATFORM=offscreen
+/// (and LIBGL_ALWAYS_SOFTWARE=1 for Mesa), set MVP_MESH to draw a mesh instead of the triangle
+//----------------------------------------------------------------------------------------------------------------------
+int runBatch(int argc, char **argv)
+{
+  if(argc!=4 && argc!=6)
+  {
+    std::cerr<<"usage "<<argv[0]<<" --batch script out/frame%04d.ppm [width height]\n";
+    return EXIT_FAILURE;
+  }
+  int width = argc==6 ? std::atoi(argv[4]) : 1024;
+  int height = argc==6 ? std::atoi(argv[5]) : 720;
+  std::vector<BatchFrame> frames;
+  std::string name;
+  if(!OffscreenRenderer::frameName(argv[3],0,name))
+  {
+    std::cerr<<"output pattern "<<argv[3]<<" needs exactly one %d (e.g. out/frame%04d.ppm)\n";
+    return EXIT_FAILURE;
+  }
+  if(width<=0 || height<=0 || !OffscreenRenderer::parseScript(argv[2],frames))
+    return EXIT_FAILURE;
 
+  QOffscreenSurface surface;
+  QOpenGLContext context;
+  if(!makeOffscreenContext(surface,context))
+    return EXIT_FAILURE;
+  const char *meshFile=std::getenv("MVP_MESH");
+  OffscreenRenderer renderer(width,height,meshFile ? meshFile : "");
+  bool ok=renderer.render(frames,argv[3]);
+  const OffscreenRenderer::Stats &stats=renderer.stats();
+  std::cout<<stats.frames<<" frames "<<width<<"x"<<height<<" in "<<stats.seconds<<" s "
+           <<stats.framesPerSecond<<" fps (readback wait "<<stats.readbackWaitMs
+           <<" ms encode wait "<<stats.encodeWaitMs<<" ms)\n";
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief MVPDemo --replay session.rec report.json [--realtime] [width height]
+/// draws a session recorded with MVP_RECORD or the Y key with no window and writes the frame and
+/// stage times, as fast as possible unless --realtime is given. MVP_MESH as for --batch
+//----------------------------------------------------------------------------------------------------------------------
+int runReplay(int argc, char **argv)
+{
+  bool realtime=argc>4 && std::strcmp(argv[4],"--realtime")==0;
+  int first=realtime ? 5 : 4;
+  if(argc!=first && argc!=first+2)
+  {
+    std::cerr<<"usage "<<argv[0]<<" --replay session.rec report.json [--realtime] [width height]\n";
+    return EXIT_FAILURE;
+  }
+  int width = argc==first+2 ? std::atoi(argv[first]) : 1024;
+  int height = argc==first+2 ? std::atoi(argv[first+1]) : 720;
+  InputSession session;
+  if(width<=0 || height<=0 || !session.load(argv[2]))
+    return EXIT_FAILURE;
+
+  QOffscreenSurface surface;
+  QOpenGLContext context;
+  if(!makeOffscreenContext(surface,context))
+    return EXIT_FAILURE;
+  const char *meshFile=std::getenv("MVP_MESH");
+  OffscreenRenderer renderer(width,height,meshFile ? meshFile : "",1);
+  ReplayReport report;
+  report.session=argv[2];
+  if(!renderer.replay(session,realtime,report))
+    return EXIT_FAILURE;
+  report.print(std::cout);
+  return report.writeJSON(argv[3]) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
 
 int main(int argc, char **argv)
 {
   QGuiApplication app(argc, argv);
+  if(argc>1 && std::strcmp(argv[1],"--batch")==0)
+    return runBatch(argc,argv);
+  if(argc>1 && std::strcmp(argv[1],"--replay")==0)
+    return runReplay(argc,argv);
   // create an OpenGL format specifier
   QSurfaceFormat format;
   // set the number of samples for multisampling
@@ -0,0 +1,29 @@
+/****************************************************************************
+converts OBJ / PLY meshes to the binary format mapped by MappedMesh
+usage MeshConvert input.(obj|ply) output.mvpm
+****************************************************************************/
+#include "MeshImport.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+int main(int argc, char **argv)
+{
+  if(argc < 3)
+  {
+    std::cerr<<"usage "<<argv[0]<<" input.(obj|ply) output.mvpm\n";
+    return EXIT_FAILURE;
+  }
+  auto start=std::chrono::high_resolution_clock::now();
+  meshfile::MeshData mesh;
+  if(!meshfile::loadText(argv[1],mesh))
+    return EXIT_FAILURE;
+  auto parsed=std::chrono::high_resolution_clock::now();
+  if(!meshfile::writeMesh(argv[2],mesh))
+    return EXIT_FAILURE;
+  auto written=std::chrono::high_resolution_clock::now();
+  std::cout<<argv[1]<<" -> "<<argv[2]<<" vertices "<<mesh.vertexCount()<<" triangles "<<mesh.indices.size()/3
+           <<" parse "<<std::chrono::duration<double,std::milli>(parsed-start).count()<<" ms"
+           <<" write "<<std::chrono::duration<double,std::milli>(written-parsed).count()<<" ms\n";
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,111 @@
+/****************************************************************************
+compares a replay report from MVPDemo --replay against a stored baseline
+usage PerfCompare baseline.json current.json [tolerance]
+fails if the mean, p50 or p95 frame time or any stage average is more than
+tolerance (default 0.15) slower than the baseline, or if there is no
+baseline, those are only written by the perf_update_baseline target. The
+p99 and max times of a short replay are mostly scheduler and driver noise so
+they are printed but never fail the run
+****************************************************************************/
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+
+namespace
+{
+// small times are mostly noise so they get this much on top of the relative tolerance
+constexpr double c_slackMs=0.05;
+
+//----------------------------------------------------------------------------------------------------------------------
+// the "key": number pairs of a flat JSON object, anything else (e.g. the session name) is skipped
+//----------------------------------------------------------------------------------------------------------------------
+bool readReport(const std::string &_fname, std::map<std::string,double> &_values)
+{
+  std::ifstream file(_fname.c_str());
+  if(!file.is_open())
+    return false;
+  std::string text;
+  while(std::getline(file,text))
+  {
+    size_t open=text.find('"');
+    size_t close=text.find('"',open+1);
+    size_t colon=text.find(':',close);
+    if(open==std::string::npos || close==std::string::npos || colon==std::string::npos)
+      continue;
+    std::istringstream value(text.substr(colon+1));
+    double v;
+    if(value>>v)
+      _values[text.substr(open+1,close-open-1)]=v;
+  }
+  return true;
+}
+
+bool endsWith(const std::string &_s, const std::string &_end)
+{
+  return _s.size()>=_end.size() && _s.compare(_s.size()-_end.size(),_end.size(),_end)==0;
+}
+
+bool gated(const std::string &_key)
+{
+  return _key=="frame_mean_ms" || _key=="frame_p50_ms" || _key=="frame_p95_ms" || endsWith(_key,"_avg_ms");
+}
+} // end anon namespace
+
+int main(int argc, char **argv)
+{
+  if(argc!=3 && argc!=4)
+  {
+    std::cerr<<"usage "<<argv[0]<<" baseline.json current.json [tolerance]\n";
+    return EXIT_FAILURE;
+  }
+  double tolerance = argc==4 ? std::atof(argv[3]) : 0.15;
+  std::map<std::string,double> current;
+  if(!readReport(argv[2],current) || current.empty())
+  {
+    std::cerr<<"unable to read "<<argv[2]<<'\n';
+    return EXIT_FAILURE;
+  }
+  std::map<std::string,double> baseline;
+  if(!readReport(argv[1],baseline))
+  {
+    // a run with nothing to compare against proves nothing so it can't pass
+    std::cout<<"FAIL no baseline "<<argv[1]<<", build the perf_update_baseline target to record one\n";
+    return EXIT_FAILURE;
+  }
+
+  // a different number of frames or events means the session or replay changed, not the speed
+  bool ok=true;
+  for(auto key : {"frames","events"})
+    if(baseline[key]!=current[key])
+    {
+      std::cout<<"FAIL "<<key<<" "<<current[key]<<" baseline "<<baseline[key]<<'\n';
+      ok=false;
+    }
+  for(const auto &b : baseline)
+  {
+    if(!endsWith(b.first,"_ms"))
+      continue;
+    auto c=current.find(b.first);
+    if(c==current.end())
+    {
+      std::cout<<"FAIL "<<b.first<<" missing\n";
+      ok=false;
+      continue;
+    }
+    if(!gated(b.first))
+    {
+      std::cout<<"info "<<b.first<<' '<<c->second<<" baseline "<<b.second<<'\n';
+      continue;
+    }
+    double limit=b.second*(1.0+tolerance)+c_slackMs;
+    bool regressed=c->second>limit;
+    std::cout<<(regressed ? "FAIL " : "ok   ")<<b.first<<' '<<c->second<<" baseline "<<b.second
+             <<" limit "<<limit<<'\n';
+    ok&=!regressed;
+  }
+  std::cout<<(ok ? "no regressions\n" : "performance regressed against the baseline\n");
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,104 @@
+/****************************************************************************
+decoder for the binary traces written by FrameTrace
+usage TraceDecode trace.bin [--summary]
+****************************************************************************/
+#include "TraceFormat.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <vector>
+
+namespace
+{
+void printMatrix(const char *_name, const float *_m)
+{
+  std::printf("  %s\n",_name);
+  for(int row=0; row<4; ++row)
+    std::printf("  [ %+0.4f %+0.4f %+0.4f %+0.4f]\n",_m[row],_m[4+row],_m[8+row],_m[12+row]);
+}
+} // end anon namespace
+
+int main(int argc, char **argv)
+{
+  if(argc < 2)
+  {
+    std::cerr<<"usage "<<argv[0]<<" trace.bin [--summary]\n";
+    return EXIT_FAILURE;
+  }
+  bool summary = argc > 2 && std::strcmp(argv[2],"--summary")==0;
+  std::FILE *file=std::fopen(argv[1],"rb");
+  if(file==nullptr)
+  {
+    std::cerr<<"unable to open "<<argv[1]<<'\n';
+    return EXIT_FAILURE;
+  }
+  trace::TraceFileHeader header;
+  if(std::fread(&header,sizeof(header),1,file)!=1 || header.magic!=trace::c_magic)
+  {
+    std::cerr<<argv[1]<<" is not a frame trace\n";
+    std::fclose(file);
+    return EXIT_FAILURE;
+  }
+  if(header.version!=trace::c_version)
+    std::cerr<<"warning trace version "<<header.version<<" expected "<<trace::c_version<<'\n';
+
+  std::map<uint16_t,size_t> counts;
+  uint64_t firstFrame=0;
+  uint64_t lastFrame=0;
+  bool anyFrame=false;
+  std::vector<char> payload;
+  trace::TraceRecordHeader record;
+  while(std::fread(&record,sizeof(record),1,file)==1)
+  {
+    payload.resize(record.payloadSize);
+    if(record.payloadSize && std::fread(payload.data(),record.payloadSize,1,file)!=1)
+    {
+      std::cerr<<"truncated record\n";
+      break;
+    }
+    ++counts[record.type];
+    uint64_t frame=0;
+    if(record.payloadSize >= sizeof(uint64_t))
+      std::memcpy(&frame,payload.data(),sizeof(frame));
+    if(!anyFrame)
+      firstFrame=frame;
+    anyFrame=true;
+    lastFrame=frame;
+    if(summary)
+      continue;
+    switch(static_cast<trace::RecordType>(record.type))
+    {
+      case trace::RecordType::FRAME_MATRICES :
+      {
+        trace::MatrixRecord m;
+        std::memcpy(&m,payload.data(),sizeof(m));
+        std::printf("frame %llu matrices\n",static_cast<unsigned long long>(m.frame));
+        printMatrix("MVP",m.MVP);
+        printMatrix("M",m.M);
+        printMatrix("View",m.view);
+        printMatrix("Project",m.project);
+      }
+      break;
+      case trace::RecordType::CLIP_POINTS :
+      {
+        trace::PointsRecord p;
+        std::memcpy(&p,payload.data(),sizeof(p));
+        std::printf("frame %llu points %u\n",static_cast<unsigned long long>(p.frame),p.count);
+        const float *pt=reinterpret_cast<const float *>(payload.data()+sizeof(p));
+        for(uint32_t i=0; i<p.count; ++i, pt+=4)
+          std::printf("  pt [%f,%f,%f,%f]\n",pt[0],pt[1],pt[2],pt[3]);
+      }
+      break;
+      default :
+        std::printf("frame %llu unknown record type %u size %u\n",static_cast<unsigned long long>(frame),record.type,record.payloadSize);
+      break;
+    }
+  }
+  std::fclose(file);
+  std::printf("frames %llu to %llu\n",static_cast<unsigned long long>(firstFrame),static_cast<unsigned long long>(lastFrame));
+  for(auto &c : counts)
+    std::printf("record type %u count %zu\n",c.first,c.second);
+  return EXIT_SUCCESS;
+}